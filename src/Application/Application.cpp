@@ -186,6 +186,9 @@ void Application::Init() {
     m_BoardFEN = Board::START_FEN;
     m_BoardFEN.resize(100);
 
+    // An empty path means the built-in engine
+    m_Engines.emplace_back(std::pair{ "Built-in engine", std::filesystem::path() });
+
     FramebufferSpecification spec;
     spec.Width = m_WindowProperties.Width;
     spec.Height = m_WindowProperties.Height;
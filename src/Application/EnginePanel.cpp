@@ -76,7 +76,7 @@ void Application::RenderEnginePanel(bool* show) {
                 ImGui::PopID();
 
                 try {
-                    m_RunningEngine = Engine::Create(path);
+                    m_RunningEngine = path.empty() ? Engine::CreateInternal() : Engine::Create(path);
                     m_RunningEngine->SetUpdateCallback([this](const Engine::BestContinuation& c) { OnEngineUpdate(c); });
                     m_RunningEngine->Init();
                     m_RunningEngine->SetPosition(m_BoardFEN);
@@ -162,9 +162,13 @@ void Application::OnEngineUpdate(const Engine::BestContinuation& bestContinuatio
 
     Board moveTranslator(m_Board);
 
-    std::ostringstream continuationText;
-    for (LongAlgebraicMove m : m_BestContinuation.Continuation)
-        continuationText << moveTranslator.Move(m) << " ";
+    // Reuses the string's capacity, so updates don't allocate once it has grown to fit the PV
+    m_BestContinuationAlgebraicMoves.clear();
 
-    m_BestContinuationAlgebraicMoves = continuationText.str();
+    char buffer[AlgebraicMove::MAX_STRING_LENGTH + 1];
+    for (LongAlgebraicMove m : m_BestContinuation.Continuation) {
+        char* end = moveTranslator.Move(m).WriteTo(buffer);
+        *(end++) = ' ';
+        m_BestContinuationAlgebraicMoves.append(buffer, end);
+    }
 }
@@ -1,10 +1,14 @@
 #include "Move.h"
 
-static char s_Promotions[] = " NBRQEEE";  // E for error lol
+#include <algorithm>
 
-std::string LongAlgebraicMove::ToString() noexcept {
-	char result[5]; // source square + destination square + possible promotion
-	char* ptr = result;
+static char s_Promotions[] = " nbrqeee";  // e for error lol
+
+// UTF-8 encoded figurines (♙♘♗♖♕♔), indexed by PieceType
+static const char* s_Figurines[] = { "\xE2\x99\x99", "\xE2\x99\x98", "\xE2\x99\x97", "\xE2\x99\x96", "\xE2\x99\x95", "\xE2\x99\x94" };
+
+char* LongAlgebraicMove::WriteTo(char* buffer) const noexcept {
+	char* ptr = buffer;
 
 	*(ptr++) = (char)('a' + FileOf(SourceSquare));
 	*(ptr++) = (char)('1' + RankOf(SourceSquare));
@@ -14,167 +18,198 @@ std::string LongAlgebraicMove::ToString() noexcept {
 	if (Promotion != Pawn && Promotion != King)
 		*(ptr++) = s_Promotions[Promotion];
 
-	return { result, ptr };
+	return ptr;
 }
 
+std::string LongAlgebraicMove::ToString() const noexcept {
+	char result[MAX_STRING_LENGTH]; // source square + destination square + possible promotion
+	return { result, WriteTo(result) };
+}
+
+static bool IsFile(char c) { return c >= 'a' && c <= 'h'; }
+static bool IsRank(char c) { return c >= '1' && c <= '8'; }
+
 AlgebraicMove::AlgebraicMove(std::string_view str) {
-	bool error = false;
-	
-	char* fromFront = (char*)&str.front();
-	char* fromBack = (char*)&str.back();
+	// Every character is checked before it is used, so text from a file can't make a square outside the board
+	std::string_view san = str;
 
-	if (*fromBack == '#') {
+	if (!san.empty() && san.back() == '#') {
 		Flags |= MoveFlag::Checkmate;
-		fromBack--;
-	} else if (*fromBack == '+') {
+		san.remove_suffix(1);
+	} else if (!san.empty() && san.back() == '+') {
 		Flags |= MoveFlag::Check;
-		fromBack--;
+		san.remove_suffix(1);
 	}
 
-	const std::string_view castle(fromFront, fromBack - fromFront + 1);
-
-	if (castle == "O-O-O") {
+	if (san == "O-O-O") {
 		Flags |= MoveFlag::CastleQueenSide;
 		return;
 	}
 	
-	if (castle == "O-O") {
+	if (san == "O-O") {
 		Flags |= MoveFlag::CastleKingSide;
 		return;
 	}
+
+	if (san.size() < 2)
+		throw InvalidAlgebraicMoveException(str);
 	
-	if (std::islower(str[0])) {  // Pawn
-		if (str[1] == 'x') {  // Capture
-			char file = str[0];  // The 'a' in something like 'axb7'
+	if (IsFile(san[0])) {  // Pawn
+		size_t next;
+
+		if (san[1] == 'x') {  // Capture
+			if (san.size() < 4 || !IsFile(san[2]) || !IsRank(san[3]))
+				throw InvalidAlgebraicMoveException(str);
+
+			// The 'a' in something like 'axb7'
 			// Technically we could calculate the rank of the pawn
 			// But it is not necessary, so just add '1'
-			Specifier = ToSquare(file, '1');
+			Specifier = ToSquare(san[0], '1');
 			Specifier |= SpecifyFile;
 
 			Flags |= MoveFlag::Capture;
 
-			Destination = ToSquare(str[2], str[3]);
-			fromFront += 4;
+			Destination = ToSquare(san[2], san[3]);
+			next = 4;
 		} else {
-			Destination = ToSquare(str[0], str[1]);
-			fromFront += 2;
+			if (!IsRank(san[1]))
+				throw InvalidAlgebraicMoveException(str);
+
+			Destination = ToSquare(san[0], san[1]);
+			next = 2;
 		}
 
-		// Promotion
-		if (*fromFront == '=') {
-			char promotion = *(++fromFront);
+		// Promotion, which has to be the end of the move
+		if (next < san.size()) {
+			if (san.size() != next + 2 || san[next] != '=')
+				throw InvalidAlgebraicMoveException(str);
 
-			switch (promotion) {
+			switch (san[next + 1]) {
 				case 'N': Flags |= MoveFlag::PromoteKnight; break;
 				case 'B': Flags |= MoveFlag::PromoteBishop; break;
 				case 'R': Flags |= MoveFlag::PromoteRook; break;
 				case 'Q': Flags |= MoveFlag::PromoteQueen; break;
-				default: error = true;
+				default: throw InvalidAlgebraicMoveException(str);
 			}
 		}
 	} else {  // Not a pawn
-		MovingPiece = CharToPieceType(str[0]);
+		switch (san[0]) {
+			case 'N': case 'B': case 'R': case 'Q': case 'K': break;
+			default: throw InvalidAlgebraicMoveException(str);
+		}
 
-		++fromFront;
+		MovingPiece = CharToPieceType(san[0]);
 
-		char rank = *(fromBack--);
-		char file = *(fromBack--);
-		Destination = ToSquare(file, rank);
+		if (san.size() < 3 || !IsFile(san[san.size() - 2]) || !IsRank(san.back()))
+			throw InvalidAlgebraicMoveException(str);
+
+		Destination = ToSquare(san[san.size() - 2], san.back());
 
 		// Capture
-		if (*fromBack == 'x')
-			fromBack--;
+		size_t end = san.size() - 2;
+		if (end > 1 && san[end - 1] == 'x')
+			end--;
 
 		// The only thing left is the square specifier
 		// N'b'd4, N'3'd4, or N'b3'd4
-		const uint64_t length = fromBack - fromFront + 1;
-		if (length == 1) {
+		const std::string_view specifier = san.substr(1, end - 1);
+		if (specifier.size() == 1) {
 			// We don't know the other coordinate (rank or file)
 			// So just add 'a' or '1'
-			if (std::isalpha(*fromFront)) {
-				Specifier = ToSquare(*fromFront, '1');
+			if (IsFile(specifier[0])) {
+				Specifier = ToSquare(specifier[0], '1');
 				Specifier |= SpecifyFile;
-			} else if (std::isdigit(*fromFront)) {
-				Specifier = ToSquare('a', *fromFront);
+			} else if (IsRank(specifier[0])) {
+				Specifier = ToSquare('a', specifier[0]);
 				Specifier |= SpecifyRank;
 			} else {
-				error = true;
+				throw InvalidAlgebraicMoveException(str);
 			}
-		} else if (length == 2) {
-			file = *(fromFront);
-			rank = *(++fromFront);
-			Specifier = ToSquare(file, rank);
+		} else if (specifier.size() == 2) {
+			if (!IsFile(specifier[0]) || !IsRank(specifier[1]))
+				throw InvalidAlgebraicMoveException(str);
+
+			Specifier = ToSquare(specifier[0], specifier[1]);
 			Specifier |= SpecifyFile | SpecifyRank;
-		} else if (length != 0) {
-			error = true;
+		} else if (specifier.size() != 0) {
+			throw InvalidAlgebraicMoveException(str);
 		}
 	}
-
-	if (error)
-		throw InvalidAlgebraicMoveException(str);
 }
 
-std::string AlgebraicMove::ToString() noexcept {
-	if (Flags & MoveFlag::CastleKingSide) {
-		if (Flags & MoveFlag::Check)
-			return "O-O+";
-		if (Flags & MoveFlag::Checkmate)
-			return "O-O#";
-		return "O-O";
+// Writes the piece letter (NBRQK) or its figurine
+static char* WritePiece(char* ptr, PieceType type, bool figurine) {
+	if (!figurine) {
+		*(ptr++) = PieceTypeToChar(type);
+		return ptr;
 	}
 
-	if (Flags & MoveFlag::CastleQueenSide) {
-		if (Flags & MoveFlag::Check)
-			return "O-O-O+";
-		if (Flags & MoveFlag::Checkmate)
-			return "O-O-O#";
-		return "O-O-O";
-	}
-
-	// Longest possible string is 7 characters (ex. axb8=N+, Qf3xh3#)
-	char result[7];
-	char* ptr = result;
-	
-	if (MovingPiece != Pawn) {
-		// Gets the piece type (NBRQK)
-		*(ptr++) = PieceTypeToChar(MovingPiece);
+	for (const char* c = s_Figurines[type]; *c; c++)
+		*(ptr++) = *c;
 
-		// Gets the specifier (like the 'b' in 'Nbd2')
-
-		// If the specefier is a file (for example: 'Nbd2')
-		if (Specifier & SpecifyFile)
-			*(ptr++) = (char)('a' + FileOf(Specifier & RemoveSpecifierFlag));
+	return ptr;
+}
 
-		// If the specefier is a rank (for example: 'N1d2')
-		if (Specifier & SpecifyRank)
-			*(ptr++) = (char)('1' + RankOf(Specifier & RemoveSpecifierFlag));
-	}
+static char* WriteAlgebraic(const AlgebraicMove& m, char* ptr, bool figurine) {
+	if (m.Flags & MoveFlag::CastlingFlags) {
+		constexpr std::string_view castle = "O-O-O";
+		const size_t length = (m.Flags & MoveFlag::CastleKingSide) ? 3 : 5;
+		ptr = std::copy(castle.data(), castle.data() + length, ptr);
+	} else {
+		if (m.MovingPiece != Pawn) {
+			// Gets the piece type (NBRQK)
+			ptr = WritePiece(ptr, m.MovingPiece, figurine);
+
+			// Gets the specifier (like the 'b' in 'Nbd2')
+
+			// If the specefier is a file (for example: 'Nbd2')
+			if (m.Specifier & SpecifyFile)
+				*(ptr++) = (char)('a' + FileOf(m.Specifier & RemoveSpecifierFlag));
+
+			// If the specefier is a rank (for example: 'N1d2')
+			if (m.Specifier & SpecifyRank)
+				*(ptr++) = (char)('1' + RankOf(m.Specifier & RemoveSpecifierFlag));
+		}
 
-	// Adds an 'x' for a capture
-	if (Flags & MoveFlag::Capture) {
-		// gets the 'a' in something like 'axb7'
-		if (MovingPiece == Pawn)
-			*(ptr++) = (char)('a' + FileOf(Specifier & RemoveSpecifierFlag));
+		// Adds an 'x' for a capture
+		if (m.Flags & MoveFlag::Capture) {
+			// gets the 'a' in something like 'axb7'
+			if (m.MovingPiece == Pawn)
+				*(ptr++) = (char)('a' + FileOf(m.Specifier & RemoveSpecifierFlag));
 
-		*(ptr++) = 'x';
-	}
+			*(ptr++) = 'x';
+		}
 
-	// The destination square
-	*(ptr++) = (char)('a' + FileOf(Destination));
-	*(ptr++) = (char)('1' + RankOf(Destination));
+		// The destination square
+		*(ptr++) = (char)('a' + FileOf(m.Destination));
+		*(ptr++) = (char)('1' + RankOf(m.Destination));
 
-	// Promotion
-	if (Flags & MoveFlag::PromotionFlags) {
-		*(ptr++) = '=';
+		// Promotion
+		if (m.Flags & MoveFlag::PromotionFlags) {
+			*(ptr++) = '=';
 
-		// Uses the promotion-flag as an index
-		*(ptr++) = s_Promotions[(Flags & 0b111)];
+			// Uses the promotion-flag as an index
+			ptr = WritePiece(ptr, (PieceType)(m.Flags & MoveFlag::PromotionFlags), figurine);
+		}
 	}
 
-	if (Flags & MoveFlag::Checkmate)
+	if (m.Flags & MoveFlag::Checkmate)
 		*(ptr++) = '#';
-	else if (Flags & MoveFlag::Check)
+	else if (m.Flags & MoveFlag::Check)
 		*(ptr++) = '+';
 
-	return { result, ptr };
+	return ptr;
+}
+
+char* AlgebraicMove::WriteTo(char* buffer) const noexcept {
+	return WriteAlgebraic(*this, buffer, false);
+}
+
+char* AlgebraicMove::WriteFigurineTo(char* buffer) const noexcept {
+	return WriteAlgebraic(*this, buffer, true);
+}
+
+std::string AlgebraicMove::ToString() const noexcept {
+	char result[MAX_STRING_LENGTH];
+	return { result, WriteTo(result) };
 }
@@ -4,55 +4,41 @@
 
 #include "Utility/StringParser.h"
 
+#include <algorithm>
 #include <sstream>
 
-static constexpr std::array<Piece, 64> s_StartBoard = {
-    WhiteRook, WhiteKnight, WhiteBishop, WhiteQueen, WhiteKing, WhiteBishop, WhiteKnight, WhiteRook,
-    WhitePawn, WhitePawn,   WhitePawn,   WhitePawn,  WhitePawn, WhitePawn,   WhitePawn,   WhitePawn,
-    None,      None,        None,        None,       None,      None,        None,        None,
-    None,      None,        None,        None,       None,      None,        None,        None,
-    None,      None,        None,        None,       None,      None,        None,        None,
-    None,      None,        None,        None,       None,      None,        None,        None,
-    BlackPawn, BlackPawn,   BlackPawn,   BlackPawn,  BlackPawn, BlackPawn,   BlackPawn,   BlackPawn,
-    BlackRook, BlackKnight, BlackBishop, BlackQueen, BlackKing, BlackBishop, BlackKnight, BlackRook
-};
-
-static constexpr std::array<BitBoard, PieceTypeCount> s_PieceBitBoards = {
-    0b0000000011111111000000000000000000000000000000001111111100000000,  // Pawns
-    0b0100001000000000000000000000000000000000000000000000000001000010,  // Knights
-    0b0010010000000000000000000000000000000000000000000000000000100100,  // Bishops
-    0b1000000100000000000000000000000000000000000000000000000010000001,  // Rooks
-    0b0000100000000000000000000000000000000000000000000000000000001000,  // Queens
-    0b0001000000000000000000000000000000000000000000000000000000010000   // Kings
-};
-
-static constexpr std::array<BitBoard, ColourCount> s_ColourBitBoards = {
-    0b0000000000000000000000000000000000000000000000001111111111111111,  // White Pieces
-    0b1111111111111111000000000000000000000000000000000000000000000000   // Black pieces
-};
-
 static constexpr std::array<BitBoard, 4> s_CastlingPaths = {
 	0x70, 0x70ull << 56, 0xE, 0xEull << 56
 };
 
 void Board::Reset() {
-    m_Board = s_StartBoard;
-    m_PieceBitBoards = s_PieceBitBoards;
-    m_ColourBitBoards = s_ColourBitBoards;
+    // The start position is set up once (with its hash and scores), then copied
+    static const Board start(START_FEN);
+    *this = start;
+}
 
-    m_PlayerTurn = White;
-    m_CastlingPath = s_CastlingPaths;
+void Board::Clear(Colour playerTurn) {
+    m_Board.fill(Piece::None);
+    m_PieceBitBoards.fill(0);
+    m_ColourBitBoards.fill(0);
+    m_CastlingPath.fill(CastleSide::NO_CASTLE);
     m_EnPassantSquare = 0;
+    m_PieceHash = 0;
 
+    m_PlayerTurn = playerTurn;
     m_HalfMoves = 0;
     m_FullMoves = 1;
+
+#if !defined(CHESS_NO_EVALUATION)
+    m_Material.fill(0);
+    m_MidgameScore.fill(0);
+    m_EndgameScore.fill(0);
+    m_Phase = 0;
+#endif
 }
 
 void Board::FromFEN(const std::string& fen) {
-    m_Board.fill(Piece::None);
-    m_PieceBitBoards.fill(0);
-    m_ColourBitBoards.fill(0);
-    m_CastlingPath.fill(CastleSide::NO_CASTLE);
+    Clear();
 
     StringParser fenParser(fen);
 
@@ -172,6 +158,47 @@ std::string Board::ToFEN() const {
 	return fen.str();
 }
 
+void Board::ToPacked(uint8_t* data) const {
+    for (Square s = 0; s < 64; s += 2)
+        data[s / 2] = (uint8_t)(m_Board[s] | m_Board[s + 1] << 4);
+
+    uint8_t castling = 0;
+    for (size_t i = 0; i < m_CastlingPath.size(); i++)
+        castling |= (m_CastlingPath[i] != NO_CASTLE) << i;
+
+    data[32] = (uint8_t)(m_PlayerTurn | castling << 1);
+    data[33] = m_EnPassantSquare;
+
+    for (int i = 0; i < 4; i++) {
+        data[PACKED_COUNTERS + i] = (uint8_t)(m_HalfMoves >> (8 * i));
+        data[PACKED_COUNTERS + 4 + i] = (uint8_t)(m_FullMoves >> (8 * i));
+    }
+}
+
+void Board::FromPacked(const uint8_t* data) {
+    Clear((Colour)(data[32] & 1));
+
+    for (Square s = 0; s < 64; s += 2) {
+        if (data[s / 2] == (Piece::None | Piece::None << 4))
+            continue;
+
+        for (Square i = 0; i < 2; i++) {
+            const Piece p = (Piece)((data[s / 2] >> (4 * i)) & 0xF);
+            if (p < Piece::None && GetPieceType(p) < PieceTypeCount)
+                PlacePiece(p, s + i);
+        }
+    }
+
+    for (size_t i = 0; i < m_CastlingPath.size(); i++)
+        if (data[32] & (2 << i))
+            m_CastlingPath[i] = s_CastlingPaths[i];
+
+    m_EnPassantSquare = data[33] & 0x3F;
+    const uint8_t* counters = data + PACKED_COUNTERS;
+    m_HalfMoves = (int32_t)(counters[0] | counters[1] << 8 | counters[2] << 16 | (uint32_t)counters[3] << 24);
+    m_FullMoves = (int32_t)(counters[4] | counters[5] << 8 | counters[6] << 16 | (uint32_t)counters[7] << 24);
+}
+
 AlgebraicMove Board::Move(LongAlgebraicMove m) {
     Piece piece = m_Board[m.SourceSquare];
     Colour colour = GetColour(piece);
@@ -215,7 +242,7 @@ AlgebraicMove Board::Move(LongAlgebraicMove m) {
             newEnPassantSquare = m.DestinationSquare + 8;
         } else if (m.DestinationSquare - m.SourceSquare == 16) {  // If white pushed pawn two squares
             newEnPassantSquare = m.DestinationSquare - 8;
-        } else if (m.DestinationSquare == m_EnPassantSquare) {  // If taking en passant
+        } else if (m.DestinationSquare == m_EnPassantSquare && m_EnPassantSquare != 0) {  // If taking en passant
             // Remove the en passant-ed pawn
             if (colour == White)
                 RemovePiece(m.DestinationSquare - 8);
@@ -234,14 +261,8 @@ AlgebraicMove Board::Move(LongAlgebraicMove m) {
     m_EnPassantSquare = newEnPassantSquare;
 
     // If a rook moves or is captured, remove castling rights accordingly
-    if (m.SourceSquare == A1 || m.DestinationSquare == A1)
-        m_CastlingPath[White | QueenSide] = NO_CASTLE;
-    else if (m.SourceSquare == H1 || m.DestinationSquare == H1)
-        m_CastlingPath[White | KingSide] = NO_CASTLE;
-    else if (m.SourceSquare == A8 || m.DestinationSquare == A8)
-        m_CastlingPath[Black | QueenSide] = NO_CASTLE;
-    else if (m.SourceSquare == H8 || m.DestinationSquare == H8)
-        m_CastlingPath[Black | KingSide] = NO_CASTLE;
+    ClearCastlingRights(m.SourceSquare);
+    ClearCastlingRights(m.DestinationSquare);
 
     m_HalfMoves = (m_HalfMoves + 1) * !(pawnMove || capture);  // Increments if no pawn move or capture, sets to 0 otherwise
     m_FullMoves += m_PlayerTurn == Black;
@@ -273,13 +294,16 @@ AlgebraicMove Board::Move(LongAlgebraicMove m) {
                 possiblePieces &= ~(1ull << GetSquare(b));
         }
 
-        // Map everything to the first rank and check if there is more than one piece
-        if (SquareCount((possiblePieces * 0x0101010101010101) >> 56) > 1)
-            specifier |= SpecifyFile;
-
-        // On the same file
-        if (BitBoardFile(m.SourceSquare) & possiblePieces & ~(1ull << m.SourceSquare))
-            specifier |= SpecifyRank;
+        // The file is enough if none of the others are on the same file, then the rank, otherwise both
+        const BitBoard others = possiblePieces & ~(1ull << m.SourceSquare);
+        if (others) {
+            if (!(others & BitBoardFile(m.SourceSquare)))
+                specifier |= SpecifyFile;
+            else if (!(others & BitBoardRank(m.SourceSquare)))
+                specifier |= SpecifyRank;
+            else
+                specifier |= SpecifyFile | SpecifyRank;
+        }
     }
 
     // Next player's turn
@@ -313,18 +337,15 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
 	if (m.Flags & MoveFlag::CastlingFlags) {
         Square kingStart = E1 ^ (m_PlayerTurn * 0b00111000);
 		Square kingDestination, rookStart, rookDestination;
-        CastleSide castleSide;
 
         if (m.Flags & MoveFlag::CastleKingSide) {
             kingDestination = G1 ^ (m_PlayerTurn * 0b00111000);
             rookStart       = H1 ^ (m_PlayerTurn * 0b00111000);
             rookDestination = F1 ^ (m_PlayerTurn * 0b00111000);
-            castleSide = KingSide;
         } else {
             kingDestination = C1 ^ (m_PlayerTurn * 0b00111000);
             rookStart       = A1 ^ (m_PlayerTurn * 0b00111000);
             rookDestination = D1 ^ (m_PlayerTurn * 0b00111000);
-            castleSide = QueenSide;
         }
         
         if (IsMoveLegal({ kingStart, kingDestination })) {
@@ -337,8 +358,12 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
             PlacePiece(PieceTypeAndColour(Rook, m_PlayerTurn), rookDestination);
 
             // Nullify castling rights
-            m_CastlingPath[m_PlayerTurn | castleSide] = NO_CASTLE;
+            m_CastlingPath[m_PlayerTurn | KingSide] = NO_CASTLE;
+            m_CastlingPath[m_PlayerTurn | QueenSide] = NO_CASTLE;
 
+            m_EnPassantSquare = 0;
+            m_HalfMoves++;
+            m_FullMoves += m_PlayerTurn == Black;
             m_PlayerTurn = opponentColour;
             return { kingStart, kingDestination };
         }
@@ -352,7 +377,7 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
             source = GetSquare(possiblePieces & BitBoardFile(file));
             
             // Remove the en passant-ed pawn if taking en passant
-            if (m.Destination == m_EnPassantSquare)
+            if (m.Destination == m_EnPassantSquare && m_EnPassantSquare != 0)
                 RemovePiece(m.Destination - direction);
         } else {  // Pawn push
             source = m.Destination - direction;
@@ -366,26 +391,33 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
                 newEnPassantSquare = source;
                 source -= direction;  // Move 'source' further back one square
             }
+        }
 
-            if ((1ull << m.Destination) & 0xFF000000000000FFull) {
-                PieceType type = (PieceType)(m.Flags & MoveFlag::PromotionFlags);
-
-                if (!type)
-                    throw IllegalMoveException(m.ToString(), "Must promote pawn");
+        // Promotion (by a push or a capture)
+        if ((1ull << m.Destination) & 0xFF000000000000FFull) {
+            PieceType type = (PieceType)(m.Flags & MoveFlag::PromotionFlags);
 
-                if (!IsMoveLegal({ source, m.Destination }))
-                    throw IllegalMoveException(m.ToString());
-                
-                // Move the piece
-                RemovePiece(source);
-                // We have to erase the piece from the bit boards before we capture it
-                RemovePiece(m.Destination);
-                PlacePiece(PieceTypeAndColour(type, m_PlayerTurn), m.Destination);
+            if (!type)
+                throw IllegalMoveException(m.ToString(), "Must promote pawn");
 
-                m_PlayerTurn = opponentColour;
+            if (!IsMoveLegal({ source, m.Destination }))
+                throw IllegalMoveException(m.ToString());
+            
+            // Capturing a rook in the corner removes castling rights
+            ClearCastlingRights(m.Destination);
+
+            // Move the piece
+            RemovePiece(source);
+            // We have to erase the piece from the bit boards before we capture it
+            RemovePiece(m.Destination);
+            PlacePiece(PieceTypeAndColour(type, m_PlayerTurn), m.Destination);
+
+            m_EnPassantSquare = 0;
+            m_HalfMoves = 0;
+            m_FullMoves += m_PlayerTurn == Black;
+            m_PlayerTurn = opponentColour;
 
-                return { source, m.Destination, type };
-            }
+            return { source, m.Destination, type };
         }
 	} else {  // Normal piece
         // All of the same type of piece that can go to the same square
@@ -403,10 +435,10 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
         
         // Prune the pieces that are not specified
         if (m.Specifier & SpecifyFile)
-            possiblePieces &= BitBoardFile(m.Specifier);
+            possiblePieces &= BitBoardFile(m.Specifier & RemoveSpecifierFlag);
 
         if (m.Specifier & SpecifyRank)
-            possiblePieces &= BitBoardRank(m.Specifier);
+            possiblePieces &= BitBoardRank(m.Specifier & RemoveSpecifierFlag);
 
         // Prune the pinned pieces
         for (BitBoard b = possiblePieces; b != 0; b &= b - 1) {
@@ -424,21 +456,24 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
         source = GetSquare(possiblePieces);
 	}
     
-    // If a rook moves or is captured, remove castling rights accordingly
-    if (source == A1 || m.Destination == A1)
-        m_CastlingPath[White | QueenSide] = NO_CASTLE;
-    else if (source == H1 || m.Destination == H1)
-        m_CastlingPath[White | KingSide] = NO_CASTLE;
-    else if (source == A8 || m.Destination == A8)
-        m_CastlingPath[Black | QueenSide] = NO_CASTLE;
-    else if (source == H8 || m.Destination == H8)
-        m_CastlingPath[Black | KingSide] = NO_CASTLE;
-
     if (!IsMoveLegal({ source, m.Destination }))
         throw IllegalMoveException(m.ToString());
 
+    // If the king or a rook moves or a rook is captured, remove castling rights accordingly
+    if (m.MovingPiece == King) {
+        m_CastlingPath[m_PlayerTurn | KingSide] = NO_CASTLE;
+        m_CastlingPath[m_PlayerTurn | QueenSide] = NO_CASTLE;
+    }
+
+    ClearCastlingRights(source);
+    ClearCastlingRights(m.Destination);
+
     m_EnPassantSquare = newEnPassantSquare;
 
+    const bool capture = m_Board[m.Destination] != Piece::None || (m.Flags & MoveFlag::Capture);
+    m_HalfMoves = (m_HalfMoves + 1) * !(m.MovingPiece == Pawn || capture);
+    m_FullMoves += m_PlayerTurn == Black;
+
     Piece piece = m_Board[source];
     // Move the piece
     RemovePiece(source);
@@ -453,6 +488,7 @@ LongAlgebraicMove Board::Move(AlgebraicMove m) {
 
 void Board::UndoMove(const GameMove& move) {
     m_PlayerTurn = OppositeColour(m_PlayerTurn);
+    m_FullMoves -= m_PlayerTurn == Black;
 
     // Deal with castling first, since "move"'s other fields are
     // undefined when castling is set during the AlgebraicMove() constructor
@@ -467,7 +503,7 @@ void Board::UndoMove(const GameMove& move) {
             	PlacePiece(WhiteRook, H1);
             	PlacePiece(WhiteKing, E1);
                 m_CastlingPath[White | KingSide]  = s_CastlingPaths[White | KingSide];
-                m_CastlingPath[White | QueenSide] = otherSide * s_CastlingPaths[White | QueenSide];
+                m_CastlingPath[White | QueenSide] = otherSide ? s_CastlingPaths[White | QueenSide] : NO_CASTLE;
             	return;
             }
             case GameMoveFlag::CastleWhiteQueenSide:
@@ -476,7 +512,7 @@ void Board::UndoMove(const GameMove& move) {
                 RemovePiece(D1);
                 PlacePiece(WhiteRook, A1);
             	PlacePiece(WhiteKing, E1);
-                m_CastlingPath[White | KingSide]  = otherSide * s_CastlingPaths[White | KingSide];
+                m_CastlingPath[White | KingSide]  = otherSide ? s_CastlingPaths[White | KingSide] : NO_CASTLE;
                 m_CastlingPath[White | QueenSide] = s_CastlingPaths[White | QueenSide];
             	return;
             }
@@ -487,7 +523,7 @@ void Board::UndoMove(const GameMove& move) {
                 PlacePiece(BlackRook, H8);
             	PlacePiece(BlackKing, E8);
                 m_CastlingPath[Black | KingSide]  = s_CastlingPaths[Black | KingSide];
-                m_CastlingPath[Black | QueenSide] = otherSide * s_CastlingPaths[Black | QueenSide];
+                m_CastlingPath[Black | QueenSide] = otherSide ? s_CastlingPaths[Black | QueenSide] : NO_CASTLE;
             	return;
             }
             case GameMoveFlag::CastleBlackQueenSide:
@@ -496,7 +532,7 @@ void Board::UndoMove(const GameMove& move) {
                 RemovePiece(D8);
                 PlacePiece(BlackRook, A8);
             	PlacePiece(BlackKing, E8);
-                m_CastlingPath[Black | KingSide]  = otherSide * s_CastlingPaths[Black | KingSide];
+                m_CastlingPath[Black | KingSide]  = otherSide ? s_CastlingPaths[Black | KingSide] : NO_CASTLE;
                 m_CastlingPath[Black | QueenSide] = s_CastlingPaths[Black | QueenSide];
             	return;
             }
@@ -520,39 +556,334 @@ void Board::UndoMove(const GameMove& move) {
         PlacePiece(move.DestinationPiece, move.Destination);
 }
 
-bool Board::HasLegalMoves(Colour colour) {
-    for (Square s = 0; s < m_Board.size(); s++)
-        if (GetColour(m_Board[s]) == colour)
-            if (GetPieceLegalMoves(s) != 0)
-                return true;
+void Board::MakeMove(LongAlgebraicMove m, UndoInfo& undo) {
+    Piece piece = m_Board[m.SourceSquare];
+    Colour colour = GetColour(piece);
+    PieceType pieceType = GetPieceType(piece);
+
+    undo.Move = m;
+    undo.MovingPiece = piece;
+    undo.CapturedPiece = m_Board[m.DestinationSquare];
+    undo.EnPassant = false;
+    undo.EnPassantSquare = m_EnPassantSquare;
+    undo.HalfMoves = m_HalfMoves;
+    undo.CastlingPath = m_CastlingPath;
+
+    Square newEnPassantSquare = 0;
+
+    if (pieceType == King) {
+        int direction = m.DestinationSquare - m.SourceSquare;
+
+        // Move the rook if castling (the king is moved below)
+        if (direction == 2) {
+            RemovePiece(m.SourceSquare + 3);
+            PlacePiece(PieceTypeAndColour(Rook, colour), m.DestinationSquare - 1);
+        } else if (direction == -2) {
+            RemovePiece(m.SourceSquare - 4);
+            PlacePiece(PieceTypeAndColour(Rook, colour), m.DestinationSquare + 1);
+        }
+
+        m_CastlingPath[colour | KingSide] = NO_CASTLE;
+        m_CastlingPath[colour | QueenSide] = NO_CASTLE;
+    } else if (pieceType == Pawn) {
+        if (abs(m.DestinationSquare - m.SourceSquare) == 16) {
+            newEnPassantSquare = (m.SourceSquare + m.DestinationSquare) / 2;
+        } else if (m.DestinationSquare == m_EnPassantSquare && m_EnPassantSquare != 0) {
+            RemovePiece(colour == White ? m.DestinationSquare - 8 : m.DestinationSquare + 8);
+            undo.EnPassant = true;
+        } else if ((1ull << m.DestinationSquare) & 0xFF000000000000FF) {
+            piece = PieceTypeAndColour(m.Promotion, colour);
+        }
+    }
+
+    ClearCastlingRights(m.SourceSquare);
+    ClearCastlingRights(m.DestinationSquare);
+
+    m_EnPassantSquare = newEnPassantSquare;
+
+    const bool capture = undo.CapturedPiece != Piece::None || undo.EnPassant;
+    m_HalfMoves = (m_HalfMoves + 1) * !(pieceType == Pawn || capture);
+    m_FullMoves += colour == Black;
+    m_PlayerTurn = OppositeColour(colour);
+
+    RemovePiece(m.SourceSquare);
+    RemovePiece(m.DestinationSquare);
+    PlacePiece(piece, m.DestinationSquare);
+}
+
+bool Board::TryMakeMove(LongAlgebraicMove m, UndoInfo& undo) {
+    // A king is never captured, even from a position that is set up wrong
+    const Piece piece = m_Board[m.SourceSquare];
+    if (piece == Piece::None || GetColour(piece) != m_PlayerTurn || (m_PieceBitBoards[King] & (1ull << m.DestinationSquare)))
+        return false;
+
+    const PieceType type = GetPieceType(piece);
+    const bool promotes = type == Pawn && ((1ull << m.DestinationSquare) & 0xFF000000000000FF);
+    if (promotes ? m.Promotion < Knight || m.Promotion > Queen : m.Promotion != Pawn)
+        return false;
+
+    // Castling is checked like the legal moves, as it can't go through check,
+    // the other moves are checked for the king being left in check after they are made
+    if (type == King && abs(m.DestinationSquare - m.SourceSquare) == 2) {
+        if (!(GetKingLegalMoves(m.SourceSquare, ControlledSquares(OppositeColour(m_PlayerTurn))) & (1ull << m.DestinationSquare)))
+            return false;
+
+        MakeMove(m, undo);
+        return true;
+    }
+
+    if (!(GetPseudoLegalMoves(m.SourceSquare) & (1ull << m.DestinationSquare)))
+        return false;
+
+    MakeMove(m, undo);
+
+    const Colour colour = GetColour(piece);
+    if (AttackersTo(GetSquare(m_ColourBitBoards[colour] & m_PieceBitBoards[King]), m_PlayerTurn) != 0) {
+        UnmakeMove(undo);
+        return false;
+    }
+
+    return true;
+}
+
+void Board::UnmakeMove(const UndoInfo& undo) {
+    const LongAlgebraicMove m = undo.Move;
+    const Colour colour = GetColour(undo.MovingPiece);
+
+    RemovePiece(m.DestinationSquare);
+    PlacePiece(undo.MovingPiece, m.SourceSquare);
+
+    if (undo.CapturedPiece != Piece::None)
+        PlacePiece(undo.CapturedPiece, m.DestinationSquare);
+
+    if (undo.EnPassant)
+        PlacePiece(PieceTypeAndColour(Pawn, OppositeColour(colour)), colour == White ? m.DestinationSquare - 8 : m.DestinationSquare + 8);
+
+    // Move the rook back if castling
+    if (GetPieceType(undo.MovingPiece) == King) {
+        int direction = m.DestinationSquare - m.SourceSquare;
+
+        if (direction == 2) {
+            RemovePiece(m.DestinationSquare - 1);
+            PlacePiece(PieceTypeAndColour(Rook, colour), m.SourceSquare + 3);
+        } else if (direction == -2) {
+            RemovePiece(m.DestinationSquare + 1);
+            PlacePiece(PieceTypeAndColour(Rook, colour), m.SourceSquare - 4);
+        }
+    }
+
+    m_EnPassantSquare = undo.EnPassantSquare;
+    m_HalfMoves = undo.HalfMoves;
+    m_CastlingPath = undo.CastlingPath;
+    m_FullMoves -= colour == Black;
+    m_PlayerTurn = colour;
+}
+
+bool Board::HasLegalMoves(Colour colour) const {
+    for (BitBoard pieces = m_ColourBitBoards[colour]; pieces != 0; pieces &= pieces - 1)
+        if (GetPieceLegalMoves(GetSquare(pieces)) != 0)
+            return true;
 
     return false;
 }
 
-BitBoard Board::GetPieceLegalMoves(Square piece) {
+BitBoard Board::GetPieceLegalMoves(Square piece) const {
+    if (m_Board[piece] == Piece::None)
+        return 0;
+
     Colour playerColour = GetColour(m_Board[piece]);
-    Colour enemyColour = OppositeColour(playerColour);
 
-    if (enemyColour == m_PlayerTurn)
+    if (playerColour != m_PlayerTurn)
         return 0;
 
-    BitBoard allPieces = m_ColourBitBoards[White] | m_ColourBitBoards[Black];
-    BitBoard king = m_ColourBitBoards[playerColour] & m_PieceBitBoards[King];
-    BitBoard enemyPieces = m_ColourBitBoards[enemyColour];
+    if (GetPieceType(m_Board[piece]) == King)
+        return GetKingLegalMoves(piece, ControlledSquares(OppositeColour(playerColour)));
+
+    return GetPieceLegalMoves(piece, GetLegalityMasks(playerColour));
+}
+
+void Board::GenerateLegalMoves(MoveList& moves) const {
+    moves.Size = 0;
 
-    if (GetPieceType(m_Board[piece]) == King) {
-        BitBoard legalMoves = GetPseudoLegalMoves(piece);
-        BitBoard controlledSquares = ControlledSquares(enemyColour);
+    const LegalityMasks masks = GetLegalityMasks(m_PlayerTurn);
+    const BitBoard controlledSquares = ControlledSquares(OppositeColour(m_PlayerTurn));
+
+    for (BitBoard pieces = m_ColourBitBoards[m_PlayerTurn]; pieces != 0; pieces &= pieces - 1) {
+        const Square source = GetSquare(pieces);
+        const PieceType type = GetPieceType(m_Board[source]);
+
+        BitBoard destinations = type == King ? GetKingLegalMoves(source, controlledSquares) : GetPieceLegalMoves(source, masks);
+
+        // Pawns moving to the first or last rank promote
+        if (type == Pawn && (destinations & 0xFF000000000000FF)) {
+            for (; destinations != 0; destinations &= destinations - 1) {
+                const Square destination = GetSquare(destinations);
+                moves.Add({ source, destination, Queen });
+                moves.Add({ source, destination, Rook });
+                moves.Add({ source, destination, Bishop });
+                moves.Add({ source, destination, Knight });
+            }
+        } else {
+            for (; destinations != 0; destinations &= destinations - 1)
+                moves.Add({ source, GetSquare(destinations) });
+        }
+    }
+}
 
-        // Deals with castling
-        if (!((allPieces & ~king) & m_CastlingPath[playerColour | KingSide]) && !(controlledSquares & m_CastlingPath[playerColour | KingSide]))
-            legalMoves |= 0x40ull << (playerColour == White ? 0 : 56);
-        if (!((allPieces & ~king) & m_CastlingPath[playerColour | QueenSide]) && !(controlledSquares & m_CastlingPath[playerColour | QueenSide]))
-            legalMoves |= 0x04ull << (playerColour == White ? 0 : 56);
+void Board::GenerateLegalChecks(MoveList& moves) const {
+    moves.Size = 0;
+
+    const Colour enemyColour = OppositeColour(m_PlayerTurn);
+    const BitBoard allPieces = m_ColourBitBoards[White] | m_ColourBitBoards[Black];
+    const BitBoard ownPieces = m_ColourBitBoards[m_PlayerTurn];
+    const BitBoard enemyKing = m_ColourBitBoards[enemyColour] & m_PieceBitBoards[King];
+    const Square kingSquare = GetSquare(enemyKing);
+
+    const BitBoard rooks = (m_PieceBitBoards[Rook] | m_PieceBitBoards[Queen]) & ownPieces;
+    const BitBoard bishops = (m_PieceBitBoards[Bishop] | m_PieceBitBoards[Queen]) & ownPieces;
+
+    // The squares each piece type checks the king from
+    const BitBoard bishopView = PseudoLegal::BishopAttack(kingSquare, allPieces);
+    const BitBoard rookView = PseudoLegal::RookAttack(kingSquare, allPieces);
+
+    std::array<BitBoard, PieceTypeCount> checkSquares = {};
+    checkSquares[Pawn] = PseudoLegal::PawnAttack(kingSquare, enemyColour);
+    checkSquares[Knight] = PseudoLegal::KnightAttack(kingSquare);
+    checkSquares[Bishop] = bishopView;
+    checkSquares[Rook] = rookView;
+    checkSquares[Queen] = bishopView | rookView;
+
+    // Own pieces between a slider and the king uncover a check when they leave the line between them
+    // (the same as the pins of GetLegalityMasks(), with the colours the other way around)
+    std::array<BitBoard, 64> discoveryLines;
+    BitBoard discoverers = 0;
+
+    for (BitBoard xRay = PseudoLegal::BishopAttack(kingSquare, allPieces & ~(bishopView & ownPieces)) & bishops & ~bishopView; xRay != 0; xRay &= xRay - 1) {
+        const BitBoard line = PseudoLegal::Line(enemyKing, xRay);
+        const BitBoard blocker = line & bishopView & ownPieces;
+        discoverers |= blocker;
+        discoveryLines[GetSquare(blocker)] = line;
+    }
 
-        return legalMoves & ~controlledSquares;
+    for (BitBoard xRay = PseudoLegal::RookAttack(kingSquare, allPieces & ~(rookView & ownPieces)) & rooks & ~rookView; xRay != 0; xRay &= xRay - 1) {
+        const BitBoard line = PseudoLegal::Line(enemyKing, xRay);
+        const BitBoard blocker = line & rookView & ownPieces;
+        discoverers |= blocker;
+        discoveryLines[GetSquare(blocker)] = line;
     }
 
+    // Castling and en passant move a second piece, so the sliders are looked at again with the pieces moved
+    auto slidersCheck = [&](BitBoard occupied, BitBoard ownRooks, BitBoard ownBishops) {
+        return (PseudoLegal::RookAttack(kingSquare, occupied) & ownRooks) || (PseudoLegal::BishopAttack(kingSquare, occupied) & ownBishops);
+    };
+
+    const LegalityMasks masks = GetLegalityMasks(m_PlayerTurn);
+    const BitBoard controlledSquares = ControlledSquares(enemyColour);
+
+    for (BitBoard pieces = ownPieces; pieces != 0; pieces &= pieces - 1) {
+        const Square source = GetSquare(pieces);
+        const BitBoard sourceSquare = 1ull << source;
+        const PieceType type = GetPieceType(m_Board[source]);
+
+        BitBoard destinations = type == King ? GetKingLegalMoves(source, controlledSquares) : GetPieceLegalMoves(source, masks);
+        if (destinations == 0)
+            continue;
+
+        const BitBoard discovered = (sourceSquare & discoverers) ? destinations & ~discoveryLines[source] : 0;
+
+        if (type == King) {
+            // The king only checks by uncovering a slider, or with the rook when castling
+            for (BitBoard castles = destinations & ~PseudoLegal::KingAttack(source); castles != 0; castles &= castles - 1) {
+                const Square destination = GetSquare(castles);
+                const bool kingSide = destination > source;
+                const BitBoard rookSquares = kingSide ? (1ull << (source + 3)) | (1ull << (destination - 1)) : (1ull << (source - 4)) | (1ull << (destination + 1));
+                const BitBoard occupied = allPieces ^ sourceSquare ^ (1ull << destination) ^ rookSquares;
+
+                if (slidersCheck(occupied, rooks ^ rookSquares, bishops))
+                    moves.Add({ source, destination });
+            }
+
+            for (destinations &= discovered & PseudoLegal::KingAttack(source); destinations != 0; destinations &= destinations - 1)
+                moves.Add({ source, GetSquare(destinations) });
+        } else if (type == Pawn) {
+            for (; destinations != 0; destinations &= destinations - 1) {
+                const Square destination = GetSquare(destinations);
+                const BitBoard destinationSquare = 1ull << destination;
+
+                if (destinationSquare & 0xFF000000000000FF) {
+                    // The promoted piece attacks from the destination, with the pawn gone from its square
+                    const BitBoard occupied = allPieces & ~sourceSquare;
+                    const bool uncovered = (discovered & destinationSquare) != 0;
+
+                    if (uncovered || (PseudoLegal::QueenAttack(destination, occupied) & enemyKing))
+                        moves.Add({ source, destination, Queen });
+                    if (uncovered || (PseudoLegal::RookAttack(destination, occupied) & enemyKing))
+                        moves.Add({ source, destination, Rook });
+                    if (uncovered || (PseudoLegal::BishopAttack(destination, occupied) & enemyKing))
+                        moves.Add({ source, destination, Bishop });
+                    if (uncovered || (PseudoLegal::KnightAttack(destination) & enemyKing))
+                        moves.Add({ source, destination, Knight });
+                } else if (destination == m_EnPassantSquare && m_EnPassantSquare != 0) {
+                    // Taking en passant also removes the captured pawn from its line
+                    const Square captured = m_PlayerTurn == White ? destination - 8 : destination + 8;
+                    const BitBoard occupied = allPieces ^ sourceSquare ^ destinationSquare ^ (1ull << captured);
+
+                    if ((destinationSquare & checkSquares[Pawn]) || slidersCheck(occupied, rooks, bishops))
+                        moves.Add({ source, destination });
+                } else if (destinationSquare & (checkSquares[Pawn] | discovered)) {
+                    moves.Add({ source, destination });
+                }
+            }
+        } else {
+            for (destinations &= checkSquares[type] | discovered; destinations != 0; destinations &= destinations - 1)
+                moves.Add({ source, GetSquare(destinations) });
+        }
+    }
+}
+
+bool Board::IsInCheck() const {
+    BitBoard king = m_ColourBitBoards[m_PlayerTurn] & m_PieceBitBoards[King];
+    return AttackersTo(GetSquare(king), OppositeColour(m_PlayerTurn)) != 0;
+}
+
+BitBoard Board::AttackersTo(Square s, Colour attacker) const {
+    const BitBoard allPieces = m_ColourBitBoards[White] | m_ColourBitBoards[Black];
+    const BitBoard rooks = m_PieceBitBoards[Rook] | m_PieceBitBoards[Queen];
+    const BitBoard bishops = m_PieceBitBoards[Bishop] | m_PieceBitBoards[Queen];
+
+    // A pawn of 'attacker' attacks 's' from the squares an opposing pawn on 's' would attack
+    BitBoard attackers = PseudoLegal::PawnAttack(s, OppositeColour(attacker)) & m_PieceBitBoards[Pawn];
+    attackers |= PseudoLegal::KnightAttack(s) & m_PieceBitBoards[Knight];
+    attackers |= PseudoLegal::BishopAttack(s, allPieces) & bishops;
+    attackers |= PseudoLegal::RookAttack(s, allPieces) & rooks;
+    attackers |= PseudoLegal::KingAttack(s) & m_PieceBitBoards[King];
+
+    return attackers & m_ColourBitBoards[attacker];
+}
+
+uint64_t Board::GetHash() const {
+    uint64_t hash = m_PieceHash;
+
+    for (size_t i = 0; i < m_CastlingPath.size(); i++)
+        if (m_CastlingPath[i] != NO_CASTLE)
+            hash ^= Zobrist::CastlingKeys[i];
+
+    if (m_EnPassantSquare != 0)
+        hash ^= Zobrist::EnPassantKeys[FileOf(m_EnPassantSquare)];
+
+    if (m_PlayerTurn == Black)
+        hash ^= Zobrist::BlackToMoveKey;
+
+    return hash;
+}
+
+Board::LegalityMasks Board::GetLegalityMasks(Colour playerColour) const {
+    Colour enemyColour = OppositeColour(playerColour);
+
+    BitBoard allPieces = m_ColourBitBoards[White] | m_ColourBitBoards[Black];
+    BitBoard king = m_ColourBitBoards[playerColour] & m_PieceBitBoards[King];
+    BitBoard enemyPieces = m_ColourBitBoards[enemyColour];
+
     Square kingSquare = GetSquare(king);
 
     BitBoard checkMask = 0;
@@ -599,28 +930,52 @@ BitBoard Board::GetPieceLegalMoves(Square piece) {
     // If there are no checks, we don't prune any moves
     if (checkMask == 0)
         checkMask = 0xFFFFFFFFFFFFFFFF;
-    
+
     // If it is double check, we can remove all blocking moves (we can only move the king)
     checkMask *= SquareCount(checkers) < 2;
 
+    return { checkMask, rookPin, bishopPin };
+}
+
+BitBoard Board::GetPieceLegalMoves(Square piece, const LegalityMasks& masks) const {
+    Colour playerColour = GetColour(m_Board[piece]);
+    Colour enemyColour = OppositeColour(playerColour);
+
+    BitBoard allPieces = m_ColourBitBoards[White] | m_ColourBitBoards[Black];
+    BitBoard king = m_ColourBitBoards[playerColour] & m_PieceBitBoards[King];
+    BitBoard enemyPieces = m_ColourBitBoards[enemyColour];
+
     BitBoard pseudoLegal = GetPseudoLegalMoves(piece);
 
     BitBoard pieceSquare = 1ull << piece;
-    if (pieceSquare & rookPin)  // If piece is horizontally pinned
-        pseudoLegal &= rookPin & PseudoLegal::RookAttack(piece, allPieces);
-    else if (pieceSquare & bishopPin)  // If piece is diagonally pinned
-        pseudoLegal &= bishopPin & PseudoLegal::BishopAttack(piece, allPieces);
+    if (pieceSquare & masks.RookPin)  // If piece is horizontally pinned
+        pseudoLegal &= masks.RookPin & PseudoLegal::RookAttack(piece, allPieces);
+    else if (pieceSquare & masks.BishopPin)  // If piece is diagonally pinned
+        pseudoLegal &= masks.BishopPin & PseudoLegal::BishopAttack(piece, allPieces);
+
+    BitBoard checkMask = masks.CheckMask;
+
+    const bool enPassant = GetPieceType(m_Board[piece]) == Pawn && m_EnPassantSquare;
+
+    // Taking en passant also removes the check of a pawn that was just pushed two squares
+    if (enPassant) {
+        Square pushedPawn = playerColour == White ? m_EnPassantSquare - 8 : m_EnPassantSquare + 8;
+        if (checkMask & (1ull << pushedPawn))
+            checkMask |= 1ull << m_EnPassantSquare;
+    }
 
     pseudoLegal &= checkMask;
 
     // Handles en passant pin: 8/4p3/8/2K2P1r/8/8/8/7k b - - 0 1
-    if (GetPieceType(m_Board[piece]) == Pawn && king & 0x000000FFFF000000 && m_EnPassantSquare) {
+    if (enPassant && king & 0x000000FFFF000000) {
+        Square kingSquare = GetSquare(king);
+
         // Gets the two pawns involved in en passant
         BitBoard twoPawns = ((1ull << (m_EnPassantSquare + 8)) | (1ull << (m_EnPassantSquare - 8))) & 0x000000FFFF000000;
         twoPawns |= pieceSquare;
 
-        // Removes the pawns and sees if king is in check
-        rookView = PseudoLegal::RookAttack(kingSquare, allPieces & ~twoPawns);
+        // Removes the pawns and sees if king is in check along its rank
+        BitBoard rookView = PseudoLegal::RookAttack(kingSquare, allPieces & ~twoPawns) & BitBoardRank(kingSquare);
         if (rookView & enemyPieces & (m_PieceBitBoards[Rook] | m_PieceBitBoards[Queen]))
             pseudoLegal &= ~(1ull << m_EnPassantSquare);
     }
@@ -628,6 +983,31 @@ BitBoard Board::GetPieceLegalMoves(Square piece) {
     return pseudoLegal;
 }
 
+BitBoard Board::GetKingLegalMoves(Square kingSquare, BitBoard controlledSquares) const {
+    Colour playerColour = GetColour(m_Board[kingSquare]);
+
+    BitBoard allPieces = m_ColourBitBoards[White] | m_ColourBitBoards[Black];
+    BitBoard king = 1ull << kingSquare;
+
+    BitBoard legalMoves = GetPseudoLegalMoves(kingSquare);
+
+    // Deals with castling
+    // The squares between the king and the rook must be empty, and the king
+    // can't castle out of check or through an attacked square (the b-file square
+    // of the queenside path only needs to be empty)
+    constexpr BitBoard B_FILE = 0x0202020202020202;
+
+    BitBoard kingSide = m_CastlingPath[playerColour | KingSide];
+    if (!((allPieces & ~king) & kingSide) && !(controlledSquares & (kingSide | king)))
+        legalMoves |= 0x40ull << (playerColour == White ? 0 : 56);
+
+    BitBoard queenSide = m_CastlingPath[playerColour | QueenSide];
+    if (!((allPieces & ~king) & queenSide) && !(controlledSquares & ((queenSide & ~B_FILE) | king)))
+        legalMoves |= 0x04ull << (playerColour == White ? 0 : 56);
+
+    return legalMoves & ~controlledSquares;
+}
+
 BitBoard Board::GetPseudoLegalMoves(Square piece) const {
     PieceType pt = GetPieceType(m_Board[piece]);
     Colour c = GetColour(m_Board[piece]);
@@ -651,20 +1031,82 @@ BitBoard Board::ControlledSquares(Colour c) const {
     BitBoard blockers = (m_ColourBitBoards[White] | m_ColourBitBoards[Black]) ^ king;
 
     BitBoard controlledSquares = 0;
-    for (Square s = 0; s < 64; s++) {
-        if (m_Board[s] != Piece::None && GetColour(m_Board[s]) == c) {
-            switch (GetPieceType(m_Board[s])) {
-                case Pawn:   controlledSquares |= PseudoLegal::PawnAttack(s, c); break;
-                case Knight: controlledSquares |= PseudoLegal::KnightAttack(s); break;
-                case Bishop: controlledSquares |= PseudoLegal::BishopAttack(s, blockers); break;
-                case Rook:   controlledSquares |= PseudoLegal::RookAttack(s, blockers); break;
-                case Queen:  controlledSquares |= PseudoLegal::QueenAttack(s, blockers); break;
-                case King:   controlledSquares |= PseudoLegal::KingAttack(s); break;
-
-                default: return 0;
-            }
+    for (BitBoard pieces = m_ColourBitBoards[c]; pieces != 0; pieces &= pieces - 1) {
+        Square s = GetSquare(pieces);
+
+        switch (GetPieceType(m_Board[s])) {
+            case Pawn:   controlledSquares |= PseudoLegal::PawnAttack(s, c); break;
+            case Knight: controlledSquares |= PseudoLegal::KnightAttack(s); break;
+            case Bishop: controlledSquares |= PseudoLegal::BishopAttack(s, blockers); break;
+            case Rook:   controlledSquares |= PseudoLegal::RookAttack(s, blockers); break;
+            case Queen:  controlledSquares |= PseudoLegal::QueenAttack(s, blockers); break;
+            case King:   controlledSquares |= PseudoLegal::KingAttack(s); break;
+
+            default: return 0;
         }
     }
 
     return controlledSquares;
 }
+
+void Board::ClearCastlingRights(Square s) {
+    switch (s) {
+        case A1: m_CastlingPath[White | QueenSide] = NO_CASTLE; break;
+        case H1: m_CastlingPath[White | KingSide]  = NO_CASTLE; break;
+        case A8: m_CastlingPath[Black | QueenSide] = NO_CASTLE; break;
+        case H8: m_CastlingPath[Black | KingSide]  = NO_CASTLE; break;
+    }
+}
+
+void Board::ComputeHash() {
+    m_PieceHash = 0;
+
+    for (Square s = 0; s < 64; s++)
+        if (m_Board[s] != Piece::None)
+            m_PieceHash ^= Zobrist::PieceKeys[m_Board[s]][s];
+}
+
+int32_t Board::Evaluate() const {
+#if !defined(CHESS_NO_EVALUATION)
+    const int32_t phase = std::min(m_Phase, Evaluation::MAX_PHASE);  // There can be more pieces after promotions
+    const int32_t midgame = m_MidgameScore[White] - m_MidgameScore[Black];
+    const int32_t endgame = m_EndgameScore[White] - m_EndgameScore[Black];
+#else
+    int32_t phase = 0, midgame = 0, endgame = 0;
+    for (Square s = 0; s < 64; s++) {
+        Piece p = m_Board[s];
+        if (p == Piece::None)
+            continue;
+
+        const int32_t sign = GetColour(p) == White ? 1 : -1;
+        midgame += sign * Evaluation::MidgameScores[p][s];
+        endgame += sign * Evaluation::EndgameScores[p][s];
+        phase += Evaluation::PhaseWeights[GetPieceType(p)];
+    }
+    phase = std::min(phase, Evaluation::MAX_PHASE);
+#endif
+
+    const int32_t score = (midgame * phase + endgame * (Evaluation::MAX_PHASE - phase)) / Evaluation::MAX_PHASE;
+
+    return m_PlayerTurn == White ? score : -score;
+}
+
+void Board::ComputeEvaluation() {
+#if !defined(CHESS_NO_EVALUATION)
+    m_Material.fill(0);
+    m_MidgameScore.fill(0);
+    m_EndgameScore.fill(0);
+    m_Phase = 0;
+
+    for (Square s = 0; s < 64; s++) {
+        Piece p = m_Board[s];
+        if (p == Piece::None)
+            continue;
+
+        m_Material[GetColour(p)] += Evaluation::MidgameValues[GetPieceType(p)];
+        m_MidgameScore[GetColour(p)] += Evaluation::MidgameScores[p][s];
+        m_EndgameScore[GetColour(p)] += Evaluation::EndgameScores[p][s];
+        m_Phase += Evaluation::PhaseWeights[GetPieceType(p)];
+    }
+#endif
+}
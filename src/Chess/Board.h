@@ -6,11 +6,43 @@
 
 #include "BitBoard.h"
 #include "BoardFormat.h"
+#include "Evaluation.h"
 #include "Move.h"
+#include "Zobrist.h"
 
 class Game;
 struct GameMove;
 
+// Everything needed to take back a move made with Board::MakeMove()
+struct UndoInfo {
+    LongAlgebraicMove Move;
+    Piece MovingPiece;
+    Piece CapturedPiece;
+    bool EnPassant;  // If the move captured en passant
+
+    // The state of the board before the move
+    Square EnPassantSquare;
+    int32_t HalfMoves;
+    std::array<BitBoard, 4> CastlingPath;
+};
+
+// A list of moves that doesn't allocate
+// (no position has more than 218 legal moves)
+struct MoveList {
+    std::array<LongAlgebraicMove, 256> Moves;
+    size_t Size = 0;
+
+    inline void Add(LongAlgebraicMove m) { Moves[Size++] = m; }
+
+    inline LongAlgebraicMove& operator[](size_t i) { return Moves[i]; }
+    inline LongAlgebraicMove operator[](size_t i) const { return Moves[i]; }
+
+    inline LongAlgebraicMove* begin() { return Moves.data(); }
+    inline LongAlgebraicMove* end() { return Moves.data() + Size; }
+    inline const LongAlgebraicMove* begin() const { return Moves.data(); }
+    inline const LongAlgebraicMove* end() const { return Moves.data() + Size; }
+};
+
 class Board {
     friend class Game;
 public:
@@ -21,27 +53,104 @@ public:
 
     void FromFEN(const std::string& fen);
     std::string ToFEN() const;
+
+    // The position in PACKED_SIZE bytes (a piece in each half byte, then the player turn and castling rights,
+    // the en passant square, and the half and full moves), which is much faster to read than a FEN
+    // FromPacked() doesn't check that the position is legal, so the data should be from ToPacked()
+    static constexpr size_t PACKED_SIZE = 42;
+    static constexpr size_t PACKED_COUNTERS = 34;  // Where the half and full moves start
+    void ToPacked(uint8_t* data) const;
+    void FromPacked(const uint8_t* data);
+
+    // Empties the board (no castling rights or en passant square),
+    // so a position can be set up piece by piece with SetPiece()
+    void Clear(Colour playerTurn = White);
+    inline void SetPiece(Piece p, Square s) { RemovePiece(s); PlacePiece(p, s); }
     
     inline Piece operator[](Square s) const { return m_Board[s]; }
 
+    inline BitBoard GetPieceBitBoard(PieceType t) const { return m_PieceBitBoards[t]; }
+    inline BitBoard GetColourBitBoard(Colour c) const { return m_ColourBitBoards[c]; }
+
     inline Square GetEnPassantSquare() const { return m_EnPassantSquare; }
     inline Colour GetPlayerTurn() const { return m_PlayerTurn; }
     inline int32_t GetHalfMoves() const { return m_HalfMoves; }
     inline int32_t GetFullMoves() const { return m_FullMoves; }
 
+    // If either player can still castle (on either side)
+    inline bool HasCastlingRights() const { return (m_CastlingPath[0] & m_CastlingPath[1] & m_CastlingPath[2] & m_CastlingPath[3]) != NO_CASTLE; }
+    inline bool CanCastle(Colour colour, CastleSide side) const { return m_CastlingPath[colour | side] != NO_CASTLE; }
+
     AlgebraicMove Move(LongAlgebraicMove m);
     LongAlgebraicMove Move(AlgebraicMove m);
     void UndoMove(const GameMove& m);
 
-    inline bool IsMoveLegal(LongAlgebraicMove m) { return GetPieceLegalMoves(m.SourceSquare) & (1ull << m.DestinationSquare); }
+    // Fast path for searching: the move is assumed to be legal,
+    // and no algebraic notation is generated
+    void MakeMove(LongAlgebraicMove m, UndoInfo& undo);
+    void UnmakeMove(const UndoInfo& undo);
+
+    inline bool IsMoveLegal(LongAlgebraicMove m) const { return GetPieceLegalMoves(m.SourceSquare) & (1ull << m.DestinationSquare); }
+
+    // MakeMove() for moves from data that can't be trusted: the move is only made if it is legal
+    // (with a promotion piece exactly when a pawn reaches the last rank), faster than IsMoveLegal() then MakeMove()
+    // Returns false, with the board unchanged, if it isn't
+    bool TryMakeMove(LongAlgebraicMove m, UndoInfo& undo);
 
-    bool HasLegalMoves(Colour colour);
-    BitBoard GetPieceLegalMoves(Square piece);
+    bool HasLegalMoves(Colour colour) const;
+    BitBoard GetPieceLegalMoves(Square piece) const;
+
+    // Fills 'moves' with every legal move of the player to move
+    // (a promotion is added once for each piece)
+    void GenerateLegalMoves(MoveList& moves) const;
+
+    // Fills 'moves' with the legal moves that give check: moves to the squares that attack the opposing king,
+    // and moves of pieces that uncover an attack from one of their sliders (promotions only to the pieces that check)
+    void GenerateLegalChecks(MoveList& moves) const;
+
+    // If the player to move is in check
+    bool IsInCheck() const;
+
+    // Pieces of 'attacker' that attack square 's'
+    BitBoard AttackersTo(Square s, Colour attacker) const;
+
+    // Zobrist hash of the position (pieces, player turn, castling rights and en passant square)
+    uint64_t GetHash() const;
+
+    // Static evaluation in centipawns from the point of view of the player to move
+    // (material and piece-square tables, tapered by the game phase)
+    //
+    // The scores are updated incrementally as pieces are placed and removed
+    // Define CHESS_NO_EVALUATION to leave that out of move generation,
+    // in which case Evaluate() scans the board instead
+    int32_t Evaluate() const;
+
+#if !defined(CHESS_NO_EVALUATION)
+    // Sum of the values of the pieces of 'colour' (not including the king)
+    inline int32_t GetMaterial(Colour colour) const { return m_Material[colour]; }
+    // From 0 (only kings and pawns) to Evaluation::MAX_PHASE (all pieces on the board)
+    inline int32_t GetPhase() const { return m_Phase; }
+#endif
 
     inline static const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\0";
 private:
+    // Check and pin information of one player, shared by all their pieces
+    struct LegalityMasks {
+        BitBoard CheckMask;  // Squares that capture or block the checking piece (every square if there is no check)
+        BitBoard RookPin;    // Lines of horizontally and vertically pinned pieces
+        BitBoard BishopPin;  // Lines of diagonally pinned pieces
+    };
+
+    LegalityMasks GetLegalityMasks(Colour colour) const;
+    BitBoard GetPieceLegalMoves(Square piece, const LegalityMasks& masks) const;
+    BitBoard GetKingLegalMoves(Square king, BitBoard controlledSquares) const;
+
     BitBoard GetPseudoLegalMoves(Square piece) const;
 
+    void ClearCastlingRights(Square s);
+    void ComputeHash();
+    void ComputeEvaluation();
+
     void PlacePiece(Piece p, Square s);
     void RemovePiece(Square s);
 
@@ -75,12 +184,30 @@ private:
     
     int32_t m_HalfMoves = 0;  // Number of half moves since the last pawn move or capture
     int32_t m_FullMoves = 1;  // The number of the full moves; it starts at 1, and is incremented after Black's move
+
+    // Zobrist hash of the pieces only (the rest is added in GetHash())
+    uint64_t m_PieceHash = 0;
+
+#if !defined(CHESS_NO_EVALUATION)
+    std::array<int32_t, ColourCount> m_Material = {};
+    std::array<int32_t, ColourCount> m_MidgameScore = {};  // Material and middlegame piece-square scores
+    std::array<int32_t, ColourCount> m_EndgameScore = {};  // Material and endgame piece-square scores
+    int32_t m_Phase = 0;
+#endif
 };
 
 inline void Board::PlacePiece(Piece p, Square s) {
     m_PieceBitBoards[GetPieceType(p)] |= 1ull << s;
     m_ColourBitBoards[GetColour(p)] |= 1ull << s;
     m_Board[s] = p;
+    m_PieceHash ^= Zobrist::PieceKeys[p][s];
+
+#if !defined(CHESS_NO_EVALUATION)
+    m_Material[GetColour(p)] += Evaluation::MidgameValues[GetPieceType(p)];
+    m_MidgameScore[GetColour(p)] += Evaluation::MidgameScores[p][s];
+    m_EndgameScore[GetColour(p)] += Evaluation::EndgameScores[p][s];
+    m_Phase += Evaluation::PhaseWeights[GetPieceType(p)];
+#endif
 }
 
 inline void Board::RemovePiece(Square s) {
@@ -89,6 +216,14 @@ inline void Board::RemovePiece(Square s) {
         m_PieceBitBoards[GetPieceType(p)] &= ~(1ull << s);
         m_ColourBitBoards[GetColour(p)] &= ~(1ull << s);
         m_Board[s] = Piece::None;
+        m_PieceHash ^= Zobrist::PieceKeys[p][s];
+
+#if !defined(CHESS_NO_EVALUATION)
+        m_Material[GetColour(p)] -= Evaluation::MidgameValues[GetPieceType(p)];
+        m_MidgameScore[GetColour(p)] -= Evaluation::MidgameScores[p][s];
+        m_EndgameScore[GetColour(p)] -= Evaluation::EndgameScores[p][s];
+        m_Phase -= Evaluation::PhaseWeights[GetPieceType(p)];
+#endif
     }
 }
 
@@ -82,6 +82,17 @@ private:
 	std::string m_Message;
 };
 
+class InvalidGameDataException : public std::exception {
+public:
+	InvalidGameDataException(const std::string& message) : m_Message(message) {}
+
+	const char* what() const noexcept override {
+		return m_Message.c_str();
+	}
+private:
+	std::string m_Message;
+};
+
 class SeekOutOfBoundsException : public std::exception {
 public:
 	const char* what() const noexcept override {
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Move.h"
+
+// Material and piece-square tables for Board::Evaluate()
+// The middlegame and endgame scores are blended by the game phase (tapered evaluation)
+// Source:
+// https://www.chessprogramming.org/Simplified_Evaluation_Function
+// https://www.chessprogramming.org/Tapered_Eval
+//
+
+namespace Evaluation {
+
+    // Indexed by PieceType
+    constexpr std::array<int32_t, PieceTypeCount> MidgameValues = { 100, 320, 330, 500, 900, 0 };
+    constexpr std::array<int32_t, PieceTypeCount> EndgameValues = { 120, 300, 320, 530, 950, 0 };
+
+    // How much each piece counts towards the game phase
+    // All the pieces (except pawns and kings) of the starting position add up to MAX_PHASE
+    constexpr std::array<int32_t, PieceTypeCount> PhaseWeights = { 0, 1, 1, 2, 4, 0 };
+    constexpr int32_t MAX_PHASE = 24;
+
+    using Table = std::array<int32_t, 64>;
+
+    // The tables are from White's point of view, and are laid out like a diagram (a8 first)
+    constexpr std::array<Table, PieceTypeCount> MidgameTables = {{
+        {  // Pawn
+              0,   0,   0,   0,   0,   0,   0,   0,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             10,  10,  20,  30,  30,  20,  10,  10,
+              5,   5,  10,  25,  25,  10,   5,   5,
+              0,   0,   0,  20,  20,   0,   0,   0,
+              5,  -5, -10,   0,   0, -10,  -5,   5,
+              5,  10,  10, -20, -20,  10,  10,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        {  // Knight
+            -50, -40, -30, -30, -30, -30, -40, -50,
+            -40, -20,   0,   0,   0,   0, -20, -40,
+            -30,   0,  10,  15,  15,  10,   0, -30,
+            -30,   5,  15,  20,  20,  15,   5, -30,
+            -30,   0,  15,  20,  20,  15,   0, -30,
+            -30,   5,  10,  15,  15,  10,   5, -30,
+            -40, -20,   0,   5,   5,   0, -20, -40,
+            -50, -40, -30, -30, -30, -30, -40, -50,
+        },
+        {  // Bishop
+            -20, -10, -10, -10, -10, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,  10,  10,   5,   0, -10,
+            -10,   5,   5,  10,  10,   5,   5, -10,
+            -10,   0,  10,  10,  10,  10,   0, -10,
+            -10,  10,  10,  10,  10,  10,  10, -10,
+            -10,   5,   0,   0,   0,   0,   5, -10,
+            -20, -10, -10, -10, -10, -10, -10, -20,
+        },
+        {  // Rook
+              0,   0,   0,   0,   0,   0,   0,   0,
+              5,  10,  10,  10,  10,  10,  10,   5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+              0,   0,   0,   5,   5,   0,   0,   0,
+        },
+        {  // Queen
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,   5,   5,   5,   0, -10,
+             -5,   0,   5,   5,   5,   5,   0,  -5,
+              0,   0,   5,   5,   5,   5,   0,  -5,
+            -10,   5,   5,   5,   5,   5,   0, -10,
+            -10,   0,   5,   0,   0,   0,   0, -10,
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+        },
+        {  // King
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -20, -30, -30, -40, -40, -30, -30, -20,
+            -10, -20, -20, -20, -20, -20, -20, -10,
+             20,  20,   0,   0,   0,   0,  20,  20,
+             20,  30,  10,   0,   0,  10,  30,  20,
+        },
+    }};
+
+    // In the endgame passed pawns matter more, and the king should be active
+    constexpr std::array<Table, PieceTypeCount> EndgameTables = {{
+        {  // Pawn
+              0,   0,   0,   0,   0,   0,   0,   0,
+             80,  80,  80,  80,  80,  80,  80,  80,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             30,  30,  30,  30,  30,  30,  30,  30,
+             15,  15,  15,  15,  15,  15,  15,  15,
+              5,   5,   5,   5,   5,   5,   5,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        MidgameTables[Knight],
+        MidgameTables[Bishop],
+        MidgameTables[Rook],
+        MidgameTables[Queen],
+        {  // King
+            -50, -40, -30, -20, -20, -30, -40, -50,
+            -30, -20, -10,   0,   0, -10, -20, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -30,   0,   0,   0,   0, -30, -30,
+            -50, -30, -30, -30, -30, -30, -30, -50,
+        },
+    }};
+
+    // Combines the values and tables into one score for each Piece and Square
+    // Indexed by the Piece enum (the unused indices 6 and 7 are left in for simplicity)
+    constexpr std::array<Table, 14> MakePieceSquareScores(const std::array<int32_t, PieceTypeCount>& values, const std::array<Table, PieceTypeCount>& tables) {
+        std::array<Table, 14> result = {};
+
+        for (uint8_t t = Pawn; t < PieceTypeCount; t++) {
+            for (Square s = 0; s < 64; s++) {
+                // The tables start at a8, the board starts at a1
+                result[PieceTypeAndColour((PieceType)t, White)][s] = values[t] + tables[t][s ^ 56];
+                result[PieceTypeAndColour((PieceType)t, Black)][s] = values[t] + tables[t][s];
+            }
+        }
+
+        return result;
+    }
+
+    constexpr std::array<Table, 14> MidgameScores = MakePieceSquareScores(MidgameValues, MidgameTables);
+    constexpr std::array<Table, 14> EndgameScores = MakePieceSquareScores(EndgameValues, EndgameTables);
+
+}
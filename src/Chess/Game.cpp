@@ -1,30 +1,133 @@
 #include "Game.h"
 
+#include "PgnLexer.h"
+#include "PgnWriter.h"
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
-#include <sstream>
 
-Game::Game()
-	: m_Branches(new Branch(nullptr, 0)), m_Variation(m_Branches) {
-	
-	Branch* newBranch = new Branch(m_Branches, 0);
-	m_Branches->Variations.push_back(newBranch);
-	m_Variation = newBranch;
+Game::Game() {
+	ResetTree();
 }
 
-Game::Game(const std::string& pgn)
-	: m_Branches(new Branch(nullptr, 0)), m_Variation(m_Branches) {
+Game::~Game() {
+	// Long comments are from the heap
+	for (const auto& [node, comment] : m_Comments)
+		FreeString(comment);
+}
 
+Game::Game(std::string_view pgn) {
 	FromPGN(pgn);
 }
 
-Game::~Game() {
-	delete m_Branches;
+Game::Game(const Game& other)
+	: m_FreeNodes(other.m_FreeNodes), m_StartPosition(other.m_StartPosition),
+	m_CheckpointInterval(other.m_CheckpointInterval), m_MergeTranspositions(other.m_MergeTranspositions),
+	m_Node(other.m_Node), m_Position(other.m_Position), m_Crossed(other.m_Crossed) {
+
+	m_Header.Assign(other.m_Header);
+
+	// The nodes are trivially copyable, so this is a memcpy
+	m_Nodes.assign(other.m_Nodes.begin(), other.m_Nodes.end());
+
+	for (const auto& [node, comment] : other.m_Comments)
+		m_Comments.emplace(node, CopyString(comment));
+
+	m_Checkpoints.insert(other.m_Checkpoints.begin(), other.m_Checkpoints.end());
+	m_Transpositions.insert(other.m_Transpositions.begin(), other.m_Transpositions.end());
+	m_Positions.insert(other.m_Positions.begin(), other.m_Positions.end());
+}
+
+Game& Game::operator=(const Game& other) {
+	if (this == &other)
+		return *this;
+
+	ResetTree();
+
+	m_Header.Assign(other.m_Header);
+	m_Nodes.assign(other.m_Nodes.begin(), other.m_Nodes.end());
+	m_FreeNodes = other.m_FreeNodes;
+	m_Node = other.m_Node;
+	m_Position = other.m_Position;
+	m_StartPosition = other.m_StartPosition;
+	m_CheckpointInterval = other.m_CheckpointInterval;
+	m_MergeTranspositions = other.m_MergeTranspositions;
+	m_Crossed = other.m_Crossed;
+
+	for (const auto& [node, comment] : other.m_Comments)
+		m_Comments.emplace(node, CopyString(comment));
+
+	m_Checkpoints.insert(other.m_Checkpoints.begin(), other.m_Checkpoints.end());
+	m_Transpositions.insert(other.m_Transpositions.begin(), other.m_Transpositions.end());
+	m_Positions.insert(other.m_Positions.begin(), other.m_Positions.end());
+
+	return *this;
+}
+
+void Game::ResetTree() {
+	// The containers (and the comments) have to give back their memory before the arena is released
+	for (const auto& [node, comment] : m_Comments)
+		FreeString(comment);
+
+	std::pmr::vector<GameNode>(&m_Pool).swap(m_Nodes);
+	decltype(m_Comments)(&m_Pool).swap(m_Comments);
+	decltype(m_Checkpoints)(&m_Pool).swap(m_Checkpoints);
+	decltype(m_Transpositions)(&m_Pool).swap(m_Transpositions);
+	decltype(m_Positions)(&m_Pool).swap(m_Positions);
+	m_Pool.Release();
+	m_Header.Clear();
+	m_Arena.release();
+
+	m_Nodes.push_back(GameNode{ {}, {}, 0 });
+	m_FreeNodes = NO_NODE;
+	m_Node = GetRoot();
+	m_Crossed.clear();
+}
+
+NodeIndex Game::NewNode(NodeIndex parent, const GameMove& move, AlgebraicMove san) {
+	NodeIndex node = m_FreeNodes;
+	if (node != NO_NODE) {
+		m_FreeNodes = m_Nodes[node].NextSibling;
+	} else {
+		node = (NodeIndex)m_Nodes.size();
+		m_Nodes.emplace_back();
+	}
+
+	m_Nodes[node] = GameNode{ move, san, m_Nodes[parent].Ply + 1, parent };
+
+	// The new move goes after the other moves from the same position
+	NodeIndex* link = &m_Nodes[parent].FirstChild;
+	while (*link != NO_NODE)
+		link = &m_Nodes[*link].NextSibling;
+
+	*link = node;
+
+	return node;
+}
+
+void Game::FreeNode(NodeIndex node) {
+	EraseComment(node);
+	m_Checkpoints.erase(node);
+	m_Nodes[node] = GameNode{ {}, {}, 0, NO_NODE, NO_NODE, m_FreeNodes };
+	m_FreeNodes = node;
+}
+
+bool Game::IsAncestor(NodeIndex ancestor, NodeIndex node) const {
+	for (; node != NO_NODE; node = m_Nodes[node].Parent) {
+		if (node == ancestor)
+			return true;
+	}
+
+	return false;
 }
 
 std::string Game::ToPGN() const {
-	std::ostringstream oss;
-	oss << *this;
-	return oss.str();
+	std::string pgn;
+	PgnWriter writer(pgn, { 0 });
+	writer.WriteHeader(*this);
+	writer.WriteMovetext(*this);
+	return pgn;
 }
 
 LongAlgebraicMove Game::Move(AlgebraicMove move) {
@@ -32,7 +135,11 @@ LongAlgebraicMove Game::Move(AlgebraicMove move) {
 
 	GameMoveFlags flags = move.Flags & GameMoveFlag::PromotionFlags;
 	Square epSquare = m_Position.GetEnPassantSquare();
-	flags |= (move.Destination == epSquare && move.MovingPiece == Pawn) * GameMoveFlag::EnPassant;
+	flags |= (move.Destination == epSquare && epSquare != 0 && move.MovingPiece == Pawn) * GameMoveFlag::EnPassant;
+
+	// Castling removes the rights for both sides, so check the other side before moving
+	CastleSide otherSide = (move.Flags & MoveFlag::CastleKingSide) ? QueenSide : KingSide;
+	bool canCastleOtherSide = m_Position.m_CastlingPath[m_Position.GetPlayerTurn() | otherSide] != NO_CASTLE;
 
 	LongAlgebraicMove lam = m_Position.Move(move);
 
@@ -40,9 +147,7 @@ LongAlgebraicMove Game::Move(AlgebraicMove move) {
 
 	if (MoveFlags castlingFlags = move.Flags & MoveFlag::CastlingFlags) {
 		flags = castlingFlags | colour << 5;
-
-		CastleSide otherSide = (move.Flags & MoveFlag::CastleKingSide) ? QueenSide : KingSide;
-		flags |= GameMoveFlag::CanCastleOtherSide * (bool)m_Position.m_CastlingPath[colour | otherSide];
+		flags |= GameMoveFlag::CanCastleOtherSide * canCastleOtherSide;
 	}
 
 	GameMove gameMove = {
@@ -53,443 +158,1033 @@ LongAlgebraicMove Game::Move(AlgebraicMove move) {
 		flags
 	};
 
-	Move(gameMove);
+	// The SAN as it is written: the parsed move doesn't say if a piece captures,
+	// and the check might be missing
+	AlgebraicMove san = move;
+	san.Flags &= ~(MoveFlag::Check | MoveFlag::Checkmate);
+	san.Flags |= MoveFlag::Capture * (destinationPiece != Piece::None || (flags & GameMoveFlag::EnPassant));
+
+	if (m_Position.IsInCheck()) {
+		san.Flags |= MoveFlag::Check;
+		san.Flags |= MoveFlag::Checkmate * !m_Position.HasLegalMoves(m_Position.GetPlayerTurn());
+	}
+
+	Move(gameMove, san);
 
 	return lam;
 }
 
 AlgebraicMove Game::Move(LongAlgebraicMove move) {
+	const GameMove gameMove = ToGameMove(m_Position, move);
+
+	// Board::Move() writes the SAN
+	AlgebraicMove san = m_Position.Move(move);
+	Move(gameMove, san);
+
+	return san;
+}
+
+GameMove Game::ToGameMove(const Board& position, LongAlgebraicMove move) {
 	GameMoveFlags flags = move.Promotion;
-	Square epSquare = m_Position.GetEnPassantSquare();
-	PieceType movingPiece = GetPieceType(m_Position[move.SourceSquare]);
-	flags |= (move.DestinationSquare == epSquare && movingPiece == Pawn) * GameMoveFlag::EnPassant;
+	Square epSquare = position.GetEnPassantSquare();
+	PieceType movingPiece = GetPieceType(position[move.SourceSquare]);
+	flags |= (move.DestinationSquare == epSquare && epSquare != 0 && movingPiece == Pawn) * GameMoveFlag::EnPassant;
 	
 	if (movingPiece == King) {
 		int direction = move.DestinationSquare - move.SourceSquare;  // Kingside or queenside
 
 		// If king is castling
 		if (abs(direction) == 2) {
-			Colour colour = GetColour(m_Position[move.SourceSquare]);
+			Colour colour = GetColour(position[move.SourceSquare]);
 			flags = 1u << (3 + (direction < 0));
 			flags |= colour << 5;
 
-			CastleSide otherDirection = (CastleSide)(1ull << (direction > 0));
-			flags |= GameMoveFlag::CanCastleOtherSide * (bool)m_Position.m_CastlingPath[colour | otherDirection];
+			CastleSide otherDirection = direction > 0 ? QueenSide : KingSide;
+			flags |= GameMoveFlag::CanCastleOtherSide * (position.m_CastlingPath[colour | otherDirection] != NO_CASTLE);
 		}
 	}
 
-	GameMove gameMove = {
+	return {
 		move.SourceSquare,
 		move.DestinationSquare,
-		m_Position[move.SourceSquare],
-		m_Position[move.DestinationSquare],
+		position[move.SourceSquare],
+		position[move.DestinationSquare],
 		flags,
 	};
-
-	Move(gameMove);
-
-	return m_Position.Move(move);
 }
 
 bool Game::Back() {
-	if (m_Ply == 0)
+	if (m_Node == GetRoot())
 		return false;
 
-	m_Position.UndoMove(m_Variation->Moves[m_Ply - m_Variation->StartingPly - 1]);
-	
-	// If the pointer is on the first move of the variation,
-	// Jump to the last move of the parent branch
-	if (m_Ply == m_Variation->StartingPly + 1)
-		m_Variation = m_Variation->Parent;
+	m_Position.UndoMove(m_Nodes[m_Node].Move);
+	m_Node = m_Nodes[m_Node].Parent;
 
-	m_Ply--;
+	// Back through the transposition the line came from
+	if (!m_Crossed.empty() && Resolve(m_Crossed.back()) == m_Node) {
+		m_Node = m_Crossed.back();
+		m_Crossed.pop_back();
+	}
 
 	return true;
 }
 
 bool Game::Forward() {
-	// The ply of the last move of the branch
-	const uint32_t maxPly = (uint32_t)m_Variation->Moves.size() + m_Variation->StartingPly;
+	const NodeIndex node = Resolve(m_Node);
 
-	// If we are at the end of the branch, go to main variation if it exists
-	if (m_Ply == maxPly) {
-		if (m_Variation->Variations.empty())
-			return false;
-
-		// Index 0 is the main line
-		m_Variation = m_Variation->Variations[0];
-	}
+	// Stop where the line would go round a position it already went through
+	if (node != m_Node && std::any_of(m_Crossed.begin(), m_Crossed.end(), [this, node](NodeIndex n) { return Resolve(n) == node; }))
+		return false;
 
-	++m_Ply;
-	const GameMove& gm = m_Variation->Moves[m_Ply - m_Variation->StartingPly - 1];
-	m_Position.Move(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)));
+	// The first child is the main line
+	const NodeIndex child = m_Nodes[node].FirstChild;
+	if (child == NO_NODE)
+		return false;
 
+	Enter(child);
+	SaveCheckpoint();
 	return true;
 }
 
-void Game::ToBeginning() {
-	m_Variation = m_Branches;
-	m_Ply = m_Variation->StartingPly;
+void Game::Enter(NodeIndex child) {
+	Step(child);
 
-	if (m_Header.count("FEN"))
-		m_Position = m_Header["FEN"];
-	else
-		m_Position.Reset();
+	// The moves in the tree are legal, so the fast path is enough
+	const GameMove& gm = m_Nodes[child].Move;
+	UndoInfo undo;
+	m_Position.MakeMove(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)), undo);
+}
+
+void Game::Step(NodeIndex child) {
+	if (m_Nodes[child].Parent != m_Node)
+		m_Crossed.push_back(m_Node);
+
+	m_Node = child;
+}
+
+void Game::SaveCheckpoint() {
+	if (m_CheckpointInterval == 0)
+		return;
+
+	const GameNode& node = m_Nodes[m_Node];
+	const bool variations = node.FirstChild != NO_NODE && m_Nodes[node.FirstChild].NextSibling != NO_NODE;
+
+	if (node.Ply % m_CheckpointInterval == 0 || variations)
+		m_Checkpoints.try_emplace(m_Node, m_Position);
+}
+
+void Game::SetCheckpointInterval(uint32_t interval) {
+	m_CheckpointInterval = interval;
+	m_Checkpoints.clear();
+}
+
+const Board* Game::GetCheckpoint(NodeIndex node) const {
+	auto it = m_Checkpoints.find(node);
+	return it == m_Checkpoints.end() ? nullptr : &it->second;
+}
+
+void Game::ToBeginning() {
+	m_Node = GetRoot();
+	m_Crossed.clear();
+	m_Position = m_StartPosition;
 }
 
 void Game::ToEnd() {
 	while (Forward());
 }
 
+NodeIndex Game::GetNodeAtPly(uint32_t ply, NodeIndex node) const {
+	while (node != NO_NODE && m_Nodes[node].Ply > ply)
+		node = m_Nodes[node].Parent;
+
+	while (node != NO_NODE && m_Nodes[node].Ply < ply)
+		node = m_Nodes[node].FirstChild;
+
+	return node;
+}
+
 void Game::Seek(uint32_t ply) {
-	if (ply < m_Ply) {
-		for (; m_Ply > ply; Back());
-	} else if (ply > m_Ply) {
-		// Test how far the main line goes
-		// Throw an error if it is too short
-		Branch* lastBranch = m_Variation;
-		for (; !lastBranch->Variations.empty(); lastBranch = lastBranch->Variations[0]);
-		if (lastBranch->StartingPly + lastBranch->Moves.size() < ply)
-			throw SeekOutOfBoundsException();
-
-		// Putting Forward() in the second statement
-		// removes the risk of a potential infinite loop
-		// (Forward() goes on the right since it must be evaluated second)
-		for (; m_Ply < ply && Forward(););
-	}
-}
-
-void Game::Seek(uint32_t ply, Branch* variation) {
-	if (variation == m_Variation) {
-		Seek(ply);
-		return;
+	// Throw an error if the line is too short
+	const NodeIndex target = GetNodeAtPly(ply);
+	if (target == NO_NODE)
+		throw SeekOutOfBoundsException();
+
+	GoTo(target);
+}
+
+void Game::GoTo(NodeIndex node) {
+	if (node == NO_NODE)
+		throw SeekOutOfBoundsException();
+
+	// The moves to 'node' from the current node, the closest checkpoint before it, or the root, backwards
+	m_Path.clear();
+
+	NodeIndex n = node;
+	auto checkpoint = m_Checkpoints.end();
+	while (n != m_Node && n != GetRoot() && (checkpoint = m_Checkpoints.find(n)) == m_Checkpoints.end()) {
+		m_Path.push_back(n);
+		n = m_Nodes[n].Parent;
 	}
 
-	ToBeginning();
+	if (n == GetRoot())
+		ToBeginning();
+	else if (n != m_Node)
+		m_Position = checkpoint->second;
 
-	if (variation == m_Branches)
-		return;
+	if (n != m_Node)
+		m_Crossed.clear();
+
+	m_Node = n;
+
+	for (auto it = m_Path.rbegin(); it != m_Path.rend(); ++it) {
+		Enter(*it);
+		SaveCheckpoint();
+	}
+}
+
+void Game::Delete(NodeIndex node) {
+	if (node == NO_NODE)
+		throw DeleteOutOfBoundsException();
 
-	if (ply <= variation->StartingPly) {
-		for (; m_Ply > ply; Back());
+	// Prohibit deletion of the root
+	if (node == GetRoot())
 		return;
+
+	const NodeIndex parent = m_Nodes[node].Parent;
+
+	// Back() has to go up the tree, not back through the transpositions
+	m_Crossed.clear();
+
+	// If the current move is being deleted, go back to the move before it
+	for (NodeIndex n = m_Node; n != NO_NODE && m_Nodes[n].Ply >= m_Nodes[node].Ply; n = m_Nodes[n].Parent) {
+		if (n == node) {
+			while (m_Node != parent)
+				Back();
+
+			break;
+		}
 	}
 
-	// If the ply is beyond the specified branch, continue down the main line
-	for (; ply > variation->StartingPly + variation->Moves.size(); variation = variation->Variations[0])
-		if (variation->Variations.empty())
-			throw SeekOutOfBoundsException();
+	// Remove it from the moves of the parent
+	NodeIndex* link = &m_Nodes[parent].FirstChild;
+	while (*link != node)
+		link = &m_Nodes[*link].NextSibling;
 
-	std::vector<Branch*> path;
-	path.reserve(4);  // Just an arbitrary number--variations probably won't go much farther than this
-	for (Branch* branch = variation; branch != m_Branches; branch = branch->Parent)
-		path.push_back(branch);
-	
-	for (size_t i = path.size() - 1; i > 0; i--) {
-		m_Variation = path[i];
+	*link = m_Nodes[node].NextSibling;
+
+	// Free the node and every node after it
+	m_Path.assign(1, node);
+	while (!m_Path.empty()) {
+		const NodeIndex n = m_Path.back();
+		m_Path.pop_back();
 
-		for (int m = 0; m < path[i]->Moves.size() - 1; m++)
-			Forward();
+		for (NodeIndex child = m_Nodes[n].FirstChild; child != NO_NODE; child = m_Nodes[child].NextSibling)
+			m_Path.push_back(child);
 
-		// Move the last move of the branch manually
-		// since Forward() will default to the main line
-		++m_Ply;
-		const GameMove& gm = m_Variation->Moves[m_Ply - m_Variation->StartingPly - 1];
-		m_Position.Move(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)));
+		FreeNode(n);
 	}
 
-	// Do the last branch
-	m_Variation = path[0];
-	for (; m_Ply < ply; Forward());
+	// The transpositions into the deleted moves become the end of their line
+	auto isFree = [this](NodeIndex n) { return n != GetRoot() && m_Nodes[n].Parent == NO_NODE; };
+
+	for (auto it = m_Transpositions.begin(); it != m_Transpositions.end();)
+		it = isFree(it->first) || isFree(it->second) ? m_Transpositions.erase(it) : std::next(it);
+
+	for (auto it = m_Positions.begin(); it != m_Positions.end();)
+		it = isFree(it->second) ? m_Positions.erase(it) : std::next(it);
 }
 
-void Game::Delete(uint32_t ply, Branch* variation) {
-	// Prohibit deletion of top-most branch
-	if (variation == m_Branches)
-		return;
+void Game::SetMergeTranspositions(bool merge) {
+	m_MergeTranspositions = merge;
 
-	bool isSameVariation = variation == m_Variation;
+	if (merge)
+		MergeTranspositions();
+	else
+		m_Positions.clear();
+}
+
+NodeIndex Game::GetTransposition(NodeIndex node) const {
+	auto it = m_Transpositions.find(node);
+	return it == m_Transpositions.end() ? NO_NODE : it->second;
+}
+
+NodeIndex Game::Resolve(NodeIndex node) const {
+	if (m_Transpositions.empty())
+		return node;
+
+	auto it = m_Transpositions.find(node);
+	return it == m_Transpositions.end() ? node : it->second;
+}
+
+void Game::MergeTranspositions() {
+	m_Transpositions.clear();
+	m_Positions.clear();
+	m_Crossed.clear();
+
+	// The plies of the moved nodes change
+	m_Checkpoints.clear();
+
+	// Breadth first, so the node closest to the start keeps the moves of a position
+	std::vector<bool> visited(m_Nodes.size());
+	std::deque<std::pair<NodeIndex, Board>> queue;
+	queue.emplace_back(GetRoot(), m_StartPosition);
 
-	// If ply is less than the branch's starting ply, move back
-	for (; variation->StartingPly >= ply; variation = variation->Parent, isSameVariation |= variation == m_Variation);
+	while (!queue.empty()) {
+		const auto [node, position] = std::move(queue.front());
+		queue.pop_front();
 
-	// If ply is beyond the specified branch, continue down the main line
-	for (; ply > variation->StartingPly + variation->Moves.size(); variation = variation->Variations[0], isSameVariation |= variation == m_Variation)
-		if (variation->Variations.empty())
-			throw DeleteOutOfBoundsException();
+		const auto [it, inserted] = m_Positions.try_emplace(position.GetHash(), node);
+		if (!inserted && !IsAncestor(it->second, node)) {
+			MergeNode(node, it->second, position, visited, queue);
+			m_Transpositions[node] = it->second;
+			continue;
+		}
 
-	if (ply <= m_Ply && isSameVariation)
-		Seek(ply - 1, variation);
+		visited[node] = true;
 
-	for (Branch* b : variation->Variations)
-		delete b;
-	variation->Variations.clear();
+		for (NodeIndex child = m_Nodes[node].FirstChild; child != NO_NODE; child = m_Nodes[child].NextSibling) {
+			const GameMove& gm = m_Nodes[child].Move;
+			UndoInfo undo;
 
-	variation->Moves.resize(ply - variation->StartingPly - 1);
-	if (variation->Moves.empty()) {
-		auto pos = std::find(variation->Parent->Variations.begin(), variation->Parent->Variations.end(), variation);
-		variation->Parent->Variations.erase(pos);
-		delete variation;
+			Board& next = queue.emplace_back(child, position).second;
+			next.MakeMove(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)), undo);
+		}
 	}
 }
 
-void Game::Move(GameMove move) {
-	const uint32_t maxPly = (uint32_t)m_Variation->Moves.size() + m_Variation->StartingPly;
+void Game::MergeNode(NodeIndex from, NodeIndex into, const Board& position, const std::vector<bool>& visited, std::deque<std::pair<NodeIndex, Board>>& queue) {
+	// The comments of both are kept
+	auto comment = m_Comments.find(from);
+	if (comment != m_Comments.end()) {
+		const std::string_view text = comment->second;
+		m_Comments.erase(comment);
+
+		auto [it, inserted] = m_Comments.try_emplace(into, text);
+		if (!inserted) {
+			if (it->second != text)
+				ReplaceComment(into, std::string(it->second) + " " + std::string(text));
+
+			FreeString(text);
+		}
+	}
+
+	NodeIndex child = m_Nodes[from].FirstChild;
+	m_Nodes[from].FirstChild = NO_NODE;
+
+	while (child != NO_NODE) {
+		const NodeIndex next = m_Nodes[child].NextSibling;
+		const GameMove& gm = m_Nodes[child].Move;
+
+		Board after = position;
+		UndoInfo undo;
+		after.MakeMove(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)), undo);
 
-	// If variations exist and index is on the last move of the list
-	// Or if the current branch is the top node
-	if (!m_Variation->Variations.empty() && m_Ply == maxPly) {
-		// Check if the move is one of them
-		for (Branch* var : m_Variation->Variations) {
-			if (var->Moves[0] == move) {
-				m_Variation = var;
-				m_Ply++;
-				return;
+		NodeIndex same = m_Nodes[into].FirstChild;
+		while (same != NO_NODE && !(m_Nodes[same].Move == gm))
+			same = m_Nodes[same].NextSibling;
+
+		if (same != NO_NODE) {
+			// It may have been merged already
+			same = Resolve(same);
+
+			// The move is in both, so the moves after it are merged too
+			MergeNode(child, same, after, visited, queue);
+
+			if (m_Node == child)
+				m_Node = same;
+
+			FreeNode(child);
+		} else {
+			// A new move for 'into', after its other moves
+			NodeIndex* link = &m_Nodes[into].FirstChild;
+			while (*link != NO_NODE)
+				link = &m_Nodes[*link].NextSibling;
+
+			*link = child;
+			m_Nodes[child].Parent = into;
+			m_Nodes[child].NextSibling = NO_NODE;
+
+			// The plies of the moved moves start from 'into'
+			const int64_t shift = (int64_t)m_Nodes[into].Ply + 1 - m_Nodes[child].Ply;
+			m_Path.assign(1, child);
+			while (!m_Path.empty()) {
+				const NodeIndex n = m_Path.back();
+				m_Path.pop_back();
+
+				m_Nodes[n].Ply = (uint32_t)(m_Nodes[n].Ply + shift);
+				for (NodeIndex c = m_Nodes[n].FirstChild; c != NO_NODE; c = m_Nodes[c].NextSibling)
+					m_Path.push_back(c);
 			}
+
+			// The moves of a node that was already visited aren't in the queue
+			if (visited[into])
+				queue.emplace_back(child, after);
 		}
-		
-		// Create a new branch for new move
-		m_Variation->Variations.push_back(new Branch(m_Variation, m_Ply));
-		// Make the current variation the new branch
-		m_Variation = m_Variation->Variations.back();
-	}
-	else if (m_Ply < maxPly) {
-		// If the next move is already in the tree, advance
-		// the index and return. Otherwise, split the tree
-		if (m_Variation->Moves[m_Ply - m_Variation->StartingPly - 1] == move) {
-			m_Ply++;
+
+		child = next;
+	}
+}
+
+void Game::Move(GameMove move, AlgebraicMove san) {
+	// After a transposition, the moves are in the node it transposes into
+	const NodeIndex node = Resolve(m_Node);
+
+	// If the move is already in the tree, go to it
+	for (NodeIndex child = m_Nodes[node].FirstChild; child != NO_NODE; child = m_Nodes[child].NextSibling) {
+		if (m_Nodes[child].Move == move) {
+			Step(child);
 			return;
 		}
+	}
 
-		// Reserve space
-		m_Variation->Variations.reserve(m_Variation->Variations.capacity() + 2);
-
-		// Create new branch for old moves
-		Branch* oldMoves = new Branch(m_Variation, m_Ply);
-		// The index of the first move to copy
-		size_t offset = m_Ply - m_Variation->StartingPly;
-		// Copy the old moves into the new branch
-		std::copy(m_Variation->Moves.begin() + offset, m_Variation->Moves.end(), std::back_inserter(oldMoves->Moves));
-		// Move old variations to new branch
-		if (!m_Variation->Variations.empty())
-			oldMoves->Variations = std::move(m_Variation->Variations);
-		m_Variation->Variations.push_back(oldMoves);
-		// Delete old moves from old branch
-		m_Variation->Moves.erase(m_Variation->Moves.begin() + offset, m_Variation->Moves.end());
+	// Otherwise it is the main line if there are no other moves, or a new variation
+	Step(NewNode(node, move, san));
 
-		// Create new branch for new move
-		Branch* newMoves = new Branch(m_Variation, m_Ply);
-		// Add variation to old branch
-		m_Variation->Variations.push_back(newMoves);
-		// Change index to new variation
-		m_Variation = newMoves;
+	if (m_MergeTranspositions) {
+		const auto [it, inserted] = m_Positions.try_emplace(m_Position.GetHash(), m_Node);
+		if (!inserted && !IsAncestor(it->second, m_Node))
+			m_Transpositions[m_Node] = it->second;
 	}
+}
+
+std::string_view Game::CopyString(std::string_view text, char newline) {
+	char* copy = (char*)m_Pool.allocate(text.size(), 1);
+	std::replace_copy(text.begin(), text.end(), copy, '\n', newline);
 
-	m_Variation->Moves.emplace_back(std::move(move));
-	m_Ply++;
+	return std::string_view(copy, text.size());
 }
 
+size_t Game::Pool::GetSize(size_t bytes, size_t alignment) {
+	if (bytes > LARGEST_BLOCK || alignment > alignof(std::max_align_t))
+		return SIZE_COUNT;
 
-void Game::SetComment(const std::string& comment) {
-	m_Variation->Moves[m_Ply - m_Variation->StartingPly - 1].Comment = comment;
+	size_t size = 0;
+	while ((SMALLEST_BLOCK << size) < bytes)
+		size++;
+
+	return size;
 }
 
-void Game::SetComment(std::string&& comment) {
-	m_Variation->Moves[m_Ply - m_Variation->StartingPly - 1].Comment = std::move(comment);
+void* Game::Pool::do_allocate(size_t bytes, size_t alignment) {
+	const size_t size = GetSize(bytes, alignment);
+	if (size == SIZE_COUNT)
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+
+	void* block = m_FreeBlocks[size];
+	if (block == nullptr)
+		return m_Arena->allocate(SMALLEST_BLOCK << size, alignof(std::max_align_t));
+
+	m_FreeBlocks[size] = *(void**)block;
+	return block;
 }
 
-void Game::FromPGN(const std::string& pgn) {
-	// Resets the moves
-	for (Branch* b : m_Branches->Variations)
-		delete b;
-	m_Branches->Variations.resize(1);
-	Branch* newBranch = new Branch(m_Branches, 0);
-	m_Branches->Variations[0] = newBranch;
-	m_Variation = newBranch;
-
-	StringParser sp(pgn);
-	while (sp.JumpPast("[")) {
-		auto key = sp.Next<std::string_view>();
-		sp.JumpPast("\"");
-		auto value = sp.Next("\"");
-		
-		if (!(key || value))
-			throw InvalidPgnException("Invalid tag in PGN header!");
-
-		if (key.value() == "FEN") {
-			m_Position.FromFEN(std::string(value.value()));
-			m_Ply = m_Position.GetFullMoves() * 2 - 2 + (m_Position.GetPlayerTurn() == Black);
-			m_Variation->StartingPly = m_Ply;
-		}
+void Game::Pool::do_deallocate(void* p, size_t bytes, size_t alignment) {
+	const size_t size = GetSize(bytes, alignment);
+	if (size == SIZE_COUNT) {
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		return;
+	}
+
+	*(void**)p = m_FreeBlocks[size];
+	m_FreeBlocks[size] = p;
+}
+
+void Game::FreeString(std::string_view text) {
+	m_Pool.deallocate((void*)text.data(), text.size(), 1);
+}
 
-		m_Header[std::string(key.value())] = value.value();
+void Game::ReplaceComment(NodeIndex node, std::string_view comment, char newline) {
+	// Copied before the old text is freed, in case it is part of it
+	const std::string_view copy = CopyString(comment, newline);
+	auto [it, inserted] = m_Comments.try_emplace(node, copy);
+	if (!inserted) {
+		FreeString(it->second);
+		it->second = copy;
 	}
-	sp.JumpPast("]");
+}
 
-	const bool checkResult = m_Header.count("Result");
+void Game::EraseComment(NodeIndex node) {
+	auto it = m_Comments.find(node);
+	if (it != m_Comments.end()) {
+		FreeString(it->second);
+		m_Comments.erase(it);
+	}
+}
 
-	// Parse the moves
-	while (auto m = sp.Next<std::string_view>()) {
-		std::string_view move = m.value();
-		
-		if (checkResult)
-			if (move == m_Header.at("Result"))
-				break;
+std::string_view Game::GetComment(NodeIndex node) const {
+	auto it = m_Comments.find(Resolve(node));
+	return it == m_Comments.end() ? std::string_view() : it->second;
+}
+
+void Game::SetComment(NodeIndex node, std::string_view comment) {
+	node = Resolve(node);
+
+	if (comment.empty())
+		EraseComment(node);
+	else
+		ReplaceComment(node, comment);
+}
 
-		if (move.front() == '(') {
+void Game::FromPGN(std::string_view pgn) {
+	// Resets the moves
+	ResetTree();
+
+	// The variations that are open, innermost last: the node to go back to after each one, and the moves played in it
+	// (a stack instead of recursion, so deeply nested variations can't overflow the call stack)
+	std::vector<std::pair<NodeIndex, uint32_t>> variations;
+
+	// Goes back to where the innermost variation started
+	auto endVariation = [this, &variations]() {
+		const auto [resume, moveCount] = variations.back();
+		variations.pop_back();
+
+		for (uint32_t i = 0; i < moveCount; i++)
 			Back();
-			ParseVariation(sp);
-			Forward();
-		}
-		else {
-			if (move.back() == '.')
-				continue;
 
-			if (move.front() == '{') {
-				std::string_view comment = sp.Reread("}").value_or("");
+		Enter(resume);
+	};
+
+	PgnLexer lexer(pgn);
+	PgnToken token;
+	bool ended = false;
 
-				// Remove the '{' from the beginning
-				comment.remove_prefix(1);
+	while (!ended && lexer.Next(token)) {
+		switch (token.Type) {
+			case PgnTokenType::Tag: {
+				const std::string unescaped = token.Escaped ? PgnLexer::Unescape(token.Value) : std::string();
+				const std::string_view value = token.Escaped ? std::string_view(unescaped) : token.Value;
 
-				// Replace all '\n' with ' '
-				std::string c(comment);
-				for (size_t i = c.find('\n'); i != std::string::npos; i = c.find('\n', i))
-					c[i] = ' ';
+				// The starting position can't change once there are moves
+				if (token.Text == "FEN" && m_Nodes[GetRoot()].FirstChild == NO_NODE) {
+					m_StartPosition.FromFEN(std::string(value));
+					m_Position = m_StartPosition;
+					m_Nodes[GetRoot()].Ply = m_Position.GetFullMoves() * 2 - 2 + (m_Position.GetPlayerTurn() == Black);
+				}
 
-				SetComment(std::move(c));
-				continue;
+				m_Header.Set(token.Text, value);
+				break;
+			}
+			case PgnTokenType::Move: {
+				AlgebraicMove move;
+				try {
+					move = AlgebraicMove(token.Text);
+				} catch (const InvalidAlgebraicMoveException&) {
+					throw InvalidPgnException("Invalid move in PGN! " + std::string(token.Text));
+				}
+
+				Move(move);
+				if (!variations.empty())
+					variations.back().second++;
+				break;
 			}
+			case PgnTokenType::Comment: {
+				const size_t first = token.Text.find_first_not_of(" \t\r\n");
+				if (first == std::string_view::npos)
+					break;
+
+				const std::string_view text = token.Text.substr(first, token.Text.find_last_not_of(" \t\r\n") + 1 - first);
+
+				// Replace all '\n' with ' ', and keep every comment of a move
+				auto it = m_Comments.find(m_Node);
+				if (it == m_Comments.end())
+					m_Comments.emplace(m_Node, CopyString(text, ' '));
+				else
+					ReplaceComment(m_Node, std::string(it->second) + " " + std::string(text), ' ');
+				break;
+			}
+			case PgnTokenType::VariationStart:
+				// The variation replaces the last move, so there has to be one
+				if (m_Node == GetRoot())
+					throw InvalidPgnException("Variation before any move in PGN!");
 
-			Move(AlgebraicMove(move));
+				variations.emplace_back(m_Node, 0);
+				Back();
+				break;
+			case PgnTokenType::VariationEnd:
+				if (variations.empty())
+					throw InvalidPgnException("Unmatched ')' in PGN!");
+
+				endVariation();
+				break;
+			case PgnTokenType::Result:
+				ended = true;
+				break;
+			case PgnTokenType::MoveNumber:
+			case PgnTokenType::Nag:
+				// The moves have their ply, and the tree has no annotations
+				break;
 		}
 	}
+
+	// Variations that aren't closed end with the text
+	while (!variations.empty())
+		endVariation();
 }
 
-void Game::ParseVariation(StringParser& sp) {
-	uint32_t moveCount = 0;
+static void WriteU16(std::string& output, uint16_t value) {
+	output += (char)(value & 0xFF);
+	output += (char)(value >> 8);
+}
 
-	while (auto m = sp.Next<std::string_view>()) {
-		std::string_view move = m.value();
+static void WriteU32(std::string& output, uint32_t value) {
+	WriteU16(output, (uint16_t)(value & 0xFFFF));
+	WriteU16(output, (uint16_t)(value >> 16));
+}
 
-		if (move.front() == '(') {
-			Back();
-			ParseVariation(sp);
-			Forward();
-		}
-		else {
-			if (move.back() == '.')
-				continue;
-
-			if (move.front() == '{') {
-				std::string_view comment = sp.Reread("}").value_or("");
-				comment.remove_prefix(1); // Remove the '{' from the beginning
-				SetComment(std::string(comment));
-				continue;
-			}
+// Reads the binary format of Serialize(), throwing if the data is too short
+class BinaryReader {
+public:
+	BinaryReader(std::string_view data) : m_Data(data) {}
 
-			if (move.back() == ')') {
-				move.remove_suffix(1); // Remove the ')' from the end
+	uint8_t U8() { return (uint8_t)Bytes(1)[0]; }
 
-				Move(AlgebraicMove(move));
-				moveCount++;
+	uint16_t U16() {
+		const std::string_view b = Bytes(2);
+		return (uint8_t)b[0] | (uint8_t)b[1] << 8;
+	}
 
-				for (uint32_t i = 0; i < moveCount; i++)
-					Back();
+	uint32_t U32() {
+		const uint32_t low = U16();
+		return low | (uint32_t)U16() << 16;
+	}
 
-				Forward();
+	uint64_t U64() {
+		const uint64_t low = U32();
+		return low | (uint64_t)U32() << 32;
+	}
 
-				break;
-			}
+	size_t GetPosition() const { return m_Position; }
 
-			Move(AlgebraicMove(move));
-			moveCount++;
-		}
+	std::string_view Bytes(size_t size) {
+		if (size > m_Data.size() - m_Position)
+			throw InvalidGameDataException("The game data is cut short!");
+
+		m_Position += size;
+		return m_Data.substr(m_Position - size, size);
+	}
+private:
+	std::string_view m_Data;
+	size_t m_Position = 0;
+};
+
+// Checksum of the bytes, 8 at a time in 4 lanes (so the multiplications don't wait for each other):
+// a change to any one of them always changes it
+static uint64_t Checksum(std::string_view data, uint64_t checksum) {
+	static constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+	auto mix = [](uint64_t& lane, uint64_t word) {
+		lane = (lane ^ word) * MULTIPLIER;
+		lane ^= lane >> 29;
+	};
+
+	uint64_t lanes[4] = { checksum, 1, 2, 3 };
+	size_t i = 0;
+	for (; i + 32 <= data.size(); i += 32) {
+		uint64_t words[4];
+		std::memcpy(words, data.data() + i, 32);
+		for (int lane = 0; lane < 4; lane++)
+			mix(lanes[lane], words[lane]);
+	}
+
+	for (; i + 8 <= data.size(); i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data.data() + i, 8);
+		mix(lanes[0], word);
+	}
+
+	uint64_t last = data.size();
+	for (size_t shift = 8; i < data.size(); i++, shift += 8)
+		last |= (uint64_t)(uint8_t)data[i] << shift;
+
+	for (int lane = 1; lane < 4; lane++)
+		mix(lanes[0], lanes[lane]);
+
+	mix(lanes[0], last);
+	return lanes[0];
+}
+
+// The checksum of a game written by Serialize(), without its own 8 bytes at 'offset'
+static uint64_t GameChecksum(std::string_view game, size_t offset) {
+	return Checksum(game.substr(offset + 8), Checksum(game.substr(0, offset), 0));
+}
+
+void Game::Serialize(std::string& output) const {
+	const size_t start = output.size();
+	WriteU32(output, 0);  // The size, when it is known
+	output += (char)SERIALIZED_VERSION;
+
+	uint16_t tags = 0;
+	m_Header.ForEach([&tags](std::string_view, std::string_view) { tags++; });
+	WriteU16(output, tags);
+
+	m_Header.ForEach([&output](std::string_view tag, std::string_view value) {
+		value = value.substr(0, 0xFFFF);
+		WriteU16(output, (uint16_t)tag.size());
+		output += tag;
+		WriteU16(output, (uint16_t)value.size());
+		output += value;
+	});
+
+	// Number the nodes in tree order: a node, the nodes after it, then its next sibling
+	std::vector<NodeIndex> order;
+	std::vector<uint32_t> numbers(m_Nodes.size());
+	std::vector<NodeIndex> stack = { GetRoot() };
+
+	while (!stack.empty()) {
+		const NodeIndex node = stack.back();
+		stack.pop_back();
+
+		numbers[node] = (uint32_t)order.size();
+		order.push_back(node);
+
+		if (m_Nodes[node].NextSibling != NO_NODE)
+			stack.push_back(m_Nodes[node].NextSibling);
+
+		if (m_Nodes[node].FirstChild != NO_NODE)
+			stack.push_back(m_Nodes[node].FirstChild);
 	}
+
+	WriteU32(output, m_Nodes[GetRoot()].Ply);
+	WriteU32(output, numbers[m_Node]);
+	WriteU32(output, (uint32_t)order.size());
+
+	uint8_t position[Board::PACKED_SIZE];
+	m_Position.ToPacked(position);
+	output.append((const char*)position, sizeof(position));
+
+	const size_t checksumOffset = output.size() - start;
+	WriteU32(output, 0);  // The checksum, when the rest is written
+	WriteU32(output, 0);
+
+	WriteU32(output, (uint32_t)m_Comments.size());
+	for (const auto& [node, comment] : m_Comments) {
+		WriteU32(output, numbers[node]);
+		WriteU32(output, (uint32_t)comment.size());
+		output += comment;
+	}
+
+	WriteU32(output, (uint32_t)m_Transpositions.size());
+	for (const auto& [node, target] : m_Transpositions) {
+		WriteU32(output, numbers[node]);
+		WriteU32(output, numbers[target]);
+	}
+
+	for (NodeIndex node : order) {
+		const GameNode& n = m_Nodes[node];
+		WriteU16(output, n.Move.Start | n.Move.Destination << 6 | (n.Move.Flags & GameMoveFlag::PromotionFlags) << 12);
+
+		output += (char)n.Move.MovingPiece;
+		output += (char)n.Move.DestinationPiece;
+		output += (char)n.Move.Flags;
+		output += (char)n.San.Specifier;
+		output += (char)n.San.Flags;
+		output += (char)((n.FirstChild != NO_NODE) * SERIALIZED_CHILDREN | (n.NextSibling != NO_NODE) * SERIALIZED_SIBLING);
+	}
+
+	const uint32_t size = (uint32_t)(output.size() - start);
+	for (int i = 0; i < 4; i++)
+		output[start + i] = (char)(size >> (8 * i));
+
+	const uint64_t checksum = GameChecksum(std::string_view(output).substr(start), checksumOffset);
+	for (int i = 0; i < 8; i++)
+		output[start + checksumOffset + i] = (char)(checksum >> (8 * i));
+}
+
+size_t Game::Deserialize(std::string_view data, bool trusted) {
+	try {
+		return ReadSerialized(data, trusted);
+	} catch (const InvalidGameDataException&) {
+	} catch (const InvalidFenException&) {
+	}
+
+	// An empty game instead of a part of the data
+	ResetTree();
+	m_StartPosition.Reset();
+	m_Position = m_StartPosition;
+	return 0;
 }
 
-// Very delicately tacked-together code (it's all weird formatting tricks)
-static std::ostream& PrintBranch(std::ostream& os, Board& board, const Branch& branch, bool offset) {
-	if ((branch.StartingPly + offset) % 2 == 1 && !offset)
-		os << branch.StartingPly / 2 + 1 << "... ";
+size_t Game::ReadSerialized(std::string_view data, bool trusted) {
+	BinaryReader reader(data);
+
+	const uint32_t size = reader.U32();
+	if (size > data.size() || reader.U8() != SERIALIZED_VERSION)
+		throw InvalidGameDataException("Invalid game data!");
+
+	reader = BinaryReader(data.substr(0, size));
+	reader.Bytes(5);
+
+	ResetTree();
+	m_StartPosition.Reset();
+
+	for (uint16_t tags = reader.U16(); tags > 0; tags--) {
+		const std::string_view tag = reader.Bytes(reader.U16());
+		const std::string_view value = reader.Bytes(reader.U16());
+
+		if (tag == "FEN")
+			m_StartPosition.FromFEN(std::string(value));
+
+		m_Header.Set(tag, value);
+	}
+
+	m_Nodes[GetRoot()].Ply = reader.U32();
+	const uint32_t current = reader.U32();
+	const uint32_t count = reader.U32();
 
-	// Print the moves of the current branch
-	for (uint32_t i = offset; i < branch.Moves.size(); i++) {
-		uint32_t ply = branch.StartingPly + i;
+	if (count == 0 || current >= count || count > size / 8)
+		throw InvalidGameDataException("Invalid game data!");
 
-		if (ply % 2 == 0)
-			os << ply / 2 + 1 << ". ";
+	const uint8_t* saved = (const uint8_t*)reader.Bytes(Board::PACKED_SIZE).data();
 
-		os << board.Move(LongAlgebraicMove(branch.Moves[i].Start, branch.Moves[i].Destination, (PieceType)(branch.Moves[i].Flags & GameMoveFlag::PromotionFlags)));
-		if (!branch.Moves[i].Comment.empty()) {
-			os << " {" << branch.Moves[i].Comment << "}";
+	// Trusted data was written by Serialize(), so the checksum only has to show it hasn't changed since
+	const size_t checksumOffset = reader.GetPosition();
+	const uint64_t checksum = reader.U64();
+	if (trusted && checksum != GameChecksum(data.substr(0, size), checksumOffset))
+		throw InvalidGameDataException("Invalid game data!");
 
-			if (i < branch.Moves.size() - 1 && ply % 2 == 0)
-				os << " " << ply / 2 + 1 << "...";
+	for (uint32_t comments = reader.U32(); comments > 0; comments--) {
+		const uint32_t node = reader.U32();
+		const std::string_view comment = reader.Bytes(reader.U32());
+
+		if (node >= count)
+			throw InvalidGameDataException("Invalid game data!");
+
+		ReplaceComment(node, comment);
+	}
+
+	for (uint32_t transpositions = reader.U32(); transpositions > 0; transpositions--) {
+		const uint32_t node = reader.U32();
+		const uint32_t target = reader.U32();
+
+		if (node >= count || target >= count || node == target)
+			throw InvalidGameDataException("Invalid game data!");
+
+		m_Transpositions[node] = target;
+	}
+
+	const uint8_t* records = (const uint8_t*)reader.Bytes((size_t)count * 8).data();
+	m_Nodes.resize(count);
+
+	// The nodes that have a next sibling that hasn't been read yet
+	m_Path.clear();
+	uint8_t links = records[7];  // Of the node before
+
+	for (NodeIndex node = 1; node < count; node++) {
+		const uint8_t* record = records + 8 * node;
+
+		// The first move after the node before, or the next sibling of the last node that has one
+		NodeIndex parent = node - 1;
+		if (links & SERIALIZED_CHILDREN) {
+			m_Nodes[parent].FirstChild = node;
+		} else {
+			if (m_Path.empty())
+				throw InvalidGameDataException("Invalid game data!");
+
+			m_Nodes[m_Path.back()].NextSibling = node;
+			parent = m_Nodes[m_Path.back()].Parent;
+			m_Path.pop_back();
 		}
 
-		if (i < branch.Moves.size() - 1 || branch.Variations.size() > 0)
-			os << " ";
+		links = record[7];
+		if (links & SERIALIZED_SIBLING)
+			m_Path.push_back(node);
+
+		// The promotion is in the move and in the flags
+		const uint16_t move = record[0] | record[1] << 8;
+		if ((move >> 12) != (record[4] & GameMoveFlag::PromotionFlags))
+			throw InvalidGameDataException("Invalid game data!");
+
+		const GameMove gameMove = { (Square)(move & 0x3F), (Square)((move >> 6) & 0x3F), (Piece)record[2], (Piece)record[3], record[4] };
+		const AlgebraicMove san(GetPieceType(gameMove.MovingPiece), gameMove.Destination, record[5], record[6]);
+
+		m_Nodes[node] = GameNode{ gameMove, san, m_Nodes[parent].Ply + 1, parent };
 	}
-	
-	if (branch.Variations.size() > 0) {
-		if (branch.Variations[0]->Moves.empty())
-			return os;
-
-		// Print the first move of the first branch (main line)
-		uint32_t ply = branch.Variations[0]->StartingPly;
-		if (ply % 2 == 0)
-			os << ply / 2 + 1 << ".";
-
-		GameMove& move = branch.Variations[0]->Moves[0];
-		PieceType movePromotion = (PieceType)(move.Flags & GameMoveFlag::PromotionFlags);
-		os << board.Move(LongAlgebraicMove(move.Start, move.Destination, movePromotion)) << " ";
-		if (!move.Comment.empty())
-			os << " {" << move.Comment << "} ";
-		board.UndoMove(move);
-
-		// Print the rest of the branches
-		for (uint32_t b = 1; b < branch.Variations.size(); b++) {
-			os << "(";
-
-			PrintBranch(os, board, *branch.Variations[b], false);
-
-			// Undo moves on board to reset the position
-			// to before the beginning of the branch
-			for (size_t j = branch.Variations[b]->Moves.size() - 1; j < branch.Variations[b]->Moves.size(); j--)
-				board.UndoMove(branch.Variations[b]->Moves[j]);
-
-			os << ") ";
+
+	if ((links & SERIALIZED_CHILDREN) || !m_Path.empty())
+		throw InvalidGameDataException("Invalid game data!");
+
+	// The moves after a transposition are in the node it transposes into
+	for (const auto& [node, target] : m_Transpositions) {
+		if (m_Nodes[node].FirstChild != NO_NODE || m_Transpositions.count(target))
+			throw InvalidGameDataException("Invalid game data!");
+	}
+
+	if (trusted) {
+		// No move is played: the current position was saved with them
+		m_Node = current;
+		m_Position.FromPacked(saved);
+
+		if (m_MergeTranspositions)
+			MergeTranspositions();
+
+		return size;
+	}
+
+	// Every move is played from the position before it, so the moves that GoTo() and Forward() play later are legal
+	// The nodes are in tree order: a node is after its parent, or after the end of the line of its previous sibling,
+	// so only the positions before variations are kept, and they are needed in the reverse order they were saved
+	std::vector<std::pair<NodeIndex, Board>> branches;
+	std::vector<uint64_t> hashes(m_Transpositions.empty() ? 0 : count);
+	if (!hashes.empty())
+		hashes[0] = m_StartPosition.GetHash();
+
+	Board position = m_StartPosition;
+	NodeIndex positionNode = GetRoot();
+	m_Position = m_StartPosition;
+
+	for (NodeIndex node = 1; node < count; node++) {
+		const GameNode& n = m_Nodes[node];
+		if (n.Parent != positionNode) {
+			while (!branches.empty() && branches.back().first != n.Parent)
+				branches.pop_back();
+
+			if (branches.empty())
+				throw InvalidGameDataException("Invalid game data!");
+
+			position = branches.back().second;
 		}
 
-		// Redo the first move of the first branch
-		board.Move(LongAlgebraicMove(move.Start, move.Destination, movePromotion));
+		if (n.NextSibling != NO_NODE && (branches.empty() || branches.back().first != n.Parent))
+			branches.emplace_back(n.Parent, position);
 
-		// Print the rest of the first branch (main line)
-		PrintBranch(os, board, *branch.Variations[0], true);
+		if (!IsValidMove(position, n.Move, n.San))
+			throw InvalidGameDataException("Invalid game data!");
 
-		// Undo the moves of the first branch
-		for (size_t j = branch.Variations[0]->Moves.size() - 1; j < branch.Variations[0]->Moves.size(); j--)
-			board.UndoMove(branch.Variations[0]->Moves[j]);
+		UndoInfo undo;
+		position.MakeMove(LongAlgebraicMove(n.Move.Start, n.Move.Destination, (PieceType)(n.Move.Flags & GameMoveFlag::PromotionFlags)), undo);
+		positionNode = node;
+
+		if (!hashes.empty())
+			hashes[node] = position.GetHash();
+
+		if (node == current)
+			m_Position = position;
 	}
-	
-	return os;
+
+	// A transposition is to the same position, and the current position is the one that was saved
+	// (but for the move counters, which are those of the line the game went through to get there)
+	for (const auto& [node, target] : m_Transpositions) {
+		if (hashes[node] != hashes[target])
+			throw InvalidGameDataException("Invalid game data!");
+	}
+
+	uint8_t packed[Board::PACKED_SIZE];
+	m_Position.ToPacked(packed);
+	if (std::memcmp(packed, saved, Board::PACKED_COUNTERS) != 0)
+		throw InvalidGameDataException("Invalid game data!");
+
+	m_Position.FromPacked(saved);
+
+	m_Node = current;
+
+	if (m_MergeTranspositions)
+		MergeTranspositions();
+
+	return size;
 }
 
-std::ostream& operator<<(std::ostream& os, const Game& game) {
-	// Output the header
-	for (const auto& [key, value] : game.m_Header)
-		os << "[" << key << " \"" << value << "\"]\n";
-	
-	if (game.m_Branches) {
-		Board board;
-		if (game.m_Header.count("FEN")) {
-			if (game.m_Branches->Variations[0]->StartingPly % 2 == 1)
-				os << "\n" << game.m_Branches->Variations[0]->StartingPly / 2 + 1 << "...";
+bool Game::IsValidMove(const Board& position, const GameMove& move, const AlgebraicMove& san) {
+	const Piece piece = position[move.Start];
+	const PieceType promotion = (PieceType)(move.Flags & GameMoveFlag::PromotionFlags);
+	const LongAlgebraicMove lam(move.Start, move.Destination, promotion);
+
+	if (piece == Piece::None || GetColour(piece) != position.GetPlayerTurn() || !position.IsMoveLegal(lam))
+		return false;
+
+	// Only a pawn on the last rank promotes, and it has to
+	const bool promotes = GetPieceType(piece) == Pawn && ((1ull << move.Destination) & 0xFF000000000000FF);
+	if (promotes ? (promotion < Knight || promotion > Queen) : promotion != Pawn)
+		return false;
+
+	// The flags are the ones the move has in the position (castling from PGN doesn't fill in the pieces)
+	const GameMove expected = ToGameMove(position, lam);
+	if (move.Flags != expected.Flags)
+		return false;
+
+	if (!(expected.Flags & GameMoveFlag::CastlingFlags) &&
+		(move.MovingPiece != expected.MovingPiece || move.DestinationPiece != expected.DestinationPiece))
+		return false;
+
+	// The SAN is written from its own flags
+	const MoveFlags sanFlags = MoveFlag::PromotionFlags | MoveFlag::CastlingFlags;
+	return (san.Flags & sanFlags) == (expected.Flags & sanFlags);
+}
+
+size_t Game::DeserializeMainLine(std::string_view data, std::string& fen, std::vector<LongAlgebraicMove>& moves) {
+	BinaryReader reader(data);
+
+	const uint32_t size = reader.U32();
+	if (size > data.size() || reader.U8() != SERIALIZED_VERSION)
+		throw InvalidGameDataException("Invalid game data!");
+
+	reader = BinaryReader(data.substr(0, size));
+	reader.Bytes(5);
+
+	fen.clear();
+	moves.clear();
+
+	for (uint16_t tags = reader.U16(); tags > 0; tags--) {
+		const std::string_view tag = reader.Bytes(reader.U16());
+		const std::string_view value = reader.Bytes(reader.U16());
 
-			board.FromFEN(game.m_Header.at("FEN"));
+		if (tag == "FEN")
+			fen = value;
+	}
+
+	reader.Bytes(8);  // Ply of the root and current node
+	const uint32_t count = reader.U32();
+	if (count == 0 || count > size / 8)
+		throw InvalidGameDataException("Invalid game data!");
+
+	reader.Bytes(Board::PACKED_SIZE + 8);  // The current position and the checksum
+
+	for (uint32_t comments = reader.U32(); comments > 0; comments--) {
+		reader.Bytes(4);
+		reader.Bytes(reader.U32());
+	}
+
+	std::vector<std::pair<uint32_t, uint32_t>> transpositions(reader.U32());
+	for (auto& [node, target] : transpositions) {
+		node = reader.U32();
+		target = reader.U32();
+
+		if (node >= count || target >= count)
+			throw InvalidGameDataException("Invalid game data!");
+	}
+
+	const uint8_t* records = (const uint8_t*)reader.Bytes((size_t)count * 8).data();
+
+	// The first move after a node is the next node, so the main line is read straight through
+	// until it ends, or reaches a transposition (where it goes on after the node it transposes into)
+	uint32_t node = 0;
+	for (uint32_t steps = 0; steps < count; steps++) {
+		if (records[8 * node + 7] & SERIALIZED_CHILDREN) {
+			if (++node >= count)
+				throw InvalidGameDataException("Invalid game data!");
+
+			const uint8_t* record = records + 8 * node;
+			const uint16_t move = record[0] | record[1] << 8;
+			if ((move >> 12) > Queen)
+				throw InvalidGameDataException("Invalid game data!");
+
+			moves.emplace_back((Square)(move & 0x3F), (Square)((move >> 6) & 0x3F), (PieceType)(move >> 12));
+			continue;
 		}
-		PrintBranch(os, board, *game.m_Branches, false);
+
+		const auto transposition = std::find_if(transpositions.begin(), transpositions.end(),
+			[node](const std::pair<uint32_t, uint32_t>& t) { return t.first == node; });
+		if (transposition == transpositions.end())
+			break;
+
+		node = transposition->second;
 	}
 
+	return size;
+}
+
+std::ostream& operator<<(std::ostream& os, const Game& game) {
+	PgnWriter writer(os, { 0 });
+	writer.WriteHeader(game);
+	writer.WriteMovetext(game);
+
 	return os;
 }
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "Board.h"
-#include "Utility/StringParser.h"
+#include "GameHeader.h"
 
+#include <array>
+#include <cstddef>
+#include <deque>
 #include <filesystem>
+#include <memory_resource>
 #include <ostream>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -45,8 +51,6 @@ struct GameMove {
 	Piece DestinationPiece;
 	GameMoveFlags Flags = 0;
 
-	std::string Comment;
-
 	bool operator==(const GameMove& m) const {
 		return Start == m.Start
 			&& Destination == m.Destination
@@ -56,52 +60,98 @@ struct GameMove {
 	}
 };
 
-// A series of moves without variations
-// As soon as a variation starts, the
-// 'Variations' vector is populated
-struct Branch {
-	// Index into 'Branches' in 'Game'
-	Branch* Parent;
-
-	// The ply number before the first move of 'Moves'
-	uint32_t StartingPly;
+// Index of a node in the tree of a game
+using NodeIndex = uint32_t;
 
-	std::vector<GameMove> Moves;
+constexpr NodeIndex NO_NODE = 0xFFFFFFFF;
 
-	// Index 0 is the main line
-	std::vector<Branch*> Variations;
+// A move in the tree of a game
+// The nodes of a game are in one array and link to each other by index,
+// so the tree is contiguous and can be copied with memcpy
+// The first child is the main line, and its siblings are the variations
+struct GameNode {
+	GameMove Move;  // Unused for the root
+	// The move in standard algebraic notation, saved when it is added
+	// so the game can be written without playing the moves again
+	AlgebraicMove San;
 
-	Branch(Branch* parent, uint32_t startingPly)
-		: Parent(parent), StartingPly(startingPly) {
-	}
-
-	~Branch() {
-		for (Branch* b : Variations)
-			delete b;
-	}
+	// The ply number after the move (the starting ply for the root)
+	uint32_t Ply;
 
-	Branch(const Branch&) = delete;
-	Branch(Branch&&) = delete;
-
-	Branch& operator=(const Branch&) = delete;
-	Branch& operator=(Branch&&) = delete;
+	NodeIndex Parent = NO_NODE;
+	NodeIndex FirstChild = NO_NODE;
+	NodeIndex NextSibling = NO_NODE;
 };
 
-// TODO: Make function that parses file with multiple games
-// std::vector<Game> ParseGames(const std::filesystem::path& path);
+static_assert(std::is_trivially_copyable_v<GameNode>);
+
+// Files with multiple games are read with PgnReader (PgnReader.h), and written with PgnWriter (PgnWriter.h)
 
 class Game {
-	friend std::ostream& operator<<(std::ostream&, const Game&);
 public:
 	Game();
-	Game(const std::string& pgn);
+	Game(std::string_view pgn);  // Parsed in place (not copied)
+	Game(const std::string& pgn) : Game(std::string_view(pgn)) {}
+	Game(const char* pgn) : Game(std::string_view(pgn)) {}
+
+	Game(const Game& other);
 	~Game();
+	Game& operator=(const Game& other);
 
 	std::string ToPGN() const;
 
-	const Board& GetPosition()    const { return m_Position; }
-	uint32_t CurrentPly()         const { return m_Ply; }
-	Branch* CurrentVariation()    const { return m_Variation; }
+	// Appends the game to 'output' in a compact binary format (little endian):
+	//     size of the game in bytes (4 bytes), version (1 byte)
+	//     header: number of tags (2 bytes), then each tag and value (2 byte length and the text)
+	//     ply of the root (4 bytes), current node (4 bytes), number of nodes (4 bytes)
+	//     the current position (Board::PACKED_SIZE bytes, see Board::ToPacked())
+	//     checksum of every other byte of the game (8 bytes)
+	//     comments: number of comments (4 bytes), then each node (4 bytes) and its text (4 byte length and the text)
+	//     transpositions: number of them (4 bytes), then each node and the node it transposes into (4 bytes each)
+	//     the nodes in tree order (each move before the moves after it, and those before its variations), 8 bytes each:
+	//         move (2 bytes): source square | destination square << 6 | promotion << 12
+	//         moving piece, captured piece, GameMoveFlags, SAN specifier and SAN flags (1 byte each)
+	//         links (1 byte): SERIALIZED_CHILDREN if the moves after it follow it,
+	//             SERIALIZED_SIBLING if another move from the same position comes after those
+	// The nodes are numbered in that order, starting with the root (which has no move)
+	void Serialize(std::string& output) const;
+	// Replaces the game with one written by Serialize(), read straight from 'data' (for example from a MappedFile)
+	// No SAN is parsed, but each move is played from the position before it to check that it is legal
+	// Trusted data (that this program wrote, like a cache or an undo snapshot in memory) is only checked against
+	// its checksum, and the current position is read instead of played, which is several times faster
+	// Returns the number of bytes read, so games written one after another can be read in turn
+	// Returns 0 (and the game is empty) if the data is cut short or isn't a valid game
+	size_t Deserialize(std::string_view data, bool trusted = false);
+	// Reads only the FEN tag ('fen' is empty without one) and the moves of the main line (through transpositions)
+	// of a game written by Serialize(), for replaying many games without building their trees
+	// The moves aren't played, so the data should be from a game that was written by Serialize()
+	// Returns the number of bytes of the game, throws InvalidGameDataException if the data is cut short or isn't a game
+	static size_t DeserializeMainLine(std::string_view data, std::string& fen, std::vector<LongAlgebraicMove>& moves);
+
+	static constexpr uint8_t SERIALIZED_VERSION = 3;
+	static constexpr uint8_t SERIALIZED_CHILDREN = 1;
+	static constexpr uint8_t SERIALIZED_SIBLING = 2;
+
+	const Board& GetPosition()      const { return m_Position; }
+	const Board& GetStartPosition() const { return m_StartPosition; }
+	uint32_t CurrentPly()           const { return m_Nodes[m_Node].Ply; }
+	NodeIndex CurrentNode()         const { return m_Node; }
+
+	// The root has no move, it is the starting position
+	static constexpr NodeIndex GetRoot() { return 0; }
+	const GameNode& GetNode(NodeIndex node) const { return m_Nodes[node]; }
+
+	// The node at 'ply' in the line through 'node': one of the moves before it, or the main line after it
+	// Returns NO_NODE if the line doesn't have the ply
+	NodeIndex GetNodeAtPly(uint32_t ply, NodeIndex node) const;
+	NodeIndex GetNodeAtPly(uint32_t ply) const { return GetNodeAtPly(ply, m_Node); }
+
+	// The tags of the PGN header
+	const GameHeader& GetHeader() const { return m_Header; }
+	// Value of a tag in the PGN header (empty if the tag is missing)
+	std::string GetHeader(std::string_view tag) const { return m_Header.Get(tag); }
+	// Setting the FEN tag doesn't change the starting position
+	void SetHeader(std::string_view tag, std::string_view value) { m_Header.Set(tag, value); }
 
 	// Add move to tree
 	LongAlgebraicMove Move(AlgebraicMove move);
@@ -111,30 +161,143 @@ public:
 	bool Forward();	    // Forward 1 move
 	void ToBeginning(); // Starting position
 	void ToEnd();       // End of current variation
-	void Seek(uint32_t ply);                    // Jump to place in current variation
-	void Seek(uint32_t ply, Branch* variation);	// Jump to place in tree. If ply is outside the branch, it will look before and after it as well.
-	
-	void Delete(uint32_t ply, Branch* variation); // Deletes the move at ply and every subsequent move.  If ply is outside the branch, it will look before and after it as well.
-
-	// Sets the comment on the current move
-	void SetComment(const std::string& comment);
-	void SetComment(std::string&& comment);
+	void Seek(uint32_t ply);    // Jump to place in current variation (see GetNodeAtPly())
+	void GoTo(NodeIndex node);  // Jump to the position after the move of the node
+
+	// The positions every 'interval' plies, and where variations start, are saved as they are reached,
+	// so jumping only replays the moves after the closest one (more memory for faster jumps)
+	// 0 only keeps the starting position
+	void SetCheckpointInterval(uint32_t interval);
+	uint32_t GetCheckpointInterval() const { return m_CheckpointInterval; }
+	size_t GetCheckpointCount()      const { return m_Checkpoints.size(); }
+	// The saved position after the move of the node, or nullptr
+	const Board* GetCheckpoint(NodeIndex node) const;
+
+	// Deletes the move of the node and every move after it (the node can't be used afterwards)
+	void Delete(NodeIndex node);
+
+	// With transpositions merged, the moves after a position are only kept by one node (the closest to the start),
+	// and the other nodes that reach the position link to it: Move() and Forward() continue from that node,
+	// Back() returns the way it came, and the comment is shared (in PGN it is only written once)
+	// Turning it on merges the moves that are already in the tree, turning it off keeps the links but stops merging new moves
+	// Repeating a position of the same line isn't a transposition
+	void SetMergeTranspositions(bool merge);
+	bool GetMergeTranspositions() const { return m_MergeTranspositions; }
+	// The node that 'node' transposes into, or NO_NODE
+	NodeIndex GetTransposition(NodeIndex node) const;
+
+	// Comment on the move of the node (copied into the game)
+	// The comment of a transposition is the comment of the node it transposes into
+	std::string_view GetComment(NodeIndex node) const;
+	void SetComment(NodeIndex node, std::string_view comment);
+	void SetComment(std::string_view comment) { SetComment(m_Node, comment); }
 private:
-	void Move(GameMove move);
+	void Move(GameMove move, AlgebraicMove san);
+	// Goes to a child of the current node (or of the node it transposes into)
+	void Enter(NodeIndex child);
+	// Enter() without playing the move
+	void Step(NodeIndex child);
+	// Saves the current position if the current node is a checkpoint
+	void SaveCheckpoint();
 
-	void FromPGN(const std::string& pgn);
-	void ParseVariation(StringParser& sp);
+	// Clears the tree and the header, and frees their memory
+	void ResetTree();
+	NodeIndex NewNode(NodeIndex parent, const GameMove& move, AlgebraicMove san);
+	// Adds the node to the free list
+	void FreeNode(NodeIndex node);
+	bool IsAncestor(NodeIndex ancestor, NodeIndex node) const;
 
-	// Game info
-	std::unordered_map<std::string, std::string> m_Header;
-	
-	// Top-level branch, contains all the moves
-	Branch* m_Branches;
+	// The node that has the moves after 'node'
+	NodeIndex Resolve(NodeIndex node) const;
+	// Links every node to the first node (breadth first) that reaches its position, moving its moves there
+	void MergeTranspositions();
+	// Moves the moves after 'from' (and its comment) to 'into', which has the same position
+	void MergeNode(NodeIndex from, NodeIndex into, const Board& position, const std::vector<bool>& visited, std::deque<std::pair<NodeIndex, Board>>& queue);
+	// Copies the text into the pool, with every '\n' replaced by 'newline'
+	std::string_view CopyString(std::string_view text, char newline = '\n');
+	// Gives the memory of a string from CopyString() back to the pool
+	void FreeString(std::string_view text);
+	// Sets the comment of the node (a copy of the text), and frees the one it had
+	void ReplaceComment(NodeIndex node, std::string_view comment, char newline = '\n');
+	void EraseComment(NodeIndex node);
+
+	void FromPGN(std::string_view pgn);
+	// Deserialize(), throwing InvalidGameDataException (or InvalidFenException) if the data isn't a valid game
+	size_t ReadSerialized(std::string_view data, bool trusted);
+	// The move of a LongAlgebraicMove in the position, with the flags needed to take it back
+	static GameMove ToGameMove(const Board& position, LongAlgebraicMove move);
+	// If a deserialized move is legal in the position, with the flags it would have there
+	static bool IsValidMove(const Board& position, const GameMove& move, const AlgebraicMove& san);
+
+	// Memory for the text of the header and for the pool below: a buffer in the game, then blocks from the heap
+	// Allocating from it is just moving a pointer, and all of it is freed at once with the game
+	static constexpr size_t ARENA_INITIAL_SIZE = 4096;
+	alignas(std::max_align_t) std::byte m_ArenaBuffer[ARENA_INITIAL_SIZE];
+	std::pmr::monotonic_buffer_resource m_Arena{ m_ArenaBuffer, ARENA_INITIAL_SIZE };
+
+	// Memory for what is freed while the game is edited: the nodes, the comments and the tables below
+	// Blocks are taken from the arena, and freed ones are kept in a list for their size (rounded up to a power of 2)
+	// to be reused by the next block of that size, so editing a game doesn't make it grow
+	// Blocks too big for that (long comments, the nodes of long games) are from the heap, and freed to it
+	class Pool : public std::pmr::memory_resource {
+	public:
+		Pool(std::pmr::memory_resource* arena) : m_Arena(arena) {}
+
+		// Forgets the free blocks, for when the arena is released
+		void Release() { m_FreeBlocks.fill(nullptr); }
+
+		static constexpr size_t SMALLEST_BLOCK = 16;
+		static constexpr size_t LARGEST_BLOCK = 4096;
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		// The list for a block, or SIZE_COUNT for blocks from the heap
+		static size_t GetSize(size_t bytes, size_t alignment);
+
+		static constexpr size_t SIZE_COUNT = 9;  // SMALLEST_BLOCK << 8 == LARGEST_BLOCK
+		std::pmr::memory_resource* m_Arena;
+		// Linked by their first bytes
+		std::array<void*, SIZE_COUNT> m_FreeBlocks{};
+	};
+
+	Pool m_Pool{ &m_Arena };
+
+	// Game info (the text is in the arena)
+	GameHeader m_Header{ &m_Arena };
+
+	// Index 0 is the root
+	std::pmr::vector<GameNode> m_Nodes{ &m_Pool };
+	// Deleted nodes, linked by 'NextSibling', reused for new moves
+	NodeIndex m_FreeNodes = NO_NODE;
+
+	// Only the nodes with comments are in the table (the text is in the pool)
+	std::pmr::unordered_map<NodeIndex, std::string_view> m_Comments{ &m_Pool };
+
+	// The position of the root (from the FEN tag)
+	Board m_StartPosition;
+
+	// Positions after the moves of some of the nodes, for GoTo()
+	static constexpr uint32_t DEFAULT_CHECKPOINT_INTERVAL = 16;
+	uint32_t m_CheckpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+	std::pmr::unordered_map<NodeIndex, Board> m_Checkpoints{ &m_Pool };
+
+	bool m_MergeTranspositions = false;
+	// The nodes that transpose into another node (they have no moves after them), to that node
+	std::pmr::unordered_map<NodeIndex, NodeIndex> m_Transpositions{ &m_Pool };
+	// The hash of each position to the node that has its moves (only while merging)
+	std::pmr::unordered_map<uint64_t, NodeIndex> m_Positions{ &m_Pool };
 
 	// Current state
-	uint32_t m_Ply = 0;
-	Branch* m_Variation;
+	NodeIndex m_Node = 0;
 	Board m_Position;
+
+	// The transpositions the current line went through, so Back() can return the same way
+	std::vector<NodeIndex> m_Crossed;
+
+	// Reused by GoTo(), Delete() and MergeTranspositions()
+	std::vector<NodeIndex> m_Path;
 };
 
 std::ostream& operator<<(std::ostream& os, const Game& game);
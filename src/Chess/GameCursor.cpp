@@ -0,0 +1,100 @@
+#include "GameCursor.h"
+
+#include "ChessException.h"
+
+#include <algorithm>
+
+GameCursor::GameCursor(const Game& game) : m_Game(&game), m_Position(game.GetStartPosition()) {}
+
+GameCursor::GameCursor(std::shared_ptr<const Game> snapshot)
+    : m_Snapshot(std::move(snapshot)), m_Game(m_Snapshot.get()), m_Position(m_Game->GetStartPosition()) {}
+
+bool GameCursor::Back() {
+    if (m_Node == Game::GetRoot())
+        return false;
+
+    const NodeIndex parent = m_Game->GetNode(m_Node).Parent;
+
+    // Back from the checkpoint that the last jump started from
+    if (m_Undo.empty()) {
+        GoTo(parent);
+        return true;
+    }
+
+    m_Position.UnmakeMove(m_Undo.back());
+    m_Undo.pop_back();
+    m_Node = parent;
+
+    // Back through the transposition the line came from
+    if (!m_Crossed.empty() && Resolve(m_Crossed.back()) == m_Node) {
+        m_Node = m_Crossed.back();
+        m_Crossed.pop_back();
+    }
+
+    return true;
+}
+
+bool GameCursor::Forward() {
+    const NodeIndex node = Resolve(m_Node);
+
+    // Stop where the line would go round a position it already went through
+    if (node != m_Node && std::any_of(m_Crossed.begin(), m_Crossed.end(), [this, node](NodeIndex n) { return Resolve(n) == node; }))
+        return false;
+
+    const NodeIndex child = m_Game->GetNode(node).FirstChild;
+    if (child == NO_NODE)
+        return false;
+
+    Enter(child);
+    return true;
+}
+
+void GameCursor::ToBeginning() {
+    m_Node = Game::GetRoot();
+    m_Position = m_Game->GetStartPosition();
+    m_Undo.clear();
+    m_Crossed.clear();
+}
+
+void GameCursor::ToEnd() {
+    while (Forward());
+}
+
+void GameCursor::GoTo(NodeIndex node) {
+    if (node == NO_NODE)
+        throw SeekOutOfBoundsException();
+
+    // The moves to 'node' from the closest checkpoint before it, or the root, backwards
+    // (the checkpoints are only read, the game saves them when it moves)
+    m_Path.clear();
+
+    NodeIndex n = node;
+    const Board* checkpoint = nullptr;
+    while (n != Game::GetRoot() && (checkpoint = m_Game->GetCheckpoint(n)) == nullptr) {
+        m_Path.push_back(n);
+        n = m_Game->GetNode(n).Parent;
+    }
+
+    m_Node = n;
+    m_Position = checkpoint ? *checkpoint : m_Game->GetStartPosition();
+    m_Undo.clear();
+    m_Crossed.clear();
+
+    for (auto it = m_Path.rbegin(); it != m_Path.rend(); ++it)
+        Enter(*it);
+}
+
+NodeIndex GameCursor::Resolve(NodeIndex node) const {
+    const NodeIndex transposition = m_Game->GetTransposition(node);
+    return transposition == NO_NODE ? node : transposition;
+}
+
+void GameCursor::Enter(NodeIndex child) {
+    if (m_Game->GetNode(child).Parent != m_Node)
+        m_Crossed.push_back(m_Node);
+
+    m_Node = child;
+
+    const GameMove& gm = m_Game->GetNode(child).Move;
+    m_Position.MakeMove(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)), m_Undo.emplace_back());
+}
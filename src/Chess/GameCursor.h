@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "Game.h"
+
+// A position in the tree of a game that is moved around on its own, without changing the game
+//
+// Game has one current position for adding moves. Any number of cursors can read the same tree,
+// each with its own position, for example one per analysis thread over a snapshot of a SharedGame (SharedGame.h)
+// A cursor only reads the game, so it can be used at the same time as other cursors on other threads,
+// as long as nothing changes the game (snapshots never change)
+class GameCursor {
+public:
+    // The game has to outlive the cursor
+    GameCursor(const Game& game);
+    // Keeps the snapshot alive for as long as the cursor uses it
+    GameCursor(std::shared_ptr<const Game> snapshot);
+
+    const Game& GetGame() const { return *m_Game; }
+
+    const Board& GetPosition() const { return m_Position; }
+    NodeIndex CurrentNode()    const { return m_Node; }
+    uint32_t CurrentPly()      const { return m_Game->GetNode(m_Node).Ply; }
+
+    // The same moves as on the game: Forward() continues through transpositions, and Back() returns the way it came
+    bool Back();
+    bool Forward();
+    void ToBeginning();
+    void ToEnd();
+    // Plays the moves from the closest checkpoint of the game (or from the start)
+    void GoTo(NodeIndex node);
+
+    std::string_view GetComment() const { return m_Game->GetComment(m_Node); }
+private:
+    // The node that has the moves after 'node'
+    NodeIndex Resolve(NodeIndex node) const;
+    void Enter(NodeIndex child);
+
+    std::shared_ptr<const Game> m_Snapshot;  // Empty for a game that isn't a snapshot
+    const Game* m_Game;
+
+    NodeIndex m_Node = Game::GetRoot();
+    Board m_Position;
+
+    // The moves played since the last jump, so Back() takes them back exactly (with the move counters)
+    std::vector<UndoInfo> m_Undo;
+    // The transpositions the current line went through
+    std::vector<NodeIndex> m_Crossed;
+    // Reused by GoTo()
+    std::vector<NodeIndex> m_Path;
+};
@@ -0,0 +1,568 @@
+#include "GameDatabase.h"
+
+#include "BitBoard.h"
+#include "ChessException.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    constexpr char MAGIC[8] = { 'G', 'A', 'M', 'E', 'S', 'D', 'B', '\0' };
+    constexpr uint32_t VERSION = 3;
+
+    // The ids sorted by the value of the column (and by id for the same value)
+    template<typename T>
+    std::vector<GameId> SortBy(const std::vector<T>& column) {
+        std::vector<uint64_t> keys(column.size());
+        for (GameId id = 0; id < column.size(); id++)
+            keys[id] = (uint64_t)column[id] << 32 | id;
+
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<GameId> ids(column.size());
+        for (size_t i = 0; i < keys.size(); i++)
+            ids[i] = (GameId)keys[i];
+
+        return ids;
+    }
+
+    // The columns and indexes are written as they are in memory (so the file is read on machines of the same endianness)
+    template<typename T>
+    void Write(std::ofstream& output, const std::vector<T>& values) {
+        const uint64_t size = values.size();
+        output.write((const char*)&size, sizeof(size));
+        output.write((const char*)values.data(), size * sizeof(T));
+    }
+
+    class DatabaseReader {
+    public:
+        DatabaseReader(const uint8_t* data, size_t size) : m_Data(data), m_Size(size) {}
+
+        const uint8_t* Bytes(uint64_t size) {
+            if (size > m_Size - m_Position)
+                throw InvalidGameDataException("The database file is cut short!");
+
+            m_Position += size;
+            return m_Data + m_Position - size;
+        }
+
+        template<typename T>
+        T Value() {
+            T value;
+            std::memcpy(&value, Bytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        void Read(std::vector<T>& values) {
+            const uint64_t size = Value<uint64_t>();
+            if (size > (m_Size - m_Position) / sizeof(T))
+                throw InvalidGameDataException("The database file is cut short!");
+
+            values.resize(size);
+            std::memcpy(values.data(), Bytes(size * sizeof(T)), size * sizeof(T));
+        }
+    private:
+        const uint8_t* m_Data;
+        size_t m_Size;
+        size_t m_Position = 0;
+    };
+}
+
+MaterialSignature GetMaterialSignature(const Board& board) {
+    MaterialSignature signature = 0;
+
+    for (Colour colour : { White, Black }) {
+        const BitBoard pieces = board.GetColourBitBoard(colour);
+        const uint64_t pawns = SquareCount(board.GetPieceBitBoard(Pawn) & pieces);
+
+        MaterialSignature counts = pawns;
+        for (PieceType type : { Knight, Bishop, Rook, Queen })
+            counts |= (pawns + SquareCount(board.GetPieceBitBoard(type) & pieces)) << (4 * type);
+
+        counts |= SquareCount(pieces & ~board.GetPieceBitBoard(King)) << 20;
+        signature |= counts << (24 * colour);
+    }
+
+    return signature;
+}
+
+GameId GameDatabase::AddGame(const Game& game) {
+    // The heap of an opened database is in the file, which can't grow
+    if (m_File.IsOpen()) {
+        m_Heap.assign(m_HeapView);
+        m_HeapView = {};
+        m_File.Close();
+    }
+
+    const GameHeader& header = game.GetHeader();
+    const GameId id = GetGameCount();
+
+    m_White.push_back(GetPlayer(header.GetWhite()));
+    m_Black.push_back(GetPlayer(header.GetBlack()));
+    m_WhiteElo.push_back(header.GetWhiteElo());
+    m_BlackElo.push_back(header.GetBlackElo());
+    m_Date.push_back(PackDate(header.GetDate()));
+    m_ECO.push_back(PackECO(header.GetECO()));
+    m_Result.push_back((uint8_t)header.GetResult());
+
+    const size_t offset = m_Heap.size();
+    game.Serialize(m_Heap);
+    m_Offsets.push_back(m_Heap.size());
+
+    // The material of the end of the main line, played from the data that searches will read
+    std::string fen;
+    std::vector<LongAlgebraicMove> moves;
+    Game::DeserializeMainLine(std::string_view(m_Heap).substr(offset), fen, moves);
+
+    Board board;
+    if (!fen.empty())
+        board.FromFEN(fen);
+
+    m_FirstMaterial.push_back(GetMaterialSignature(board));
+
+    UndoInfo undo;
+    for (LongAlgebraicMove move : moves)
+        board.MakeMove(move, undo);
+
+    m_LastMaterial.push_back(GetMaterialSignature(board));
+
+    return id;
+}
+
+bool GameDatabase::Import(const std::filesystem::path& path, const PgnImporter::Options& options, PgnImporter::Statistics& statistics) {
+    PgnImporter::Options ordered = options;
+    ordered.Ordered = true;
+
+    const bool imported = PgnImporter(ordered).Import(path, [this](PgnImporter::ImportedGame& game) {
+        if (game.Parsed)
+            AddGame(*game.Parsed);
+    }, statistics);
+
+    BuildIndexes();
+    return imported;
+}
+
+void GameDatabase::BuildIndexes() {
+    const uint32_t games = GetGameCount();
+
+    m_ByWhiteElo = SortBy(m_WhiteElo);
+    m_ByBlackElo = SortBy(m_BlackElo);
+    m_ByDate = SortBy(m_Date);
+
+    // Counting sorts, which keep the ids of each value in order
+    m_ECOStarts.assign(NO_ECO + 2, 0);
+    for (uint16_t eco : m_ECO)
+        m_ECOStarts[eco + 1]++;
+
+    for (size_t i = 1; i < m_ECOStarts.size(); i++)
+        m_ECOStarts[i] += m_ECOStarts[i - 1];
+
+    m_ByECO.resize(games);
+    std::vector<uint32_t> next(m_ECOStarts.begin(), m_ECOStarts.end() - 1);
+    for (GameId id = 0; id < games; id++)
+        m_ByECO[next[m_ECO[id]]++] = id;
+
+    m_PlayerStarts.assign(m_Players.size() + 1, 0);
+    for (GameId id = 0; id < games; id++) {
+        m_PlayerStarts[m_White[id] + 1]++;
+        if (m_Black[id] != m_White[id])
+            m_PlayerStarts[m_Black[id] + 1]++;
+    }
+
+    for (size_t i = 1; i < m_PlayerStarts.size(); i++)
+        m_PlayerStarts[i] += m_PlayerStarts[i - 1];
+
+    m_ByPlayer.resize(m_PlayerStarts.back());
+    next.assign(m_PlayerStarts.begin(), m_PlayerStarts.end() - 1);
+    for (GameId id = 0; id < games; id++) {
+        m_ByPlayer[next[m_White[id]]++] = id;
+        if (m_Black[id] != m_White[id])
+            m_ByPlayer[next[m_Black[id]]++] = id;
+    }
+
+    for (int result = 0; result < 4; result++) {
+        m_ResultBits[result].assign((games + 63) / 64, 0);
+        m_ResultCounts[result] = 0;
+    }
+
+    for (GameId id = 0; id < games; id++) {
+        m_ResultBits[m_Result[id]][id / 64] |= 1ULL << (id % 64);
+        m_ResultCounts[m_Result[id]]++;
+    }
+
+    m_IndexedGames = games;
+}
+
+template<typename T>
+std::pair<const GameId*, const GameId*> GameDatabase::FindRange(const std::vector<GameId>& index, const std::vector<T>& column, T min, T max) {
+    const GameId* begin = std::lower_bound(index.data(), index.data() + index.size(), min,
+        [&column](GameId id, T value) { return column[id] < value; });
+    const GameId* end = std::upper_bound(begin, index.data() + index.size(), max,
+        [&column](T value, GameId id) { return value < column[id]; });
+
+    return { begin, end };
+}
+
+bool GameDatabase::Resolve(const GameQuery& query, Conditions& conditions) const {
+    conditions.Query = &query;
+
+    if (query.MinWhiteElo > query.MaxWhiteElo || query.MinBlackElo > query.MaxBlackElo || query.MinDate > query.MaxDate)
+        return false;
+
+    // The codes that start with the text are one range: "B9" is B90 to B99
+    if (!query.ECO.empty()) {
+        const std::string& eco = query.ECO;
+        if (eco.size() > 3 || eco[0] < 'A' || eco[0] > 'E' ||
+            std::any_of(eco.begin() + 1, eco.end(), [](char c) { return c < '0' || c > '9'; }))
+            return false;
+
+        conditions.FirstECO = (eco[0] - 'A') * 100;
+        conditions.ECOCount = 100;
+        if (eco.size() >= 2) { conditions.FirstECO += (eco[1] - '0') * 10; conditions.ECOCount = 10; }
+        if (eco.size() == 3) { conditions.FirstECO += eco[2] - '0'; conditions.ECOCount = 1; }
+    }
+
+    conditions.White = query.White.empty() ? NO_PLAYER : FindPlayer(query.White);
+    conditions.Black = query.Black.empty() ? NO_PLAYER : FindPlayer(query.Black);
+    conditions.Player = query.Player.empty() ? NO_PLAYER : FindPlayer(query.Player);
+
+    return (query.White.empty() || conditions.White != NO_PLAYER) &&
+        (query.Black.empty() || conditions.Black != NO_PLAYER) &&
+        (query.Player.empty() || conditions.Player != NO_PLAYER);
+}
+
+std::vector<GameId> GameDatabase::Query(const GameQuery& query) const {
+    if (!HasIndexes())
+        throw InvalidGameDataException("The indexes of the database are not built!");
+
+    Conditions conditions;
+    if (!Resolve(query, conditions))
+        return {};
+
+    // The candidates are the games of the condition with the fewest games: a range of an index, or a result bitmap
+    // (every game if the query has no conditions)
+    const uint32_t games = GetGameCount();
+    size_t candidates = (size_t)games + 1;
+    std::pair<const GameId*, const GameId*> range = { nullptr, nullptr };
+    const std::vector<uint64_t>* bits = nullptr;
+
+    auto consider = [&](std::pair<const GameId*, const GameId*> r) {
+        if ((size_t)(r.second - r.first) < candidates) {
+            candidates = r.second - r.first;
+            range = r;
+        }
+    };
+
+    if (query.MinWhiteElo != 0 || query.MaxWhiteElo != 0xFFFF)
+        consider(FindRange(m_ByWhiteElo, m_WhiteElo, query.MinWhiteElo, query.MaxWhiteElo));
+
+    if (query.MinBlackElo != 0 || query.MaxBlackElo != 0xFFFF)
+        consider(FindRange(m_ByBlackElo, m_BlackElo, query.MinBlackElo, query.MaxBlackElo));
+
+    if (query.MinDate != 0 || query.MaxDate != 99999999)
+        consider(FindRange(m_ByDate, m_Date, query.MinDate, query.MaxDate));
+
+    if (!query.ECO.empty()) {
+        consider({ m_ByECO.data() + m_ECOStarts[conditions.FirstECO],
+            m_ByECO.data() + m_ECOStarts[conditions.FirstECO + conditions.ECOCount] });
+    }
+
+    for (uint32_t player : { conditions.White, conditions.Black, conditions.Player }) {
+        if (player != NO_PLAYER)
+            consider({ m_ByPlayer.data() + m_PlayerStarts[player], m_ByPlayer.data() + m_PlayerStarts[player + 1] });
+    }
+
+    if (query.Result && m_ResultCounts[(int)*query.Result] < candidates) {
+        candidates = m_ResultCounts[(int)*query.Result];
+        bits = &m_ResultBits[(int)*query.Result];
+    }
+
+    std::vector<GameId> ids;
+
+    if (bits) {
+        ids.reserve(candidates);
+        for (size_t word = 0; word < bits->size(); word++) {
+            for (uint64_t b = (*bits)[word]; b != 0; b &= b - 1) {
+                const GameId id = (GameId)(word * 64 + GetSquare(b));
+                if (Matches(id, conditions))
+                    ids.push_back(id);
+            }
+        }
+    } else if (candidates > games) {
+        for (GameId id = 0; id < games; id++) {
+            if (Matches(id, conditions))
+                ids.push_back(id);
+        }
+    } else {
+        for (const GameId* id = range.first; id != range.second; id++) {
+            if (Matches(*id, conditions))
+                ids.push_back(*id);
+        }
+
+        // The ranges of the sorted indexes (and of more than one ECO code) are not in the order of the ids
+        std::sort(ids.begin(), ids.end());
+    }
+
+    return ids;
+}
+
+bool GameDatabase::Matches(GameId id, const GameQuery& query) const {
+    Conditions conditions;
+    return Resolve(query, conditions) && Matches(id, conditions);
+}
+
+bool GameDatabase::Matches(GameId id, const Conditions& conditions) const {
+    const GameQuery& query = *conditions.Query;
+
+    if (m_WhiteElo[id] < query.MinWhiteElo || m_WhiteElo[id] > query.MaxWhiteElo ||
+        m_BlackElo[id] < query.MinBlackElo || m_BlackElo[id] > query.MaxBlackElo ||
+        m_Date[id] < query.MinDate || m_Date[id] > query.MaxDate)
+        return false;
+
+    if (query.Result && m_Result[id] != (uint8_t)*query.Result)
+        return false;
+
+    // NO_ECO is after the range of every code
+    if ((uint32_t)(m_ECO[id] - conditions.FirstECO) >= conditions.ECOCount)
+        return false;
+
+    return (conditions.White == NO_PLAYER || m_White[id] == conditions.White) &&
+        (conditions.Black == NO_PLAYER || m_Black[id] == conditions.Black) &&
+        (conditions.Player == NO_PLAYER || m_White[id] == conditions.Player || m_Black[id] == conditions.Player);
+}
+
+Game GameDatabase::GetGame(GameId id) const {
+    Game game;
+    if (game.Deserialize(GetHeap().substr(m_Offsets[id], m_Offsets[id + 1] - m_Offsets[id])) == 0)
+        throw InvalidGameDataException("The game data in the database is corrupt!");
+
+    return game;
+}
+
+void GameDatabase::GetMainLine(GameId id, std::string& fen, std::vector<LongAlgebraicMove>& moves) const {
+    Game::DeserializeMainLine(GetHeap().substr(m_Offsets[id], m_Offsets[id + 1] - m_Offsets[id]), fen, moves);
+}
+
+std::string GameDatabase::GetECO(GameId id) const {
+    const uint16_t eco = m_ECO[id];
+    if (eco == NO_ECO)
+        return "";
+
+    return { (char)('A' + eco / 100), (char)('0' + eco / 10 % 10), (char)('0' + eco % 10) };
+}
+
+uint16_t GameDatabase::PackECO(std::string_view eco) {
+    if (eco.size() != 3 || eco[0] < 'A' || eco[0] > 'E' || eco[1] < '0' || eco[1] > '9' || eco[2] < '0' || eco[2] > '9')
+        return NO_ECO;
+
+    return (eco[0] - 'A') * 100 + (eco[1] - '0') * 10 + (eco[2] - '0');
+}
+
+uint32_t GameDatabase::GetPlayer(std::string_view name) {
+    const auto [it, added] = m_PlayerIds.try_emplace(std::string(name), (uint32_t)m_Players.size());
+    if (added)
+        m_Players.emplace_back(name);
+
+    return it->second;
+}
+
+uint32_t GameDatabase::FindPlayer(std::string_view name) const {
+    const auto it = m_PlayerIds.find(std::string(name));
+    return it != m_PlayerIds.end() ? it->second : NO_PLAYER;
+}
+
+// The file is:
+//     MAGIC (8 bytes), VERSION (4 bytes), number of indexed games (4 bytes)
+//     the columns, the offsets of the games and the indexes, each as its size (8 bytes) and its values
+//     the names of the players: their number (8 bytes), then each name (4 byte length and the text)
+//     the move heap: its size (8 bytes) and the games
+bool GameDatabase::Save(const std::filesystem::path& path) const {
+    std::ofstream output(path, std::ios::binary);
+    if (!output)
+        return false;
+
+    output.write(MAGIC, sizeof(MAGIC));
+    output.write((const char*)&VERSION, sizeof(VERSION));
+    output.write((const char*)&m_IndexedGames, sizeof(m_IndexedGames));
+
+    Write(output, m_White);
+    Write(output, m_Black);
+    Write(output, m_WhiteElo);
+    Write(output, m_BlackElo);
+    Write(output, m_Date);
+    Write(output, m_ECO);
+    Write(output, m_Result);
+    Write(output, m_FirstMaterial);
+    Write(output, m_LastMaterial);
+    Write(output, m_Offsets);
+
+    Write(output, m_ByWhiteElo);
+    Write(output, m_ByBlackElo);
+    Write(output, m_ByDate);
+    Write(output, m_ECOStarts);
+    Write(output, m_ByECO);
+    Write(output, m_PlayerStarts);
+    Write(output, m_ByPlayer);
+    for (const std::vector<uint64_t>& bits : m_ResultBits)
+        Write(output, bits);
+
+    const uint64_t players = m_Players.size();
+    output.write((const char*)&players, sizeof(players));
+    for (const std::string& name : m_Players) {
+        const uint32_t size = (uint32_t)name.size();
+        output.write((const char*)&size, sizeof(size));
+        output.write(name.data(), size);
+    }
+
+    const std::string_view heap = GetHeap();
+    const uint64_t heapSize = heap.size();
+    output.write((const char*)&heapSize, sizeof(heapSize));
+    output.write(heap.data(), heap.size());
+
+    return (bool)output;
+}
+
+bool GameDatabase::Open(const std::filesystem::path& path) {
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+
+    DatabaseReader reader(file.GetData(), file.GetSize());
+    if (std::memcmp(reader.Bytes(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0 || reader.Value<uint32_t>() != VERSION)
+        throw InvalidGameDataException("The file isn't a game database!");
+
+    // Read into another database, so this one is unchanged if the file is corrupt
+    GameDatabase loaded;
+    loaded.m_IndexedGames = reader.Value<uint32_t>();
+
+    reader.Read(loaded.m_White);
+    reader.Read(loaded.m_Black);
+    reader.Read(loaded.m_WhiteElo);
+    reader.Read(loaded.m_BlackElo);
+    reader.Read(loaded.m_Date);
+    reader.Read(loaded.m_ECO);
+    reader.Read(loaded.m_Result);
+    reader.Read(loaded.m_FirstMaterial);
+    reader.Read(loaded.m_LastMaterial);
+    reader.Read(loaded.m_Offsets);
+
+    reader.Read(loaded.m_ByWhiteElo);
+    reader.Read(loaded.m_ByBlackElo);
+    reader.Read(loaded.m_ByDate);
+    reader.Read(loaded.m_ECOStarts);
+    reader.Read(loaded.m_ByECO);
+    reader.Read(loaded.m_PlayerStarts);
+    reader.Read(loaded.m_ByPlayer);
+    for (int result = 0; result < 4; result++) {
+        reader.Read(loaded.m_ResultBits[result]);
+
+        for (uint64_t bits : loaded.m_ResultBits[result])
+            loaded.m_ResultCounts[result] += (uint32_t)SquareCount(bits);
+    }
+
+    // A name is at least its 4 byte length
+    const uint64_t players = reader.Value<uint64_t>();
+    if (players > file.GetSize() / 4)
+        throw InvalidGameDataException("The database file is cut short!");
+
+    loaded.m_Players.resize(players);
+    for (uint32_t player = 0; player < players; player++) {
+        const uint32_t size = reader.Value<uint32_t>();
+        loaded.m_Players[player].assign((const char*)reader.Bytes(size), size);
+        loaded.m_PlayerIds.emplace(loaded.m_Players[player], player);
+    }
+
+    const uint64_t heapSize = reader.Value<uint64_t>();
+    loaded.m_HeapView = std::string_view((const char*)reader.Bytes(heapSize), heapSize);
+
+    if (!loaded.IsValid())
+        throw InvalidGameDataException("The database file is corrupt!");
+
+    loaded.m_File = std::move(file);
+    Swap(loaded);
+
+    return true;
+}
+
+bool GameDatabase::IsValid() const {
+    const uint32_t games = GetGameCount();
+    const uint32_t players = (uint32_t)m_Players.size();
+    const uint64_t heapSize = m_HeapView.size();
+
+    // The ids of an index are games of the database
+    auto validIds = [games](const std::vector<GameId>& ids) {
+        return std::all_of(ids.begin(), ids.end(), [games](GameId id) { return id < games; });
+    };
+
+    // The starts of a counting sort split the index into one list for each value
+    auto validStarts = [](const std::vector<uint32_t>& starts, size_t values, size_t indexSize) {
+        return starts.size() == values + 1 && starts[0] == 0 && starts.back() == indexSize &&
+            std::is_sorted(starts.begin(), starts.end());
+    };
+
+    // Columns
+    if (m_White.size() != games || m_Black.size() != games || m_BlackElo.size() != games || m_Date.size() != games ||
+        m_ECO.size() != games || m_Result.size() != games || m_FirstMaterial.size() != games || m_LastMaterial.size() != games)
+        return false;
+
+    if (std::any_of(m_White.begin(), m_White.end(), [players](uint32_t p) { return p >= players; }) ||
+        std::any_of(m_Black.begin(), m_Black.end(), [players](uint32_t p) { return p >= players; }) ||
+        std::any_of(m_ECO.begin(), m_ECO.end(), [](uint16_t eco) { return eco > NO_ECO; }) ||
+        std::any_of(m_Result.begin(), m_Result.end(), [](uint8_t result) { return result >= 4; }))
+        return false;
+
+    // Move heap
+    if (m_Offsets.size() != (size_t)games + 1 || m_Offsets[0] != 0 || m_Offsets.back() != heapSize ||
+        !std::is_sorted(m_Offsets.begin(), m_Offsets.end()))
+        return false;
+
+    // Indexes that queries use (BuildIndexes() replaces the others without reading them)
+    if (!HasIndexes())
+        return true;
+
+    if (m_ByWhiteElo.size() != games || m_ByBlackElo.size() != games || m_ByDate.size() != games ||
+        !validIds(m_ByWhiteElo) || !validIds(m_ByBlackElo) || !validIds(m_ByDate) || !validIds(m_ByECO) || !validIds(m_ByPlayer) ||
+        !validStarts(m_ECOStarts, NO_ECO + 1, m_ByECO.size()) || !validStarts(m_PlayerStarts, players, m_ByPlayer.size()))
+        return false;
+
+    // The bits after the last game are 0
+    for (const std::vector<uint64_t>& bits : m_ResultBits) {
+        if (bits.size() != ((size_t)games + 63) / 64 || (games % 64 != 0 && bits.back() >> (games % 64) != 0))
+            return false;
+    }
+
+    return true;
+}
+
+void GameDatabase::Swap(GameDatabase& other) noexcept {
+    std::swap(m_White, other.m_White);
+    std::swap(m_Black, other.m_Black);
+    std::swap(m_WhiteElo, other.m_WhiteElo);
+    std::swap(m_BlackElo, other.m_BlackElo);
+    std::swap(m_Date, other.m_Date);
+    std::swap(m_ECO, other.m_ECO);
+    std::swap(m_Result, other.m_Result);
+    std::swap(m_FirstMaterial, other.m_FirstMaterial);
+    std::swap(m_LastMaterial, other.m_LastMaterial);
+
+    std::swap(m_Players, other.m_Players);
+    std::swap(m_PlayerIds, other.m_PlayerIds);
+
+    std::swap(m_Offsets, other.m_Offsets);
+    std::swap(m_Heap, other.m_Heap);
+    std::swap(m_File, other.m_File);
+    std::swap(m_HeapView, other.m_HeapView);
+
+    std::swap(m_IndexedGames, other.m_IndexedGames);
+    std::swap(m_ByWhiteElo, other.m_ByWhiteElo);
+    std::swap(m_ByBlackElo, other.m_ByBlackElo);
+    std::swap(m_ByDate, other.m_ByDate);
+    std::swap(m_ECOStarts, other.m_ECOStarts);
+    std::swap(m_ByECO, other.m_ByECO);
+    std::swap(m_PlayerStarts, other.m_PlayerStarts);
+    std::swap(m_ByPlayer, other.m_ByPlayer);
+    std::swap(m_ResultBits, other.m_ResultBits);
+    std::swap(m_ResultCounts, other.m_ResultCounts);
+}
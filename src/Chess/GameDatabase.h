@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Game.h"
+#include "PgnImporter.h"
+#include "Utility/MappedFile.h"
+
+using GameId = uint32_t;
+
+// The material that a game can only lose as it goes on, 4 bits for each count, White's then Black's (<< 24):
+//     pawns, knights + pawns, bishops + pawns, rooks + pawns, queens + pawns (a pawn can promote to the piece),
+//     and every piece but the king
+// So a position can only come later in a game than another one if none of its counts is higher
+using MaterialSignature = uint64_t;
+
+MaterialSignature GetMaterialSignature(const Board& board);
+
+// The games a query asks for, every condition has to match (the defaults match every game)
+struct GameQuery {
+    uint16_t MinWhiteElo = 0;  // A missing rating is 0
+    uint16_t MaxWhiteElo = 0xFFFF;
+    uint16_t MinBlackElo = 0;
+    uint16_t MaxBlackElo = 0xFFFF;
+
+    // Dates as YYYYMMDD (GameDatabase::PackDate()), with 0 for the parts that are unknown
+    uint32_t MinDate = 0;
+    uint32_t MaxDate = 99999999;
+
+    std::string ECO;     // A code ("B90") or the start of one ("B9" for B90 to B99, "B" for every B), empty for any
+    std::string White;   // Names of the players, empty for any
+    std::string Black;
+    std::string Player;  // With either color
+    std::optional<GameResult> Result;
+};
+
+// A local database of many games, with the tags that are searched stored by column
+//
+// Each searched tag has its own array, indexed by the id of the game (the order the games were added),
+// so a condition only reads the column it is about:
+//     players: ids into a table of names (each name is stored once)
+//     ratings, dates (YYYYMMDD), ECO codes (0 to 499, or NO_ECO) and results
+//     the material signatures of the first and last positions of the main line (for PositionSearch, PositionSearch.h)
+// The games themselves are in the move heap, one after another in the binary format of Game::Serialize(),
+// so GetGame() reads a game without parsing any PGN
+//
+// BuildIndexes() sorts the ids by each column, so a query doesn't have to look at every game:
+//     ratings and dates: the ids sorted by the value, a range of values is a range of the array (found by binary search)
+//     ECO codes and players: the ids of each value together (the ECO codes in order, so "B9" is one range)
+//     results: a bitmap for each result
+// A query starts from the index with the fewest games for its conditions, and checks the other conditions on the columns
+// of those games only, so its time depends on the number of games of its most selective condition, not of the database
+class GameDatabase {
+public:
+    static constexpr uint16_t NO_ECO = 500;
+
+    GameDatabase() = default;
+
+    GameDatabase(const GameDatabase&) = delete;
+    GameDatabase& operator=(const GameDatabase&) = delete;
+
+    // Returns the id of the game
+    GameId AddGame(const Game& game);
+    // Adds the games of a PGN file that could be parsed (in the order of the file), and builds the indexes
+    // Returns false if the file could not be mapped
+    bool Import(const std::filesystem::path& path, const PgnImporter::Options& options, PgnImporter::Statistics& statistics);
+
+    // Has to be called after the games are added, before Query()
+    void BuildIndexes();
+    bool HasIndexes() const { return !m_ECOStarts.empty() && m_IndexedGames == GetGameCount(); }
+
+    // The ids of the matching games, in order
+    // Throws InvalidGameDataException if the indexes are not built
+    std::vector<GameId> Query(const GameQuery& query) const;
+    // Whether the game matches the query, from the columns (without the indexes)
+    bool Matches(GameId id, const GameQuery& query) const;
+
+    // Reads the game from the move heap
+    // Throws InvalidGameDataException if its data isn't a valid game
+    Game GetGame(GameId id) const;
+    // Reads the FEN tag and the moves of the main line only (see Game::DeserializeMainLine())
+    void GetMainLine(GameId id, std::string& fen, std::vector<LongAlgebraicMove>& moves) const;
+
+    uint32_t GetGameCount() const { return (uint32_t)m_WhiteElo.size(); }
+
+    std::string_view GetWhite(GameId id) const { return m_Players[m_White[id]]; }
+    std::string_view GetBlack(GameId id) const { return m_Players[m_Black[id]]; }
+    uint16_t GetWhiteElo(GameId id)      const { return m_WhiteElo[id]; }
+    uint16_t GetBlackElo(GameId id)      const { return m_BlackElo[id]; }
+    uint32_t GetDate(GameId id)          const { return m_Date[id]; }
+    std::string GetECO(GameId id)        const;
+    GameResult GetResult(GameId id)      const { return (GameResult)m_Result[id]; }
+    MaterialSignature GetFirstMaterial(GameId id) const { return m_FirstMaterial[id]; }
+    MaterialSignature GetLastMaterial(GameId id)  const { return m_LastMaterial[id]; }
+
+    static uint32_t PackDate(PgnDate date) { return date.Year * 10000 + date.Month * 100 + date.Day; }
+    // NO_ECO if the text isn't a code
+    static uint16_t PackECO(std::string_view eco);
+
+    // Writes the database with its indexes, returns false if the file could not be written
+    bool Save(const std::filesystem::path& path) const;
+    // Replaces the database with one written by Save()
+    // The move heap is read from the mapped file, so only the columns and indexes are loaded
+    // Returns false if the file could not be mapped, throws InvalidGameDataException if it isn't a database
+    // or is corrupt (every id and range is checked before it is used), and then the database is unchanged
+    bool Open(const std::filesystem::path& path);
+private:
+    static constexpr uint32_t NO_PLAYER = 0xFFFFFFFF;
+
+    // A query with the ECO codes and the players as numbers
+    struct Conditions {
+        const GameQuery* Query = nullptr;
+        uint16_t FirstECO = 0;
+        uint16_t ECOCount = NO_ECO + 1;  // Every code, and the games without one
+        uint32_t White = NO_PLAYER;
+        uint32_t Black = NO_PLAYER;
+        uint32_t Player = NO_PLAYER;
+    };
+
+    // Returns false if no game can match the query (a player that isn't in the database, or an empty range)
+    bool Resolve(const GameQuery& query, Conditions& conditions) const;
+    bool Matches(GameId id, const Conditions& conditions) const;
+
+    // If the columns, offsets and indexes are consistent (for a database read by Open())
+    bool IsValid() const;
+    void Swap(GameDatabase& other) noexcept;
+
+    uint32_t GetPlayer(std::string_view name);
+    // NO_PLAYER if no game has the player
+    uint32_t FindPlayer(std::string_view name) const;
+
+    std::string_view GetHeap() const { return m_File.IsOpen() ? m_HeapView : m_Heap; }
+
+    // The ids that have 'column' in [min, max], from an index sorted by the column
+    template<typename T>
+    static std::pair<const GameId*, const GameId*> FindRange(const std::vector<GameId>& index, const std::vector<T>& column, T min, T max);
+
+    // Columns
+    std::vector<uint32_t> m_White;
+    std::vector<uint32_t> m_Black;
+    std::vector<uint16_t> m_WhiteElo;
+    std::vector<uint16_t> m_BlackElo;
+    std::vector<uint32_t> m_Date;
+    std::vector<uint16_t> m_ECO;
+    std::vector<uint8_t> m_Result;
+    std::vector<MaterialSignature> m_FirstMaterial;
+    std::vector<MaterialSignature> m_LastMaterial;
+
+    std::vector<std::string> m_Players;
+    std::unordered_map<std::string, uint32_t> m_PlayerIds;
+
+    // Move heap: game 'id' is at [m_Offsets[id], m_Offsets[id + 1])
+    std::vector<uint64_t> m_Offsets = { 0 };
+    std::string m_Heap;
+    MappedFile m_File;          // Open() keeps the heap in the file
+    std::string_view m_HeapView;
+
+    // Indexes
+    uint32_t m_IndexedGames = 0;
+    std::vector<GameId> m_ByWhiteElo;
+    std::vector<GameId> m_ByBlackElo;
+    std::vector<GameId> m_ByDate;
+    std::vector<uint32_t> m_ECOStarts;     // The games of code 'eco' are at [m_ECOStarts[eco], m_ECOStarts[eco + 1]) of m_ByECO
+    std::vector<GameId> m_ByECO;
+    std::vector<uint32_t> m_PlayerStarts;  // The same for the players (a game is in the lists of both of its players)
+    std::vector<GameId> m_ByPlayer;
+    std::vector<uint64_t> m_ResultBits[4];
+    uint32_t m_ResultCounts[4] = {};
+};
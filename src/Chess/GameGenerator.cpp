@@ -0,0 +1,365 @@
+#include "GameGenerator.h"
+
+#include "Game.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// Each thread writes its games to its own buffer, and copies it to the output when it is this big
+static constexpr size_t FLUSH_SIZE = 1 << 20;
+
+// PGN movetext lines are at most 80 characters
+static constexpr size_t MAX_LINE_LENGTH = 80;
+
+static const char* s_Results[] = { "*", "1-0", "0-1", "1/2-1/2" };
+
+static bool IsCapture(const Board& board, LongAlgebraicMove m) {
+    return board[m.DestinationSquare] != Piece::None || m.Promotion != Pawn ||
+        (GetPieceType(board[m.SourceSquare]) == Pawn && FileOf(m.SourceSquare) != FileOf(m.DestinationSquare));
+}
+
+// Neither player can mate (only kings, or one knight or bishop)
+static bool IsInsufficientMaterial(const Board& board) {
+    if (board.GetPieceBitBoard(Pawn) | board.GetPieceBitBoard(Rook) | board.GetPieceBitBoard(Queen))
+        return false;
+
+    const BitBoard minorPieces = board.GetPieceBitBoard(Knight) | board.GetPieceBitBoard(Bishop);
+    return (minorPieces & (minorPieces - 1)) == 0;
+}
+
+// The pieces and the player to move (the part of the FEN that Board::UndoMove() always restores)
+static std::string_view Placement(const std::string& fen) {
+    return std::string_view(fen).substr(0, fen.find(' ', fen.find(' ') + 1));
+}
+
+// The random moves of a game, and the result
+struct GeneratedGame {
+    std::vector<LongAlgebraicMove> Moves;
+    std::vector<uint64_t> Hashes;   // Of every position, for repetitions
+    std::vector<std::string> FENs;  // Of every position, only when checking
+    std::string MoveText;           // Only for PGN
+    std::string Result;
+};
+
+static void Fail(GameGenerator::Statistics& statistics, const std::string& check, const std::string& fen, LongAlgebraicMove m) {
+    if (statistics.Failures++ == 0)
+        statistics.FirstFailure = check + " failed: " + m.ToString() + " in " + fen;
+}
+
+// Plays 'm' on 'board' with Board::Move(), and checks it against the other ways of getting the same position
+static bool CheckMove(Board& board, LongAlgebraicMove m, AlgebraicMove& algebraic, const std::string& fen, GameGenerator::Statistics& statistics) {
+    Board fast = board;
+    Board fromSAN = board;
+    UndoInfo undo;
+    fast.MakeMove(m, undo);
+
+    algebraic = board.Move(m);
+    const std::string after = board.ToFEN();
+
+    try {
+        fromSAN.Move(algebraic);
+    } catch (std::exception&) {}
+
+    if (fromSAN.ToFEN() != after) {
+        Fail(statistics, "SAN round trip (" + algebraic.ToString() + ")", fen, m);
+        return false;
+    }
+
+    if (fast.ToFEN() != after || fast.GetHash() != board.GetHash() || fast.Evaluate() != board.Evaluate()) {
+        Fail(statistics, "MakeMove() against Move()", fen, m);
+        return false;
+    }
+
+    fast.UnmakeMove(undo);
+    if (fast.ToFEN() != fen || fast.GetHash() != Board(fen).GetHash()) {
+        Fail(statistics, "UnmakeMove()", fen, m);
+        return false;
+    }
+
+    Board fromFEN(after);
+    if (fromFEN.ToFEN() != after || fromFEN.GetHash() != board.GetHash() || fromFEN.Evaluate() != board.Evaluate()) {
+        Fail(statistics, "FEN round trip", fen, m);
+        return false;
+    }
+
+    if (fromFEN.HasLegalMoves(fromFEN.GetPlayerTurn()) != board.HasLegalMoves(board.GetPlayerTurn())) {
+        Fail(statistics, "HasLegalMoves()", fen, m);
+        return false;
+    }
+
+    return true;
+}
+
+// Plays the game forwards in a Game, then takes every move back
+static bool CheckUndo(const GeneratedGame& game, GameGenerator::Statistics& statistics) {
+    Game replay;
+    for (size_t i = 0; i < game.Moves.size(); i++) {
+        replay.Move(game.Moves[i]);
+
+        if (replay.GetPosition().ToFEN() != game.FENs[i + 1]) {
+            Fail(statistics, "Game::Move()", game.FENs[i], game.Moves[i]);
+            return false;
+        }
+    }
+
+    for (size_t i = game.Moves.size(); i > 0; i--) {
+        replay.Back();
+
+        if (Placement(replay.GetPosition().ToFEN()) != Placement(game.FENs[i - 1])) {
+            Fail(statistics, "Board::UndoMove()", game.FENs[i - 1], game.Moves[i - 1]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void AppendMoveText(std::string& text, size_t& lineLength, std::string_view token) {
+    if (lineLength != 0 && lineLength + 1 + token.size() > MAX_LINE_LENGTH) {
+        text += '\n';
+        lineLength = 0;
+    } else if (lineLength != 0) {
+        text += ' ';
+        lineLength++;
+    }
+
+    text += token;
+    lineLength += token.size();
+}
+
+// Returns false if a check failed
+static bool PlayGame(const GameGenerator::Options& options, uint64_t& random, GeneratedGame& game, GameGenerator::Statistics& statistics) {
+    const bool writeSAN = options.OutputFormat == GameGenerator::Format::PGN;
+
+    game.Moves.clear();
+    game.Hashes.clear();
+    game.FENs.clear();
+    game.MoveText.clear();
+
+    Board board;
+    MoveList moves;
+    UndoInfo undo;
+    size_t lineLength = 0;
+
+    game.Hashes.push_back(board.GetHash());
+    if (options.Check)
+        game.FENs.push_back(board.ToFEN());
+
+    while (true) {
+        board.GenerateLegalMoves(moves);
+
+        if (moves.Size == 0) {
+            game.Result = !board.IsInCheck() ? "1/2-1/2" : board.GetPlayerTurn() == White ? "0-1" : "1-0";
+            break;
+        }
+
+        if (board.GetHalfMoves() >= 100 || IsInsufficientMaterial(board)) {
+            game.Result = "1/2-1/2";
+            break;
+        }
+
+        // Threefold repetition (only positions since the last capture or pawn move can repeat)
+        int32_t repetitions = 0;
+        const size_t current = game.Hashes.size() - 1;
+        for (size_t i = 2; i <= std::min<size_t>(board.GetHalfMoves(), current); i += 2)
+            repetitions += game.Hashes[current - i] == game.Hashes[current];
+
+        if (repetitions >= 2) {
+            game.Result = "1/2-1/2";
+            break;
+        }
+
+        if ((int32_t)game.Moves.size() >= options.MaxPlies) {
+            game.Result = "*";
+            break;
+        }
+
+        // Pick a move (captures and promotions count 'CaptureWeight' times)
+        size_t captures = 0;
+        if (options.CaptureWeight > 1)
+            for (LongAlgebraicMove m : moves)
+                captures += IsCapture(board, m);
+
+        const uint64_t total = moves.Size + captures * (options.CaptureWeight - 1);
+        uint64_t pick = Zobrist::NextRandom(random) % total;
+
+        LongAlgebraicMove chosen = moves[0];
+        for (LongAlgebraicMove m : moves) {
+            const uint64_t weight = (options.CaptureWeight > 1 && IsCapture(board, m)) ? options.CaptureWeight : 1;
+            if (pick < weight) {
+                chosen = m;
+                break;
+            }
+            pick -= weight;
+        }
+
+        // Move numbers for PGN
+        if (writeSAN && board.GetPlayerTurn() == White) {
+            char number[16];
+            char* end = std::to_chars(number, number + sizeof(number), board.GetFullMoves()).ptr;
+            *(end++) = '.';
+            AppendMoveText(game.MoveText, lineLength, std::string_view(number, end - number));
+        }
+
+        if (options.Check) {
+            AlgebraicMove algebraic = AlgebraicMove(Pawn, 0, 0, 0);
+            if (!CheckMove(board, chosen, algebraic, game.FENs.back(), statistics))
+                return false;
+
+            game.FENs.push_back(board.ToFEN());
+
+            if (writeSAN) {
+                char san[AlgebraicMove::MAX_STRING_LENGTH];
+                AppendMoveText(game.MoveText, lineLength, std::string_view(san, algebraic.WriteTo(san) - san));
+            }
+        } else if (writeSAN) {
+            char san[AlgebraicMove::MAX_STRING_LENGTH];
+            AlgebraicMove algebraic = board.Move(chosen);
+            AppendMoveText(game.MoveText, lineLength, std::string_view(san, algebraic.WriteTo(san) - san));
+        } else {
+            board.MakeMove(chosen, undo);
+        }
+
+        game.Moves.push_back(chosen);
+        game.Hashes.push_back(board.GetHash());
+    }
+
+    if (writeSAN)
+        AppendMoveText(game.MoveText, lineLength, game.Result);
+
+    if (options.Check)
+        return CheckUndo(game, statistics);
+
+    return true;
+}
+
+static void WritePGN(std::string& output, const GeneratedGame& game, uint64_t round) {
+    output += "[Event \"Random game\"]\n[Site \"?\"]\n[Date \"????.??.??\"]\n[Round \"";
+    output += std::to_string(round);
+    output += "\"]\n[White \"?\"]\n[Black \"?\"]\n[Result \"";
+    output += game.Result;
+    output += "\"]\n\n";
+    output += game.MoveText;
+    output += "\n\n";
+}
+
+GameGenerator::Statistics GameGenerator::Run(std::ostream* output) const {
+    const uint32_t threadCount = (uint32_t)std::min<uint64_t>(
+        m_Options.Threads != 0 ? m_Options.Threads : std::max(1u, std::thread::hardware_concurrency()),
+        std::max<uint64_t>(m_Options.Games, 1));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    Statistics total;
+    std::mutex mutex;  // For 'output' and 'total'
+    std::atomic<uint64_t> next = 0;
+
+    auto worker = [&]() {
+        Statistics statistics;
+        GeneratedGame game;
+        std::string buffer;
+
+        auto flush = [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            output->write(buffer.data(), buffer.size());
+            buffer.clear();
+        };
+
+        for (uint64_t n = next++; n < m_Options.Games; n = next++) {
+            // Seeded by the number of the game, so the games don't depend on the number of threads
+            uint64_t random = m_Options.Seed ^ (n * 0xD1B54A32D192ED03ull);
+            Zobrist::NextRandom(random);
+
+            if (!PlayGame(m_Options, random, game, statistics))
+                continue;
+
+            statistics.Games++;
+            statistics.Positions += game.Moves.size();
+
+            if (game.Result == "1-0")
+                statistics.WhiteWins++;
+            else if (game.Result == "0-1")
+                statistics.BlackWins++;
+            else if (game.Result == "1/2-1/2")
+                statistics.Draws++;
+            else
+                statistics.Unfinished++;
+
+            if (output == nullptr)
+                continue;
+
+            if (m_Options.OutputFormat == Format::PGN)
+                WritePGN(buffer, game, n + 1);
+            else if (m_Options.OutputFormat == Format::Binary)
+                WriteBinary(buffer, game.Moves, game.Result);
+
+            if (buffer.size() >= FLUSH_SIZE)
+                flush();
+        }
+
+        if (output != nullptr && !buffer.empty())
+            flush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        total.Games += statistics.Games;
+        total.Positions += statistics.Positions;
+        total.WhiteWins += statistics.WhiteWins;
+        total.BlackWins += statistics.BlackWins;
+        total.Draws += statistics.Draws;
+        total.Unfinished += statistics.Unfinished;
+        if (total.Failures == 0)
+            total.FirstFailure = statistics.FirstFailure;
+        total.Failures += statistics.Failures;
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    total.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return total;
+}
+
+void GameGenerator::WriteBinary(std::string& output, const std::vector<LongAlgebraicMove>& moves, const std::string& result) {
+    const uint8_t resultIndex = (uint8_t)(std::find(std::begin(s_Results), std::end(s_Results), result) - std::begin(s_Results));
+
+    output += (char)(moves.size() & 0xFF);
+    output += (char)(moves.size() >> 8);
+    output += (char)(resultIndex < 4 ? resultIndex : 0);
+
+    for (LongAlgebraicMove m : moves) {
+        const uint16_t data = m.SourceSquare | m.DestinationSquare << 6 | m.Promotion << 12;
+        output += (char)(data & 0xFF);
+        output += (char)(data >> 8);
+    }
+}
+
+bool GameGenerator::ReadBinary(std::istream& input, std::vector<LongAlgebraicMove>& moves, std::string& result) {
+    uint8_t header[3];
+    if (!input.read((char*)header, sizeof(header)))
+        return false;
+
+    const size_t plies = header[0] | header[1] << 8;
+    result = s_Results[header[2] & 0b11];
+
+    std::vector<uint8_t> data(plies * 2);
+    if (!input.read((char*)data.data(), data.size()))
+        return false;
+
+    moves.resize(plies);
+    for (size_t i = 0; i < plies; i++) {
+        const uint16_t move = data[2 * i] | data[2 * i + 1] << 8;
+        moves[i] = LongAlgebraicMove(move & 0x3F, (move >> 6) & 0x3F, (PieceType)(move >> 12));
+    }
+
+    return true;
+}
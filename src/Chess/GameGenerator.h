@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+
+// Plays random legal games on multiple threads, for stress testing and benchmarks
+//
+// Each thread has its own Board, and each game its own random number generator,
+// so a game only depends on the seed and its number (the "Round" tag in PGN)
+// The games are written as they are finished, so with more than one thread they are out of order
+class GameGenerator {
+public:
+    enum class Format {
+        None,    // Only play the games (for benchmarks)
+        PGN,
+        Binary   // See WriteBinary()
+    };
+
+    struct Options {
+        uint64_t Games = 1000;
+        uint32_t Threads = 0;      // 0 for one thread per core
+        uint64_t Seed = 0;
+        int32_t MaxPlies = 400;    // Longer games are stopped without a result
+        uint32_t CaptureWeight = 1;  // How many times more likely a capture or promotion is than a quiet move
+        Format OutputFormat = Format::None;
+
+        // Checks the board after every move against slower ways of getting the same position:
+        // the FEN round trip (hash, evaluation and FEN), UnmakeMove(), Board::Move() (which also writes the SAN,
+        // played again with Board::Move(AlgebraicMove)),
+        // and Game::Back() (Board::UndoMove()) from the end of each game to the start
+        bool Check = false;
+    };
+
+    struct Statistics {
+        uint64_t Games = 0;
+        uint64_t Positions = 0;  // Every position after a move
+        uint64_t WhiteWins = 0;
+        uint64_t BlackWins = 0;
+        uint64_t Draws = 0;
+        uint64_t Unfinished = 0;  // Stopped after Options::MaxPlies
+        uint64_t Failures = 0;    // Failed checks
+        std::string FirstFailure; // Description of the first failed check
+        double Seconds = 0;
+    };
+
+    GameGenerator(const Options& options) : m_Options(options) {}
+
+    // Plays the games, and writes them to 'output' (if it isn't nullptr) in the format of the options
+    Statistics Run(std::ostream* output = nullptr) const;
+
+    // The binary format of a game is:
+    //     number of plies (2 bytes, little endian)
+    //     result (1 byte: 0 = "*", 1 = "1-0", 2 = "0-1", 3 = "1/2-1/2")
+    //     each move (2 bytes, little endian): source square | destination square << 6 | promotion << 12
+    // The games always start from the starting position
+    static void WriteBinary(std::string& output, const std::vector<LongAlgebraicMove>& moves, const std::string& result);
+    // Returns false at the end of the input
+    static bool ReadBinary(std::istream& input, std::vector<LongAlgebraicMove>& moves, std::string& result);
+private:
+    Options m_Options;
+};
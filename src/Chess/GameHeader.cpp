@@ -0,0 +1,216 @@
+#include "GameHeader.h"
+
+#include "Utility/StringPool.h"
+
+#include <algorithm>
+#include <charconv>
+
+// In the order of the Tag enum
+static constexpr std::array<std::string_view, 11> s_TagNames = {
+    "Event", "Site", "Date", "Round", "White", "Black", "Result",
+    "WhiteElo", "BlackElo", "ECO", "TimeControl",
+};
+
+static constexpr std::array<std::string_view, 4> s_Results = { "*", "1-0", "0-1", "1/2-1/2" };
+
+std::string_view ToString(GameResult result) {
+    return s_Results[(size_t)result];
+}
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// A number without leading zeros, or "??" (0) for the parts of a date
+static bool ParseNumber(std::string_view text, uint32_t max, bool unknown, uint32_t& value) {
+    if (unknown && std::all_of(text.begin(), text.end(), [](char c) { return c == '?'; })) {
+        value = 0;
+        return true;
+    }
+
+    if (text.empty() || !std::all_of(text.begin(), text.end(), IsDigit))
+        return false;
+
+    value = 0;
+    for (char c : text)
+        value = value * 10 + (c - '0');
+
+    return value <= max;
+}
+
+GameHeader::Tag GameHeader::FindTag(std::string_view tag) {
+    return (Tag)(std::find(s_TagNames.begin(), s_TagNames.end(), tag) - s_TagNames.begin());
+}
+
+void GameHeader::Assign(const GameHeader& other) {
+    if (this == &other)
+        return;
+
+    Clear();
+    other.ForEach([this](std::string_view tag, std::string_view value) { Set(tag, value); });
+}
+
+void GameHeader::Set(std::string_view tag, std::string_view value) {
+    const Tag typed = FindTag(tag);
+    if (typed != TagCount) {
+        // A value that doesn't fit the type replaces the typed one
+        m_Typed &= ~(1 << typed);
+
+        if (SetTyped(typed, value)) {
+            m_Typed |= 1 << typed;
+            m_Other.erase(std::remove_if(m_Other.begin(), m_Other.end(), [tag](const auto& t) { return t.first == tag; }), m_Other.end());
+            return;
+        }
+    }
+
+    for (auto& [name, text] : m_Other) {
+        if (name == tag) {
+            text = Copy(value);
+            return;
+        }
+    }
+
+    m_Other.emplace_back(StringPool::Get().Intern(tag), Copy(value));
+}
+
+std::string GameHeader::Get(std::string_view tag) const {
+    const Tag typed = FindTag(tag);
+    if (typed != TagCount && (m_Typed & (1 << typed))) {
+        char buffer[10];
+        return std::string(GetTyped(typed, buffer));
+    }
+
+    for (const auto& [name, text] : m_Other) {
+        if (name == tag)
+            return std::string(text);
+    }
+
+    return {};
+}
+
+bool GameHeader::Has(std::string_view tag) const {
+    const Tag typed = FindTag(tag);
+    if (typed != TagCount && (m_Typed & (1 << typed)))
+        return true;
+
+    return std::any_of(m_Other.begin(), m_Other.end(), [tag](const auto& t) { return t.first == tag; });
+}
+
+void GameHeader::Clear() {
+    m_Typed = 0;
+
+    m_Event = m_Site = m_Round = m_White = m_Black = m_TimeControl = {};
+    m_Date = {};
+    m_Result = GameResult::Unfinished;
+    m_WhiteElo = m_BlackElo = 0;
+
+    decltype(m_Other)(m_Resource).swap(m_Other);
+}
+
+void GameHeader::ForEach(const std::function<void(std::string_view tag, std::string_view value)>& function) const {
+    char buffer[10];
+    for (uint8_t tag = 0; tag < TagCount; tag++) {
+        if (m_Typed & (1 << tag))
+            function(s_TagNames[tag], GetTyped((Tag)tag, buffer));
+    }
+
+    for (const auto& [name, text] : m_Other)
+        function(name, text);
+}
+
+bool GameHeader::SetTyped(Tag tag, std::string_view value) {
+    uint32_t number = 0;
+
+    switch (tag) {
+        case Event:       m_Event = StringPool::Get().Intern(value); return true;
+        case White:       m_White = StringPool::Get().Intern(value); return true;
+        case Black:       m_Black = StringPool::Get().Intern(value); return true;
+        case TimeControl: m_TimeControl = StringPool::Get().Intern(value); return true;
+        case Site:        m_Site = Copy(value); return true;
+        case Round:       m_Round = Copy(value); return true;
+        case Date: {
+            // "YYYY.MM.DD", a year of 0 would be written as "????"
+            uint32_t year, month, day;
+            if (value.size() != 10 || value[4] != '.' || value[7] != '.')
+                return false;
+
+            if (!ParseNumber(value.substr(0, 4), 9999, true, year) || (year == 0 && value[0] != '?'))
+                return false;
+
+            if (!ParseNumber(value.substr(5, 2), 12, true, month) || (month == 0 && value[5] != '?'))
+                return false;
+
+            if (!ParseNumber(value.substr(8, 2), 31, true, day) || (day == 0 && value[8] != '?'))
+                return false;
+
+            m_Date = { (uint16_t)year, (uint8_t)month, (uint8_t)day };
+            return true;
+        }
+        case Result: {
+            auto it = std::find(s_Results.begin(), s_Results.end(), value);
+            if (it == s_Results.end())
+                return false;
+
+            m_Result = (GameResult)(it - s_Results.begin());
+            return true;
+        }
+        case WhiteElo:
+        case BlackElo:
+            // Without leading zeros, so it is written back the same
+            if (value.size() > 5 || (value.size() > 1 && value[0] == '0') || !ParseNumber(value, 0xFFFF, false, number))
+                return false;
+
+            (tag == WhiteElo ? m_WhiteElo : m_BlackElo) = (uint16_t)number;
+            return true;
+        case ECO:
+            if (value.size() != 3 || value[0] < 'A' || value[0] > 'E' || !IsDigit(value[1]) || !IsDigit(value[2]))
+                return false;
+
+            std::copy(value.begin(), value.end(), m_ECO.begin());
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string_view GameHeader::GetTyped(Tag tag, char* buffer) const {
+    // Writes 'value' with 'digits' digits, or question marks if it is 0
+    auto write = [](char* ptr, uint32_t value, int digits) {
+        const bool unknown = value == 0;
+        for (int i = digits - 1; i >= 0; i--, value /= 10)
+            ptr[i] = unknown ? '?' : (char)('0' + value % 10);
+    };
+
+    switch (tag) {
+        case Event:       return m_Event;
+        case Site:        return m_Site;
+        case Round:       return m_Round;
+        case White:       return m_White;
+        case Black:       return m_Black;
+        case TimeControl: return m_TimeControl;
+        case Result:      return ToString(m_Result);
+        case ECO:         return GetECO();
+        case Date:
+            buffer[4] = buffer[7] = '.';
+            write(buffer, m_Date.Year, 4);
+            write(buffer + 5, m_Date.Month, 2);
+            write(buffer + 8, m_Date.Day, 2);
+
+            return std::string_view(buffer, 10);
+        case WhiteElo:
+        case BlackElo:
+            return std::string_view(buffer, std::to_chars(buffer, buffer + 10, tag == WhiteElo ? m_WhiteElo : m_BlackElo).ptr - buffer);
+        default:
+            return {};
+    }
+}
+
+std::string_view GameHeader::Copy(std::string_view text) {
+    if (text.empty())
+        return {};
+
+    char* copy = (char*)m_Resource->allocate(text.size(), 1);
+    std::copy(text.begin(), text.end(), copy);
+
+    return std::string_view(copy, text.size());
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The Result tag
+enum class GameResult : uint8_t {
+    Unfinished,  // "*"
+    WhiteWins,   // "1-0"
+    BlackWins,   // "0-1"
+    Draw,        // "1/2-1/2"
+};
+
+std::string_view ToString(GameResult result);
+
+// The Date tag ("YYYY.MM.DD"), with 0 for the parts that are unknown ("??")
+struct PgnDate {
+    uint16_t Year = 0;
+    uint8_t Month = 0;
+    uint8_t Day = 0;
+};
+
+// The tags of a game
+//
+// The Seven Tag Roster (Event, Site, Date, Round, White, Black and Result) and the common tags
+// (WhiteElo, BlackElo, ECO and TimeControl) are typed fields, the other tags are in a small list in the order they were set
+// Events, players, time controls and the names of the other tags repeat across many games,
+// so they are interned (StringPool::Get()), and the rest of the text is copied into the memory resource of the game
+// A value that doesn't fit the type of its tag (like the date "1956") is kept as text with the other tags
+class GameHeader {
+public:
+    GameHeader(std::pmr::memory_resource* resource) : m_Resource(resource), m_Other(resource) {}
+    // Copies the text of 'other' into 'resource'
+    GameHeader(const GameHeader& other, std::pmr::memory_resource* resource) : GameHeader(resource) { Assign(other); }
+
+    GameHeader(const GameHeader&) = delete;
+    GameHeader& operator=(const GameHeader&) = delete;
+
+    // Replaces the tags with the tags of 'other' (copied into the memory resource of this header)
+    void Assign(const GameHeader& other);
+
+    void Set(std::string_view tag, std::string_view value);
+    // Value of a tag (empty if the tag is missing)
+    std::string Get(std::string_view tag) const;
+    bool Has(std::string_view tag) const;
+
+    bool IsEmpty() const { return m_Typed == 0 && m_Other.empty(); }
+    // Removes every tag, and gives back the memory of the list (so the memory resource can be released)
+    void Clear();
+
+    // Calls 'function' with each tag and its value, the Seven Tag Roster first (in its order)
+    void ForEach(const std::function<void(std::string_view tag, std::string_view value)>& function) const;
+
+    std::string_view GetEvent()       const { return m_Event; }
+    std::string_view GetSite()        const { return m_Site; }
+    PgnDate GetDate()                 const { return m_Date; }
+    std::string_view GetRound()       const { return m_Round; }
+    std::string_view GetWhite()       const { return m_White; }
+    std::string_view GetBlack()       const { return m_Black; }
+    GameResult GetResult()            const { return m_Result; }  // Unfinished if the tag is missing
+    uint16_t GetWhiteElo()            const { return m_WhiteElo; }  // 0 if the tag is missing
+    uint16_t GetBlackElo()            const { return m_BlackElo; }
+    std::string_view GetECO()         const { return std::string_view(m_ECO.data(), (m_Typed & (1 << ECO)) ? m_ECO.size() : 0); }
+    std::string_view GetTimeControl() const { return m_TimeControl; }
+private:
+    enum Tag : uint8_t {
+        Event, Site, Date, Round, White, Black, Result,
+        WhiteElo, BlackElo, ECO, TimeControl,
+        TagCount
+    };
+
+    // TagCount if the tag isn't typed
+    static Tag FindTag(std::string_view tag);
+
+    // Returns false if the value doesn't fit the type of the tag
+    bool SetTyped(Tag tag, std::string_view value);
+    // 'buffer' is for the tags that are written as text (10 characters)
+    std::string_view GetTyped(Tag tag, char* buffer) const;
+
+    std::string_view Copy(std::string_view text);
+
+    std::pmr::memory_resource* m_Resource;
+
+    uint16_t m_Typed = 0;  // A bit for each typed tag that is set
+
+    std::string_view m_Event;
+    std::string_view m_Site;
+    std::string_view m_Round;
+    std::string_view m_White;
+    std::string_view m_Black;
+    std::string_view m_TimeControl;
+    PgnDate m_Date;
+    GameResult m_Result = GameResult::Unfinished;
+    uint16_t m_WhiteElo = 0;
+    uint16_t m_BlackElo = 0;
+    std::array<char, 3> m_ECO = {};
+
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> m_Other;
+};
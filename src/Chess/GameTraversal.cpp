@@ -0,0 +1,85 @@
+#include "GameTraversal.h"
+
+GameTraversal::GameTraversal(const Game& game, bool positions) : m_Game(game), m_Positions(positions), m_Position(game.GetStartPosition()) {}
+
+bool GameTraversal::Next(Event& event) {
+    while (true) {
+        switch (m_State) {
+            case State::Line: {
+                const NodeIndex main = m_Game.GetNode(m_Node).FirstChild;
+                if (main == NO_NODE) {
+                    if (m_Stack.empty())
+                        return false;
+
+                    // The end of a variation, back to the position before it
+                    Unplay(m_Stack.back().Length);
+                    m_State = State::Variations;
+
+                    event = { EventType::EndVariation, m_Stack.back().Variation, m_Depth-- };
+                    return true;
+                }
+
+                const NodeIndex variation = m_Game.GetNode(main).NextSibling;
+                if (variation != NO_NODE) {
+                    m_Stack.push_back({ main, NO_NODE, variation, m_Length });
+                    m_State = State::Variations;
+                }
+
+                Play(main);
+                m_Node = main;
+
+                event = { EventType::Move, main, m_Depth };
+                return true;
+            }
+            case State::Variations: {
+                Branch& branch = m_Stack.back();
+                Unplay(branch.Length);
+
+                if (branch.NextVariation != NO_NODE) {
+                    branch.Variation = branch.NextVariation;
+                    branch.NextVariation = m_Game.GetNode(branch.Variation).NextSibling;
+
+                    m_Node = branch.Variation;
+                    m_State = State::Enter;
+
+                    event = { EventType::StartVariation, branch.Variation, ++m_Depth };
+                    return true;
+                }
+
+                // Every variation was walked, the line continues after the main move
+                m_Node = branch.Main;
+                m_Stack.pop_back();
+
+                Play(m_Node);
+                m_State = State::Line;
+                break;
+            }
+            case State::Enter:
+                Play(m_Node);
+                m_State = State::Line;
+
+                event = { EventType::Move, m_Node, m_Depth };
+                return true;
+        }
+    }
+}
+
+void GameTraversal::Play(NodeIndex node) {
+    m_Length++;
+    if (!m_Positions)
+        return;
+
+    const GameMove& gm = m_Game.GetNode(node).Move;
+    m_Position.MakeMove(LongAlgebraicMove(gm.Start, gm.Destination, (PieceType)(gm.Flags & GameMoveFlag::PromotionFlags)), m_Undo.emplace_back());
+}
+
+void GameTraversal::Unplay(size_t length) {
+    if (m_Positions) {
+        for (; m_Length > length; m_Length--) {
+            m_Position.UnmakeMove(m_Undo.back());
+            m_Undo.pop_back();
+        }
+    }
+
+    m_Length = length;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Game.h"
+
+// Walks every node of a game tree without recursion, in the order the moves are written in PGN:
+// a move, then its variations (each one with every move after it), then the moves after it
+//
+// The state is an explicit stack with an entry for each move that has variations,
+// so the depth of the tree is only limited by memory
+// The links of transpositions aren't followed, each node is visited once
+class GameTraversal {
+public:
+    enum class EventType : uint8_t {
+        Move,            // The move of 'Node' was played
+        StartVariation,  // A variation starting with 'Node' begins (its move comes next)
+        EndVariation,    // The variation starting with 'Node' is over, the position is back to before it
+    };
+
+    struct Event {
+        EventType Type;
+        NodeIndex Node;
+        uint32_t Depth;  // The number of variations the node is in (1 for the first level of variations)
+    };
+
+    // With 'positions', the moves are played on one board (with Board::MakeMove() and Board::UnmakeMove()),
+    // and GetPosition() is the position after the last move event
+    GameTraversal(const Game& game, bool positions = false);
+
+    // Returns false when every node has been visited
+    bool Next(Event& event);
+
+    // The position after the moves of the current line (the starting position without 'positions')
+    const Board& GetPosition() const { return m_Position; }
+    // The number of moves played from the starting position to the current node
+    size_t GetLength() const { return m_Length; }
+private:
+    void Play(NodeIndex node);
+    // Takes back moves until 'length' moves are left
+    void Unplay(size_t length);
+
+    enum class State : uint8_t {
+        Line,        // Continue with the main move after 'm_Node'
+        Variations,  // Start the next variation of the top of the stack, or continue after its main move
+        Enter,       // Play the first move of the variation that started
+    };
+
+    const Game& m_Game;
+    const bool m_Positions;
+
+    Board m_Position;
+    std::vector<UndoInfo> m_Undo;  // Only with 'm_Positions'
+    size_t m_Length = 0;
+
+    // A move with variations: the variations are walked before the moves after it
+    struct Branch {
+        NodeIndex Main;
+        NodeIndex Variation;      // The variation being walked
+        NodeIndex NextVariation;  // NO_NODE after the last one
+        size_t Length;            // The number of moves before them
+    };
+
+    std::vector<Branch> m_Stack;
+
+    State m_State = State::Line;
+    NodeIndex m_Node = Game::GetRoot();
+    uint32_t m_Depth = 0;
+};
@@ -137,12 +137,26 @@ struct LongAlgebraicMove {
         }
     }
 
-    std::string ToString() noexcept;
+    // Longest possible string is 5 characters (ex. e7e8q)
+    static constexpr size_t MAX_STRING_LENGTH = 5;
+
+    // Writes the move in UCI notation to 'buffer' (not null-terminated)
+    // 'buffer' must have space for at least MAX_STRING_LENGTH characters
+    // Returns a pointer to one past the last character written
+    char* WriteTo(char* buffer) const noexcept;
+
+    std::string ToString() const noexcept;
+
+    bool operator==(const LongAlgebraicMove& m) const {
+        return SourceSquare == m.SourceSquare && DestinationSquare == m.DestinationSquare && Promotion == m.Promotion;
+    }
+
+    bool operator!=(const LongAlgebraicMove& m) const { return !(*this == m); }
 };
 
 inline std::ostream& operator<<(std::ostream& os, LongAlgebraicMove m) {
-    os << m.ToString();
-    return os;
+    char buffer[LongAlgebraicMove::MAX_STRING_LENGTH];
+    return os.write(buffer, m.WriteTo(buffer) - buffer);
 }
 
 using MoveFlags = uint8_t;
@@ -190,15 +204,30 @@ struct AlgebraicMove {
     // Other information like check(mate), captures, castling, and promotion
     MoveFlags Flags = 0;
 
+    AlgebraicMove() = default;
     AlgebraicMove(PieceType movingPiece, Square destination, Square specifier, MoveFlags flags)
 	    : MovingPiece(movingPiece), Destination(destination), Specifier(specifier), Flags(flags) {}
     
     AlgebraicMove(std::string_view str);
 
-    std::string ToString() noexcept;
+    // Longest possible string is 7 characters (ex. axb8=N+, Qf3xh3#)
+    static constexpr size_t MAX_STRING_LENGTH = 7;
+    // Figurines take 3 bytes of UTF-8, so the longest is 9 bytes (ex. ♕f3xh3#, axb8=♘+)
+    static constexpr size_t MAX_FIGURINE_STRING_LENGTH = 9;
+
+    // Writes the move in standard algebraic notation to 'buffer' (not null-terminated)
+    // 'buffer' must have space for at least MAX_STRING_LENGTH characters
+    // Returns a pointer to one past the last character written
+    char* WriteTo(char* buffer) const noexcept;
+
+    // Same as WriteTo(), but pieces are written as UTF-8 figurines (ex. ♘f3 instead of Nf3)
+    // 'buffer' must have space for at least MAX_FIGURINE_STRING_LENGTH characters
+    char* WriteFigurineTo(char* buffer) const noexcept;
+
+    std::string ToString() const noexcept;
 };
 
 inline std::ostream& operator<<(std::ostream& os, AlgebraicMove m) {
-    os << m.ToString();
-    return os;
+    char buffer[AlgebraicMove::MAX_STRING_LENGTH];
+    return os.write(buffer, m.WriteTo(buffer) - buffer);
 }
@@ -0,0 +1,410 @@
+#include "OpeningExplorer.h"
+
+#include "Game.h"
+#include "GameCursor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <random>
+#include <sstream>
+
+namespace {
+    constexpr char MAGIC[8] = { 'E', 'X', 'P', 'L', 'O', 'R', 'E', 'R' };
+    constexpr uint32_t VERSION = 1;
+
+    // Entries per bucket, on average, when every move of the runs is a different entry
+    constexpr uint64_t BUCKET_ENTRIES = 32;
+
+    template<typename T>
+    T ReadValue(const uint8_t* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    void WriteValue(uint8_t* data, T value) {
+        std::memcpy(data, &value, sizeof(T));
+    }
+
+    // Reads the records of a run in blocks
+    template<typename Record>
+    class RunReader {
+    public:
+        RunReader(const std::filesystem::path& path) : m_File(path, std::ios::binary) {}
+
+        bool IsOpen() const { return (bool)m_File; }
+
+        // Returns false at the end of the run
+        bool Next(Record& record) {
+            if (m_Position == m_Records.size()) {
+                m_Records.resize(4096);
+                m_File.read((char*)m_Records.data(), m_Records.size() * sizeof(Record));
+                m_Records.resize(m_File.gcount() / sizeof(Record));
+                m_Position = 0;
+
+                if (m_Records.empty())
+                    return false;
+            }
+
+            record = m_Records[m_Position++];
+            return true;
+        }
+    private:
+        std::ifstream m_File;
+        std::vector<Record> m_Records;
+        size_t m_Position = 0;
+    };
+}
+
+bool OpeningExplorer::Open(const std::filesystem::path& path) {
+    Close();
+
+    if (!m_File.Open(path) || m_File.GetSize() < HEADER_SIZE) {
+        m_File.Close();
+        return false;
+    }
+
+    const uint8_t* data = m_File.GetData();
+    const uint32_t bucketBits = ReadValue<uint32_t>(data + 12);
+    const uint64_t entries = ReadValue<uint64_t>(data + 16);
+    const uint64_t buckets = ReadValue<uint64_t>(data + 24);
+
+    const bool valid = std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0 && ReadValue<uint32_t>(data + 8) == VERSION && bucketBits <= 32 &&
+        entries <= (m_File.GetSize() - HEADER_SIZE) / ENTRY_SIZE && buckets == HEADER_SIZE + entries * ENTRY_SIZE &&
+        m_File.GetSize() - buckets == (((uint64_t)1 << bucketBits) + 1) * 8;
+
+    if (!valid) {
+        m_File.Close();
+        return false;
+    }
+
+    // Lookups search between the entries the buckets give, so they must run from the first entry to the last
+    // without going backwards
+    const uint8_t* bucketData = data + buckets;
+    const uint64_t bucketCount = ((uint64_t)1 << bucketBits) + 1;
+    uint64_t previous = 0;
+    for (uint64_t i = 0; i < bucketCount; i++) {
+        const uint64_t first = ReadValue<uint64_t>(bucketData + i * 8);
+        if (first < previous || first > entries || (i == 0 && first != 0) || (i == bucketCount - 1 && first != entries)) {
+            m_File.Close();
+            return false;
+        }
+        previous = first;
+    }
+
+    m_Entries = data + HEADER_SIZE;
+    m_Buckets = data + buckets;
+    m_BucketBits = bucketBits;
+    m_EntryCount = entries;
+    return true;
+}
+
+void OpeningExplorer::Close() {
+    m_File.Close();
+    m_Entries = nullptr;
+    m_Buckets = nullptr;
+    m_BucketBits = 0;
+    m_EntryCount = 0;
+}
+
+uint64_t OpeningExplorer::GetHash(size_t entry) const {
+    return ReadValue<uint64_t>(m_Entries + entry * ENTRY_SIZE);
+}
+
+ExplorerMove OpeningExplorer::GetMove(size_t entry) const {
+    const uint8_t* data = m_Entries + entry * ENTRY_SIZE;
+    const uint16_t move = ReadValue<uint16_t>(data + 8);
+
+    ExplorerMove result;
+    result.Move = LongAlgebraicMove(move & 0x3F, (move >> 6) & 0x3F, (PieceType)(move >> 12));
+    result.Statistics.Games = ReadValue<uint32_t>(data + 12);
+    result.Statistics.WhiteWins = ReadValue<uint32_t>(data + 16);
+    result.Statistics.Draws = ReadValue<uint32_t>(data + 20);
+    result.Statistics.BlackWins = ReadValue<uint32_t>(data + 24);
+    result.Statistics.EloCount = ReadValue<uint32_t>(data + 28);
+    result.Statistics.EloSum = ReadValue<uint64_t>(data + 32);
+    return result;
+}
+
+std::pair<size_t, size_t> OpeningExplorer::FindEntries(uint64_t hash) const {
+    if (m_EntryCount == 0)
+        return { 0, 0 };
+
+    // The bucket of the hash, then a binary search of its entries
+    const uint64_t bucket = m_BucketBits == 0 ? 0 : hash >> (64 - m_BucketBits);
+    size_t low = (size_t)ReadValue<uint64_t>(m_Buckets + bucket * 8);
+    size_t high = (size_t)ReadValue<uint64_t>(m_Buckets + bucket * 8 + 8);
+
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (GetHash(middle) < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    size_t last = low;
+    while (last < m_EntryCount && GetHash(last) == hash)
+        last++;
+
+    return { low, last };
+}
+
+size_t OpeningExplorer::GetMoves(const Board& board, std::vector<ExplorerMove>& moves) const {
+    moves.clear();
+
+    const auto [first, last] = FindEntries(board.GetHash());
+    for (size_t i = first; i < last; i++)
+        moves.push_back(GetMove(i));
+
+    std::stable_sort(moves.begin(), moves.end(), [](const ExplorerMove& a, const ExplorerMove& b) {
+        return a.Statistics.Games > b.Statistics.Games;
+    });
+
+    return moves.size();
+}
+
+MoveStatistics OpeningExplorer::GetStatistics(const Board& board) const {
+    MoveStatistics statistics;
+
+    const auto [first, last] = FindEntries(board.GetHash());
+    for (size_t i = first; i < last; i++)
+        statistics.Add(GetMove(i).Statistics);
+
+    return statistics;
+}
+
+OpeningExplorerBuilder::OpeningExplorerBuilder(const Options& options) : m_Options(options) {
+    if (m_Options.TemporaryDirectory.empty())
+        m_Options.TemporaryDirectory = std::filesystem::temp_directory_path();
+
+    m_Options.BufferedMoves = std::max<size_t>(1, m_Options.BufferedMoves);
+
+    // Builders of other processes can use the same directory (and have the same address),
+    // so the runs are named with a random number, and a counter for the builders of this process
+    static std::atomic<uint64_t> s_Builders = 0;
+    std::random_device random;
+    const uint64_t id = (uint64_t)random() << 32 ^ random() ^ (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+
+    std::ostringstream prefix;
+    prefix << "explorer_" << std::hex << id << "_" << std::dec << s_Builders.fetch_add(1) << "_";
+    m_RunPrefix = prefix.str();
+}
+
+OpeningExplorerBuilder::~OpeningExplorerBuilder() {
+    RemoveRuns();
+}
+
+bool OpeningExplorerBuilder::AddGame(const Game& game) {
+    if (m_Written)
+        return false;
+
+    // The same statistics as a Repertoire
+    const GameHeader& header = game.GetHeader();
+
+    MoveStatistics statistics;
+    statistics.Games = 1;
+    statistics.WhiteWins = header.GetResult() == GameResult::WhiteWins;
+    statistics.Draws = header.GetResult() == GameResult::Draw;
+    statistics.BlackWins = header.GetResult() == GameResult::BlackWins;
+
+    for (uint16_t elo : { header.GetWhiteElo(), header.GetBlackElo() }) {
+        statistics.EloSum += elo;
+        statistics.EloCount += elo != 0;
+    }
+
+    m_Games++;
+
+    GameCursor cursor(game);
+    for (uint32_t ply = 0; m_Options.MaxPly == 0 || ply < m_Options.MaxPly; ply++) {
+        const uint64_t hash = cursor.GetPosition().GetHash();
+        if (!cursor.Forward())
+            break;
+
+        const GameMove& move = game.GetNode(cursor.CurrentNode()).Move;
+        m_Buffer.push_back({ hash, (uint16_t)(move.Start | move.Destination << 6 | (move.Flags & GameMoveFlag::PromotionFlags) << 12), statistics });
+
+        if (m_Buffer.size() >= m_Options.BufferedMoves && !WriteRun())
+            return false;
+    }
+
+    return !m_Failed;
+}
+
+bool OpeningExplorerBuilder::Import(const std::filesystem::path& path, const PgnImporter::Options& options, PgnImporter::Statistics& statistics) {
+    if (m_Written)
+        return false;
+
+    const bool imported = PgnImporter(options).Import(path, [this](PgnImporter::ImportedGame& game) {
+        if (game.Parsed)
+            AddGame(*game.Parsed);
+    }, statistics);
+
+    return imported && !m_Failed;
+}
+
+bool OpeningExplorerBuilder::WriteRun() {
+    std::sort(m_Buffer.begin(), m_Buffer.end(), [](const Record& a, const Record& b) {
+        return a.Hash != b.Hash ? a.Hash < b.Hash : a.Move < b.Move;
+    });
+
+    // The same move from the same position is one record
+    size_t count = 0;
+    for (const Record& record : m_Buffer) {
+        if (count != 0 && m_Buffer[count - 1].Hash == record.Hash && m_Buffer[count - 1].Move == record.Move)
+            m_Buffer[count - 1].Statistics.Add(record.Statistics);
+        else
+            m_Buffer[count++] = record;
+    }
+
+    const std::filesystem::path path = m_Options.TemporaryDirectory / (m_RunPrefix + std::to_string(m_Runs.size()) + ".run");
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)m_Buffer.data(), count * sizeof(Record));
+    file.close();
+
+    m_Runs.push_back(path);
+    m_RunRecords += count;
+    m_Buffer.clear();
+
+    if (!file)
+        m_Failed = true;
+
+    return !m_Failed;
+}
+
+void OpeningExplorerBuilder::RemoveRuns() {
+    std::error_code error;
+    for (const std::filesystem::path& run : m_Runs)
+        std::filesystem::remove(run, error);
+
+    m_Runs.clear();
+    m_RunRecords = 0;
+}
+
+bool OpeningExplorerBuilder::Write(const std::filesystem::path& path) {
+    if (m_Written)
+        return false;
+
+    if (!m_Buffer.empty())
+        WriteRun();
+
+    if (m_Failed) {
+        RemoveRuns();
+        return false;
+    }
+
+    std::vector<RunReader<Record>> runs;
+    runs.reserve(m_Runs.size());
+    for (const std::filesystem::path& run : m_Runs) {
+        if (!runs.emplace_back(run).IsOpen()) {
+            m_Failed = true;
+            RemoveRuns();
+            return false;
+        }
+    }
+
+    // Before anything is merged, so the runs are still there to write the explorer somewhere else
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    // The runs have at least as many records as the explorer will have entries
+    uint32_t bucketBits = 0;
+    while (bucketBits < 32 && ((uint64_t)BUCKET_ENTRIES << bucketBits) < m_RunRecords)
+        bucketBits++;
+
+    std::vector<uint64_t> buckets(((size_t)1 << bucketBits) + 1);
+    size_t nextBucket = 0;
+    uint64_t entries = 0;
+
+    uint8_t header[OpeningExplorer::HEADER_SIZE] = {};
+    file.write((const char*)header, sizeof(header));
+
+    auto writeEntry = [&](const Record& record) {
+        const uint64_t bucket = bucketBits == 0 ? 0 : record.Hash >> (64 - bucketBits);
+        while (nextBucket <= bucket)
+            buckets[nextBucket++] = entries;
+
+        uint8_t entry[OpeningExplorer::ENTRY_SIZE] = {};
+        WriteValue<uint64_t>(entry, record.Hash);
+        WriteValue<uint16_t>(entry + 8, record.Move);
+        WriteValue<uint32_t>(entry + 12, record.Statistics.Games);
+        WriteValue<uint32_t>(entry + 16, record.Statistics.WhiteWins);
+        WriteValue<uint32_t>(entry + 20, record.Statistics.Draws);
+        WriteValue<uint32_t>(entry + 24, record.Statistics.BlackWins);
+        WriteValue<uint32_t>(entry + 28, record.Statistics.EloCount);
+        WriteValue<uint64_t>(entry + 32, record.Statistics.EloSum);
+        file.write((const char*)entry, sizeof(entry));
+        entries++;
+    };
+
+    // Merges the runs: the smallest record of each run is in the queue, with the index of its run
+    using Head = std::pair<Record, size_t>;
+    auto greater = [](const Head& a, const Head& b) {
+        return a.first.Hash != b.first.Hash ? a.first.Hash > b.first.Hash : a.first.Move > b.first.Move;
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(greater)> queue(greater);
+
+    for (size_t i = 0; i < runs.size(); i++) {
+        Record record;
+        if (runs[i].Next(record))
+            queue.push({ record, i });
+    }
+
+    bool pending = false;
+    Record current = {};
+    while (!queue.empty()) {
+        const auto [record, run] = queue.top();
+        queue.pop();
+
+        if (pending && current.Hash == record.Hash && current.Move == record.Move) {
+            current.Statistics.Add(record.Statistics);
+        } else {
+            if (pending)
+                writeEntry(current);
+
+            current = record;
+            pending = true;
+        }
+
+        Record next;
+        if (runs[run].Next(next))
+            queue.push({ next, run });
+    }
+
+    if (pending)
+        writeEntry(current);
+
+    while (nextBucket < buckets.size())
+        buckets[nextBucket++] = entries;
+
+    file.write((const char*)buckets.data(), buckets.size() * sizeof(uint64_t));
+
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    WriteValue<uint32_t>(header + 8, VERSION);
+    WriteValue<uint32_t>(header + 12, bucketBits);
+    WriteValue<uint64_t>(header + 16, entries);
+    WriteValue<uint64_t>(header + 24, OpeningExplorer::HEADER_SIZE + entries * OpeningExplorer::ENTRY_SIZE);
+    file.seekp(0);
+    file.write((const char*)header, sizeof(header));
+    file.close();
+
+    // The runs can still be written somewhere else (the file system could be full)
+    if (!file) {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+
+    runs.clear();
+    RemoveRuns();
+    m_Written = true;
+
+    return true;
+}
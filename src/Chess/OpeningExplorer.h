@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "PgnImporter.h"
+#include "Repertoire.h"
+#include "Utility/MappedFile.h"
+
+class Game;
+
+// A move of the explorer, with the games that played it from the position
+struct ExplorerMove {
+    LongAlgebraicMove Move;
+    MoveStatistics Statistics;
+};
+
+// A memory mapped opening explorer: the moves played from each position (by its hash, Board::GetHash()),
+// with how often they were played, how those games ended and the average rating of the players
+//
+// The file is (little endian):
+//     header: MAGIC (8 bytes), VERSION (4 bytes), bucket bits (4 bytes), number of entries (8 bytes), offset of the buckets (8 bytes)
+//     the entries, sorted by hash then move, 40 bytes each:
+//         hash (8 bytes), move (2 bytes: source square | destination square << 6 | promotion << 12), unused (2 bytes),
+//         games, white wins, draws, black wins, rated players (4 bytes each), sum of the ratings (8 bytes)
+//     the buckets: for each value of the top 'bucket bits' bits of the hash, the index of its first entry (8 bytes),
+//         then the number of entries
+// Hashes are spread evenly, so a bucket has a few dozen entries: a lookup reads one bucket and searches it,
+// which touches one or two pages of the file; only the buckets are read when it is opened, to check them
+class OpeningExplorer {
+public:
+    OpeningExplorer() = default;
+    OpeningExplorer(const std::filesystem::path& path) { Open(path); }
+
+    // Returns false if the file could not be mapped or isn't an explorer
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return m_File.IsOpen(); }
+    size_t GetEntryCount() const { return m_EntryCount; }
+
+    // The moves played from the position, the most played first
+    // Returns the number of moves
+    size_t GetMoves(const Board& board, std::vector<ExplorerMove>& moves) const;
+    // Of every game that went through the position (and had a move after it)
+    MoveStatistics GetStatistics(const Board& board) const;
+
+    static constexpr size_t ENTRY_SIZE = 40;
+    static constexpr size_t HEADER_SIZE = 32;
+private:
+    // The entries with the hash, [first, last)
+    std::pair<size_t, size_t> FindEntries(uint64_t hash) const;
+    uint64_t GetHash(size_t entry) const;
+    ExplorerMove GetMove(size_t entry) const;
+
+    MappedFile m_File;
+    const uint8_t* m_Entries = nullptr;
+    const uint8_t* m_Buckets = nullptr;
+    uint32_t m_BucketBits = 0;
+    size_t m_EntryCount = 0;
+};
+
+// Collects the moves of many games and writes them as an explorer file
+//
+// The moves are sorted outside of memory, so the number of positions isn't limited by the memory:
+// they are collected in a buffer, which is sorted (adding up the same moves of the same position) and written
+// to a temporary file (a run) each time it is full, then Write() merges the runs into the explorer in one pass
+class OpeningExplorerBuilder {
+public:
+    struct Options {
+        uint32_t MaxPly = 40;              // Moves of each game that are added (0 for every move)
+        size_t BufferedMoves = 1 << 22;    // Moves collected before they are written to a run (48 bytes each)
+        std::filesystem::path TemporaryDirectory;  // For the runs, the system's temporary directory if empty
+    };
+
+    OpeningExplorerBuilder(const Options& options);
+    ~OpeningExplorerBuilder();
+
+    OpeningExplorerBuilder(const OpeningExplorerBuilder&) = delete;
+    OpeningExplorerBuilder& operator=(const OpeningExplorerBuilder&) = delete;
+
+    // Adds the moves of the main line of the game (through transpositions), up to Options::MaxPly
+    // Returns false if a run could not be written, or if the explorer was already written
+    bool AddGame(const Game& game);
+    // Adds the games of a PGN file that could be parsed
+    // Returns false if the file could not be mapped, a run could not be written, or the explorer was already written
+    bool Import(const std::filesystem::path& path, const PgnImporter::Options& options, PgnImporter::Statistics& statistics);
+
+    uint64_t GetGameCount() const { return m_Games; }
+    size_t GetRunCount() const { return m_Runs.size(); }
+
+    // Merges the moves into an explorer file, and removes the runs, so it can only be done once
+    // Returns false if a run could not be read or written (the builder can't be used after that),
+    // if the explorer could not be written (the runs are kept, so it can be written to another path), or if it was already written
+    bool Write(const std::filesystem::path& path);
+private:
+    struct Record {
+        uint64_t Hash;
+        uint16_t Move;
+        MoveStatistics Statistics;
+    };
+
+    // Sorts the buffer and writes it to a new run
+    bool WriteRun();
+    void RemoveRuns();
+
+    Options m_Options;
+    std::string m_RunPrefix;    // Of the names of the runs, different for each builder, even in other processes
+    std::vector<Record> m_Buffer;
+    std::vector<std::filesystem::path> m_Runs;
+    uint64_t m_RunRecords = 0;  // In every run
+    uint64_t m_Games = 0;
+    bool m_Failed = false;      // A run could not be written or read
+    bool m_Written = false;     // By Write(), which takes the runs
+};
@@ -0,0 +1,231 @@
+#include "PgnImporter.h"
+
+#include "Game.h"
+#include "PgnReader.h"
+
+#include "Utility/BoundedQueue.h"
+#include "Utility/MappedFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Games sent between the stages together, so the queues are locked once for many games
+struct ImportBatch {
+    uint64_t Number = 0;
+    std::vector<PgnImporter::ImportedGame> Games;
+};
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PgnImporter::Statistics::Report(std::ostream& output) const {
+    output << Games << " games (" << Failures << " failed), " << Bytes / (1024.0 * 1024.0) << "MB in " << Seconds << "s: ";
+    output << (Seconds > 0 ? Games / Seconds : 0) << " games/s with " << Threads << " parsing threads\n";
+
+    auto stage = [&output](const char* name, const StageStatistics& stage) {
+        output << name << stage.GetThroughput() << " games/s while busy, " << stage.GetBusySeconds() << "s busy, ";
+        output << stage.Starved << "s starved, " << stage.Blocked << "s blocked\n";
+    };
+
+    stage("Scanning: ", Scanning);
+    stage("Parsing (all threads): ", Parsing);
+    stage("Output: ", Output);
+}
+
+bool PgnImporter::Import(const std::filesystem::path& path, const Callback& callback, Statistics& statistics) const {
+    MappedFile file;
+    if (!file.Open(path))
+        return false;
+
+    statistics = Import(std::string_view((const char*)file.GetData(), file.GetSize()), callback);
+    return true;
+}
+
+PgnImporter::Statistics PgnImporter::Import(std::string_view text, const Callback& callback) const {
+    const uint32_t threadCount = m_Options.Threads != 0 ? m_Options.Threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t batchSize = std::max(1u, m_Options.BatchSize);
+    const size_t queueSize = m_Options.QueueSize != 0 ? m_Options.QueueSize : 2 * threadCount;
+
+    // In order, a slow batch holds back the ones after it, so the output stage has to keep them
+    // The scanning stage waits when this many batches haven't been given to the callback
+    const uint64_t window = 2 * queueSize + threadCount;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    Statistics statistics;
+    statistics.Bytes = text.size();
+    statistics.Threads = threadCount;
+
+    BoundedQueue<ImportBatch> parseQueue(queueSize);
+    BoundedQueue<ImportBatch> outputQueue(queueSize);
+
+    std::mutex windowMutex;  // For 'outputBatches' and 'stopped'
+    std::condition_variable windowCondition;
+    uint64_t outputBatches = 0;
+    bool stopped = false;  // The callback threw an exception
+
+    auto scan = [&]() {
+        const auto stageStart = std::chrono::steady_clock::now();
+        StageStatistics& stage = statistics.Scanning;
+
+        PgnScanner scanner(text);
+        size_t offset = 0;
+        bool more = scanner.Next(offset);
+
+        ImportBatch batch;
+        size_t index = 0;
+        while (more) {
+            if (m_Options.Ordered) {
+                std::unique_lock<std::mutex> lock(windowMutex);
+                if (batch.Number - outputBatches >= window && !stopped) {
+                    const auto waitStart = std::chrono::steady_clock::now();
+                    windowCondition.wait(lock, [&]() { return batch.Number - outputBatches < window || stopped; });
+                    stage.Blocked += SecondsSince(waitStart);
+                }
+
+                if (stopped)
+                    break;
+            }
+
+            batch.Games.reserve(batchSize);
+            while (more && batch.Games.size() < batchSize) {
+                const size_t gameStart = offset;
+                more = scanner.Next(offset);
+
+                ImportedGame& game = batch.Games.emplace_back();
+                game.Index = index++;
+                game.Text = PgnScanner::GetGameText(text, gameStart, more ? offset : text.size());
+            }
+
+            stage.Games += batch.Games.size();
+            const uint64_t number = batch.Number;
+            if (!parseQueue.Push(std::move(batch), &stage.Blocked))
+                break;
+
+            batch = ImportBatch();
+            batch.Number = number + 1;
+        }
+
+        parseQueue.Close();
+        stage.Seconds = SecondsSince(stageStart);
+    };
+
+    std::mutex statisticsMutex;  // For 'statistics.Parsing' and 'statistics.Failures'
+    std::atomic<uint32_t> parsingThreads = threadCount;
+
+    auto parse = [&]() {
+        const auto stageStart = std::chrono::steady_clock::now();
+        StageStatistics stage;
+        uint64_t failures = 0;
+
+        ImportBatch batch;
+        while (parseQueue.Pop(batch, &stage.Starved)) {
+            for (ImportedGame& game : batch.Games) {
+                try {
+                    game.Parsed = std::make_unique<Game>(game.Text);
+                } catch (std::exception& e) {
+                    game.Error = e.what();
+                    failures++;
+                }
+            }
+
+            stage.Games += batch.Games.size();
+            outputQueue.Push(std::move(batch), &stage.Blocked);
+        }
+
+        // The last parsing thread tells the output stage that there are no more games
+        if (--parsingThreads == 0)
+            outputQueue.Close();
+
+        stage.Seconds = SecondsSince(stageStart);
+
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+        statistics.Parsing.Games += stage.Games;
+        statistics.Parsing.Seconds += stage.Seconds;
+        statistics.Parsing.Starved += stage.Starved;
+        statistics.Parsing.Blocked += stage.Blocked;
+        statistics.Failures += failures;
+    };
+
+    auto output = [&]() {
+        const auto stageStart = std::chrono::steady_clock::now();
+        StageStatistics& stage = statistics.Output;
+
+        auto give = [&](ImportBatch& batch) {
+            if (callback) {
+                for (ImportedGame& game : batch.Games)
+                    callback(game);
+            }
+
+            stage.Games += batch.Games.size();
+
+            if (m_Options.Ordered) {
+                {
+                    std::lock_guard<std::mutex> lock(windowMutex);
+                    outputBatches++;
+                }
+
+                windowCondition.notify_one();
+            }
+        };
+
+        std::map<uint64_t, ImportBatch> waiting;  // Batches that came before the ones in front of them
+        uint64_t next = 0;
+
+        ImportBatch batch;
+        while (outputQueue.Pop(batch, &stage.Starved)) {
+            if (!m_Options.Ordered) {
+                give(batch);
+                continue;
+            }
+
+            waiting.emplace(batch.Number, std::move(batch));
+            for (auto it = waiting.begin(); it != waiting.end() && it->first == next; it = waiting.erase(it), next++)
+                give(it->second);
+        }
+
+        stage.Seconds = SecondsSince(stageStart);
+    };
+
+    std::thread scanThread(scan);
+
+    std::vector<std::thread> parseThreads;
+    for (uint32_t i = 0; i < threadCount; i++)
+        parseThreads.emplace_back(parse);
+
+    auto join = [&]() {
+        scanThread.join();
+        for (std::thread& thread : parseThreads)
+            thread.join();
+    };
+
+    try {
+        output();
+    } catch (...) {
+        // Stop the other stages before passing on the exception
+        {
+            std::lock_guard<std::mutex> lock(windowMutex);
+            stopped = true;
+        }
+
+        windowCondition.notify_all();
+        parseQueue.Close();
+        outputQueue.Close();
+
+        join();
+        throw;
+    }
+
+    join();
+
+    statistics.Games = statistics.Output.Games;
+    statistics.Seconds = SecondsSince(start);
+    return statistics;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+class Game;
+
+// Imports a PGN file with many games on multiple threads
+//
+// The import is a pipeline of three stages, with a bounded queue between each of them:
+//     scanning: one thread finds where the games start (PgnScanner), and sends them in batches to the parsing threads
+//     parsing: each thread parses and checks the moves of a batch of games (each game has its own Board)
+//     output: one thread gives the games to the callback, in the order of the file if Options::Ordered
+// When a stage is slower than the one before it, its queue fills up and the stage before it waits (backpressure),
+// so the memory used doesn't depend on the size of the file
+class PgnImporter {
+public:
+    struct Options {
+        uint32_t Threads = 0;     // Parsing threads, 0 for one per core
+        bool Ordered = true;      // Give the games to the callback in the order of the file
+        uint32_t BatchSize = 64;  // Games sent between the stages at a time
+        uint32_t QueueSize = 0;   // Batches in each queue, 0 for two per parsing thread
+    };
+
+    struct ImportedGame {
+        size_t Index = 0;                    // Of the game in the file
+        std::string_view Text;               // Points into the file (only valid in the callback)
+        std::unique_ptr<Game> Parsed;        // nullptr if the game could not be parsed
+        std::string Error;                   // Why the game could not be parsed
+    };
+
+    // Called on the output thread, so it doesn't have to be thread safe
+    // The game can be moved out of 'Parsed'
+    using Callback = std::function<void(ImportedGame& game)>;
+
+    struct StageStatistics {
+        uint64_t Games = 0;
+        double Seconds = 0;   // Time the stage was running (added up for all the parsing threads)
+        double Starved = 0;   // Time spent waiting for the stage before it
+        double Blocked = 0;   // Time spent waiting for the stage after it (the queue was full)
+
+        double GetBusySeconds() const { return Seconds - Starved - Blocked; }
+        // Games per second when the stage is not waiting
+        double GetThroughput() const { return GetBusySeconds() > 0 ? Games / GetBusySeconds() : 0; }
+    };
+
+    struct Statistics {
+        uint64_t Games = 0;
+        uint64_t Failures = 0;      // Games that could not be parsed
+        uint64_t Bytes = 0;
+        uint32_t Threads = 0;       // Parsing threads
+        double Seconds = 0;
+
+        StageStatistics Scanning;
+        StageStatistics Parsing;
+        StageStatistics Output;
+
+        // Writes the throughput of each stage, and how long it waited for the others
+        void Report(std::ostream& output) const;
+    };
+
+    PgnImporter(const Options& options) : m_Options(options) {}
+
+    // Returns false if the file could not be mapped
+    bool Import(const std::filesystem::path& path, const Callback& callback, Statistics& statistics) const;
+    Statistics Import(std::string_view text, const Callback& callback) const;
+private:
+    Options m_Options;
+};
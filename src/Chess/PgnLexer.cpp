@@ -0,0 +1,327 @@
+#include "PgnLexer.h"
+
+#include "ChessException.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+    enum CharClass : uint8_t {
+        Invalid,
+        Space,
+        Digit,
+        Letter,
+        SymbolPart,      // Can be in a symbol after its first character: _ + # = : - /
+        Period,
+        Star,
+        LeftBracket,
+        RightBracket,
+        Quote,
+        LeftBrace,
+        Semicolon,
+        LeftParenthesis,
+        RightParenthesis,
+        Dollar,
+        Annotation,      // ! ?
+        Percent,
+    };
+
+    constexpr std::array<CharClass, 256> MakeClasses() {
+        std::array<CharClass, 256> classes{};
+
+        for (char c : { ' ', '\t', '\r', '\n', '\v', '\f' })
+            classes[(uint8_t)c] = Space;
+        for (char c = '0'; c <= '9'; c++)
+            classes[(uint8_t)c] = Digit;
+        for (char c = 'a'; c <= 'z'; c++)
+            classes[(uint8_t)c] = Letter;
+        for (char c = 'A'; c <= 'Z'; c++)
+            classes[(uint8_t)c] = Letter;
+        for (char c : { '_', '+', '#', '=', ':', '-', '/' })
+            classes[(uint8_t)c] = SymbolPart;
+
+        classes['.'] = Period;
+        classes['*'] = Star;
+        classes['['] = LeftBracket;
+        classes[']'] = RightBracket;
+        classes['"'] = Quote;
+        classes['{'] = LeftBrace;
+        classes[';'] = Semicolon;
+        classes['('] = LeftParenthesis;
+        classes[')'] = RightParenthesis;
+        classes['$'] = Dollar;
+        classes['!'] = Annotation;
+        classes['?'] = Annotation;
+        classes['%'] = Percent;
+
+        return classes;
+    }
+
+    constexpr std::array<CharClass, 256> s_Classes = MakeClasses();
+
+    CharClass Classify(char c) {
+        return s_Classes[(uint8_t)c];
+    }
+
+    bool IsSymbol(char c) {
+        const CharClass type = Classify(c);
+        return type == Digit || type == Letter || type == SymbolPart;
+    }
+
+    bool IsFile(char c) { return c >= 'a' && c <= 'h'; }
+    bool IsRank(char c) { return c >= '1' && c <= '8'; }
+
+    // If the text has the shape of a SAN move: [KQRBN]?[a-h]?[1-8]?x?[a-h][1-8](=[QRBN])?[+#]? or castling
+    bool IsSan(std::string_view san) {
+        if (!san.empty() && (san.back() == '+' || san.back() == '#'))
+            san.remove_suffix(1);
+
+        if (san == "O-O" || san == "O-O-O")
+            return true;
+
+        size_t end = san.size();
+        if (end >= 2 && san[end - 2] == '=') {
+            const char promotion = san[end - 1];
+            if (promotion != 'Q' && promotion != 'R' && promotion != 'B' && promotion != 'N')
+                return false;
+
+            end -= 2;
+        }
+
+        size_t i = 0;
+        if (i < end && (san[i] == 'K' || san[i] == 'Q' || san[i] == 'R' || san[i] == 'B' || san[i] == 'N'))
+            i++;
+
+        // The destination, then what is left is the capture and the square or file or rank the piece is on
+        if (end < i + 2 || !IsFile(san[end - 2]) || !IsRank(san[end - 1]))
+            return false;
+
+        end -= 2;
+        if (end > i && san[end - 1] == 'x')
+            end--;
+
+        if (i < end && IsFile(san[i]))
+            i++;
+        if (i < end && IsRank(san[i]))
+            i++;
+
+        return i == end;
+    }
+}
+
+bool PgnLexer::Next(PgnToken& token) {
+    while (SkipWhitespace()) {
+        const size_t start = m_Position;
+        const char c = m_Text[start];
+
+        token.Text = m_Text.substr(start, 1);
+        token.Value = {};
+        token.Number = 0;
+        token.Escaped = false;
+        token.Offset = start;
+
+        switch (Classify(c)) {
+            case Digit:
+            case Letter:
+                ReadSymbol(token);
+                return true;
+            case LeftBracket:
+                ReadTag(token);
+                return true;
+            case LeftBrace: {
+                // Comments don't nest, and one that isn't closed goes to the end of the text
+                const char* close = (const char*)std::memchr(m_Text.data() + start + 1, '}', m_Text.size() - start - 1);
+                const size_t end = close ? close - m_Text.data() : m_Text.size();
+
+                token.Type = PgnTokenType::Comment;
+                token.Text = m_Text.substr(start + 1, end - start - 1);
+                m_Position = close ? end + 1 : end;
+                return true;
+            }
+            case Semicolon: {
+                const char* newline = (const char*)std::memchr(m_Text.data() + start + 1, '\n', m_Text.size() - start - 1);
+                size_t end = newline ? newline - m_Text.data() : m_Text.size();
+                m_Position = end;
+
+                if (end > start + 1 && m_Text[end - 1] == '\r')
+                    end--;
+
+                token.Type = PgnTokenType::Comment;
+                token.Text = m_Text.substr(start + 1, end - start - 1);
+                return true;
+            }
+            case LeftParenthesis:
+                token.Type = PgnTokenType::VariationStart;
+                m_Position++;
+                return true;
+            case RightParenthesis:
+                token.Type = PgnTokenType::VariationEnd;
+                m_Position++;
+                return true;
+            case Star:
+                token.Type = PgnTokenType::Result;
+                m_Position++;
+                return true;
+            case Dollar: {
+                size_t end = start + 1;
+                while (end < m_Text.size() && Classify(m_Text[end]) == Digit)
+                    token.Number = token.Number * 10 + (m_Text[end++] - '0');
+
+                if (end == start + 1)
+                    Fail("NAG without a number in PGN!");
+
+                token.Type = PgnTokenType::Nag;
+                token.Text = m_Text.substr(start, end - start);
+                m_Position = end;
+                return true;
+            }
+            case Annotation:
+                ReadSuffix(token);
+                return true;
+            case Period:
+                // Periods that aren't after a move number ("1 ...")
+                while (m_Position < m_Text.size() && Classify(m_Text[m_Position]) == Period)
+                    m_Position++;
+
+                continue;
+            default:
+                Fail("Invalid character in PGN!");
+        }
+    }
+
+    return false;
+}
+
+std::string PgnLexer::Unescape(std::string_view value) {
+    std::string text;
+    text.reserve(value.size());
+
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '\\' && i + 1 < value.size())
+            i++;
+
+        text += value[i];
+    }
+
+    return text;
+}
+
+bool PgnLexer::SkipWhitespace() {
+    while (m_Position < m_Text.size()) {
+        const char c = m_Text[m_Position];
+
+        if (Classify(c) == Space) {
+            m_Position++;
+        } else if (c == '%' && (m_Position == 0 || m_Text[m_Position - 1] == '\n')) {
+            // The escape mechanism: the line is for other programs
+            const char* newline = (const char*)std::memchr(m_Text.data() + m_Position, '\n', m_Text.size() - m_Position);
+            m_Position = newline ? newline - m_Text.data() + 1 : m_Text.size();
+        } else {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PgnLexer::ReadTag(PgnToken& token) {
+    size_t position = m_Position + 1;
+    auto skipSpaces = [this, &position]() {
+        while (position < m_Text.size() && Classify(m_Text[position]) == Space)
+            position++;
+    };
+
+    skipSpaces();
+    const size_t nameStart = position;
+    while (position < m_Text.size() && IsSymbol(m_Text[position]))
+        position++;
+
+    if (position == nameStart)
+        Fail("Invalid tag in PGN header!");
+
+    token.Type = PgnTokenType::Tag;
+    token.Text = m_Text.substr(nameStart, position - nameStart);
+
+    skipSpaces();
+    if (position == m_Text.size() || m_Text[position] != '"')
+        Fail("Invalid tag in PGN header!");
+
+    // A backslash escapes the next character (\" and \\)
+    const size_t valueStart = ++position;
+    while (position < m_Text.size() && m_Text[position] != '"') {
+        if (m_Text[position] == '\\') {
+            token.Escaped = true;
+            position++;
+        }
+
+        position++;
+    }
+
+    if (position >= m_Text.size())
+        Fail("Invalid tag in PGN header!");
+
+    token.Value = m_Text.substr(valueStart, position - valueStart);
+
+    position++;
+    skipSpaces();
+    if (position == m_Text.size() || m_Text[position] != ']')
+        Fail("Invalid tag in PGN header!");
+
+    m_Position = position + 1;
+}
+
+void PgnLexer::ReadSymbol(PgnToken& token) {
+    const size_t start = m_Position;
+
+    // Only digits is a move number
+    size_t end = start;
+    while (end < m_Text.size() && Classify(m_Text[end]) == Digit)
+        token.Number = token.Number * 10 + (m_Text[end++] - '0');
+
+    if (end == m_Text.size() || !IsSymbol(m_Text[end])) {
+        token.Type = PgnTokenType::MoveNumber;
+        token.Text = m_Text.substr(start, end - start);
+
+        // The periods after it, one for White's move and three for Black's (any number is read)
+        while (end < m_Text.size() && Classify(m_Text[end]) == Period)
+            end++;
+
+        m_Position = end;
+        return;
+    }
+
+    while (end < m_Text.size() && IsSymbol(m_Text[end]))
+        end++;
+
+    token.Text = m_Text.substr(start, end - start);
+    token.Number = 0;
+    token.Type = token.Text == "1-0" || token.Text == "0-1" || token.Text == "1/2-1/2" ? PgnTokenType::Result : PgnTokenType::Move;
+
+    if (token.Type == PgnTokenType::Move && !IsSan(token.Text))
+        Fail("Invalid move in PGN!");
+
+    m_Position = end;
+}
+
+void PgnLexer::ReadSuffix(PgnToken& token) {
+    // "!", "?", "!!", "??", "!?" and "?!" are NAGs 1 to 6
+    const size_t start = m_Position;
+    const char first = m_Text[start];
+    const char second = start + 1 < m_Text.size() ? m_Text[start + 1] : '\0';
+
+    size_t length = 1;
+    token.Number = first == '!' ? 1 : 2;
+
+    if (second == '!' || second == '?') {
+        length = 2;
+        token.Number = first == second ? (first == '!' ? 3 : 4) : (first == '!' ? 5 : 6);
+    }
+
+    token.Type = PgnTokenType::Nag;
+    token.Text = m_Text.substr(start, length);
+    m_Position = start + length;
+}
+
+void PgnLexer::Fail(const char* message) const {
+    throw InvalidPgnException(std::string(message) + " (at offset " + std::to_string(m_Position) + ")");
+}
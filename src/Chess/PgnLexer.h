@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum class PgnTokenType : uint8_t {
+    Tag,             // [Name "Value"]: 'Text' is the name and 'Value' the value, as it is in the text (see Unescape())
+    MoveNumber,      // "12." or "12...": 'Number' is the move number
+    Move,            // The SAN of a move, with its check or mate suffix (only its shape is checked)
+    Nag,             // "$12", or a suffix annotation ("!", "?!", ...) as its NAG: 'Number' is the NAG
+    Comment,         // {...} or ;... to the end of the line: 'Text' is the text inside
+    VariationStart,  // (
+    VariationEnd,    // )
+    Result,          // "1-0", "0-1", "1/2-1/2" or "*"
+};
+
+struct PgnToken {
+    PgnTokenType Type;
+    std::string_view Text;   // Points into the text of the lexer
+    std::string_view Value;  // Only for tags
+    uint32_t Number = 0;
+    bool Escaped = false;    // If the value of a tag has escaped characters (\" or \\)
+    size_t Offset = 0;       // Of the first character of the token in the text
+};
+
+// Splits PGN text into tokens in one pass, without copying or allocating (the tokens point into the text)
+//
+// Every character is classified with a table, so each one is looked at once
+// Covers the PGN standard: tag pairs with escaped strings, move numbers (with any number of periods),
+// SAN moves, NAGs and suffix annotations, brace and rest of line comments, variations, results,
+// and the lines that start with '%' (which are skipped)
+// Throws InvalidPgnException on characters that can't start a token, on tags that aren't closed,
+// and on symbols that don't have the shape of a SAN move (the moves aren't checked against a position)
+class PgnLexer {
+public:
+    PgnLexer(std::string_view text) : m_Text(text) {}
+
+    // Returns false at the end of the text
+    bool Next(PgnToken& token);
+
+    // The offset of the next character to read
+    size_t GetOffset() const { return m_Position; }
+
+    // The value of a tag with its escapes replaced (only needed when the token is 'Escaped')
+    static std::string Unescape(std::string_view value);
+private:
+    // Skips whitespace and '%' lines, returns false at the end of the text
+    bool SkipWhitespace();
+
+    void ReadTag(PgnToken& token);
+    void ReadSymbol(PgnToken& token);
+    void ReadSuffix(PgnToken& token);
+
+    [[noreturn]] void Fail(const char* message) const;
+
+    std::string_view m_Text;
+    size_t m_Position = 0;
+};
@@ -0,0 +1,210 @@
+#include "PgnReader.h"
+
+#include "Game.h"
+
+#include <cstring>
+#include <fstream>
+
+// The index file is a header and then every offset (including the end of the file), all little-endian
+// The header is 32 bytes, so the offsets are aligned when the index is mapped
+struct IndexHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t FileSize;
+    int64_t ModificationTime;
+    uint64_t GameCount;
+};
+
+static_assert(sizeof(IndexHeader) == 32);
+
+static constexpr char INDEX_MAGIC[4] = { 'C', 'P', 'G', 'I' };
+static constexpr uint32_t INDEX_VERSION = 1;
+
+static int64_t GetModificationTime(const std::filesystem::path& path) {
+    std::error_code error;
+    return (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+}
+
+PgnScanner::PgnScanner(std::string_view text) : m_Text(text) {
+    if (text.size() >= 3 && std::memcmp(text.data(), "\xEF\xBB\xBF", 3) == 0)  // UTF-8 byte order mark
+        m_Position = 3;
+}
+
+bool PgnScanner::Next(size_t& offset) {
+    const char* data = m_Text.data();
+    const size_t size = m_Text.size();
+
+    while (m_Position < size) {
+        const size_t position = m_Position;
+        const char* newline = (const char*)std::memchr(data + position, '\n', size - position);
+        const size_t lineEnd = newline ? newline - data + 1 : size;
+        m_Position = lineEnd;
+
+        size_t start = position;
+        while (start < lineEnd && (data[start] == ' ' || data[start] == '\t'))
+            start++;
+
+        const char first = start < lineEnd ? data[start] : '\n';
+        if (!m_InComment && first == '[') {
+            const bool newGame = m_AfterMovetext;
+            m_Started = true;
+            m_AfterMovetext = false;
+
+            if (newGame) {
+                offset = position;
+                return true;
+            }
+        } else if (m_InComment || (first != '\n' && first != '\r' && first != '%')) {
+            const bool newGame = !m_Started;
+            m_Started = true;
+            m_AfterMovetext = true;
+
+            // Find the comments in the line
+            const char* p = data + position;
+            const char* end = data + lineEnd;
+            while (p < end) {
+                if (m_InComment) {
+                    const char* close = (const char*)std::memchr(p, '}', end - p);
+                    if (!close)
+                        break;
+
+                    m_InComment = false;
+                    p = close + 1;
+                } else {
+                    const char* open = (const char*)std::memchr(p, '{', end - p);
+                    const char* rest = (const char*)std::memchr(p, ';', (open ? open : end) - p);
+                    if (rest || !open)  // The rest of the line is a comment
+                        break;
+
+                    m_InComment = true;
+                    p = open + 1;
+                }
+            }
+
+            if (newGame) {
+                offset = position;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+std::string_view PgnScanner::GetGameText(std::string_view text, size_t start, size_t end) {
+    text = text.substr(start, end - start);
+
+    // Remove the blank lines before the next game
+    const size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(0, last == std::string_view::npos ? 0 : last + 1);
+}
+
+bool PgnReader::Open(const std::filesystem::path& path) {
+    Close();
+
+    if (!m_File.Open(path))
+        return false;
+
+    m_Path = path;
+    m_Text = std::string_view((const char*)m_File.GetData(), m_File.GetSize());
+
+    if (!LoadIndex())
+        Scan();
+
+    return true;
+}
+
+void PgnReader::Close() {
+    m_File.Close();
+    m_IndexFile.Close();
+    m_ScannedOffsets.clear();
+
+    m_Path.clear();
+    m_Text = {};
+    m_Offsets = nullptr;
+    m_GameCount = 0;
+}
+
+void PgnReader::Scan() {
+    m_ScannedOffsets.clear();
+
+    PgnScanner scanner(m_Text);
+    size_t offset;
+    while (scanner.Next(offset))
+        m_ScannedOffsets.push_back(offset);
+
+    m_ScannedOffsets.push_back(m_Text.size());
+
+    m_Offsets = m_ScannedOffsets.data();
+    m_GameCount = m_ScannedOffsets.size() - 1;
+}
+
+bool PgnReader::LoadIndex() {
+    if (!m_IndexFile.Open(GetIndexPath(m_Path)))
+        return false;
+
+    IndexHeader header;
+    if (m_IndexFile.GetSize() < sizeof(header)) {
+        m_IndexFile.Close();
+        return false;
+    }
+
+    std::memcpy(&header, m_IndexFile.GetData(), sizeof(header));
+
+    const bool valid = std::memcmp(header.Magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+        && header.Version == INDEX_VERSION
+        && header.FileSize == m_Text.size()
+        && header.ModificationTime == GetModificationTime(m_Path)
+        && header.GameCount < m_IndexFile.GetSize() / sizeof(uint64_t)
+        && m_IndexFile.GetSize() == sizeof(header) + (header.GameCount + 1) * sizeof(uint64_t);
+
+    if (!valid) {
+        m_IndexFile.Close();
+        return false;
+    }
+
+    // The games are read with the offsets, so a corrupt index must not point outside the file
+    // (or give a game that ends before it starts): the offsets must never decrease, and end at the end of the file
+    const uint64_t* offsets = (const uint64_t*)(m_IndexFile.GetData() + sizeof(header));
+    bool ordered = offsets[header.GameCount] == m_Text.size();
+    for (uint64_t i = 0; i < header.GameCount; i++)
+        ordered &= offsets[i] <= offsets[i + 1];
+
+    if (!ordered) {
+        m_IndexFile.Close();
+        return false;
+    }
+
+    m_Offsets = offsets;
+    m_GameCount = header.GameCount;
+    return true;
+}
+
+bool PgnReader::SaveIndex() const {
+    if (!IsOpen())
+        return false;
+
+    if (IsIndexLoaded())
+        return true;
+
+    IndexHeader header;
+    std::memcpy(header.Magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.Version = INDEX_VERSION;
+    header.FileSize = m_Text.size();
+    header.ModificationTime = GetModificationTime(m_Path);
+    header.GameCount = m_GameCount;
+
+    std::ofstream file(GetIndexPath(m_Path), std::ios::binary);
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)m_Offsets, (m_GameCount + 1) * sizeof(uint64_t));
+
+    return (bool)file;
+}
+
+std::string_view PgnReader::GetGameText(size_t index) const {
+    return PgnScanner::GetGameText(m_Text, m_Offsets[index], m_Offsets[index + 1]);
+}
+
+std::unique_ptr<Game> PgnReader::ReadGame(size_t index) const {
+    return std::make_unique<Game>(GetGameText(index));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "Utility/MappedFile.h"
+
+class Game;
+
+// Finds where the games in PGN text start, a line at a time, only looking inside movetext lines for comments
+// (a '[' at the start of a line in a comment doesn't start a game)
+// A game starts at a tag line ('[' at the start of a line) that comes after movetext,
+// so games without tags are read as part of the game before them
+class PgnScanner {
+public:
+    PgnScanner(std::string_view text);
+
+    // Finds the start of the next game, returns false at the end of the text
+    bool Next(size_t& offset);
+
+    // The text of the game in [start, end), without the blank lines before the next game
+    static std::string_view GetGameText(std::string_view text, size_t start, size_t end);
+private:
+    std::string_view m_Text;
+    size_t m_Position = 0;
+
+    bool m_Started = false;
+    bool m_AfterMovetext = true;
+    bool m_InComment = false;
+};
+
+// A PGN file with any number of games, mapped into memory
+//
+// Opening the file only finds where each game starts, the games are parsed one at a time when they are read
+// The offsets can be saved next to the file (<file>.idx), so opening it again doesn't have to scan it
+// See PgnScanner for where games start
+class PgnReader {
+public:
+    PgnReader() = default;
+    PgnReader(const std::filesystem::path& path) { Open(path); }
+
+    // Uses the saved offsets if they were saved for the same file (same size and modification time)
+    // and are in order up to the end of the file, otherwise scans the file
+    // Returns false if the file could not be mapped
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return m_File.IsOpen(); }
+
+    // Returns false if the index could not be written
+    bool SaveIndex() const;
+    // If the offsets were loaded from the index instead of scanning the file
+    bool IsIndexLoaded() const { return m_IndexFile.IsOpen(); }
+
+    size_t GetGameCount() const { return m_GameCount; }
+    uint64_t GetGameOffset(size_t index) const { return m_Offsets[index]; }
+
+    // The text of the game, pointing into the mapped file
+    std::string_view GetGameText(size_t index) const;
+
+    // Throws InvalidPgnException (or one of the move exceptions) if the game can't be parsed
+    std::unique_ptr<Game> ReadGame(size_t index) const;
+
+    static std::filesystem::path GetIndexPath(const std::filesystem::path& path) { return std::filesystem::path(path) += ".idx"; }
+private:
+    void Scan();
+    bool LoadIndex();
+private:
+    std::filesystem::path m_Path;
+    MappedFile m_File;
+    std::string_view m_Text;
+
+    // Start of every game, and the end of the file, so game i is [m_Offsets[i], m_Offsets[i + 1])
+    // Points into 'm_IndexFile' or 'm_ScannedOffsets'
+    const uint64_t* m_Offsets = nullptr;
+    size_t m_GameCount = 0;
+
+    MappedFile m_IndexFile;
+    std::vector<uint64_t> m_ScannedOffsets;
+};
@@ -0,0 +1,161 @@
+#include "PgnWriter.h"
+
+#include "GameTraversal.h"
+
+#include <algorithm>
+#include <charconv>
+
+// The buffer is written to the file or stream when it is this big
+static constexpr size_t FLUSH_SIZE = 1 << 16;
+
+PgnWriter::PgnWriter(std::FILE* file, const Options& options) : m_Options(options), m_File(file), m_Output(&m_Buffer) {
+    m_Buffer.reserve(FLUSH_SIZE);
+}
+
+PgnWriter::PgnWriter(std::ostream& output, const Options& options) : m_Options(options), m_Stream(&output), m_Output(&m_Buffer) {
+    m_Buffer.reserve(FLUSH_SIZE);
+}
+
+PgnWriter::PgnWriter(std::string& output, const Options& options) : m_Options(options), m_Output(&output) {}
+
+void PgnWriter::Write(const Game& game) {
+    WriteHeader(game);
+    WriteMovetext(game);
+
+    const std::string result = game.GetHeader("Result");
+    WriteToken(result.empty() ? "*" : result);
+    m_Output->append("\n\n");
+
+    FlushIfFull();
+}
+
+void PgnWriter::WriteHeader(const Game& game) {
+    const GameHeader& header = game.GetHeader();
+    header.ForEach([this](std::string_view tag, std::string_view value) {
+        m_Output->push_back('[');
+        m_Output->append(tag);
+        m_Output->append(" \"");
+
+        // Quotes and backslashes in the value are escaped with a backslash
+        for (size_t start = 0; start < value.size();) {
+            const size_t special = std::min(value.find_first_of("\"\\", start), value.size());
+            m_Output->append(value.substr(start, special - start));
+
+            if (special < value.size()) {
+                m_Output->push_back('\\');
+                m_Output->push_back(value[special]);
+            }
+
+            start = special + 1;
+        }
+
+        m_Output->append("\"]\n");
+    });
+
+    if (!header.IsEmpty())
+        m_Output->push_back('\n');
+}
+
+void PgnWriter::WriteMovetext(const Game& game) {
+    m_Space = false;
+    m_LineLength = 0;
+
+    WriteComment(game, Game::GetRoot());
+
+    // The first move needs its number even if it is Black's move,
+    // as do the first move of a variation and the move after a comment or after variations
+    bool moveNumber = true;
+
+    GameTraversal traversal(game);
+    GameTraversal::Event event;
+    while (traversal.Next(event)) {
+        switch (event.Type) {
+            case GameTraversal::EventType::Move:
+                moveNumber = WriteMove(game, event.Node, moveNumber);
+                break;
+            case GameTraversal::EventType::StartVariation:
+                WriteToken("(");
+                m_Space = false;
+                moveNumber = true;
+                break;
+            case GameTraversal::EventType::EndVariation:
+                m_Output->push_back(')');
+                m_LineLength++;
+                moveNumber = true;
+                break;
+        }
+    }
+
+    FlushIfFull();
+}
+
+bool PgnWriter::Flush() {
+    if (m_Output != &m_Buffer || m_Buffer.empty())
+        return true;
+
+    bool written = true;
+    if (m_File)
+        written = std::fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File) == m_Buffer.size();
+    else if (m_Stream)
+        written = (bool)m_Stream->write(m_Buffer.data(), m_Buffer.size());
+
+    m_Buffer.clear();
+    return written;
+}
+
+bool PgnWriter::WriteMove(const Game& game, NodeIndex node, bool moveNumber) {
+    const GameNode& n = game.GetNode(node);
+    const uint32_t ply = n.Ply - 1;
+
+    if (ply % 2 == 0 || moveNumber) {
+        char number[16];
+        char* end = std::to_chars(number, number + 10, ply / 2 + 1).ptr;
+        end = std::fill_n(end, ply % 2 == 0 ? 1 : 3, '.');
+        WriteToken(std::string_view(number, end - number));
+    }
+
+    char san[AlgebraicMove::MAX_STRING_LENGTH];
+    WriteToken(std::string_view(san, n.San.WriteTo(san) - san));
+
+    return WriteComment(game, node);
+}
+
+bool PgnWriter::WriteComment(const Game& game, NodeIndex node) {
+    // A transposition shares the comment of the node it transposes into, which is written there
+    std::string_view comment = game.GetComment(node);
+    if (comment.empty() || game.GetTransposition(node) != NO_NODE)
+        return false;
+
+    Separate(comment.size() + 2);
+    m_Output->push_back('{');
+    m_Output->append(comment);
+    m_Output->push_back('}');
+    m_LineLength += comment.size() + 2;
+    return true;
+}
+
+void PgnWriter::Separate(size_t length) {
+    if (!m_Space) {
+        m_Space = true;
+        return;
+    }
+
+    if (m_Options.MaxLineLength != 0 && m_LineLength + 1 + length > m_Options.MaxLineLength) {
+        m_Output->push_back('\n');
+        m_LineLength = 0;
+    } else {
+        m_Output->push_back(' ');
+        m_LineLength++;
+    }
+}
+
+void PgnWriter::WriteToken(std::string_view token) {
+    Separate(token.size());
+    m_Output->append(token);
+    m_LineLength += token.size();
+}
+
+void PgnWriter::FlushIfFull() {
+    if (m_Buffer.size() >= FLUSH_SIZE)
+        Flush();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "Game.h"
+
+// Writes games as PGN text without playing their moves (the nodes of a game have the SAN of their move)
+// The tree is walked with GameTraversal, so deep trees don't recurse
+//
+// The text is collected in a buffer and written to the file or stream when the buffer is full,
+// on Flush(), and when the writer is destroyed
+// Writing to a string appends to it directly
+class PgnWriter {
+public:
+    struct Options {
+        uint32_t MaxLineLength = 80;  // Of the movetext, 0 to write it on one line
+    };
+
+    PgnWriter(std::FILE* file, const Options& options);
+    PgnWriter(std::ostream& output, const Options& options);
+    PgnWriter(std::string& output, const Options& options);
+
+    PgnWriter(std::FILE* file) : PgnWriter(file, Options()) {}
+    PgnWriter(std::ostream& output) : PgnWriter(output, Options()) {}
+    PgnWriter(std::string& output) : PgnWriter(output, Options()) {}
+    ~PgnWriter() { Flush(); }
+
+    PgnWriter(const PgnWriter&) = delete;
+    PgnWriter& operator=(const PgnWriter&) = delete;
+
+    // The header, the movetext and the result, then a blank line before the next game
+    void Write(const Game& game);
+
+    // The tags, and a blank line after them if there are any
+    void WriteHeader(const Game& game);
+    // The moves with their comments and variations (without the result)
+    void WriteMovetext(const Game& game);
+
+    // Returns false if the text could not be written
+    bool Flush();
+private:
+    // Returns true if the next move needs its number (after a comment)
+    bool WriteMove(const Game& game, NodeIndex node, bool moveNumber);
+    // Returns false if the node has no comment to write
+    bool WriteComment(const Game& game, NodeIndex node);
+
+    // Writes the space (or the new line) before a token of 'length' characters
+    void Separate(size_t length);
+    void WriteToken(std::string_view token);
+
+    void FlushIfFull();
+
+    Options m_Options;
+
+    std::FILE* m_File = nullptr;
+    std::ostream* m_Stream = nullptr;
+    std::string m_Buffer;
+    std::string* m_Output;  // 'm_Buffer', or the string given to the constructor
+
+    bool m_Space = false;  // If there has to be a space before the next token
+    size_t m_LineLength = 0;
+};
@@ -0,0 +1,283 @@
+#include "Polyglot.h"
+
+#include "Game.h"
+#include "PolyglotRandom.h"
+#include "PseudoLegal.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace Polyglot {
+
+    // Each entry is a key (64 bits), move (16 bits), weight (16 bits) and learn value (32 bits), all big-endian
+    static constexpr size_t ENTRY_SIZE = 16;
+
+    static uint64_t ReadBigEndian(const uint8_t* data, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; i++)
+            value = (value << 8) | data[i];
+        return value;
+    }
+
+    static void WriteBigEndian(uint8_t* data, uint64_t value, size_t bytes) {
+        for (size_t i = bytes; i > 0; i--) {
+            data[i - 1] = (uint8_t)value;
+            value >>= 8;
+        }
+    }
+
+    uint64_t GetKey(const Board& board) {
+        uint64_t key = 0;
+
+        for (Square s = 0; s < 64; s++) {
+            Piece p = board[s];
+            if (p == Piece::None)
+                continue;
+
+            // Black pieces come before white pieces of the same type
+            const uint32_t kind = 2 * GetPieceType(p) + (GetColour(p) == White);
+            key ^= Random64[64 * kind + s];
+        }
+
+        if (board.CanCastle(White, KingSide))  key ^= Random64[768];
+        if (board.CanCastle(White, QueenSide)) key ^= Random64[769];
+        if (board.CanCastle(Black, KingSide))  key ^= Random64[770];
+        if (board.CanCastle(Black, QueenSide)) key ^= Random64[771];
+
+        const Square enPassant = board.GetEnPassantSquare();
+        if (enPassant != 0) {
+            const Colour turn = board.GetPlayerTurn();
+            const BitBoard pawns = board.GetPieceBitBoard(Pawn) & board.GetColourBitBoard(turn);
+
+            if (PseudoLegal::PawnAttack(enPassant, OppositeColour(turn)) & pawns)
+                key ^= Random64[772 + FileOf(enPassant)];
+        }
+
+        if (board.GetPlayerTurn() == White)
+            key ^= Random64[780];
+
+        return key;
+    }
+
+    uint16_t EncodeMove(const Board& board, LongAlgebraicMove move) {
+        Square destination = move.DestinationSquare;
+
+        // Castling
+        if (GetPieceType(board[move.SourceSquare]) == King && FileOf(move.SourceSquare) == 4) {
+            if (FileOf(destination) == 6)
+                destination = move.SourceSquare + 3;
+            else if (FileOf(destination) == 2)
+                destination = move.SourceSquare - 4;
+        }
+
+        // Promotions are 1 (knight) to 4 (queen), the same as PieceType (Pawn means no promotion)
+        return (uint16_t)(destination | (move.SourceSquare << 6) | (move.Promotion << 12));
+    }
+
+    LongAlgebraicMove DecodeMove(const Board& board, uint16_t move) {
+        const Square source = (move >> 6) & 0x3F;
+        Square destination = move & 0x3F;
+        const PieceType promotion = (PieceType)((move >> 12) & 0x7);
+
+        // The king takes its own rook
+        if (GetPieceType(board[source]) == King && board[destination] != Piece::None && GetColour(board[destination]) == GetColour(board[source])) {
+            if (destination > source)
+                destination = source + 2;
+            else
+                destination = source - 2;
+        }
+
+        return LongAlgebraicMove(source, destination, promotion);
+    }
+
+    bool Book::Open(const std::filesystem::path& path) {
+        Close();
+
+        if (!m_File.Open(path) || m_File.GetSize() % ENTRY_SIZE != 0) {
+            m_File.Close();
+            return false;
+        }
+
+        m_EntryCount = m_File.GetSize() / ENTRY_SIZE;
+        return true;
+    }
+
+    void Book::Close() {
+        m_File.Close();
+        m_EntryCount = 0;
+    }
+
+    size_t Book::FindFirst(uint64_t key) const {
+        const uint8_t* data = m_File.GetData();
+
+        size_t low = 0, high = m_EntryCount;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+
+            if (ReadBigEndian(data + middle * ENTRY_SIZE, 8) < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+
+        return low < m_EntryCount && ReadBigEndian(data + low * ENTRY_SIZE, 8) == key ? low : m_EntryCount;
+    }
+
+    size_t Book::GetMoves(const Board& board, std::vector<BookMove>& moves) const {
+        moves.clear();
+
+        const uint64_t key = GetKey(board);
+        const uint8_t* data = m_File.GetData();
+
+        for (size_t i = FindFirst(key); i < m_EntryCount; i++) {
+            const uint8_t* entry = data + i * ENTRY_SIZE;
+            if (ReadBigEndian(entry, 8) != key)
+                break;
+
+            BookMove move;
+            move.Move = DecodeMove(board, (uint16_t)ReadBigEndian(entry + 8, 2));
+            move.Weight = (uint16_t)ReadBigEndian(entry + 10, 2);
+            move.Learn = (uint32_t)ReadBigEndian(entry + 12, 4);
+            moves.push_back(move);
+        }
+
+        return moves.size();
+    }
+
+    std::optional<LongAlgebraicMove> Book::GetBestMove(const Board& board) const {
+        const uint64_t key = GetKey(board);
+        const uint8_t* data = m_File.GetData();
+
+        std::optional<LongAlgebraicMove> best;
+        uint16_t bestWeight = 0;
+
+        for (size_t i = FindFirst(key); i < m_EntryCount; i++) {
+            const uint8_t* entry = data + i * ENTRY_SIZE;
+            if (ReadBigEndian(entry, 8) != key)
+                break;
+
+            const uint16_t weight = (uint16_t)ReadBigEndian(entry + 10, 2);
+            if (!best || weight > bestWeight) {
+                best = DecodeMove(board, (uint16_t)ReadBigEndian(entry + 8, 2));
+                bestWeight = weight;
+            }
+        }
+
+        return best;
+    }
+
+    std::optional<LongAlgebraicMove> Book::PickMove(const Board& board, uint64_t& seed) const {
+        const uint64_t key = GetKey(board);
+        const uint8_t* data = m_File.GetData();
+
+        const size_t first = FindFirst(key);
+
+        uint64_t totalWeight = 0;
+        size_t end = first;
+        for (; end < m_EntryCount && ReadBigEndian(data + end * ENTRY_SIZE, 8) == key; end++)
+            totalWeight += ReadBigEndian(data + end * ENTRY_SIZE + 10, 2);
+
+        if (totalWeight == 0)
+            return std::nullopt;
+
+        uint64_t pick = Zobrist::NextRandom(seed) % totalWeight;
+        for (size_t i = first; i < end; i++) {
+            const uint8_t* entry = data + i * ENTRY_SIZE;
+            const uint64_t weight = ReadBigEndian(entry + 10, 2);
+
+            if (pick < weight)
+                return DecodeMove(board, (uint16_t)ReadBigEndian(entry + 8, 2));
+
+            pick -= weight;
+        }
+
+        return std::nullopt;
+    }
+
+    void BookBuilder::AddGame(Game& game, uint32_t maxPly) {
+        const NodeIndex currentNode = game.CurrentNode();
+
+        // Weights for White and Black
+        uint32_t weights[ColourCount] = { 1, 1 };
+
+        const GameResult result = game.GetHeader().GetResult();
+        if (result == GameResult::WhiteWins) {
+            weights[White] = 2;
+            weights[Black] = 0;
+        } else if (result == GameResult::BlackWins) {
+            weights[White] = 0;
+            weights[Black] = 2;
+        }
+
+        game.ToBeginning();
+
+        Board position = game.GetPosition();
+        for (uint32_t ply = 0; ply < maxPly && game.Forward(); ply++) {
+            const GameMove& m = game.GetNode(game.CurrentNode()).Move;
+
+            const LongAlgebraicMove move(m.Start, m.Destination, (PieceType)(m.Flags & GameMoveFlag::PromotionFlags));
+            AddMove(position, move, weights[position.GetPlayerTurn()]);
+
+            position = game.GetPosition();
+        }
+
+        game.GoTo(currentNode);
+    }
+
+    void BookBuilder::AddMove(const Board& board, LongAlgebraicMove move, uint32_t weight) {
+        std::vector<Entry>& entries = m_Positions[GetKey(board)];
+        const uint16_t encoded = EncodeMove(board, move);
+
+        for (Entry& entry : entries) {
+            if (entry.Move == encoded) {
+                entry.Weight += weight;
+                return;
+            }
+        }
+
+        entries.push_back({ encoded, weight });
+    }
+
+    bool BookBuilder::Write(const std::filesystem::path& path) const {
+        std::vector<uint64_t> keys;
+        keys.reserve(m_Positions.size());
+        for (const auto& [key, entries] : m_Positions)
+            keys.push_back(key);
+
+        std::sort(keys.begin(), keys.end());
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        std::vector<Entry> entries;
+        uint8_t buffer[ENTRY_SIZE];
+
+        for (uint64_t key : keys) {
+            entries = m_Positions.at(key);
+
+            std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.Weight > b.Weight; });
+
+            // Scale down so the highest weight fits in 16 bits
+            const uint64_t maxWeight = entries.front().Weight;
+            for (Entry& entry : entries) {
+                if (maxWeight > UINT16_MAX)
+                    entry.Weight = entry.Weight * UINT16_MAX / maxWeight;
+            }
+
+            for (const Entry& entry : entries) {
+                if (entry.Weight == 0)
+                    continue;
+
+                WriteBigEndian(buffer, key, 8);
+                WriteBigEndian(buffer + 8, entry.Move, 2);
+                WriteBigEndian(buffer + 10, entry.Weight, 2);
+                WriteBigEndian(buffer + 12, 0, 4);
+                file.write((const char*)buffer, ENTRY_SIZE);
+            }
+        }
+
+        return (bool)file;
+    }
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.h"
+#include "Utility/MappedFile.h"
+
+class Game;
+
+// Opening books in the Polyglot (.bin) format
+// Source:
+// http://hgm.nubati.net/book_format.html
+namespace Polyglot {
+
+    // Polyglot hash of the position
+    // (the en passant file only counts if the player to move has a pawn that can capture)
+    uint64_t GetKey(const Board& board);
+
+    // Polyglot moves are 16 bits: destination (6 bits), source (6 bits), promotion (3 bits)
+    // Castling is written as the king taking its own rook (ex. e1h1)
+    uint16_t EncodeMove(const Board& board, LongAlgebraicMove move);
+    LongAlgebraicMove DecodeMove(const Board& board, uint16_t move);
+
+    struct BookMove {
+        LongAlgebraicMove Move;
+        uint16_t Weight;
+        uint32_t Learn;
+    };
+
+    // A memory mapped book
+    // Lookups are a binary search of the mapped entries, nothing is read from the file after it is opened
+    class Book {
+    public:
+        Book() = default;
+        Book(const std::filesystem::path& path) { Open(path); }
+
+        // Returns false if the file could not be mapped or isn't a list of 16 byte entries
+        bool Open(const std::filesystem::path& path);
+        void Close();
+
+        bool IsOpen() const { return m_File.IsOpen(); }
+        size_t GetEntryCount() const { return m_EntryCount; }
+
+        // Every book move of the position, in the order of the file (normally highest weight first)
+        // Returns the number of moves
+        size_t GetMoves(const Board& board, std::vector<BookMove>& moves) const;
+
+        // The move with the highest weight
+        std::optional<LongAlgebraicMove> GetBestMove(const Board& board) const;
+
+        // A move picked at random with a probability proportional to its weight
+        // 'seed' is updated, so one seed can be kept per thread
+        std::optional<LongAlgebraicMove> PickMove(const Board& board, uint64_t& seed) const;
+    private:
+        // Index of the first entry with 'key', or m_EntryCount if there is none
+        size_t FindFirst(uint64_t key) const;
+    private:
+        MappedFile m_File;
+        size_t m_EntryCount = 0;
+    };
+
+    // Collects moves from games and writes them as a book
+    class BookBuilder {
+    public:
+        // Adds the moves of the main line of 'game' up to 'maxPly'
+        // Each move is weighted by the result for the player who made it:
+        // 2 for a win, 1 for a draw and 0 for a loss (1 if the game has no result)
+        // The game is returned to the position it was in
+        void AddGame(Game& game, uint32_t maxPly = 40);
+
+        void AddMove(const Board& board, LongAlgebraicMove move, uint32_t weight);
+
+        size_t GetPositionCount() const { return m_Positions.size(); }
+
+        // Writes the entries sorted by key, then by weight (highest first)
+        // Moves that were never weighted are left out, and the weights of a position
+        // are scaled down together if any of them don't fit in 16 bits
+        // Returns false if the file could not be written
+        bool Write(const std::filesystem::path& path) const;
+    private:
+        struct Entry {
+            uint16_t Move;
+            uint64_t Weight;
+        };
+
+        std::unordered_map<uint64_t, std::vector<Entry>> m_Positions;
+    };
+
+}
@@ -0,0 +1,253 @@
+#include "PositionSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SEARCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SEARCH_SSE2
+#endif
+
+PositionPattern PositionPattern::FromPosition(const Board& board) {
+    PositionPattern pattern;
+
+    for (Colour colour : { White, Black }) {
+        for (uint8_t type = Pawn; type < PieceTypeCount; type++) {
+            const BitBoard pieces = board.GetPieceBitBoard((PieceType)type) & board.GetColourBitBoard(colour);
+            pattern.m_Required[colour * 8 + type] = pieces;
+            pattern.m_Forbidden[colour * 8 + type] = ~pieces;
+        }
+    }
+
+    pattern.Update();
+    return pattern.SetPlayerTurn(board.GetPlayerTurn());
+}
+
+PositionPattern& PositionPattern::Require(Piece piece, BitBoard squares) {
+    m_Required[GetColour(piece) * 8 + GetPieceType(piece)] |= squares;
+    Update();
+    return *this;
+}
+
+PositionPattern& PositionPattern::Forbid(Piece piece, BitBoard squares) {
+    m_Forbidden[GetColour(piece) * 8 + GetPieceType(piece)] |= squares;
+    Update();
+    return *this;
+}
+
+void PositionPattern::Update() {
+    m_MinMaterial = 0;
+    m_MaxMaterial = 0;
+
+    // The same counts as GetMaterialSignature(), of the pieces that are required, and of the squares they can be on
+    for (Colour colour : { White, Black }) {
+        uint64_t min[PieceTypeCount], max[PieceTypeCount];
+        uint64_t minTotal = 0, maxTotal = 0;
+
+        for (uint8_t type = Pawn; type < King; type++) {
+            min[type] = SquareCount(m_Required[colour * 8 + type]);
+            max[type] = SquareCount(~m_Forbidden[colour * 8 + type]);
+            minTotal += min[type];
+            maxTotal += max[type];
+        }
+
+        MaterialSignature minCounts = min[Pawn], maxCounts = std::min<uint64_t>(max[Pawn], 15);
+        for (PieceType type : { Knight, Bishop, Rook, Queen }) {
+            minCounts |= std::min<uint64_t>(min[Pawn] + min[type], 15) << (4 * type);
+            maxCounts |= std::min<uint64_t>(max[Pawn] + max[type], 15) << (4 * type);
+        }
+
+        minCounts |= std::min<uint64_t>(minTotal, 15) << 20;
+        maxCounts |= std::min<uint64_t>(maxTotal, 15) << 20;
+
+        m_MinMaterial |= minCounts << (24 * colour);
+        m_MaxMaterial |= maxCounts << (24 * colour);
+    }
+}
+
+bool PositionPattern::Matches(const Board& board) const {
+    if (!m_AnyTurn && board.GetPlayerTurn() != m_PlayerTurn)
+        return false;
+
+    // The bitboard of each piece is the one of its type and of its colour,
+    // which has to have every required square, and none of the forbidden ones
+#if defined(SEARCH_AVX2)
+    const __m256i types[2] = {
+        _mm256_set_epi64x(board.GetPieceBitBoard(Rook), board.GetPieceBitBoard(Bishop), board.GetPieceBitBoard(Knight), board.GetPieceBitBoard(Pawn)),
+        _mm256_set_epi64x(0, 0, board.GetPieceBitBoard(King), board.GetPieceBitBoard(Queen))
+    };
+
+    __m256i missing = _mm256_setzero_si256();
+    for (int colour = 0; colour < ColourCount; colour++) {
+        const __m256i pieces = _mm256_set1_epi64x(board.GetColourBitBoard((Colour)colour));
+
+        for (int i = 0; i < 2; i++) {
+            const __m256i bits = _mm256_and_si256(types[i], pieces);
+            const __m256i required = _mm256_load_si256((const __m256i*)&m_Required[colour * 8 + i * 4]);
+            const __m256i forbidden = _mm256_load_si256((const __m256i*)&m_Forbidden[colour * 8 + i * 4]);
+
+            missing = _mm256_or_si256(missing, _mm256_andnot_si256(bits, required));
+            missing = _mm256_or_si256(missing, _mm256_and_si256(bits, forbidden));
+        }
+    }
+
+    return _mm256_testz_si256(missing, missing);
+#elif defined(SEARCH_SSE2)
+    const __m128i types[3] = {
+        _mm_set_epi64x(board.GetPieceBitBoard(Knight), board.GetPieceBitBoard(Pawn)),
+        _mm_set_epi64x(board.GetPieceBitBoard(Rook), board.GetPieceBitBoard(Bishop)),
+        _mm_set_epi64x(board.GetPieceBitBoard(King), board.GetPieceBitBoard(Queen))
+    };
+
+    __m128i missing = _mm_setzero_si128();
+    for (int colour = 0; colour < ColourCount; colour++) {
+        const __m128i pieces = _mm_set1_epi64x(board.GetColourBitBoard((Colour)colour));
+
+        for (int i = 0; i < 3; i++) {
+            const __m128i bits = _mm_and_si128(types[i], pieces);
+            const __m128i required = _mm_load_si128((const __m128i*)&m_Required[colour * 8 + i * 2]);
+            const __m128i forbidden = _mm_load_si128((const __m128i*)&m_Forbidden[colour * 8 + i * 2]);
+
+            missing = _mm_or_si128(missing, _mm_andnot_si128(bits, required));
+            missing = _mm_or_si128(missing, _mm_and_si128(bits, forbidden));
+        }
+    }
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+    BitBoard missing = 0;
+    for (int colour = 0; colour < ColourCount; colour++) {
+        const BitBoard pieces = board.GetColourBitBoard((Colour)colour);
+
+        for (uint8_t type = Pawn; type < PieceTypeCount; type++) {
+            const BitBoard bits = board.GetPieceBitBoard((PieceType)type) & pieces;
+            missing |= (m_Required[colour * 8 + type] & ~bits) | (m_Forbidden[colour * 8 + type] & bits);
+        }
+    }
+
+    return missing == 0;
+#endif
+}
+
+std::vector<PositionMatch> PositionSearch::Search(const PositionPattern& pattern, Statistics* statistics) const {
+    return Run(pattern, nullptr, statistics);
+}
+
+std::vector<PositionMatch> PositionSearch::Search(const PositionPattern& pattern, const std::vector<GameId>& games, Statistics* statistics) const {
+    return Run(pattern, &games, statistics);
+}
+
+std::vector<PositionMatch> PositionSearch::Run(const PositionPattern& pattern, const std::vector<GameId>* games, Statistics* statistics) const {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    const size_t count = games ? games->size() : m_Database.GetGameCount();
+    const uint32_t batchSize = std::max(1u, m_Options.BatchSize);
+
+    uint32_t threads = m_Options.Threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    threads = (uint32_t)std::max<size_t>(1, std::min<size_t>(threads, (count + batchSize - 1) / batchSize));
+
+    std::atomic<size_t> nextBatch = 0;
+    std::vector<std::vector<PositionMatch>> matches(threads);
+    std::vector<Statistics> threadStatistics(threads);
+
+    auto work = [&](uint32_t thread) {
+        const Board start;
+        Board board;
+        UndoInfo undo;
+        std::string fen;
+        std::vector<LongAlgebraicMove> moves;
+        Statistics& s = threadStatistics[thread];
+
+        for (size_t first = nextBatch.fetch_add(batchSize); first < count; first = nextBatch.fetch_add(batchSize)) {
+            const size_t last = std::min(count, first + batchSize);
+
+            for (size_t i = first; i < last; i++) {
+                const GameId id = games ? (*games)[i] : (GameId)i;
+                s.Games++;
+
+                if (!pattern.CanMatch(m_Database.GetFirstMaterial(id), m_Database.GetLastMaterial(id))) {
+                    s.Skipped++;
+                    continue;
+                }
+
+                try {
+                    m_Database.GetMainLine(id, fen, moves);
+                    if (fen.empty())
+                        board = start;
+                    else
+                        board.FromFEN(fen);
+                } catch (const std::exception&) {
+                    s.Corrupt++;
+                    continue;
+                }
+
+                for (uint32_t ply = 0;; ply++) {
+                    s.Positions++;
+                    if (pattern.Matches(board)) {
+                        matches[thread].push_back({ id, ply });
+                        break;
+                    }
+
+                    if (ply == moves.size())
+                        break;
+
+                    // Only captures and promotions change the material
+                    const LongAlgebraicMove move = moves[ply];
+                    const bool material = board[move.DestinationSquare] != None || move.Promotion != Pawn ||
+                        (GetPieceType(board[move.SourceSquare]) == Pawn && FileOf(move.SourceSquare) != FileOf(move.DestinationSquare));
+
+                    // The move heap isn't checked when the database is opened, so the rest of a corrupt game is left out
+                    if (!board.TryMakeMove(move, undo)) {
+                        s.Corrupt++;
+                        break;
+                    }
+
+                    if (material && !pattern.CanStillMatch(GetMaterialSignature(board)))
+                        break;
+                }
+            }
+        }
+    };
+
+    if (threads == 1) {
+        work(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < threads; i++)
+            workers.emplace_back(work, i);
+
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    std::vector<PositionMatch> result;
+    for (const std::vector<PositionMatch>& m : matches)
+        result.insert(result.end(), m.begin(), m.end());
+
+    // The batches were taken in order, but finished in any order
+    std::sort(result.begin(), result.end(), [](const PositionMatch& a, const PositionMatch& b) { return a.Game < b.Game; });
+
+    if (statistics) {
+        *statistics = Statistics();
+        for (const Statistics& s : threadStatistics) {
+            statistics->Games += s.Games;
+            statistics->Skipped += s.Skipped;
+            statistics->Positions += s.Positions;
+            statistics->Corrupt += s.Corrupt;
+        }
+
+        statistics->Matches = result.size();
+        statistics->Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    return result;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+#include "GameDatabase.h"
+
+// Conditions on the pieces of a position, tested on its bitboards
+//
+// For each piece there are squares where it has to be (Require()) and squares where it can't be (Forbid()),
+// for example a white knight on d5 with no black pawns on the c and e files:
+//     PositionPattern().Require(WhiteKnight, 1ull << D5).Forbid(BlackPawn, BitBoardFile(C1) | BitBoardFile(E1))
+// The conditions of every piece are tested at once with SIMD (AVX2 or SSE2, when the compiler targets them,
+// see CHESS_NATIVE_ARCH in CMakeLists.txt)
+class PositionPattern {
+public:
+    PositionPattern() { Update(); }
+    // Exactly the pieces of the position (and no others), with the same player to move
+    static PositionPattern FromPosition(const Board& board);
+
+    PositionPattern& Require(Piece piece, BitBoard squares);
+    PositionPattern& Forbid(Piece piece, BitBoard squares);
+    PositionPattern& SetPlayerTurn(Colour colour) { m_AnyTurn = false; m_PlayerTurn = colour; return *this; }
+
+    bool Matches(const Board& board) const;
+
+    // Whether a line from a position with the material 'first' to one with 'last' can go through a matching position
+    // (see MaterialSignature in GameDatabase.h)
+    bool CanMatch(MaterialSignature first, MaterialSignature last) const {
+        return IsAtLeast(first, m_MinMaterial) && IsAtLeast(m_MaxMaterial, last);
+    }
+    // Whether a position with the material, or one after it, can match
+    bool CanStillMatch(MaterialSignature material) const { return IsAtLeast(material, m_MinMaterial); }
+private:
+    // The material the pattern needs at least, and can have at most
+    void Update();
+
+    // If each of the counts of 'a' is at least the one of 'b'
+    static bool IsAtLeast(MaterialSignature a, MaterialSignature b) {
+        // Each count in a byte of its own, with the top bit set, so the subtractions don't borrow from each other
+        constexpr uint64_t LOW = 0x0F0F0F0F0F0F0F0F, TOP = 0x8080808080808080;
+        return ((((a & LOW) | TOP) - (b & LOW)) & (((a >> 4 & LOW) | TOP) - (b >> 4 & LOW)) & TOP) == TOP;
+    }
+
+    // By colour * 8 + piece type (the last two of each colour are unused, so the SIMD loads are whole)
+    alignas(32) std::array<BitBoard, 16> m_Required = {};
+    alignas(32) std::array<BitBoard, 16> m_Forbidden = {};
+
+    bool m_AnyTurn = true;
+    Colour m_PlayerTurn = White;
+
+    MaterialSignature m_MinMaterial = 0;
+    MaterialSignature m_MaxMaterial = 0;
+};
+
+// The first position of a game that matches a pattern
+struct PositionMatch {
+    GameId Game = 0;
+    uint32_t Ply = 0;  // Of the main line, 0 for the starting position
+
+    bool operator==(const PositionMatch& other) const { return Game == other.Game && Ply == other.Ply; }
+};
+
+// Finds the games of a database whose main line goes through a position that matches a pattern
+//
+// Each game is played again from the move heap with Board::MakeMove(), testing the pattern after every move
+// (with Board::TryMakeMove(), as the heap isn't checked when the database is opened)
+// Before that, the material signatures of the game (GameDatabase::GetFirstMaterial()/GetLastMaterial())
+// skip the games that never have the material of the pattern, and a game is stopped when it has lost material the pattern needs
+// The threads take batches of games from a shared counter, so a thread that gets long games doesn't hold up the others
+class PositionSearch {
+public:
+    struct Options {
+        uint32_t Threads = 0;     // 0 for one per core
+        uint32_t BatchSize = 256; // Games taken by a thread at a time
+    };
+
+    struct Statistics {
+        uint64_t Games = 0;
+        uint64_t Skipped = 0;    // By the material signatures, without playing them
+        uint64_t Positions = 0;  // That the pattern was tested on
+        uint64_t Matches = 0;
+        uint64_t Corrupt = 0;    // Games whose moves could not be read or played (searched up to the bad move)
+        double Seconds = 0;
+    };
+
+    // The database has to outlive the search, and not change while it searches
+    PositionSearch(const GameDatabase& database, const Options& options) : m_Database(database), m_Options(options) {}
+
+    // The games that match, in order of id
+    std::vector<PositionMatch> Search(const PositionPattern& pattern, Statistics* statistics = nullptr) const;
+    // Only the games with the ids (in order, like the ids from GameDatabase::Query())
+    std::vector<PositionMatch> Search(const PositionPattern& pattern, const std::vector<GameId>& games, Statistics* statistics = nullptr) const;
+private:
+    // 'games' is nullptr for every game
+    std::vector<PositionMatch> Run(const PositionPattern& pattern, const std::vector<GameId>* games, Statistics* statistics) const;
+
+    const GameDatabase& m_Database;
+    Options m_Options;
+};
@@ -41,32 +41,38 @@ namespace {
     {
         std::array<BitBoard, 64> result = { 0 };
 
-        for (Square s = 8; s < 56; s++) {
+        // The captures are also calculated for the first and last rank, since
+        // PawnAttack() is used to find the pawns attacking a square on those ranks
+        for (Square s = 0; s < 64; s++) {
             // White pawns
-            // Diagonal captures
-            if (RankOf(s + 8) == RankOf(s + 9) && (s + 9) < 64)
-                result[s] |= 1ull << (s + 9);
-            if (RankOf(s + 8) == RankOf(s + 7) && (s + 7) < 64)
-                result[s] |= 1ull << (s + 7);
-            // Calculates the square in front of the pawn
-            if (s + 8 < 64)
-                result[s] |= 1ull << (s + 8);
-            // Calculates two squares in frot of the pawn for only the first push
-            if ((1ull << s) & 0x000000000000FF00)
-                result[s] |= 1ull << (s + 16);
+            if (s < 56) {
+                // Diagonal captures
+                if (RankOf(s + 8) == RankOf(s + 9) && (s + 9) < 64)
+                    result[s] |= 1ull << (s + 9);
+                if (RankOf(s + 8) == RankOf(s + 7) && (s + 7) < 64)
+                    result[s] |= 1ull << (s + 7);
+                // Calculates the square in front of the pawn
+                if (s >= 8)
+                    result[s] |= 1ull << (s + 8);
+                // Calculates two squares in frot of the pawn for only the first push
+                if ((1ull << s) & 0x000000000000FF00)
+                    result[s] |= 1ull << (s + 16);
+            }
 
             // Black pawns
-            // Diagonal captures
-            if (RankOf(s - 8) == RankOf(s - 9) && (s - 9) < 64)
-                result[s] |= 1ull << (s - 9);
-            if (RankOf(s - 8) == RankOf(s - 7) && (s - 7) < 64)
-                result[s] |= 1ull << (s - 7);
-            // Calculates one square in front of the pawn
-            if (s - 8 < 64)
-                result[s] |= 1ull << (s - 8);
-            // Calculates two squares in frot of the pawn for only the first push
-            if ((1ull << s) & 0x00FF000000000000)
-                result[s] |= 1ull << (s - 16);
+            if (s >= 8) {
+                // Diagonal captures
+                if (RankOf(s - 8) == RankOf(s - 9) && (s - 9) < 64)
+                    result[s] |= 1ull << (s - 9);
+                if (RankOf(s - 8) == RankOf(s - 7) && (s - 7) < 64)
+                    result[s] |= 1ull << (s - 7);
+                // Calculates one square in front of the pawn
+                if (s < 56)
+                    result[s] |= 1ull << (s - 8);
+                // Calculates two squares in frot of the pawn for only the first push
+                if ((1ull << s) & 0x00FF000000000000)
+                    result[s] |= 1ull << (s - 16);
+            }
         }
 
         return result;
@@ -274,11 +280,14 @@ namespace PseudoLegal {
         // moves according to the colour that is moving
         BitBoard colourMask = (1ull << square) - 1;
 
+        // A blocker in front of the pawn also blocks its double push (which is only off the board near the last rank)
         if (colour == White) {
             colourMask = ~colourMask;
-            blockers |= (blockers << 8) & (1ull << (square + 16));
+            if (square < 48)
+                blockers |= (blockers << 8) & (1ull << (square + 16));
         } else {
-            blockers |= (blockers >> 8) & (1ull << (square - 16));
+            if (square >= 16)
+                blockers |= (blockers >> 8) & (1ull << (square - 16));
         }
 
         BitBoard pawnMoves = pawns[square] & colourMask;
@@ -287,7 +296,8 @@ namespace PseudoLegal {
         // The square doesn't actually block the pawn, which is
         // why it is added after the above if-statement
         // (Blockers are attacked by pawns)
-        blockers |= 1ull << enPassant;
+        // (0 means there is no en passant square)
+        blockers |= (BitBoard)(enPassant != 0) << enPassant;
 
         pawnMoves &= ~(blockers & BitBoardFile(square));
         pawnMoves &= ~(blockers ^ ~BitBoardFile(square));
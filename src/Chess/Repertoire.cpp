@@ -0,0 +1,294 @@
+#include "Repertoire.h"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+void MoveStatistics::Add(const MoveStatistics& other) {
+    Games += other.Games;
+    WhiteWins += other.WhiteWins;
+    Draws += other.Draws;
+    BlackWins += other.BlackWins;
+    EloSum += other.EloSum;
+    EloCount += other.EloCount;
+}
+
+Repertoire::Repertoire(const std::string& fen) : m_FEN(fen) {
+    m_Nodes.emplace_back();
+}
+
+bool Repertoire::AddGame(const Game& game, uint32_t maxPly) {
+    const std::string fen = game.GetHeader("FEN");
+    if ((fen.empty() ? Board::START_FEN : fen) != m_FEN)
+        return false;
+
+    // The statistics that the game adds to each of its moves
+    const GameHeader& header = game.GetHeader();
+
+    MoveStatistics statistics;
+    statistics.Games = 1;
+    statistics.WhiteWins = header.GetResult() == GameResult::WhiteWins;
+    statistics.Draws = header.GetResult() == GameResult::Draw;
+    statistics.BlackWins = header.GetResult() == GameResult::BlackWins;
+
+    for (uint16_t elo : { header.GetWhiteElo(), header.GetBlackElo() }) {
+        statistics.EloSum += elo;
+        statistics.EloCount += elo != 0;
+    }
+
+    m_Nodes[GetRoot()].Statistics.Add(statistics);
+
+    // The moves are read from the nodes of the game, without playing them
+    NodeIndex node = GetRoot();
+    uint32_t ply = 0;
+    for (NodeIndex n = game.GetNode(Game::GetRoot()).FirstChild; n != NO_NODE && (maxPly == 0 || ply < maxPly); n = game.GetNode(n).FirstChild, ply++) {
+        node = AddMove(node, game.GetNode(n).Move, game.GetNode(n).San);
+        m_Nodes[node].Statistics.Add(statistics);
+    }
+
+    return true;
+}
+
+uint64_t Repertoire::AddGames(const std::vector<Game>& games, uint32_t threads, uint32_t maxPly) {
+    const uint32_t cores = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = cores;
+
+    threads = (uint32_t)std::min<size_t>(threads, games.size() / MIN_GAMES_PER_THREAD);
+    if (cores <= 1)
+        threads = 1;
+
+    if (threads <= 1) {
+        uint64_t added = 0;
+        for (const Game& game : games)
+            added += AddGame(game, maxPly);
+
+        return added;
+    }
+
+    // The games by their first move: games without one (or that are added to a move
+    // this repertoire already has) are in group 0, which is added to this repertoire
+    std::vector<std::vector<uint32_t>> groups(1);
+    std::unordered_map<uint64_t, size_t> firstMoves;
+
+    for (uint32_t g = 0; g < games.size(); g++) {
+        const NodeIndex first = games[g].GetNode(Game::GetRoot()).FirstChild;
+        if (first == NO_NODE) {
+            groups[0].push_back(g);
+            continue;
+        }
+
+        const GameMove& move = games[g].GetNode(first).Move;
+        const uint64_t key = GetKey(GetRoot(), move.Start, move.Destination, move.Flags & GameMoveFlag::PromotionFlags);
+        if (m_Moves[FindSlot(key)].Key == key) {
+            groups[0].push_back(g);
+            continue;
+        }
+
+        const auto [it, inserted] = firstMoves.try_emplace(key, groups.size());
+        if (inserted)
+            groups.emplace_back();
+
+        groups[it->second].push_back(g);
+    }
+
+    // The largest groups first, each to the thread with the fewest games so far
+    // Thread 0 is this one, with the games of group 0
+    std::vector<size_t> order;
+    for (size_t i = 1; i < groups.size(); i++)
+        order.push_back(i);
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return groups[a].size() > groups[b].size(); });
+
+    std::vector<std::vector<size_t>> shardGroups(threads);
+    std::vector<size_t> shardGames(threads);
+    shardGroups[0].push_back(0);
+    shardGames[0] = groups[0].size();
+
+    for (size_t group : order) {
+        const size_t shard = std::min_element(shardGames.begin(), shardGames.end()) - shardGames.begin();
+        shardGroups[shard].push_back(group);
+        shardGames[shard] += groups[group].size();
+    }
+
+    // Each thread adds its games to its own shard (the first one to this repertoire),
+    // and no two shards have a move from the root in common
+    std::vector<Repertoire> shards(threads, Repertoire(m_FEN));
+    std::vector<uint64_t> added(threads);
+
+    auto addShard = [&](uint32_t i) {
+        Repertoire& shard = i == 0 ? *this : shards[i];
+        for (size_t group : shardGroups[i]) {
+            for (uint32_t g : groups[group])
+                added[i] += shard.AddGame(games[g], maxPly);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; i++)
+        workers.emplace_back(addShard, i);
+
+    addShard(0);
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    uint64_t total = added[0];
+    for (uint32_t i = 1; i < threads; i++) {
+        Splice(shards[i]);
+        total += added[i];
+    }
+
+    return total;
+}
+
+void Repertoire::Splice(const Repertoire& other) {
+    m_Nodes[GetRoot()].Statistics.Add(other.m_Nodes[GetRoot()].Statistics);
+
+    // The nodes of 'other' are appended in the same order, so each one moves by 'offset'
+    const NodeIndex offset = (NodeIndex)m_Nodes.size() - 1;
+    auto moved = [offset](NodeIndex node) {
+        return node == NO_NODE || node == GetRoot() ? node : node + offset;
+    };
+
+    while ((m_Nodes.size() + other.m_Nodes.size()) * 2 >= m_Moves.size())
+        Grow();
+
+    m_Nodes.reserve(m_Nodes.size() + other.m_Nodes.size() - 1);
+
+    for (NodeIndex i = 1; i < other.m_Nodes.size(); i++) {
+        const NodeIndex index = (NodeIndex)m_Nodes.size();
+        RepertoireNode& node = m_Nodes.emplace_back(other.m_Nodes[i]);
+        node.Parent = moved(node.Parent);
+        node.FirstChild = moved(node.FirstChild);
+        node.NextSibling = moved(node.NextSibling);
+
+        // The moves from the root join the moves this repertoire already has
+        if (node.Parent == GetRoot()) {
+            node.NextSibling = m_Nodes[GetRoot()].FirstChild;
+            m_Nodes[GetRoot()].FirstChild = index;
+        }
+
+        const uint64_t key = GetKey(node.Parent, node.Move.Start, node.Move.Destination, node.Move.Flags & GameMoveFlag::PromotionFlags);
+        m_Moves[FindSlot(key)] = { key, index };
+    }
+}
+
+void Repertoire::Merge(const Repertoire& other) {
+    m_Nodes[GetRoot()].Statistics.Add(other.m_Nodes[GetRoot()].Statistics);
+
+    // Pairs of nodes with the same moves to them: one of 'other', and the one it is merged into
+    std::vector<std::pair<NodeIndex, NodeIndex>> stack = { { GetRoot(), GetRoot() } };
+
+    while (!stack.empty()) {
+        const auto [from, into] = stack.back();
+        stack.pop_back();
+
+        for (NodeIndex child = other.m_Nodes[from].FirstChild; child != NO_NODE; child = other.m_Nodes[child].NextSibling) {
+            const RepertoireNode& node = other.m_Nodes[child];
+
+            const NodeIndex merged = AddMove(into, node.Move, node.San);
+            m_Nodes[merged].Statistics.Add(node.Statistics);
+
+            stack.emplace_back(child, merged);
+        }
+    }
+}
+
+NodeIndex Repertoire::FindMove(NodeIndex node, LongAlgebraicMove move) const {
+    return m_Moves[FindSlot(GetKey(node, move.SourceSquare, move.DestinationSquare, move.Promotion))].Node;
+}
+
+Game Repertoire::ToGame(uint32_t minGames) const {
+    Game game(m_FEN == Board::START_FEN ? "" : "[FEN \"" + m_FEN + "\"]");
+
+    // The moves of each node, most played first
+    auto moves = [this, minGames](NodeIndex node) {
+        std::vector<NodeIndex> children;
+        for (NodeIndex child = m_Nodes[node].FirstChild; child != NO_NODE; child = m_Nodes[child].NextSibling) {
+            if (m_Nodes[child].Statistics.Games >= minGames)
+                children.push_back(child);
+        }
+
+        // The first move played comes first when they were played as often
+        std::sort(children.begin(), children.end(), [this](NodeIndex a, NodeIndex b) {
+            const uint32_t gamesA = m_Nodes[a].Statistics.Games, gamesB = m_Nodes[b].Statistics.Games;
+            return gamesA != gamesB ? gamesA > gamesB : a < b;
+        });
+
+        return children;
+    };
+
+    // Depth first, with the moves that are left to play from each position
+    std::vector<std::vector<NodeIndex>> stack;
+    stack.push_back(moves(GetRoot()));
+    std::reverse(stack.back().begin(), stack.back().end());
+
+    while (!stack.empty()) {
+        if (stack.back().empty()) {
+            stack.pop_back();
+            game.Back();
+            continue;
+        }
+
+        const NodeIndex node = stack.back().back();
+        stack.back().pop_back();
+
+        const GameMove& m = m_Nodes[node].Move;
+        game.Move(LongAlgebraicMove(m.Start, m.Destination, (PieceType)(m.Flags & GameMoveFlag::PromotionFlags)));
+
+        stack.push_back(moves(node));
+        std::reverse(stack.back().begin(), stack.back().end());
+    }
+
+    game.ToBeginning();
+    return game;
+}
+
+NodeIndex Repertoire::AddMove(NodeIndex parent, const GameMove& move, AlgebraicMove san) {
+    const uint64_t key = GetKey(parent, move.Start, move.Destination, move.Flags & GameMoveFlag::PromotionFlags);
+
+    Slot* slot = &m_Moves[FindSlot(key)];
+    if (slot->Key == key)
+        return slot->Node;
+
+    // The root isn't in the table
+    if (m_Nodes.size() * 2 >= m_Moves.size()) {
+        Grow();
+        slot = &m_Moves[FindSlot(key)];
+    }
+
+    const NodeIndex index = (NodeIndex)m_Nodes.size();
+    *slot = { key, index };
+
+    // New moves go first, the order only matters for ToGame(), which sorts them
+    RepertoireNode& node = m_Nodes.emplace_back();
+    node.Move = move;
+    node.San = san;
+    node.Parent = parent;
+    node.NextSibling = m_Nodes[parent].FirstChild;
+    m_Nodes[parent].FirstChild = index;
+
+    return index;
+}
+
+size_t Repertoire::FindSlot(uint64_t key) const {
+    const size_t mask = m_Moves.size() - 1;
+
+    // Fibonacci hashing spreads the keys of the moves of one node
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (m_Moves[slot].Key != key && m_Moves[slot].Key != EMPTY_KEY)
+        slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+void Repertoire::Grow() {
+    std::vector<Slot> old(m_Moves.size() * 2);
+    old.swap(m_Moves);
+
+    for (const Slot& slot : old) {
+        if (slot.Key != EMPTY_KEY)
+            m_Moves[FindSlot(slot.Key)] = slot;
+    }
+}
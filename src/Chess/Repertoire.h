@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Game.h"
+
+// How often a move was played, and how those games ended
+struct MoveStatistics {
+    uint32_t Games = 0;
+    uint32_t WhiteWins = 0;
+    uint32_t Draws = 0;
+    uint32_t BlackWins = 0;   // The other games are unfinished
+
+    uint64_t EloSum = 0;      // Of the players with a rating
+    uint32_t EloCount = 0;
+
+    // 0 if none of the players had a rating
+    double GetAverageElo() const { return EloCount != 0 ? (double)EloSum / EloCount : 0; }
+
+    void Add(const MoveStatistics& other);
+};
+
+// A move in the tree of a repertoire, with the games that played it
+struct RepertoireNode {
+    GameMove Move;  // Unused for the root
+    AlgebraicMove San;
+
+    NodeIndex Parent = NO_NODE;
+    NodeIndex FirstChild = NO_NODE;  // The children are in no particular order
+    NodeIndex NextSibling = NO_NODE;
+
+    MoveStatistics Statistics;  // The statistics of the root are of every game
+};
+
+// Merges the main lines of many games into one opening tree, counting the games and results of each move
+//
+// The moves of a node are found by hashing the node and the move, so adding a game doesn't search
+// the moves that were already played from each position (the table is open addressing, so it doesn't allocate for each move)
+// AddGames() splits the games between threads by their first move: each thread builds the tree of its first moves (a shard),
+// and the shards share no node, so they are spliced into the repertoire at the end without merging them
+class Repertoire {
+public:
+    // Only games that start from 'fen' are added
+    Repertoire(const std::string& fen = Board::START_FEN);
+
+    // Adds the main line of the game, up to 'maxPly' moves (0 for every move)
+    // Returns false if the game starts from another position
+    bool AddGame(const Game& game, uint32_t maxPly = 0);
+    // Adds the games on 'threads' threads (0 for one per core), returns the number of games that were added
+    // A first move is added by one thread, so the threads are only as balanced as the first moves of the games,
+    // and the games of the first moves that the repertoire already has are added on the calling thread:
+    // there is at most one thread for every MIN_GAMES_PER_THREAD games, and only one on a single core
+    uint64_t AddGames(const std::vector<Game>& games, uint32_t threads = 0, uint32_t maxPly = 0);
+
+    static constexpr size_t MIN_GAMES_PER_THREAD = 4096;
+
+    // Adds the moves and statistics of another repertoire of the same position
+    void Merge(const Repertoire& other);
+
+    static constexpr NodeIndex GetRoot() { return 0; }
+    const RepertoireNode& GetNode(NodeIndex node) const { return m_Nodes[node]; }
+    size_t GetNodeCount() const { return m_Nodes.size(); }
+    uint32_t GetGameCount() const { return m_Nodes[GetRoot()].Statistics.Games; }
+
+    // The move from 'node', or NO_NODE if no game played it
+    NodeIndex FindMove(NodeIndex node, LongAlgebraicMove move) const;
+
+    // The moves played in at least 'minGames' games as a game tree (to be written as PGN),
+    // the most played move from each position first
+    Game ToGame(uint32_t minGames = 1) const;
+private:
+    // The child of 'parent' with the move, added if it is new
+    NodeIndex AddMove(NodeIndex parent, const GameMove& move, AlgebraicMove san);
+    // Appends the nodes of a repertoire that has none of the moves from the root of this one
+    void Splice(const Repertoire& other);
+
+    static uint64_t GetKey(NodeIndex parent, Square start, Square destination, uint8_t promotion) {
+        return (uint64_t)parent << 16 | start | destination << 6 | promotion << 12;
+    }
+
+    // The slot of the key in 'm_Moves', which is empty if the key isn't in the table
+    size_t FindSlot(uint64_t key) const;
+    // Doubles the size of the table
+    void Grow();
+
+    std::string m_FEN;
+
+    // Index 0 is the root
+    std::vector<RepertoireNode> m_Nodes;
+
+    // GetKey() of each node (its parent and its move) to the node, with linear probing
+    // The table is at most half full, and its size is a power of 2
+    struct Slot {
+        uint64_t Key = EMPTY_KEY;
+        NodeIndex Node = NO_NODE;
+    };
+
+    static constexpr uint64_t EMPTY_KEY = ~0ull;  // Keys are at most 48 bits
+    std::vector<Slot> m_Moves = std::vector<Slot>(1024);
+};
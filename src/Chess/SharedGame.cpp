@@ -0,0 +1,25 @@
+#include "SharedGame.h"
+
+SharedGame::SharedGame(const Game& game) : m_Game(game), m_Snapshot(std::make_shared<const Game>(game)) {}
+
+std::shared_ptr<const Game> SharedGame::Edit(const std::function<void(Game&)>& edit) {
+    std::lock_guard lock(m_EditMutex);
+
+    // An edit that throws (an illegal move) can have changed the game before it did, so it is published too
+    try {
+        edit(m_Game);
+    } catch (...) {
+        Publish();
+        throw;
+    }
+
+    return Publish();
+}
+
+std::shared_ptr<const Game> SharedGame::Publish() {
+    auto snapshot = std::make_shared<const Game>(m_Game);
+    std::atomic_store(&m_Snapshot, snapshot);
+    m_Version.fetch_add(1, std::memory_order_release);
+
+    return snapshot;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "Game.h"
+
+// A game that is edited and read by many threads, for example the GUI adding moves while analysis threads walk the tree
+//
+// The game is published as snapshots that never change (read-copy-update):
+// a reader takes the latest snapshot without waiting for anything and keeps it for as long as it needs it,
+// and each edit is made to the writer's own copy of the game, which is then copied into a new snapshot
+// So readers never see a half made edit, and never block the writer (nor the writer them)
+// Edits from different threads are made one at a time
+//
+// The nodes keep their index from one snapshot to the next (until they are deleted),
+// so a reader can annotate what it found in a snapshot with an edit, for example Edit([&](Game& g) { g.SetComment(node, text); })
+// Read the snapshots with GameCursor (GameCursor.h) or GameTraversal (GameTraversal.h)
+class SharedGame {
+public:
+    SharedGame(const Game& game = Game());
+
+    SharedGame(const SharedGame&) = delete;
+    SharedGame& operator=(const SharedGame&) = delete;
+
+    // The latest snapshot
+    std::shared_ptr<const Game> GetSnapshot() const { return std::atomic_load(&m_Snapshot); }
+    // The number of edits so far (the version of the latest snapshot)
+    uint64_t GetVersion() const { return m_Version.load(std::memory_order_acquire); }
+
+    // Makes the edit to the game (with its current position, which only the edits use), then publishes it
+    // Several changes in one edit are published together, with one copy of the game
+    // Returns the new snapshot
+    std::shared_ptr<const Game> Edit(const std::function<void(Game&)>& edit);
+private:
+    // Copies the game into a new snapshot (with 'm_EditMutex' locked)
+    std::shared_ptr<const Game> Publish();
+
+    std::mutex m_EditMutex;
+    Game m_Game;  // Only used while 'm_EditMutex' is locked
+
+    std::shared_ptr<const Game> m_Snapshot;  // Only read and written atomically
+    std::atomic<uint64_t> m_Version = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Move.h"
+
+// Random keys for hashing positions
+// Source:
+// https://www.chessprogramming.org/Zobrist_Hashing
+//
+
+namespace Zobrist {
+
+    // SplitMix64, so the keys can be generated at compile time
+    constexpr uint64_t NextRandom(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Indexed by the Piece enum (the unused indices 6 and 7 are left in for simplicity)
+    constexpr std::array<std::array<uint64_t, 64>, 14> PieceKeys = []() -> auto
+    {
+        std::array<std::array<uint64_t, 64>, 14> result = {};
+
+        uint64_t state = 0x5EED;
+        for (auto& piece : result)
+            for (uint64_t& key : piece)
+                key = NextRandom(state);
+
+        return result;
+    }();
+
+    // Indexed the same way as Board::m_CastlingPath (Colour | CastleSide)
+    constexpr std::array<uint64_t, 4> CastlingKeys = []() -> auto
+    {
+        std::array<uint64_t, 4> result = {};
+
+        uint64_t state = 0xCA571E;
+        for (uint64_t& key : result)
+            key = NextRandom(state);
+
+        return result;
+    }();
+
+    // Indexed by the file of the en passant square
+    constexpr std::array<uint64_t, 8> EnPassantKeys = []() -> auto
+    {
+        std::array<uint64_t, 8> result = {};
+
+        uint64_t state = 0xE9;
+        for (uint64_t& key : result)
+            key = NextRandom(state);
+
+        return result;
+    }();
+
+    // XORed in when it is black's turn
+    constexpr uint64_t BlackToMoveKey = 0xF3D1B2A1C9E87D65ull;
+
+}
@@ -17,6 +17,7 @@
 class Engine {
 public:
     static std::unique_ptr<Engine> Create(const std::filesystem::path& path);
+    static std::unique_ptr<Engine> CreateInternal();  // The built-in engine
 
     Engine(const Engine& other) = delete;
     Engine(Engine&& other) noexcept = delete;
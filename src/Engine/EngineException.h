@@ -36,3 +36,21 @@ public:
 
     const char* what() const noexcept override { return "Engine not ready"; }
 };
+
+class NetworkLoadError : public std::exception {
+public:
+    NetworkLoadError(const std::string& message) : m_Message(message) {}
+
+    const char* what() const noexcept override { return m_Message.c_str(); }
+private:
+    std::string m_Message;
+};
+
+class TablebaseError : public std::exception {
+public:
+    TablebaseError(const std::string& message) : m_Message(message) {}
+
+    const char* what() const noexcept override { return m_Message.c_str(); }
+private:
+    std::string m_Message;
+};
@@ -0,0 +1,181 @@
+#include "InternalEngine.h"
+
+#include <algorithm>
+#include <sstream>
+
+std::unique_ptr<Engine> Engine::CreateInternal() {
+    return std::make_unique<InternalEngine>();
+}
+
+InternalEngine::InternalEngine() {
+    m_Search.SetUpdateCallback([this](const Engine::BestContinuation& continuation) {
+        std::stringstream ss;
+        ss << "info depth " << continuation.Depth;
+        ss << " score " << (continuation.Mate ? "mate " : "cp ") << continuation.Score;
+        ss << " nodes " << m_Search.GetNodes();
+        ss << " time " << m_Search.GetElapsedTime().count();
+        ss << " pv";
+        for (LongAlgebraicMove m : continuation.Continuation)
+            ss << ' ' << m;
+        ss << '\n';
+
+        Output(ss.str());
+    });
+
+    m_Search.SetFinishCallback([this](const Engine::BestContinuation& continuation) {
+        std::stringstream ss;
+        ss << "bestmove ";
+        if (continuation.Continuation.empty())
+            ss << "0000";
+        else
+            ss << continuation.Continuation[0];
+        ss << '\n';
+
+        Output(ss.str());
+    });
+}
+
+InternalEngine::~InternalEngine() {
+    Stop();
+
+    m_Search.Stop();
+}
+
+void InternalEngine::Send(const std::string& message) {
+    StringParser sp(message);
+
+    while (auto command = sp.NextLine()) {
+        if (!command.value().empty())
+            HandleCommand(command.value());
+    }
+}
+
+bool InternalEngine::Receive(std::string& message) {
+    std::lock_guard<std::mutex> lock(m_OutputMutex);
+
+    if (m_Output.empty())
+        return false;
+
+    message = std::move(m_Output);
+    m_Output.clear();
+
+    return true;
+}
+
+void InternalEngine::HandleCommand(std::string_view command) {
+    StringParser sp{ std::string(command) };
+    std::string_view commandType = sp.Next<std::string_view>().value_or("");
+
+    if (commandType == "uci") {
+        std::stringstream ss;
+        ss << "id name Chess\n";
+        ss << "id author cucumberbolts\n";
+        ss << "option name Hash type spin default 16 min 1 max 4096\n";
+        ss << "option name Threads type spin default 1 min 1 max " << std::max(std::thread::hardware_concurrency(), 1u) << '\n';
+        ss << "option name Clear Hash type button\n";
+        ss << "uciok\n";
+
+        Output(ss.str());
+    } else if (commandType == "isready") {
+        Output("readyok\n");
+    } else if (commandType == "ucinewgame") {
+        m_Search.ClearHash();
+    } else if (commandType == "setoption") {
+        HandleSetOptionCommand(sp);
+    } else if (commandType == "position") {
+        HandlePositionCommand(sp);
+    } else if (commandType == "go") {
+        HandleGoCommand(sp);
+    } else if (commandType == "stop" || commandType == "quit") {
+        m_Search.Stop();
+    }
+
+    // Ignore undefined commands
+}
+
+void InternalEngine::HandleSetOptionCommand(StringParser& sp) {
+    sp.JumpPast("name");
+    std::string name{ sp.Next("value").value_or("") };
+
+    if (name == "Hash") {
+        if (auto value = sp.Next<int32_t>())
+            m_Search.SetHashSize(std::max(value.value(), 1));
+    } else if (name == "Threads") {
+        if (auto value = sp.Next<int32_t>())
+            m_Search.SetThreads(std::max(value.value(), 1));
+    } else if (name == "Clear Hash") {
+        m_Search.ClearHash();
+    }
+}
+
+void InternalEngine::HandlePositionCommand(StringParser& sp) {
+    m_Search.Stop();
+
+    std::string_view type = sp.Next<std::string_view>().value_or("");
+
+    if (type == "startpos") {
+        m_Position.Reset();
+
+        if (!sp.JumpPast("moves"))
+            return;
+    } else if (type == "fen") {
+        // This also skips "moves"
+        std::string_view fen = sp.Next("moves").value_or("");
+        m_Position.FromFEN(std::string(fen.substr(0, fen.find('\0'))));
+    } else {
+        return;
+    }
+
+    // The moves are played up to the first one that isn't legal
+    UndoInfo undo;
+    while (auto move = sp.Next<std::string_view>()) {
+        LongAlgebraicMove m;
+        if (!ParseMove(m_Position, move.value(), m))
+            break;
+
+        m_Position.MakeMove(m, undo);
+    }
+}
+
+// The characters are checked before making the move, so that they can't throw or give squares off the board,
+// and the move must be one of the legal moves (so a pawn that reaches the last rank needs a promotion piece)
+bool InternalEngine::ParseMove(const Board& position, std::string_view text, LongAlgebraicMove& move) {
+    if (text.size() != 4 && text.size() != 5)
+        return false;
+
+    for (size_t i = 0; i < 4; i += 2) {
+        if (text[i] < 'a' || text[i] > 'h' || text[i + 1] < '1' || text[i + 1] > '8')
+            return false;
+    }
+
+    if (text.size() == 5 && std::string_view("nbrq").find(text[4]) == std::string_view::npos)
+        return false;
+
+    move = LongAlgebraicMove(text);
+
+    MoveList moves;
+    position.GenerateLegalMoves(moves);
+    return std::find(moves.begin(), moves.end(), move) != moves.end();
+}
+
+void InternalEngine::HandleGoCommand(StringParser& sp) {
+    Search::Limits limits;
+
+    while (auto token = sp.Next<std::string_view>()) {
+        if (token.value() == "depth")
+            limits.Depth = sp.Next<int32_t>().value_or(limits.Depth);
+        else if (token.value() == "nodes")
+            limits.Nodes = sp.Next<int32_t>().value_or(0);
+        else if (token.value() == "movetime")
+            limits.MoveTime = std::chrono::milliseconds(sp.Next<int32_t>().value_or(0));
+
+        // "infinite" is the same as no limits
+    }
+
+    m_Search.Start(m_Position, limits);
+}
+
+void InternalEngine::Output(const std::string& message) {
+    std::lock_guard<std::mutex> lock(m_OutputMutex);
+    m_Output += message;
+}
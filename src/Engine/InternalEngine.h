@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Engine.h"
+#include "Search.h"
+
+#include "Chess/Board.h"
+
+#include <mutex>
+#include <string>
+
+// The built-in engine
+//
+// It speaks UCI like the external engines, but the commands are handled
+// in this process instead of being sent through a pipe
+class InternalEngine : public Engine {
+public:
+    InternalEngine();
+
+    ~InternalEngine() override;
+
+    void Send(const std::string& message) override;
+    bool Receive(std::string& message) override;
+private:
+    void HandleCommand(std::string_view command);
+    void HandleSetOptionCommand(StringParser& sp);
+    void HandlePositionCommand(StringParser& sp);
+    void HandleGoCommand(StringParser& sp);
+
+    // The legal move of 'position' in UCI notation, returns false if 'text' isn't one
+    static bool ParseMove(const Board& position, std::string_view text, LongAlgebraicMove& move);
+
+    void Output(const std::string& message);
+private:
+    Search m_Search;
+    Board m_Position;
+
+    // Output waiting to be received
+    std::mutex m_OutputMutex;
+    std::string m_Output;
+};
@@ -0,0 +1,297 @@
+#include "MateSolver.h"
+
+#include <algorithm>
+#include <thread>
+
+// Proof and disproof numbers are saturated at this (28 bits each in the table)
+static constexpr uint32_t INFINITE_NUMBER = (1u << 28) - 1;
+
+// Stored with disproofs that don't depend on the depth (no checks, stalemate)
+static constexpr int32_t FINAL_DEPTH = 127;
+
+static constexpr uint64_t BLACK_ATTACKER_KEY = 0x9E3779B97F4A7C15;
+
+static uint32_t Add(uint32_t a, uint32_t b) {
+    return (uint32_t)std::min<uint64_t>((uint64_t)a + b, INFINITE_NUMBER);
+}
+
+// Layout (least significant bit first): proof (28 bits), disproof (28 bits), depth (8 bits)
+// An empty slot unpacks to 0 and 0, which no position has
+static uint64_t Pack(uint32_t proof, uint32_t disproof, int32_t depth) {
+    return proof | (uint64_t)disproof << 28 | (uint64_t)(uint8_t)depth << 56;
+}
+
+MateSolver::MateSolver(size_t hashSizeMB, uint32_t threads) {
+    SetHashSize(hashSizeMB);
+    SetThreads(threads);
+}
+
+void MateSolver::SetHashSize(size_t megabytes) {
+    // Round down to a power of 2 so the key can be masked instead of using modulo
+    size_t size = 1;
+    while (size * 2 * sizeof(Slot) <= megabytes * 1024 * 1024)
+        size *= 2;
+
+    m_Slots = std::make_unique<Slot[]>(size);
+    m_Size = size;
+
+    ClearHash();
+}
+
+void MateSolver::ClearHash() {
+    for (size_t i = 0; i < m_Size; i++) {
+        m_Slots[i].Key.store(0, std::memory_order_relaxed);
+        m_Slots[i].Data.store(0, std::memory_order_relaxed);
+    }
+}
+
+void MateSolver::SetThreads(uint32_t threads) {
+    m_ThreadCount = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+MateSolver::Result MateSolver::Solve(const Board& position, const Limits& limits) {
+    Worker worker;
+    worker.Position = position;
+    return Solve(worker, limits);
+}
+
+std::vector<MateSolver::Result> MateSolver::Solve(const std::vector<Board>& positions, const Limits& limits) {
+    std::vector<Result> results(positions.size());
+
+    std::atomic<size_t> next = 0;
+    auto solve = [&]() {
+        Worker worker;
+        for (size_t i = next.fetch_add(1); i < positions.size(); i = next.fetch_add(1)) {
+            worker.Position = positions[i];
+            results[i] = Solve(worker, limits);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < std::min<size_t>(m_ThreadCount, positions.size()); i++)
+        threads.emplace_back(solve);
+
+    solve();
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    return results;
+}
+
+MateSolver::Result MateSolver::Solve(Worker& worker, const Limits& limits) {
+    worker.KeyColour = worker.Position.GetPlayerTurn() == Black ? BLACK_ATTACKER_KEY : 0;
+    worker.Nodes = 0;
+    worker.MaxNodes = limits.Nodes;
+    worker.Aborted = false;
+
+    Result result;
+
+    // A proof with a depth limit doesn't have to be the shortest mate,
+    // so look for mate in 1, then mate in 2, ... (disproofs of the shorter mates are kept in the table)
+    const int32_t maxMoves = std::min(limits.Moves, MAX_MOVES);
+    for (int32_t moves = 1; moves <= maxMoves; moves++) {
+        const int32_t depth = 2 * moves - 1;
+
+        Search(worker, depth, INFINITE_NUMBER, INFINITE_NUMBER, true);
+        if (worker.Aborted)
+            break;
+
+        Numbers root = Lookup(GetKey(worker), depth);
+        if (root.Proof == 0) {
+            result.Mate = true;
+            result.Moves = moves;
+            ExtractContinuation(worker, depth, result.Continuation);
+            break;
+        }
+
+        // No checks, or no mate at any depth
+        if (root.Disproof == 0 && root.Depth == FINAL_DEPTH)
+            break;
+    }
+
+    result.Nodes = worker.Nodes;
+    return result;
+}
+
+// The attacker nodes are OR nodes (one checking move that mates is enough),
+// and the defender nodes are AND nodes (every evasion has to be mated)
+void MateSolver::Search(Worker& worker, int32_t depth, uint32_t proofThreshold, uint32_t disproofThreshold, bool attacker) {
+    Board& board = worker.Position;
+    const uint64_t key = GetKey(worker);
+
+    if (worker.MaxNodes != 0 && worker.Nodes >= worker.MaxNodes) {
+        worker.Aborted = true;
+        return;
+    }
+
+    worker.Nodes++;
+
+    if (attacker && depth <= 0) {
+        Store(key, { INFINITE_NUMBER, 0, depth });
+        return;
+    }
+
+    MoveList moves;
+    if (attacker)
+        board.GenerateLegalChecks(moves);
+    else
+        board.GenerateLegalMoves(moves);
+
+    std::array<uint64_t, 256> keys;
+    UndoInfo undo;
+
+    if (attacker) {
+        if (moves.Size == 0) {
+            Store(key, { INFINITE_NUMBER, 0, FINAL_DEPTH });
+            return;
+        }
+
+        for (size_t i = 0; i < moves.Size; i++) {
+            board.MakeMove(moves[i], undo);
+            keys[i] = GetKey(worker);
+            board.UnmakeMove(undo);
+        }
+    } else {
+        // The defender is always in check, so these are the evasions
+        if (moves.Size == 0) {
+            Store(key, board.IsInCheck() ? Numbers{ 0, INFINITE_NUMBER, 0 } : Numbers{ INFINITE_NUMBER, 0, FINAL_DEPTH });
+            return;
+        }
+
+        if (depth <= 0) {
+            Store(key, { INFINITE_NUMBER, 0, depth });
+            return;
+        }
+
+        for (size_t i = 0; i < moves.Size; i++) {
+            board.MakeMove(moves[i], undo);
+            keys[i] = GetKey(worker);
+            board.UnmakeMove(undo);
+        }
+    }
+
+    while (true) {
+        // The proof number of an OR node is the smallest of its children, and the disproof number is the sum
+        // (the other way around for an AND node)
+        uint32_t proof = attacker ? INFINITE_NUMBER : 0;
+        uint32_t disproof = attacker ? 0 : INFINITE_NUMBER;
+
+        size_t best = 0;
+        Numbers bestNumbers{};
+        uint32_t second = INFINITE_NUMBER;  // The second smallest proof (or disproof) number
+
+        for (size_t i = 0; i < moves.Size; i++) {
+            Numbers child = Lookup(keys[i], depth - 1);
+
+            const uint32_t smallest = attacker ? proof : disproof;
+            const uint32_t number = attacker ? child.Proof : child.Disproof;
+
+            if (number < smallest) {
+                second = smallest;
+                best = i;
+                bestNumbers = child;
+            } else if (number < second) {
+                second = number;
+            }
+
+            if (attacker) {
+                proof = std::min(proof, child.Proof);
+                disproof = Add(disproof, child.Disproof);
+            } else {
+                proof = Add(proof, child.Proof);
+                disproof = std::min(disproof, child.Disproof);
+            }
+        }
+
+        if (proof >= proofThreshold || disproof >= disproofThreshold || worker.Aborted) {
+            Store(key, { proof, disproof, depth });
+            return;
+        }
+
+        // Search the most proving child until it is no longer the best one,
+        // or until this node would go over its thresholds
+        uint32_t childProof, childDisproof;
+        if (attacker) {
+            childProof = std::min(proofThreshold, Add(second, 1));
+            childDisproof = disproofThreshold >= INFINITE_NUMBER ? INFINITE_NUMBER : disproofThreshold - disproof + bestNumbers.Disproof;
+        } else {
+            childProof = proofThreshold >= INFINITE_NUMBER ? INFINITE_NUMBER : proofThreshold - proof + bestNumbers.Proof;
+            childDisproof = std::min(disproofThreshold, Add(second, 1));
+        }
+
+        board.MakeMove(moves[best], undo);
+        Search(worker, depth - 1, childProof, childDisproof, !attacker);
+        board.UnmakeMove(undo);
+    }
+}
+
+MateSolver::Numbers MateSolver::Lookup(uint64_t key, int32_t depth) const {
+    const Slot& slot = m_Slots[key & (m_Size - 1)];
+
+    uint64_t data = slot.Data.load(std::memory_order_relaxed);
+    if ((slot.Key.load(std::memory_order_relaxed) ^ data) != key || data == 0)
+        return { 1, 1, depth };
+
+    Numbers numbers{ (uint32_t)(data & INFINITE_NUMBER), (uint32_t)((data >> 28) & INFINITE_NUMBER), (int32_t)(int8_t)(data >> 56) };
+
+    // A mate in fewer plies is still a mate, and no mate in more plies means no mate in fewer
+    if (numbers.Proof == 0 && numbers.Depth <= depth)
+        return numbers;
+    if (numbers.Disproof == 0 && numbers.Depth >= depth)
+        return numbers;
+
+    // Numbers from a search with a different depth limit
+    if (numbers.Depth != depth || numbers.Proof == 0 || numbers.Disproof == 0)
+        return { 1, 1, depth };
+
+    return numbers;
+}
+
+void MateSolver::Store(uint64_t key, const Numbers& numbers) {
+    Slot& slot = m_Slots[key & (m_Size - 1)];
+
+    uint64_t data = Pack(numbers.Proof, numbers.Disproof, numbers.Depth);
+    slot.Key.store(key ^ data, std::memory_order_relaxed);
+    slot.Data.store(data, std::memory_order_relaxed);
+}
+
+void MateSolver::ExtractContinuation(Worker& worker, int32_t depth, std::vector<LongAlgebraicMove>& continuation) const {
+    const Board root = worker.Position;
+    Board& board = worker.Position;
+
+    MoveList moves;
+    UndoInfo undo;
+
+    for (bool attacker = true; depth > 0; depth--, attacker = !attacker) {
+        board.GenerateLegalMoves(moves);
+
+        // The attacker plays the quickest proven mate, and the defender the slowest
+        bool found = false;
+        LongAlgebraicMove bestMove;
+        int32_t bestDepth = 0;
+
+        for (LongAlgebraicMove m : moves) {
+            board.MakeMove(m, undo);
+            Numbers child = Lookup(GetKey(worker), depth - 1);
+            board.UnmakeMove(undo);
+
+            if (child.Proof != 0)
+                continue;
+
+            if (!found || (attacker ? child.Depth < bestDepth : child.Depth > bestDepth)) {
+                found = true;
+                bestMove = m;
+                bestDepth = child.Depth;
+            }
+        }
+
+        if (!found)
+            break;
+
+        continuation.push_back(bestMove);
+        board.MakeMove(bestMove, undo);
+    }
+
+    worker.Position = root;
+}
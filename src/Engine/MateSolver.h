@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Chess/Board.h"
+
+// Finds forced mates with depth-first proof-number search (df-pn)
+//
+// The player to move is the attacker, and only their checking moves are searched,
+// so the tree is much smaller than the one a general search has to look at
+// Proof and disproof numbers are kept in a hash table shared by all threads
+// Sources:
+// https://www.chessprogramming.org/Proof-Number_Search
+// https://www.chessprogramming.org/Depth-First_Proof-Number_Search
+class MateSolver {
+public:
+    static constexpr int32_t MAX_MOVES = 63;
+
+    struct Limits {
+        int32_t Moves = 5;   // The longest mate to look for (in moves of the attacker)
+        uint64_t Nodes = 0;  // For each position, 0 means no limit
+    };
+
+    struct Result {
+        bool Mate = false;
+        int32_t Moves = 0;  // Mate in this many moves (the shortest mate)
+        std::vector<LongAlgebraicMove> Continuation;  // A mating line, which might be cut short
+        uint64_t Nodes = 0;
+    };
+
+    MateSolver(size_t hashSizeMB = 64, uint32_t threads = 0);  // 0 for one thread per core
+
+    MateSolver(const MateSolver&) = delete;
+    MateSolver& operator=(const MateSolver&) = delete;
+
+    void SetHashSize(size_t megabytes);
+    void ClearHash();
+
+    void SetThreads(uint32_t threads);
+    uint32_t GetThreads() const { return m_ThreadCount; }
+
+    Result Solve(const Board& position, const Limits& limits);
+
+    // Solves each position on its own thread, with all threads sharing the table
+    std::vector<Result> Solve(const std::vector<Board>& positions, const Limits& limits);
+private:
+    struct Numbers {
+        uint32_t Proof;
+        uint32_t Disproof;
+        int32_t Depth;  // Number of plies left when they were stored
+    };
+
+    struct Worker {
+        Board Position;
+        uint64_t KeyColour = 0;  // Added to the keys when Black is the attacker (the numbers mean the opposite)
+        uint64_t Nodes = 0;
+        uint64_t MaxNodes = 0;
+        bool Aborted = false;
+    };
+
+    Result Solve(Worker& worker, const Limits& limits);
+
+    void Search(Worker& worker, int32_t depth, uint32_t proofThreshold, uint32_t disproofThreshold, bool attacker);
+
+    static uint64_t GetKey(const Worker& worker) { return worker.Position.GetHash() ^ worker.KeyColour; }
+
+    // Numbers of a position with 'depth' plies left ({ 1, 1 } if they aren't known)
+    // A proof or disproof is returned with the depth it was stored with
+    Numbers Lookup(uint64_t key, int32_t depth) const;
+    void Store(uint64_t key, const Numbers& numbers);
+
+    // Follows the proven moves from the table
+    void ExtractContinuation(Worker& worker, int32_t depth, std::vector<LongAlgebraicMove>& continuation) const;
+private:
+    // The key XORed with the data, the same as the transposition table
+    struct Slot {
+        std::atomic<uint64_t> Key;
+        std::atomic<uint64_t> Data;
+    };
+
+    std::unique_ptr<Slot[]> m_Slots;
+    size_t m_Size = 0;  // Always a power of 2
+
+    uint32_t m_ThreadCount = 1;
+};
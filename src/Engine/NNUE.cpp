@@ -0,0 +1,417 @@
+#include "NNUE.h"
+
+#include "EngineException.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define NNUE_AVX2
+#elif defined(__SSSE3__) || defined(__AVX__)
+    #include <tmmintrin.h>
+    #define NNUE_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define NNUE_SSE2
+#endif
+
+#if defined(NNUE_SSSE3)
+    // SSSE3 includes everything from SSE2
+    #define NNUE_SSE2
+#endif
+
+namespace NNUE {
+
+    const char* GetInstructionSet() {
+#if defined(NNUE_AVX2)
+        return "AVX2";
+#elif defined(NNUE_SSSE3)
+        return "SSSE3";
+#elif defined(NNUE_SSE2)
+        return "SSE2";
+#else
+        return "scalar";
+#endif
+    }
+
+    // ---------------- Kernels ----------------
+    // The sizes must be multiples of 32
+
+    // values += weights
+    static void AddWeights(int16_t* values, const int16_t* weights, size_t size) {
+#if defined(NNUE_AVX2)
+        for (size_t i = 0; i < size; i += 16) {
+            __m256i v = _mm256_load_si256((const __m256i*)(values + i));
+            __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+            _mm256_store_si256((__m256i*)(values + i), _mm256_add_epi16(v, w));
+        }
+#elif defined(NNUE_SSE2)
+        for (size_t i = 0; i < size; i += 8) {
+            __m128i v = _mm_load_si128((const __m128i*)(values + i));
+            __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+            _mm_store_si128((__m128i*)(values + i), _mm_add_epi16(v, w));
+        }
+#else
+        for (size_t i = 0; i < size; i++)
+            values[i] += weights[i];
+#endif
+    }
+
+    // values -= weights
+    static void SubtractWeights(int16_t* values, const int16_t* weights, size_t size) {
+#if defined(NNUE_AVX2)
+        for (size_t i = 0; i < size; i += 16) {
+            __m256i v = _mm256_load_si256((const __m256i*)(values + i));
+            __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+            _mm256_store_si256((__m256i*)(values + i), _mm256_sub_epi16(v, w));
+        }
+#elif defined(NNUE_SSE2)
+        for (size_t i = 0; i < size; i += 8) {
+            __m128i v = _mm_load_si128((const __m128i*)(values + i));
+            __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+            _mm_store_si128((__m128i*)(values + i), _mm_sub_epi16(v, w));
+        }
+#else
+        for (size_t i = 0; i < size; i++)
+            values[i] -= weights[i];
+#endif
+    }
+
+    // output = clamp(input, 0, 127)
+    static void ClippedReLU(const int16_t* input, uint8_t* output, size_t size) {
+#if defined(NNUE_AVX2)
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i max = _mm256_set1_epi16(127);
+        for (size_t i = 0; i < size; i += 32) {
+            __m256i a = _mm256_load_si256((const __m256i*)(input + i));
+            __m256i b = _mm256_load_si256((const __m256i*)(input + i + 16));
+            a = _mm256_min_epi16(_mm256_max_epi16(a, zero), max);
+            b = _mm256_min_epi16(_mm256_max_epi16(b, zero), max);
+
+            // Packing works on each 128 bit lane separately, so the order has to be fixed
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0b11011000);
+            _mm256_store_si256((__m256i*)(output + i), packed);
+        }
+#elif defined(NNUE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i max = _mm_set1_epi16(127);
+        for (size_t i = 0; i < size; i += 16) {
+            __m128i a = _mm_load_si128((const __m128i*)(input + i));
+            __m128i b = _mm_load_si128((const __m128i*)(input + i + 8));
+            a = _mm_min_epi16(_mm_max_epi16(a, zero), max);
+            b = _mm_min_epi16(_mm_max_epi16(b, zero), max);
+            _mm_store_si128((__m128i*)(output + i), _mm_packus_epi16(a, b));
+        }
+#else
+        for (size_t i = 0; i < size; i++)
+            output[i] = (uint8_t)std::clamp<int16_t>(input[i], 0, 127);
+#endif
+    }
+
+    // output = clamp(input >> WEIGHT_SCALE_BITS, 0, 127)
+    static void ClippedReLU(const int32_t* input, uint8_t* output, size_t size) {
+        for (size_t i = 0; i < size; i++)
+            output[i] = (uint8_t)std::clamp(input[i] >> WEIGHT_SCALE_BITS, 0, 127);
+    }
+
+    // output = biases + weights * input
+    // 'weights' is stored one output row after another
+    static void Affine(const uint8_t* input, size_t inputSize, const int8_t* weights, const int32_t* biases, int32_t* output, size_t outputSize) {
+#if defined(NNUE_AVX2)
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (size_t o = 0; o < outputSize; o++) {
+            const int8_t* row = weights + o * inputSize;
+
+            __m256i sum = _mm256_setzero_si256();
+            for (size_t i = 0; i < inputSize; i += 32) {
+                __m256i in = _mm256_load_si256((const __m256i*)(input + i));
+                __m256i w = _mm256_loadu_si256((const __m256i*)(row + i));
+                // u8 x i8 -> pairs of i16 -> pairs of i32 (inputs are at most 127, so there is no saturation)
+                __m256i product = _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones);
+                sum = _mm256_add_epi32(sum, product);
+            }
+
+            __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0b01001110));
+            sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0b10110001));
+            output[o] = biases[o] + _mm_cvtsi128_si32(sum128);
+        }
+#elif defined(NNUE_SSSE3)
+        const __m128i ones = _mm_set1_epi16(1);
+        for (size_t o = 0; o < outputSize; o++) {
+            const int8_t* row = weights + o * inputSize;
+
+            __m128i sum = _mm_setzero_si128();
+            for (size_t i = 0; i < inputSize; i += 16) {
+                __m128i in = _mm_load_si128((const __m128i*)(input + i));
+                __m128i w = _mm_loadu_si128((const __m128i*)(row + i));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+            }
+
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b01001110));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0b10110001));
+            output[o] = biases[o] + _mm_cvtsi128_si32(sum);
+        }
+#else
+        for (size_t o = 0; o < outputSize; o++) {
+            const int8_t* row = weights + o * inputSize;
+
+            int32_t sum = biases[o];
+            for (size_t i = 0; i < inputSize; i++)
+                sum += (int32_t)input[i] * row[i];
+
+            output[o] = sum;
+        }
+#endif
+    }
+
+    // ---------------- File reading ----------------
+    // The file is little-endian like the machines this runs on, so it is read as is
+
+    template<typename T>
+    static void Read(std::istream& stream, T* data, size_t count) {
+        if (!stream.read((char*)data, count * sizeof(T)))
+            throw NetworkLoadError("Unexpected end of network file");
+    }
+
+    template<typename T>
+    static T Read(std::istream& stream) {
+        T value;
+        Read(stream, &value, 1);
+        return value;
+    }
+
+    template<typename T>
+    static void Write(std::ostream& stream, const T* data, size_t count) {
+        stream.write((const char*)data, count * sizeof(T));
+    }
+
+    static constexpr char MAGIC[4] = { 'C', 'N', 'U', 'E' };
+
+    // ---------------- Network ----------------
+
+    Network::Network(FeatureSet set)
+        : m_FeatureSet(set), m_AccumulatorWeights(std::make_unique<int16_t[]>(FeatureCount(set) * ACCUMULATOR_SIZE)) {}
+
+    std::unique_ptr<Network> Network::Load(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw NetworkLoadError("Could not open network file " + path.string());
+
+        char magic[4];
+        Read(file, magic, 4);
+        if (std::memcmp(magic, MAGIC, 4) != 0)
+            throw NetworkLoadError("Not a network file: " + path.string());
+
+        if (Read<uint32_t>(file) != VERSION)
+            throw NetworkLoadError("Unsupported network version");
+
+        uint32_t set = Read<uint32_t>(file);
+        if (set > (uint32_t)FeatureSet::HalfKA)
+            throw NetworkLoadError("Unknown feature set");
+
+        uint32_t accumulatorSize = Read<uint32_t>(file);
+        uint32_t hidden1Size = Read<uint32_t>(file);
+        uint32_t hidden2Size = Read<uint32_t>(file);
+        if (accumulatorSize != ACCUMULATOR_SIZE || hidden1Size != HIDDEN1_SIZE || hidden2Size != HIDDEN2_SIZE)
+            throw NetworkLoadError("Unsupported network architecture");
+
+        std::unique_ptr<Network> network(new Network((FeatureSet)set));
+
+        Read(file, network->m_AccumulatorBiases.data(), ACCUMULATOR_SIZE);
+        Read(file, network->m_AccumulatorWeights.get(), FeatureCount(network->m_FeatureSet) * ACCUMULATOR_SIZE);
+
+        Read(file, network->m_Hidden1Biases.data(), HIDDEN1_SIZE);
+        for (auto& row : network->m_Hidden1Weights)
+            Read(file, row.data(), row.size());
+
+        Read(file, network->m_Hidden2Biases.data(), HIDDEN2_SIZE);
+        for (auto& row : network->m_Hidden2Weights)
+            Read(file, row.data(), row.size());
+
+        network->m_OutputBias = Read<int32_t>(file);
+        Read(file, network->m_OutputWeights.data(), HIDDEN2_SIZE);
+
+        if (file.peek() != std::ifstream::traits_type::eof())
+            throw NetworkLoadError("Network file is too long");
+
+        return network;
+    }
+
+    std::unique_ptr<Network> Network::CreateRandom(FeatureSet set, uint64_t seed) {
+        std::unique_ptr<Network> network(new Network(set));
+
+        // Uniform in [-range, range]
+        auto random = [&seed](int32_t range) { return (int32_t)(Zobrist::NextRandom(seed) % (2 * range + 1)) - range; };
+
+        for (int16_t& b : network->m_AccumulatorBiases)
+            b = (int16_t)random(64);
+        for (size_t i = 0; i < FeatureCount(set) * ACCUMULATOR_SIZE; i++)
+            network->m_AccumulatorWeights[i] = (int16_t)random(32);
+
+        for (int32_t& b : network->m_Hidden1Biases)
+            b = random(1024);
+        for (auto& row : network->m_Hidden1Weights)
+            for (int8_t& w : row)
+                w = (int8_t)random(16);
+
+        for (int32_t& b : network->m_Hidden2Biases)
+            b = random(1024);
+        for (auto& row : network->m_Hidden2Weights)
+            for (int8_t& w : row)
+                w = (int8_t)random(64);
+
+        network->m_OutputBias = random(1024);
+        for (int8_t& w : network->m_OutputWeights)
+            w = (int8_t)random(127);
+
+        return network;
+    }
+
+    void Network::Save(const std::filesystem::path& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            throw NetworkLoadError("Could not create network file " + path.string());
+
+        const uint32_t header[] = { VERSION, (uint32_t)m_FeatureSet, ACCUMULATOR_SIZE, HIDDEN1_SIZE, HIDDEN2_SIZE };
+        Write(file, MAGIC, 4);
+        Write(file, header, 5);
+
+        Write(file, m_AccumulatorBiases.data(), ACCUMULATOR_SIZE);
+        Write(file, m_AccumulatorWeights.get(), FeatureCount(m_FeatureSet) * ACCUMULATOR_SIZE);
+
+        Write(file, m_Hidden1Biases.data(), HIDDEN1_SIZE);
+        for (const auto& row : m_Hidden1Weights)
+            Write(file, row.data(), row.size());
+
+        Write(file, m_Hidden2Biases.data(), HIDDEN2_SIZE);
+        for (const auto& row : m_Hidden2Weights)
+            Write(file, row.data(), row.size());
+
+        Write(file, &m_OutputBias, 1);
+        Write(file, m_OutputWeights.data(), HIDDEN2_SIZE);
+    }
+
+    // Each perspective sees the board from its own side (Black's is flipped vertically)
+    size_t Network::FeatureIndex(Colour perspective, Square king, Piece p, Square s) const {
+        const size_t pieceCount = m_FeatureSet == FeatureSet::HalfKP ? 10 : 12;
+        const size_t piece = GetPieceType(p) * 2 + (GetColour(p) != perspective);
+
+        return (FlipPerspective(king, perspective) * pieceCount + piece) * 64 + FlipPerspective(s, perspective);
+    }
+
+    void Network::AddFeature(std::array<int16_t, ACCUMULATOR_SIZE>& values, size_t feature) const {
+        AddWeights(values.data(), m_AccumulatorWeights.get() + feature * ACCUMULATOR_SIZE, ACCUMULATOR_SIZE);
+    }
+
+    void Network::RemoveFeature(std::array<int16_t, ACCUMULATOR_SIZE>& values, size_t feature) const {
+        SubtractWeights(values.data(), m_AccumulatorWeights.get() + feature * ACCUMULATOR_SIZE, ACCUMULATOR_SIZE);
+    }
+
+    void Network::RefreshPerspective(std::array<int16_t, ACCUMULATOR_SIZE>& values, const Board& board, Colour perspective) const {
+        values = m_AccumulatorBiases;
+
+        BitBoard pieces = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+        if (m_FeatureSet == FeatureSet::HalfKP)
+            pieces &= ~board.GetPieceBitBoard(King);
+
+        const Square king = GetSquare(board.GetPieceBitBoard(King) & board.GetColourBitBoard(perspective));
+
+        for (; pieces != 0; pieces &= pieces - 1) {
+            Square s = GetSquare(pieces);
+            AddFeature(values, FeatureIndex(perspective, king, board[s], s));
+        }
+    }
+
+    void Network::Refresh(Accumulator& accumulator, const Board& board) const {
+        RefreshPerspective(accumulator.Values[White], board, White);
+        RefreshPerspective(accumulator.Values[Black], board, Black);
+    }
+
+    void Network::Update(const Accumulator& before, Accumulator& after, const Board& board, const UndoInfo& undo) const {
+        struct Change {
+            Piece P;
+            Square S;
+        };
+
+        // At most: the moving piece, a captured piece and a castling rook
+        std::array<Change, 3> removed, added;
+        size_t removedCount = 0, addedCount = 0;
+
+        const Square source = undo.Move.SourceSquare;
+        const Square destination = undo.Move.DestinationSquare;
+        const Colour colour = GetColour(undo.MovingPiece);
+
+        removed[removedCount++] = { undo.MovingPiece, source };
+        added[addedCount++] = { board[destination], destination };  // Could be promoted
+
+        if (undo.CapturedPiece != Piece::None)
+            removed[removedCount++] = { undo.CapturedPiece, destination };
+
+        if (undo.EnPassant)
+            removed[removedCount++] = { PieceTypeAndColour(Pawn, OppositeColour(colour)), (Square)(colour == White ? destination - 8 : destination + 8) };
+
+        const bool kingMoved = GetPieceType(undo.MovingPiece) == King;
+        if (kingMoved && destination == source + 2) {
+            removed[removedCount++] = { PieceTypeAndColour(Rook, colour), (Square)(source + 3) };
+            added[addedCount++] = { PieceTypeAndColour(Rook, colour), (Square)(destination - 1) };
+        } else if (kingMoved && destination + 2 == source) {
+            removed[removedCount++] = { PieceTypeAndColour(Rook, colour), (Square)(source - 4) };
+            added[addedCount++] = { PieceTypeAndColour(Rook, colour), (Square)(destination + 1) };
+        }
+
+        for (Colour perspective : { White, Black }) {
+            // Every feature depends on the king square
+            if (kingMoved && perspective == colour) {
+                RefreshPerspective(after.Values[perspective], board, perspective);
+                continue;
+            }
+
+            auto& values = after.Values[perspective];
+            values = before.Values[perspective];
+
+            const Square king = GetSquare(board.GetPieceBitBoard(King) & board.GetColourBitBoard(perspective));
+
+            for (size_t i = 0; i < removedCount; i++) {
+                if (m_FeatureSet == FeatureSet::HalfKA || GetPieceType(removed[i].P) != King)
+                    RemoveFeature(values, FeatureIndex(perspective, king, removed[i].P, removed[i].S));
+            }
+
+            for (size_t i = 0; i < addedCount; i++) {
+                if (m_FeatureSet == FeatureSet::HalfKA || GetPieceType(added[i].P) != King)
+                    AddFeature(values, FeatureIndex(perspective, king, added[i].P, added[i].S));
+            }
+        }
+    }
+
+    int32_t Network::Evaluate(const Accumulator& accumulator, Colour playerTurn) const {
+        alignas(64) std::array<uint8_t, 2 * ACCUMULATOR_SIZE> input;
+        ClippedReLU(accumulator.Values[playerTurn].data(), input.data(), ACCUMULATOR_SIZE);
+        ClippedReLU(accumulator.Values[OppositeColour(playerTurn)].data(), input.data() + ACCUMULATOR_SIZE, ACCUMULATOR_SIZE);
+
+        alignas(64) std::array<int32_t, HIDDEN1_SIZE> hidden1;
+        alignas(64) std::array<uint8_t, HIDDEN1_SIZE> hidden1Output;
+        Affine(input.data(), input.size(), m_Hidden1Weights[0].data(), m_Hidden1Biases.data(), hidden1.data(), HIDDEN1_SIZE);
+        ClippedReLU(hidden1.data(), hidden1Output.data(), HIDDEN1_SIZE);
+
+        alignas(64) std::array<int32_t, HIDDEN2_SIZE> hidden2;
+        alignas(64) std::array<uint8_t, HIDDEN2_SIZE> hidden2Output;
+        Affine(hidden1Output.data(), HIDDEN1_SIZE, m_Hidden2Weights[0].data(), m_Hidden2Biases.data(), hidden2.data(), HIDDEN2_SIZE);
+        ClippedReLU(hidden2.data(), hidden2Output.data(), HIDDEN2_SIZE);
+
+        int32_t output = m_OutputBias;
+        for (size_t i = 0; i < HIDDEN2_SIZE; i++)
+            output += (int32_t)hidden2Output[i] * m_OutputWeights[i];
+
+        return output / OUTPUT_SCALE;
+    }
+
+    int32_t Network::Evaluate(const Board& board) const {
+        Accumulator accumulator;
+        Refresh(accumulator, board);
+        return Evaluate(accumulator, board.GetPlayerTurn());
+    }
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "Chess/Board.h"
+
+// Efficiently updatable neural network evaluation
+//
+// The input layer is a set of one-hot features, one for each piece relative
+// to the king of the perspective, so a move only changes a few of them and
+// the first layer ("accumulator") can be updated instead of recomputed
+// Source:
+// https://www.chessprogramming.org/NNUE
+//
+// Layers: features -> 2 x 256 (one half for each perspective, player to move first) -> 32 -> 32 -> 1
+//
+// The kernels use AVX2 or SSSE3/SSE2 if the compiler targets them (ex. -mavx2 or /arch:AVX2,
+// or the CHESS_NATIVE_ARCH CMake option) and plain loops otherwise; the results are the same
+namespace NNUE {
+
+    enum class FeatureSet : uint32_t {
+        HalfKP,  // King square x non-king piece x square
+        HalfKA   // King square x piece (kings included) x square
+    };
+
+    constexpr size_t ACCUMULATOR_SIZE = 256;
+    constexpr size_t HIDDEN1_SIZE = 32;
+    constexpr size_t HIDDEN2_SIZE = 32;
+
+    // The output is divided by this to get centipawns
+    constexpr int32_t OUTPUT_SCALE = 16;
+    // Hidden layer outputs are shifted right by this before clipping
+    constexpr int32_t WEIGHT_SCALE_BITS = 6;
+
+    constexpr size_t FeatureCount(FeatureSet set) { return 64 * (set == FeatureSet::HalfKP ? 10 : 12) * 64; }
+
+    // The instruction set the kernels were compiled for: "AVX2", "SSSE3", "SSE2" or "scalar"
+    const char* GetInstructionSet();
+
+    // The first layer for both perspectives, indexed by Colour
+    struct alignas(64) Accumulator {
+        std::array<std::array<int16_t, ACCUMULATOR_SIZE>, ColourCount> Values;
+    };
+
+    class Network {
+    public:
+        // Loads a network from a file
+        //
+        // File format (little-endian):
+        // "CNUE", version (u32), feature set (u32), accumulator size (u32), hidden sizes (u32, u32)
+        // accumulator biases (i16), accumulator weights (i16, feature major)
+        // hidden 1 biases (i32), hidden 1 weights (i8, output major)
+        // hidden 2 biases (i32), hidden 2 weights (i8, output major)
+        // output bias (i32), output weights (i8)
+        static std::unique_ptr<Network> Load(const std::filesystem::path& path);
+
+        // Makes a network with random weights (for testing and benchmarking)
+        static std::unique_ptr<Network> CreateRandom(FeatureSet set, uint64_t seed);
+
+        void Save(const std::filesystem::path& path) const;
+
+        FeatureSet GetFeatureSet() const { return m_FeatureSet; }
+
+        // Computes the accumulator from scratch
+        void Refresh(Accumulator& accumulator, const Board& board) const;
+
+        // Computes 'after' from 'before' and the move that was made
+        // 'board' is the position after the move
+        // The perspective of a king that moved is refreshed instead
+        void Update(const Accumulator& before, Accumulator& after, const Board& board, const UndoInfo& undo) const;
+
+        // Evaluation in centipawns from the point of view of the player to move
+        int32_t Evaluate(const Accumulator& accumulator, Colour playerTurn) const;
+
+        // Refreshes and evaluates (for positions that aren't related to each other)
+        int32_t Evaluate(const Board& board) const;
+
+        static constexpr uint32_t VERSION = 1;
+    private:
+        Network(FeatureSet set);
+
+        size_t FeatureIndex(Colour perspective, Square king, Piece p, Square s) const;
+
+        void AddFeature(std::array<int16_t, ACCUMULATOR_SIZE>& values, size_t feature) const;
+        void RemoveFeature(std::array<int16_t, ACCUMULATOR_SIZE>& values, size_t feature) const;
+        void RefreshPerspective(std::array<int16_t, ACCUMULATOR_SIZE>& values, const Board& board, Colour perspective) const;
+    private:
+        FeatureSet m_FeatureSet;
+
+        alignas(64) std::array<int16_t, ACCUMULATOR_SIZE> m_AccumulatorBiases;
+        std::unique_ptr<int16_t[]> m_AccumulatorWeights;  // FeatureCount() x ACCUMULATOR_SIZE
+
+        alignas(64) std::array<int32_t, HIDDEN1_SIZE> m_Hidden1Biases;
+        alignas(64) std::array<std::array<int8_t, 2 * ACCUMULATOR_SIZE>, HIDDEN1_SIZE> m_Hidden1Weights;
+
+        alignas(64) std::array<int32_t, HIDDEN2_SIZE> m_Hidden2Biases;
+        alignas(64) std::array<std::array<int8_t, HIDDEN1_SIZE>, HIDDEN2_SIZE> m_Hidden2Weights;
+
+        int32_t m_OutputBias;
+        alignas(64) std::array<int8_t, HIDDEN2_SIZE> m_OutputWeights;
+    };
+
+}
@@ -0,0 +1,563 @@
+#include "Retrograde.h"
+
+#include "EngineException.h"
+#include "Chess/PseudoLegal.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace Retrograde {
+
+    // File layout: "CRBB", version (u32), name (8 chars, padded with zeros), position count (u64), results
+    static constexpr char MAGIC[4] = { 'C', 'R', 'B', 'B' };
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t NAME_SIZE = 8;
+    static constexpr size_t HEADER_SIZE = 4 + 4 + NAME_SIZE + 8;
+
+    // The order of the pieces of one side in a name
+    static constexpr std::string_view PIECE_ORDER = "KQRBNP";
+
+    static int32_t PieceValue(char c) {
+        switch (c) {
+            case 'Q': return 9;
+            case 'R': return 5;
+            case 'B': return 3;
+            case 'N': return 3;
+            case 'P': return 1;
+            default:  return 0;
+        }
+    }
+
+    static std::string SortSide(std::string side) {
+        std::sort(side.begin(), side.end(), [](char a, char b) { return PIECE_ORDER.find(a) < PIECE_ORDER.find(b); });
+        return side;
+    }
+
+    // The name of the pieces on the board, White first
+    static std::string GetMaterialName(const Board& board) {
+        std::string name;
+
+        for (Colour c : { White, Black }) {
+            for (char p : PIECE_ORDER) {
+                BitBoard pieces = board.GetPieceBitBoard(CharToPieceType(p)) & board.GetColourBitBoard(c);
+                name.append(SquareCount(pieces), p);
+            }
+        }
+
+        return name;
+    }
+
+    std::string Bitbase::Normalize(const std::string& name) {
+        const size_t secondKing = name.find('K', 1);
+        if (name.empty() || name[0] != 'K' || secondKing == std::string::npos || name.size() > MAX_PIECES)
+            throw TablebaseError("Invalid ending " + name);
+
+        std::string sides[2] = { SortSide(name.substr(0, secondKing)), SortSide(name.substr(secondKing)) };
+        int32_t values[2] = { 0, 0 };
+
+        for (int32_t i = 0; i < 2; i++) {
+            for (size_t j = 0; j < sides[i].size(); j++) {
+                if (PIECE_ORDER.find(sides[i][j]) == std::string_view::npos || (sides[i][j] == 'K') != (j == 0))
+                    throw TablebaseError("Invalid ending " + name);
+
+                values[i] += PieceValue(sides[i][j]);
+            }
+        }
+
+        if (sides[0].find('P') != std::string::npos && sides[1].find('P') != std::string::npos)
+            throw TablebaseError("Endings with pawns on both sides are not supported: " + name);
+
+        // The stronger side first (or the side with the stronger pieces if they are equal)
+        auto stronger = [&](const std::string& a, const std::string& b) {
+            for (size_t i = 0; i < std::min(a.size(), b.size()); i++)
+                if (a[i] != b[i])
+                    return PIECE_ORDER.find(a[i]) < PIECE_ORDER.find(b[i]);
+            return a.size() > b.size();
+        };
+
+        if (values[1] > values[0] || (values[1] == values[0] && stronger(sides[1], sides[0])))
+            std::swap(sides[0], sides[1]);
+
+        return sides[0] + sides[1];
+    }
+
+    // The pieces of a normalized name, White's then Black's
+    static std::vector<Piece> GetPieces(const std::string& name) {
+        std::vector<Piece> pieces;
+
+        Colour colour = White;
+        for (size_t i = 0; i < name.size(); i++) {
+            if (i > 0 && name[i] == 'K')
+                colour = Black;
+
+            pieces.push_back(PieceTypeAndColour(CharToPieceType(name[i]), colour));
+        }
+
+        return pieces;
+    }
+
+    static size_t PositionCount(size_t pieceCount) {
+        return (size_t)2 << (6 * pieceCount);
+    }
+
+    static size_t ToIndex(Colour playerTurn, const std::array<Square, Bitbase::MAX_PIECES>& squares, size_t pieceCount) {
+        size_t index = 0;
+        for (size_t i = pieceCount; i > 0; i--)
+            index = (index << 6) | squares[i - 1];
+
+        return (index << 1) | playerTurn;
+    }
+
+    static Colour FromIndex(size_t index, std::array<Square, Bitbase::MAX_PIECES>& squares, size_t pieceCount) {
+        const Colour playerTurn = (Colour)(index & 1);
+
+        index >>= 1;
+        for (size_t i = 0; i < pieceCount; i++) {
+            squares[i] = index & 63;
+            index >>= 6;
+        }
+
+        return playerTurn;
+    }
+
+    // Sorts the squares of identical pieces, so every position has one index
+    static void SortIdenticalPieces(const std::vector<Piece>& pieces, std::array<Square, Bitbase::MAX_PIECES>& squares) {
+        for (size_t i = 0; i < pieces.size();) {
+            size_t j = i + 1;
+            while (j < pieces.size() && pieces[j] == pieces[i])
+                j++;
+
+            std::sort(squares.begin() + i, squares.begin() + j);
+            i = j;
+        }
+    }
+
+    std::optional<size_t> Bitbase::GetIndex(const Board& board, bool flip) const {
+        const BitBoard occupied = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+        if (SquareCount(occupied) != m_Pieces.size())
+            return std::nullopt;
+
+        std::array<Square, MAX_PIECES> squares = {};
+
+        for (size_t i = 0; i < m_Pieces.size();) {
+            const PieceType type = GetPieceType(m_Pieces[i]);
+            const Colour colour = flip ? OppositeColour(GetColour(m_Pieces[i])) : GetColour(m_Pieces[i]);
+
+            BitBoard b = board.GetPieceBitBoard(type) & board.GetColourBitBoard(colour);
+
+            size_t j = i;
+            for (; j < m_Pieces.size() && m_Pieces[j] == m_Pieces[i]; j++) {
+                if (b == 0)
+                    return std::nullopt;
+
+                squares[j] = GetSquare(b) ^ (flip ? 56 : 0);
+                b &= b - 1;
+            }
+
+            if (b != 0)
+                return std::nullopt;
+
+            std::sort(squares.begin() + i, squares.begin() + j);
+            i = j;
+        }
+
+        const Colour playerTurn = flip ? OppositeColour(board.GetPlayerTurn()) : board.GetPlayerTurn();
+        return ToIndex(playerTurn, squares, m_Pieces.size());
+    }
+
+    std::optional<Result> Bitbase::Probe(const Board& board) const {
+        if (!IsOpen())
+            return std::nullopt;
+
+        for (bool flip : { false, true }) {
+            if (std::optional<size_t> index = GetIndex(board, flip))
+                return Probe(*index);
+        }
+
+        return std::nullopt;
+    }
+
+    bool Bitbase::Open(const std::filesystem::path& path) {
+        m_Data = nullptr;
+        m_Memory.clear();
+
+        if (!m_File.Open(path) || m_File.GetSize() < HEADER_SIZE)
+            return false;
+
+        const uint8_t* data = m_File.GetData();
+
+        uint32_t version;
+        std::memcpy(&version, data + 4, sizeof(version));
+
+        char name[NAME_SIZE + 1] = {};
+        std::memcpy(name, data + 8, NAME_SIZE);
+
+        uint64_t positionCount;
+        std::memcpy(&positionCount, data + 8 + NAME_SIZE, sizeof(positionCount));
+
+        try {
+            m_Name = Normalize(name);
+        } catch (TablebaseError&) {
+            m_File.Close();
+            return false;
+        }
+
+        m_Pieces = GetPieces(m_Name);
+        m_PositionCount = PositionCount(m_Pieces.size());
+
+        if (std::memcmp(data, MAGIC, 4) != 0 || version != VERSION || positionCount != m_PositionCount || m_File.GetSize() != HEADER_SIZE + GetDataSize()) {
+            m_File.Close();
+            return false;
+        }
+
+        m_Data = data + HEADER_SIZE;
+        return true;
+    }
+
+    bool Bitbase::Save(const std::filesystem::path& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file || !IsOpen())
+            return false;
+
+        char name[NAME_SIZE] = {};
+        std::memcpy(name, m_Name.data(), m_Name.size());
+
+        const uint64_t positionCount = m_PositionCount;
+
+        file.write(MAGIC, 4);
+        file.write((const char*)&VERSION, sizeof(VERSION));
+        file.write(name, NAME_SIZE);
+        file.write((const char*)&positionCount, sizeof(positionCount));
+        file.write((const char*)m_Data, GetDataSize());
+
+        return (bool)file;
+    }
+
+    // ---------------- Generation ----------------
+
+    Generator::Generator(uint32_t threads)
+        : m_ThreadCount(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())) {
+    }
+
+    std::optional<Result> Generator::Probe(const Board& board) const {
+        const BitBoard occupied = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+        if (SquareCount(occupied) == 2)
+            return Result::Draw;
+
+        auto it = m_Tables.find(Bitbase::Normalize(GetMaterialName(board)));
+        if (it == m_Tables.end())
+            return std::nullopt;
+
+        return it->second->Probe(board);
+    }
+
+    const Bitbase& Generator::Generate(const std::string& name) {
+        const std::string normalized = Bitbase::Normalize(name);
+        if (normalized.size() < 3)
+            throw TablebaseError("Invalid ending " + name);
+
+        if (auto it = m_Tables.find(normalized); it != m_Tables.end())
+            return *it->second;
+
+        // First every ending that a capture or promotion leads to
+        const std::vector<Piece> pieces = GetPieces(normalized);
+
+        auto childName = [&](size_t captured, size_t promoted, PieceType promotion) {
+            std::string child;
+            for (size_t i = 0; i < pieces.size(); i++) {
+                if (i != captured)
+                    child += PieceTypeToChar(i == promoted ? promotion : GetPieceType(pieces[i]));
+            }
+            return child;
+        };
+
+        for (size_t promoted = 0; promoted <= pieces.size(); promoted++) {
+            const bool isPawn = promoted < pieces.size() && GetPieceType(pieces[promoted]) == Pawn;
+            if (promoted < pieces.size() && !isPawn)
+                continue;
+
+            for (PieceType promotion : { Knight, Bishop, Rook, Queen }) {
+                for (size_t captured = 0; captured <= pieces.size(); captured++) {
+                    if (captured < pieces.size() && (GetPieceType(pieces[captured]) == King || captured == promoted))
+                        continue;
+                    if (captured == pieces.size() && promoted == pieces.size())
+                        continue;
+
+                    std::string child = childName(captured, promoted, promotion);
+                    if (child.size() > 2)
+                        Generate(child);
+                }
+
+                if (!isPawn)
+                    break;
+            }
+        }
+
+        auto table = std::make_unique<Bitbase>();
+        table->m_Name = normalized;
+        table->m_Pieces = pieces;
+        table->m_PositionCount = PositionCount(pieces.size());
+
+        Statistics statistics;
+        statistics.Name = normalized;
+        Run(*table, statistics);
+
+        m_Statistics.push_back(statistics);
+        return *(m_Tables[normalized] = std::move(table));
+    }
+
+    // Calls 'function(begin, end)' for blocks of [0, count) on every thread
+    static void ParallelFor(size_t count, uint32_t threadCount, const std::function<void(size_t, size_t)>& function) {
+        constexpr size_t BLOCK_SIZE = 1 << 14;
+
+        std::atomic<size_t> next = 0;
+        auto worker = [&]() {
+            for (size_t begin = next.fetch_add(BLOCK_SIZE); begin < count; begin = next.fetch_add(BLOCK_SIZE))
+                function(begin, std::min(begin + BLOCK_SIZE, count));
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 1; i < threadCount; i++)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    void Generator::Run(Bitbase& table, Statistics& statistics) {
+        // Working state of a position (the final result once it is known)
+        enum State : uint8_t { Unknown, Win, Loss, Draw, Invalid };
+
+        // The number of moves that stay in the table and haven't been shown to win for the opponent
+        // If every one of them does, the position is lost, unless a capture or promotion draws
+        constexpr uint8_t DRAWING_EXIT = 0x80;
+
+        constexpr uint8_t NOT_RESOLVED = 0xFF;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        const std::vector<Piece>& pieces = table.m_Pieces;
+        const size_t pieceCount = pieces.size();
+        const size_t positionCount = table.m_PositionCount;
+
+        auto states = std::make_unique<std::atomic<uint8_t>[]>(positionCount);
+        auto moveCounts = std::make_unique<std::atomic<uint8_t>[]>(positionCount);
+        auto passes = std::make_unique<std::atomic<uint8_t>[]>(positionCount);  // The pass a position was resolved in
+
+        statistics.Positions = positionCount;
+        statistics.WorkingMemory = positionCount * 3 + table.GetDataSize();
+
+        // Sets up the position, or returns false if the index isn't a valid position
+        auto setUp = [&](size_t index, Board& board, std::array<Square, Bitbase::MAX_PIECES>& squares) {
+            const Colour playerTurn = FromIndex(index, squares, pieceCount);
+
+            BitBoard occupied = 0;
+            for (size_t i = 0; i < pieceCount; i++) {
+                const BitBoard square = 1ull << squares[i];
+                if (occupied & square)
+                    return false;
+
+                if (GetPieceType(pieces[i]) == Pawn && (RankOf(squares[i]) == 0 || RankOf(squares[i]) == 7))
+                    return false;
+
+                if (i > 0 && pieces[i] == pieces[i - 1] && squares[i] < squares[i - 1])
+                    return false;
+
+                occupied |= square;
+            }
+
+            board.Clear(playerTurn);
+            for (size_t i = 0; i < pieceCount; i++)
+                board.SetPiece(pieces[i], squares[i]);
+
+            // The player who just moved can't be in check
+            const Colour opponent = OppositeColour(playerTurn);
+            const BitBoard king = board.GetPieceBitBoard(King) & board.GetColourBitBoard(opponent);
+
+            return board.AttackersTo(GetSquare(king), playerTurn) == 0;
+        };
+
+        // Pass 0: checkmates, stalemates, and the positions decided by a capture or promotion
+        ParallelFor(positionCount, m_ThreadCount, [&](size_t begin, size_t end) {
+            Board board;
+            MoveList moves;
+            UndoInfo undo;
+            std::array<Square, Bitbase::MAX_PIECES> squares;
+
+            for (size_t index = begin; index < end; index++) {
+                passes[index].store(NOT_RESOLVED, std::memory_order_relaxed);
+                moveCounts[index].store(0, std::memory_order_relaxed);
+
+                if (!setUp(index, board, squares)) {
+                    states[index].store(Invalid, std::memory_order_relaxed);
+                    continue;
+                }
+
+                board.GenerateLegalMoves(moves);
+
+                State bestExit = Unknown;  // The best result of a capture or promotion
+                uint8_t moveCount = 0;
+
+                for (LongAlgebraicMove m : moves) {
+                    const bool promotion = GetPieceType(board[m.SourceSquare]) == Pawn && (RankOf(m.DestinationSquare) == 0 || RankOf(m.DestinationSquare) == 7);
+
+                    if (board[m.DestinationSquare] == Piece::None && !promotion) {
+                        moveCount++;
+                        continue;
+                    }
+
+                    board.MakeMove(m, undo);
+                    std::optional<Result> result = Probe(board);
+                    board.UnmakeMove(undo);
+
+                    if (!result)
+                        throw TablebaseError("Missing table for a capture or promotion in " + table.m_Name);
+
+                    if (*result == Result::Loss)
+                        bestExit = Win;
+                    else if (*result == Result::Draw && bestExit != Win)
+                        bestExit = Draw;
+                    else if (bestExit == Unknown)
+                        bestExit = Loss;
+                }
+
+                State state = Unknown;
+                if (bestExit == Win)
+                    state = Win;
+                else if (moves.Size == 0)
+                    state = board.IsInCheck() ? Loss : Draw;
+                else if (moveCount == 0)
+                    state = bestExit;
+
+                states[index].store(state, std::memory_order_relaxed);
+                moveCounts[index].store(moveCount | (bestExit == Draw ? DRAWING_EXIT : 0), std::memory_order_relaxed);
+
+                if (state == Win || state == Loss)
+                    passes[index].store(0, std::memory_order_relaxed);
+            }
+        });
+
+        // Each pass takes back the moves that led to the positions resolved in the previous pass:
+        // a position that can move to a lost position is won,
+        // a position where every move goes to a won position is lost
+        std::atomic<size_t> resolved = 1;
+        uint8_t pass = 0;
+
+        while (resolved.load() != 0) {
+            if (pass + 1 == NOT_RESOLVED)
+                throw TablebaseError("Too many passes for " + table.m_Name);
+
+            resolved = 0;
+
+            ParallelFor(positionCount, m_ThreadCount, [&](size_t begin, size_t end) {
+                Board board;
+                std::array<Square, Bitbase::MAX_PIECES> squares, previous;
+                size_t count = 0;
+
+                for (size_t index = begin; index < end; index++) {
+                    if (passes[index].load(std::memory_order_relaxed) != pass)
+                        continue;
+
+                    const State state = (State)states[index].load(std::memory_order_relaxed);
+                    setUp(index, board, squares);
+
+                    const Colour mover = OppositeColour(board.GetPlayerTurn());
+                    const BitBoard occupied = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+
+                    for (size_t i = 0; i < pieceCount; i++) {
+                        if (GetColour(pieces[i]) != mover)
+                            continue;
+
+                        const Square s = squares[i];
+
+                        // The squares the piece could have come from
+                        BitBoard origins;
+                        switch (GetPieceType(pieces[i])) {
+                            case Pawn: {
+                                const int32_t back = mover == White ? -8 : 8;
+                                const Square single = s + back;
+                                origins = 0;
+
+                                if (!(occupied & (1ull << single)) && RankOf(single) != 0 && RankOf(single) != 7) {
+                                    origins |= 1ull << single;
+
+                                    const Square pawnRank = mover == White ? 1 : 6;
+                                    const Square twice = single + back;
+                                    if (RankOf(twice) == pawnRank && !(occupied & (1ull << twice)))
+                                        origins |= 1ull << twice;
+                                }
+                                break;
+                            }
+                            case Knight: origins = PseudoLegal::KnightAttack(s);            break;
+                            case Bishop: origins = PseudoLegal::BishopAttack(s, occupied);  break;
+                            case Rook:   origins = PseudoLegal::RookAttack(s, occupied);    break;
+                            case Queen:  origins = PseudoLegal::QueenAttack(s, occupied);   break;
+                            default:     origins = PseudoLegal::KingAttack(s);              break;
+                        }
+
+                        origins &= ~occupied;
+
+                        for (; origins != 0; origins &= origins - 1) {
+                            previous = squares;
+                            previous[i] = GetSquare(origins);
+                            SortIdenticalPieces(pieces, previous);
+
+                            const size_t before = ToIndex(mover, previous, pieceCount);
+
+                            uint8_t expected = Unknown;
+                            if (states[before].load(std::memory_order_relaxed) != Unknown)
+                                continue;
+
+                            if (state == Loss) {
+                                if (states[before].compare_exchange_strong(expected, Win, std::memory_order_relaxed)) {
+                                    passes[before].store(pass + 1, std::memory_order_relaxed);
+                                    count++;
+                                }
+                            } else {
+                                const uint8_t remaining = moveCounts[before].fetch_sub(1, std::memory_order_relaxed) - 1;
+
+                                if (remaining == 0 && states[before].compare_exchange_strong(expected, Loss, std::memory_order_relaxed)) {
+                                    passes[before].store(pass + 1, std::memory_order_relaxed);
+                                    count++;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                resolved += count;
+            });
+
+            pass++;
+        }
+
+        statistics.Passes = pass;
+
+        // Everything else is a draw
+        table.m_Memory.assign(table.GetDataSize(), 0);
+        for (size_t index = 0; index < positionCount; index++) {
+            Result result;
+            switch (states[index].load(std::memory_order_relaxed)) {
+                case Win:     result = Result::Win;     statistics.Wins++;   break;
+                case Loss:    result = Result::Loss;    statistics.Losses++; break;
+                case Invalid: result = Result::Invalid;                      break;
+                default:      result = Result::Draw;    statistics.Draws++;  break;
+            }
+
+            table.m_Memory[index / 4] |= (uint8_t)result << (2 * (index % 4));
+        }
+
+        table.m_Data = table.m_Memory.data();
+
+        statistics.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chess/Board.h"
+#include "Utility/MappedFile.h"
+
+// Generates win/draw/loss tables of small endings by retrograde analysis
+// Source:
+// https://www.chessprogramming.org/Retrograde_Analysis
+namespace Retrograde {
+
+    // From the point of view of the player to move
+    enum class Result : uint8_t {
+        Draw,
+        Win,
+        Loss,
+        Invalid  // Illegal position, or identical pieces out of order (every position is stored once)
+    };
+
+    // The results of every position of an ending, 2 bits per position
+    //
+    // An ending is named by its pieces, ex. "KPK" or "KQKR", with the stronger side first
+    // The index of a position is the player to move (lowest bit) and then 6 bits for the square of each piece,
+    // in the order of the name (identical pieces are in order of their squares)
+    // Castling and en passant are not included
+    class Bitbase {
+    public:
+        static constexpr int32_t MAX_PIECES = 4;
+
+        Bitbase() = default;
+
+        // Maps a file written by Save()
+        // Returns false if the file doesn't exist or isn't a bitbase
+        bool Open(const std::filesystem::path& path);
+        bool Save(const std::filesystem::path& path) const;
+
+        bool IsOpen() const { return m_Data != nullptr; }
+
+        const std::string& GetName() const { return m_Name; }
+        size_t GetPositionCount() const { return m_PositionCount; }
+        size_t GetDataSize() const { return (m_PositionCount + 3) / 4; }
+
+        // Returns std::nullopt if the position has other pieces (the colours can be either way around)
+        std::optional<Result> Probe(const Board& board) const;
+
+        inline Result Probe(size_t index) const { return (Result)((m_Data[index / 4] >> (2 * (index % 4))) & 0b11); }
+
+        // The name of an ending with the stronger side first, ex. "KRKQ" -> "KQKR"
+        // Throws TablebaseError if it isn't an ending that can be generated
+        static std::string Normalize(const std::string& name);
+    private:
+        friend class Generator;
+
+        // Index of the position, or std::nullopt if the pieces don't match
+        // If 'flip' then the colours of the pieces are swapped (and the board is flipped vertically)
+        std::optional<size_t> GetIndex(const Board& board, bool flip) const;
+    private:
+        std::string m_Name;
+        std::vector<Piece> m_Pieces;  // In the order of the index
+        size_t m_PositionCount = 0;
+
+        const uint8_t* m_Data = nullptr;
+        MappedFile m_File;
+        std::vector<uint8_t> m_Memory;  // If generated instead of loaded
+    };
+
+    struct Statistics {
+        std::string Name;
+        size_t Positions = 0;
+        size_t Wins = 0;
+        size_t Draws = 0;
+        size_t Losses = 0;
+        int32_t Passes = 0;         // Retrograde passes until nothing changed
+        double Seconds = 0;
+        size_t WorkingMemory = 0;   // Bytes used while generating
+    };
+
+    // Generates endings (and the endings they turn into by captures and promotions) on multiple threads
+    class Generator {
+    public:
+        Generator(uint32_t threads = 0);  // 0 for one thread per core
+
+        // Returns the finished table, generating it first if needed
+        // Throws TablebaseError for a name that isn't an ending with 2 to 4 pieces (including the kings),
+        // or that has pawns on both sides (en passant isn't handled)
+        const Bitbase& Generate(const std::string& name);
+
+        // Statistics of each table that was generated, in the order they were finished
+        const std::vector<Statistics>& GetStatistics() const { return m_Statistics; }
+    private:
+        // Result of a position with any material the generator has a table for
+        std::optional<Result> Probe(const Board& board) const;
+
+        void Run(Bitbase& table, Statistics& statistics);
+    private:
+        uint32_t m_ThreadCount;
+
+        std::unordered_map<std::string, std::unique_ptr<Bitbase>> m_Tables;
+        std::vector<Statistics> m_Statistics;
+    };
+
+}
@@ -0,0 +1,466 @@
+#include "Search.h"
+
+#include <algorithm>
+
+// Move ordering: the table move, then captures (most valuable victim, least valuable attacker),
+// then queen promotions, then killer moves, then quiet moves by their history score
+static constexpr int32_t TABLE_MOVE_SCORE = 1 << 30;
+static constexpr int32_t CAPTURE_SCORE = 1 << 28;
+static constexpr int32_t PROMOTION_SCORE = 1 << 27;
+static constexpr int32_t KILLER_SCORE = 1 << 26;
+
+// Scores closer to mate than this are mate scores
+static constexpr int32_t MATE_BOUND = Search::MATE_SCORE - Search::MAX_PLY;
+
+static bool IsCapture(const Board& board, LongAlgebraicMove m) {
+    return board[m.DestinationSquare] != Piece::None ||
+        (GetPieceType(board[m.SourceSquare]) == Pawn && FileOf(m.SourceSquare) != FileOf(m.DestinationSquare));
+}
+
+// Mate scores are stored relative to the position in the table,
+// and relative to the root everywhere else
+static int16_t ToTableScore(int32_t score, int32_t ply) {
+    if (score > MATE_BOUND)
+        return (int16_t)(score + ply);
+    if (score < -MATE_BOUND)
+        return (int16_t)(score - ply);
+    return (int16_t)score;
+}
+
+static int32_t FromTableScore(int16_t score, int32_t ply) {
+    if (score > MATE_BOUND)
+        return score - ply;
+    if (score < -MATE_BOUND)
+        return score + ply;
+    return score;
+}
+
+// Moves the best scored move from [index, moves.Size) to 'index'
+static void PickMove(MoveList& moves, std::array<int32_t, 256>& scores, size_t index) {
+    size_t best = index;
+    for (size_t i = index + 1; i < moves.Size; i++) {
+        if (scores[i] > scores[best])
+            best = i;
+    }
+
+    std::swap(moves[index], moves[best]);
+    std::swap(scores[index], scores[best]);
+}
+
+Search::Search(size_t hashSizeMB, uint32_t threads)
+    : m_Table(hashSizeMB), m_ThreadCount(std::max(threads, 1u)) {}
+
+Search::~Search() {
+    Stop();
+}
+
+void Search::SetThreads(uint32_t threads) {
+    Stop();
+    m_ThreadCount = std::max(threads, 1u);
+}
+
+void Search::SetHashSize(size_t megabytes) {
+    Stop();
+    m_Table.Resize(std::max<size_t>(megabytes, 1));
+}
+
+void Search::ClearHash() {
+    Stop();
+    m_Table.Clear();
+}
+
+void Search::Start(const Board& position, const Limits& limits) {
+    Stop();
+
+    m_Limits = limits;
+    m_Limits.Depth = std::clamp(m_Limits.Depth, 1, MAX_PLY - 1);
+    m_StartTime = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(m_ResultMutex);
+        m_Result = Engine::BestContinuation();
+    }
+
+    m_Workers.resize(m_ThreadCount);
+    for (uint32_t i = 0; i < m_ThreadCount; i++) {
+        if (!m_Workers[i])
+            m_Workers[i] = std::make_unique<Worker>();
+
+        Worker& worker = *m_Workers[i];
+        worker.Id = i;
+        worker.Position = position;
+        worker.Positions.clear();
+        worker.Positions.push_back(position.GetHash());
+        worker.Killers = {};
+        worker.History = {};
+        worker.PrincipalVariationLength = {};
+        worker.Nodes = 0;
+    }
+
+    m_Stop = false;
+    m_Searching = true;
+
+    m_MainThread = std::thread([this]() {
+        std::vector<std::thread> helpers;
+        for (uint32_t i = 1; i < m_ThreadCount; i++)
+            helpers.emplace_back(&Search::IterativeDeepening, this, std::ref(*m_Workers[i]));
+
+        IterativeDeepening(*m_Workers[0]);
+
+        m_Stop = true;
+        for (auto& helper : helpers)
+            helper.join();
+
+        m_Searching = false;
+
+        if (m_FinishCallback)
+            m_FinishCallback(GetBestContinuation());
+    });
+}
+
+void Search::Stop() {
+    m_Stop = true;
+    Wait();
+}
+
+void Search::Wait() {
+    if (m_MainThread.joinable())
+        m_MainThread.join();
+}
+
+Engine::BestContinuation Search::Run(const Board& position, const Limits& limits) {
+    Start(position, limits);
+    Wait();
+    return GetBestContinuation();
+}
+
+Engine::BestContinuation Search::GetBestContinuation() const {
+    std::lock_guard<std::mutex> lock(m_ResultMutex);
+    return m_Result;
+}
+
+uint64_t Search::GetNodes() const {
+    uint64_t nodes = 0;
+    for (uint32_t i = 0; i < m_ThreadCount && i < m_Workers.size(); i++)
+        nodes += m_Workers[i]->Nodes.load(std::memory_order_relaxed);
+    return nodes;
+}
+
+std::chrono::milliseconds Search::GetElapsedTime() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_StartTime);
+}
+
+void Search::IterativeDeepening(Worker& worker) {
+    // If no depth completes before the search is stopped, play any legal move
+    if (worker.Id == 0) {
+        MoveList moves;
+        worker.Position.GenerateLegalMoves(moves);
+
+        std::lock_guard<std::mutex> lock(m_ResultMutex);
+        if (moves.Size > 0)
+            m_Result.Continuation = { moves[0] };
+    }
+
+    for (int32_t depth = 1; depth <= m_Limits.Depth; depth++) {
+        // Half of the helper threads search one ply deeper,
+        // so the threads don't all search the same tree at the same time
+        int32_t searchDepth = depth + (worker.Id & 1);
+
+        int32_t score = AlphaBeta(worker, -INFINITE_SCORE, INFINITE_SCORE, searchDepth, 0);
+
+        if (m_Stop)
+            break;
+
+        if (worker.Id == 0) {
+            Engine::BestContinuation continuation = MakeContinuation(worker, score, depth);
+
+            {
+                std::lock_guard<std::mutex> lock(m_ResultMutex);
+                m_Result = continuation;
+            }
+
+            if (m_UpdateCallback)
+                m_UpdateCallback(continuation);
+        }
+    }
+}
+
+int32_t Search::AlphaBeta(Worker& worker, int32_t alpha, int32_t beta, int32_t depth, int32_t ply) {
+    worker.PrincipalVariationLength[ply] = ply;
+
+    if (depth <= 0)
+        return Quiescence(worker, alpha, beta, ply);
+
+    if (ShouldStop(worker))
+        return 0;
+
+    Board& board = worker.Position;
+    const bool root = ply == 0;
+
+    if (!root) {
+        if (board.GetHalfMoves() >= 100 || IsRepetition(worker))
+            return 0;
+
+        if (ply >= MAX_PLY - 1)
+            return board.Evaluate();
+
+        // There is no point searching for a mate longer than one already found
+        alpha = std::max(alpha, -MATE_SCORE + ply);
+        beta = std::min(beta, MATE_SCORE - ply - 1);
+        if (alpha >= beta)
+            return alpha;
+    }
+
+    const uint64_t hash = worker.Positions.back();
+
+    TranspositionTable::Entry entry;
+    LongAlgebraicMove tableMove;
+    if (m_Table.Probe(hash, entry)) {
+        tableMove = entry.Move;
+
+        if (!root && entry.Depth >= depth) {
+            int32_t score = FromTableScore(entry.Score, ply);
+
+            if (entry.Bound == TranspositionTable::BoundType::Exact ||
+                (entry.Bound == TranspositionTable::BoundType::Lower && score >= beta) ||
+                (entry.Bound == TranspositionTable::BoundType::Upper && score <= alpha))
+                return score;
+        }
+    }
+
+    const bool inCheck = board.IsInCheck();
+    if (inCheck)
+        depth++;  // Check extension
+
+    MoveList moves;
+    board.GenerateLegalMoves(moves);
+
+    if (moves.Size == 0)
+        return inCheck ? -MATE_SCORE + ply : 0;
+
+    std::array<int32_t, 256> scores;
+    ScoreMoves(worker, moves, scores, tableMove, ply);
+
+    const int32_t originalAlpha = alpha;
+    int32_t bestScore = -INFINITE_SCORE;
+    LongAlgebraicMove bestMove = moves[0];
+
+    UndoInfo undo;
+    for (size_t i = 0; i < moves.Size; i++) {
+        PickMove(moves, scores, i);
+        const LongAlgebraicMove m = moves[i];
+        const bool quiet = !IsCapture(board, m) && m.Promotion == Pawn;
+
+        board.MakeMove(m, undo);
+        worker.Positions.push_back(board.GetHash());
+
+        // Principal variation search: the first move is expected to be the best,
+        // so the rest are searched with a null window to prove that they are worse
+        int32_t score;
+        if (i == 0) {
+            score = -AlphaBeta(worker, -beta, -alpha, depth - 1, ply + 1);
+        } else {
+            score = -AlphaBeta(worker, -alpha - 1, -alpha, depth - 1, ply + 1);
+            if (score > alpha && score < beta)
+                score = -AlphaBeta(worker, -beta, -alpha, depth - 1, ply + 1);
+        }
+
+        worker.Positions.pop_back();
+        board.UnmakeMove(undo);
+
+        if (m_Stop)
+            return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = m;
+
+            if (score > alpha) {
+                alpha = score;
+                UpdatePrincipalVariation(worker, m, ply);
+
+                if (alpha >= beta) {
+                    if (quiet) {
+                        if (worker.Killers[ply][0] != m) {
+                            worker.Killers[ply][1] = worker.Killers[ply][0];
+                            worker.Killers[ply][0] = m;
+                        }
+
+                        worker.History[m.SourceSquare][m.DestinationSquare] += depth * depth;
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+
+    TranspositionTable::BoundType bound = TranspositionTable::BoundType::Upper;
+    if (bestScore >= beta)
+        bound = TranspositionTable::BoundType::Lower;
+    else if (bestScore > originalAlpha)
+        bound = TranspositionTable::BoundType::Exact;
+
+    m_Table.Store(hash, { bestMove, ToTableScore(bestScore, ply), (int8_t)std::min(depth, 127), bound });
+
+    return bestScore;
+}
+
+int32_t Search::Quiescence(Worker& worker, int32_t alpha, int32_t beta, int32_t ply) {
+    worker.PrincipalVariationLength[ply] = ply;
+
+    if (ShouldStop(worker))
+        return 0;
+
+    Board& board = worker.Position;
+
+    if (ply >= MAX_PLY - 1)
+        return board.Evaluate();
+
+    // When in check every evasion is searched, otherwise the player
+    // to move may "stand pat" instead of capturing
+    const bool inCheck = board.IsInCheck();
+
+    int32_t bestScore = -INFINITE_SCORE;
+    if (!inCheck) {
+        bestScore = board.Evaluate();
+        if (bestScore >= beta)
+            return bestScore;
+        alpha = std::max(alpha, bestScore);
+    }
+
+    MoveList moves;
+    board.GenerateLegalMoves(moves);
+
+    if (inCheck && moves.Size == 0)
+        return -MATE_SCORE + ply;
+
+    std::array<int32_t, 256> scores;
+    ScoreMoves(worker, moves, scores, LongAlgebraicMove(), ply);
+
+    UndoInfo undo;
+    for (size_t i = 0; i < moves.Size; i++) {
+        PickMove(moves, scores, i);
+        const LongAlgebraicMove m = moves[i];
+
+        if (!inCheck && !IsCapture(board, m) && m.Promotion != Queen)
+            continue;
+
+        board.MakeMove(m, undo);
+        int32_t score = -Quiescence(worker, -beta, -alpha, ply + 1);
+        board.UnmakeMove(undo);
+
+        if (m_Stop)
+            return 0;
+
+        if (score > bestScore) {
+            bestScore = score;
+
+            if (score > alpha) {
+                alpha = score;
+                UpdatePrincipalVariation(worker, m, ply);
+
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+
+    return bestScore;
+}
+
+void Search::ScoreMoves(const Worker& worker, const MoveList& moves, std::array<int32_t, 256>& scores, LongAlgebraicMove tableMove, int32_t ply) const {
+    const Board& board = worker.Position;
+
+    for (size_t i = 0; i < moves.Size; i++) {
+        const LongAlgebraicMove m = moves[i];
+
+        if (m == tableMove && m.SourceSquare != m.DestinationSquare) {
+            scores[i] = TABLE_MOVE_SCORE;
+        } else if (IsCapture(board, m)) {
+            // En passant captures have no piece on the destination square
+            Piece victim = board[m.DestinationSquare];
+            int32_t victimValue = Evaluation::MidgameValues[victim == Piece::None ? Pawn : GetPieceType(victim)];
+            scores[i] = CAPTURE_SCORE + victimValue * 8 - GetPieceType(board[m.SourceSquare]);
+        } else if (m.Promotion == Queen) {
+            scores[i] = PROMOTION_SCORE;
+        } else if (m == worker.Killers[ply][0]) {
+            scores[i] = KILLER_SCORE + 1;
+        } else if (m == worker.Killers[ply][1]) {
+            scores[i] = KILLER_SCORE;
+        } else {
+            scores[i] = worker.History[m.SourceSquare][m.DestinationSquare];
+        }
+
+        // Underpromotions are almost never good
+        if (m.Promotion != Pawn && m.Promotion != Queen)
+            scores[i] -= PROMOTION_SCORE;
+    }
+}
+
+void Search::UpdatePrincipalVariation(Worker& worker, LongAlgebraicMove move, int32_t ply) const {
+    auto& line = worker.PrincipalVariation[ply];
+    const auto& childLine = worker.PrincipalVariation[ply + 1];
+    const int32_t childLength = std::max(worker.PrincipalVariationLength[ply + 1], ply + 1);
+
+    line[ply] = move;
+    for (int32_t i = ply + 1; i < childLength; i++)
+        line[i] = childLine[i];
+
+    worker.PrincipalVariationLength[ply] = childLength;
+}
+
+bool Search::IsRepetition(const Worker& worker) const {
+    // A position can only repeat after both players have made at least two moves,
+    // and not across a pawn move or capture
+    const size_t size = worker.Positions.size();
+    const size_t limit = std::min<size_t>(worker.Position.GetHalfMoves(), size - 1);
+    const uint64_t hash = worker.Positions.back();
+
+    for (size_t i = 4; i <= limit; i += 2) {
+        if (worker.Positions[size - 1 - i] == hash)
+            return true;
+    }
+
+    return false;
+}
+
+bool Search::ShouldStop(Worker& worker) {
+    uint64_t nodes = worker.Nodes.load(std::memory_order_relaxed) + 1;
+    worker.Nodes.store(nodes, std::memory_order_relaxed);
+
+    // Only the main thread checks the limits, every 1024 nodes
+    if (worker.Id == 0 && (nodes & 1023) == 0) {
+        if (m_Limits.Nodes != 0 && GetNodes() >= m_Limits.Nodes)
+            m_Stop = true;
+
+        if (m_Limits.MoveTime.count() != 0 && GetElapsedTime() >= m_Limits.MoveTime)
+            m_Stop = true;
+    }
+
+    return m_Stop.load(std::memory_order_relaxed);
+}
+
+Engine::BestContinuation Search::MakeContinuation(const Worker& worker, int32_t score, int32_t depth) const {
+    Engine::BestContinuation continuation;
+    continuation.Depth = depth;
+
+    const auto& line = worker.PrincipalVariation[0];
+    continuation.Continuation.assign(line.begin(), line.begin() + worker.PrincipalVariationLength[0]);
+
+    if (continuation.Continuation.size() > 1)
+        continuation.PonderMove = continuation.Continuation[1];
+
+    // Mate scores are converted to moves (not plies) like UCI
+    if (score > MATE_BOUND) {
+        continuation.Mate = true;
+        continuation.Score = (MATE_SCORE - score + 1) / 2;
+    } else if (score < -MATE_BOUND) {
+        continuation.Mate = true;
+        continuation.Score = -(MATE_SCORE + score) / 2;
+    } else {
+        continuation.Score = score;
+    }
+
+    return continuation;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Engine.h"
+#include "TranspositionTable.h"
+
+#include "Chess/Board.h"
+
+// Alpha-beta search that runs in this process
+//
+// Iterative deepening with a transposition table and a quiescence search.
+// Extra threads search the same position and share the transposition table
+// (Lazy SMP): https://www.chessprogramming.org/Lazy_SMP
+class Search {
+public:
+    static constexpr int32_t MAX_PLY = 128;
+    static constexpr int32_t MATE_SCORE = 32000;
+    static constexpr int32_t INFINITE_SCORE = 32001;
+
+    struct Limits {
+        int32_t Depth = MAX_PLY - 1;
+        uint64_t Nodes = 0;                       // 0 means no limit
+        std::chrono::milliseconds MoveTime{ 0 };  // 0 means no limit
+    };
+
+    Search(size_t hashSizeMB = 16, uint32_t threads = 1);
+    ~Search();
+
+    Search(const Search&) = delete;
+    Search(Search&&) = delete;
+
+    Search& operator=(const Search&) = delete;
+    Search& operator=(Search&&) = delete;
+
+    // These stop the current search
+    void SetThreads(uint32_t threads);
+    void SetHashSize(size_t megabytes);
+    void ClearHash();
+
+    uint32_t GetThreads() const { return m_ThreadCount; }
+
+    // Starts searching on other threads and returns immediately
+    void Start(const Board& position, const Limits& limits);
+    // Stops the search and waits for the threads to finish
+    void Stop();
+    // Waits until the search reaches its limits
+    void Wait();
+
+    bool IsSearching() const { return m_Searching; }
+
+    // Blocks until the search reaches its limits, then returns the result
+    Engine::BestContinuation Run(const Board& position, const Limits& limits);
+
+    Engine::BestContinuation GetBestContinuation() const;
+    uint64_t GetNodes() const;
+    std::chrono::milliseconds GetElapsedTime() const;
+
+    // Called from the search thread after every completed depth
+    // Note: Stop() and Wait() must not be called from the callbacks
+    void SetUpdateCallback(const std::function<void(const Engine::BestContinuation&)>& callback) { m_UpdateCallback = callback; }
+    // Called from the search thread when the search is finished
+    void SetFinishCallback(const std::function<void(const Engine::BestContinuation&)>& callback) { m_FinishCallback = callback; }
+private:
+    struct Worker {
+        uint32_t Id = 0;
+
+        Board Position;
+
+        // Hashes of the positions since the start of the search (for repetitions)
+        std::vector<uint64_t> Positions;
+
+        std::array<std::array<LongAlgebraicMove, 2>, MAX_PLY> Killers;
+        std::array<std::array<int32_t, 64>, 64> History;
+
+        // Triangular principal variation table
+        std::array<std::array<LongAlgebraicMove, MAX_PLY>, MAX_PLY> PrincipalVariation;
+        std::array<int32_t, MAX_PLY> PrincipalVariationLength;
+
+        std::atomic<uint64_t> Nodes = 0;
+    };
+
+    void IterativeDeepening(Worker& worker);
+    int32_t AlphaBeta(Worker& worker, int32_t alpha, int32_t beta, int32_t depth, int32_t ply);
+    int32_t Quiescence(Worker& worker, int32_t alpha, int32_t beta, int32_t ply);
+
+    void ScoreMoves(const Worker& worker, const MoveList& moves, std::array<int32_t, 256>& scores, LongAlgebraicMove tableMove, int32_t ply) const;
+    void UpdatePrincipalVariation(Worker& worker, LongAlgebraicMove move, int32_t ply) const;
+
+    bool IsRepetition(const Worker& worker) const;
+    bool ShouldStop(Worker& worker);
+
+    Engine::BestContinuation MakeContinuation(const Worker& worker, int32_t score, int32_t depth) const;
+private:
+    TranspositionTable m_Table;
+
+    uint32_t m_ThreadCount;
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+    std::thread m_MainThread;
+
+    Limits m_Limits;
+    std::chrono::steady_clock::time_point m_StartTime;
+
+    std::atomic<bool> m_Stop = false;
+    std::atomic<bool> m_Searching = false;
+
+    mutable std::mutex m_ResultMutex;
+    Engine::BestContinuation m_Result;
+
+    std::function<void(const Engine::BestContinuation&)> m_UpdateCallback;
+    std::function<void(const Engine::BestContinuation&)> m_FinishCallback;
+};
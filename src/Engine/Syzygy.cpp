@@ -0,0 +1,963 @@
+#include "Syzygy.h"
+
+#include "Chess/PseudoLegal.h"
+#include "Utility/MappedFile.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace Syzygy {
+
+    // ---------------- File format helpers ----------------
+
+    enum TableFlag : uint8_t {
+        SideToMove  = 1,
+        Mapped      = 2,
+        WinPlies    = 4,
+        LossPlies   = 8,
+        Wide        = 16,
+        SingleValue = 128
+    };
+
+    // The files store pieces as 1-6 for White (pawn to king) and 9-14 for Black,
+    // which is the Piece enum plus 1
+    static uint8_t ToFilePiece(Piece p) { return (uint8_t)p + 1; }
+
+    static uint16_t ReadLittleEndian16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    static uint32_t ReadLittleEndian32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+    static uint32_t ReadBigEndian32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+    static uint64_t ReadBigEndian64(const uint8_t* p) { return ((uint64_t)ReadBigEndian32(p) << 32) | ReadBigEndian32(p + 4); }
+
+    static const uint8_t* AlignTo(const uint8_t* p, uintptr_t alignment) {
+        return (const uint8_t*)(((uintptr_t)p + alignment - 1) & ~(alignment - 1));
+    }
+
+    static Square FlipFile(Square s) { return s ^ 7; }
+    static Square FlipRank(Square s) { return s ^ 56; }
+    // Negative below the a1-h8 diagonal, 0 on it and positive above it
+    static int32_t OffDiagonal(Square s) { return (int32_t)RankOf(s) - (int32_t)FileOf(s); }
+
+    // ---------------- Index encoding tables ----------------
+
+    struct Encoding {
+        std::array<int32_t, 64> MapPawns{};
+        std::array<int32_t, 64> MapB1H1H7{};
+        std::array<int32_t, 64> MapA1D1D4{};
+        std::array<std::array<int32_t, 64>, 10> MapKK{};
+
+        std::array<std::array<int32_t, 64>, 6> Binomial{};       // [k][n]: ways to choose k of n
+        std::array<std::array<int32_t, 64>, 6> LeadPawnIndex{};  // [lead pawn count][square]
+        std::array<std::array<int32_t, 4>, 6> LeadPawnsSize{};   // [lead pawn count][file a-d]
+
+        Encoding() {
+            // MapB1H1H7 numbers the squares below the a1-h8 diagonal 0..27
+            int32_t code = 0;
+            for (Square s = 0; s < 64; s++)
+                if (OffDiagonal(s) < 0)
+                    MapB1H1H7[s] = code++;
+
+            // MapA1D1D4 numbers the a1-d1-d4 triangle 0..9, with the diagonal last
+            std::vector<Square> diagonal;
+            code = 0;
+            for (Square s = A1; s <= D4; s++) {
+                if (OffDiagonal(s) < 0 && FileOf(s) <= 3)
+                    MapA1D1D4[s] = code++;
+                else if (OffDiagonal(s) == 0 && FileOf(s) <= 3)
+                    diagonal.push_back(s);
+            }
+
+            for (Square s : diagonal)
+                MapA1D1D4[s] = code++;
+
+            // MapKK numbers the 462 legal placements of two kings with the first in the a1-d1-d4 triangle
+            // (if the first king is on the diagonal, the second can't be above it)
+            std::vector<std::pair<int32_t, Square>> bothOnDiagonal;
+            code = 0;
+            for (int32_t index = 0; index < 10; index++) {
+                for (Square s1 = A1; s1 <= D4; s1++) {
+                    if (MapA1D1D4[s1] != index || (index == 0 && s1 != B1))
+                        continue;
+
+                    for (Square s2 = 0; s2 < 64; s2++) {
+                        if ((PseudoLegal::KingAttack(s1) | (1ull << s1)) & (1ull << s2))
+                            continue;  // Illegal
+                        else if (OffDiagonal(s1) == 0 && OffDiagonal(s2) > 0)
+                            continue;  // First on the diagonal, second above it
+                        else if (OffDiagonal(s1) == 0 && OffDiagonal(s2) == 0)
+                            bothOnDiagonal.emplace_back(index, s2);
+                        else
+                            MapKK[index][s2] = code++;
+                    }
+                }
+            }
+
+            for (auto [index, s] : bothOnDiagonal)
+                MapKK[index][s] = code++;
+
+            Binomial[0][0] = 1;
+            for (int32_t n = 1; n < 64; n++)
+                for (int32_t k = 0; k < 6 && k <= n; k++)
+                    Binomial[k][n] = (k > 0 ? Binomial[k - 1][n - 1] : 0) + (k < n ? Binomial[k][n - 1] : 0);
+
+            // MapPawns numbers a2-h7 so that the leading pawn (closest to the edge, then lowest rank) is the highest
+            int32_t availableSquares = 47;
+            for (int32_t leadPawnCount = 1; leadPawnCount <= 5; leadPawnCount++) {
+                for (Square file = 0; file < 4; file++) {
+                    int32_t index = 0;
+
+                    for (Square rank = 1; rank <= 6; rank++) {
+                        Square s = rank * 8 + file;
+
+                        if (leadPawnCount == 1) {
+                            MapPawns[s] = availableSquares--;
+                            MapPawns[FlipFile(s)] = availableSquares--;
+                        }
+
+                        LeadPawnIndex[leadPawnCount][s] = index;
+                        index += Binomial[leadPawnCount - 1][MapPawns[s]];
+                    }
+
+                    LeadPawnsSize[leadPawnCount][file] = index;
+                }
+            }
+        }
+    };
+
+    static const Encoding& GetEncoding() {
+        static const Encoding s_Encoding;
+        return s_Encoding;
+    }
+
+    // ---------------- Tables ----------------
+
+    using Symbol = uint16_t;
+
+    // Decompression and indexing data of one sub-table
+    // (WDL files have one for each player to move, files with pawns have one for each file of the leading pawn)
+    struct PairsData {
+        uint8_t Flags = 0;
+        uint8_t MaxSymbolLength = 0;
+        uint8_t MinSymbolLength = 0;      // Also the value if the flags have SingleValue
+        uint32_t BlockCount = 0;
+        size_t BlockSize = 0;
+        size_t Span = 0;                  // There is a sparse index entry about every 'Span' values
+        const uint8_t* LowestSymbol = nullptr;   // u16 for each symbol length
+        const uint8_t* SymbolTree = nullptr;     // 3 bytes for each symbol: left and right 12 bit symbols
+        const uint8_t* BlockLengths = nullptr;   // u16 for each block: number of values - 1
+        uint32_t BlockLengthsSize = 0;
+        const uint8_t* SparseIndex = nullptr;    // 6 bytes for each entry: block (u32) and offset (u16)
+        size_t SparseIndexSize = 0;
+        const uint8_t* Data = nullptr;           // Huffman coded blocks
+        std::vector<uint64_t> Base64;            // Lowest symbol of each length, left aligned to 64 bits
+        std::vector<uint8_t> SymbolLength;       // Number of values - 1 that a symbol expands to
+        std::array<uint8_t, Tablebases::MAX_PIECES> Pieces{};
+        std::array<uint64_t, Tablebases::MAX_PIECES + 1> GroupIndex{};
+        std::array<int32_t, Tablebases::MAX_PIECES + 1> GroupLength{};
+        std::array<uint16_t, 4> MapIndex{};      // DTZ only: win, loss, cursed win, blessed loss
+
+        Symbol Left(Symbol s) const { const uint8_t* lr = SymbolTree + 3 * s; return (Symbol)(((lr[1] & 0xF) << 8) | lr[0]); }
+        Symbol Right(Symbol s) const { const uint8_t* lr = SymbolTree + 3 * s; return (Symbol)((lr[2] << 4) | (lr[1] >> 4)); }
+    };
+
+    struct Table {
+        std::atomic<bool> Ready = false;
+        MappedFile File;
+        const uint8_t* Map = nullptr;  // DTZ only: value remapping
+        std::array<std::array<PairsData, 4>, 2> Items;  // [player to move][file of the leading pawn]
+    };
+
+}
+
+struct Syzygy::Tablebases::TableEntry {
+    std::string Name;  // ex. "KRvK"
+    uint64_t Key;      // Material key with the first side of the name as White
+    uint64_t Key2;     // Material key with the first side of the name as Black
+    int32_t PieceCount;
+    bool HasPawns;
+    bool HasUniquePieces;
+    std::array<uint8_t, 2> PawnCount;  // [leading colour, other colour]
+
+    Table WDL, DTZ;
+
+    PairsData& Get(bool dtz, int32_t stm, int32_t file) {
+        return dtz ? DTZ.Items[0][HasPawns ? file : 0] : WDL.Items[stm % 2][HasPawns ? file : 0];
+    }
+};
+
+namespace Syzygy {
+
+    // 4 bits for the number of each piece, White first
+    static uint64_t MaterialKey(const std::array<std::array<int32_t, PieceTypeCount>, ColourCount>& counts) {
+        uint64_t key = 0;
+        for (uint8_t c = White; c < ColourCount; c++)
+            for (uint8_t t = Pawn; t < PieceTypeCount; t++)
+                key |= (uint64_t)counts[c][t] << (4 * (c * PieceTypeCount + t));
+        return key;
+    }
+
+    static uint64_t MaterialKey(const Board& board) {
+        std::array<std::array<int32_t, PieceTypeCount>, ColourCount> counts;
+        for (uint8_t c = White; c < ColourCount; c++)
+            for (uint8_t t = Pawn; t < PieceTypeCount; t++)
+                counts[c][t] = (int32_t)SquareCount(board.GetPieceBitBoard((PieceType)t) & board.GetColourBitBoard((Colour)c));
+        return MaterialKey(counts);
+    }
+
+    static bool IsCapture(const Board& board, LongAlgebraicMove m) {
+        return board[m.DestinationSquare] != Piece::None ||
+            (GetPieceType(board[m.SourceSquare]) == Pawn && FileOf(m.SourceSquare) != FileOf(m.DestinationSquare));
+    }
+
+    static WDL Negate(WDL wdl) { return (WDL)(-(int8_t)wdl); }
+
+    // DTZ of the move before a capture or pawn move, given the result after it
+    static int32_t DTZBeforeZeroing(WDL wdl) {
+        switch (wdl) {
+            case WDL::Win:         return 1;
+            case WDL::CursedWin:   return 101;
+            case WDL::BlessedLoss: return -101;
+            case WDL::Loss:        return -1;
+            default:               return 0;
+        }
+    }
+
+    template<typename T>
+    static int32_t SignOf(T value) { return (T(0) < value) - (value < T(0)); }
+
+    // ---------------- Decompression ----------------
+
+    // The values are compressed with "Recursive Pairing" (a symbol stands for a pair of symbols),
+    // then coded with a canonical Huffman code in blocks that each hold up to 65536 values
+    static int32_t DecompressPairs(const PairsData& d, uint64_t index) {
+        if (d.Flags & SingleValue)
+            return d.MinSymbolLength;
+
+        // Find the block with the value, starting from the nearest sparse index entry
+        // Entry k points to the value at index k * Span + Span / 2
+        uint32_t k = (uint32_t)(index / d.Span);
+
+        uint32_t block = ReadLittleEndian32(d.SparseIndex + 6 * k);
+        int32_t offset = ReadLittleEndian16(d.SparseIndex + 6 * k + 4);
+
+        offset += (int32_t)(index % d.Span) - (int32_t)(d.Span / 2);
+
+        while (offset < 0)
+            offset += ReadLittleEndian16(d.BlockLengths + 2 * --block) + 1;
+
+        while (offset > ReadLittleEndian16(d.BlockLengths + 2 * block))
+            offset -= ReadLittleEndian16(d.BlockLengths + 2 * block++) + 1;
+
+        // Read symbols from the start of the block until reaching the one that covers 'offset'
+        const uint8_t* pointer = d.Data + (uint64_t)block * d.BlockSize;
+
+        uint64_t buffer = ReadBigEndian64(pointer);
+        pointer += 8;
+        int32_t bufferSize = 64;
+
+        Symbol symbol;
+        while (true) {
+            // Longer codes have lower values
+            size_t length = 0;
+            while (buffer < d.Base64[length])
+                length++;
+
+            symbol = (Symbol)((buffer - d.Base64[length]) >> (64 - length - d.MinSymbolLength));
+            symbol += ReadLittleEndian16(d.LowestSymbol + 2 * length);
+
+            if (offset < d.SymbolLength[symbol] + 1)
+                break;
+
+            offset -= d.SymbolLength[symbol] + 1;
+            length += d.MinSymbolLength;
+            buffer <<= length;
+            bufferSize -= (int32_t)length;
+
+            if (bufferSize <= 32) {
+                bufferSize += 32;
+                buffer |= (uint64_t)ReadBigEndian32(pointer) << (64 - bufferSize);
+                pointer += 4;
+            }
+        }
+
+        // Expand the pairs until reaching a single value
+        while (d.SymbolLength[symbol]) {
+            Symbol left = d.Left(symbol);
+
+            if (offset < d.SymbolLength[left] + 1) {
+                symbol = left;
+            } else {
+                offset -= d.SymbolLength[left] + 1;
+                symbol = d.Right(symbol);
+            }
+        }
+
+        return d.Left(symbol);
+    }
+
+    // ---------------- Table setup ----------------
+
+    // Pieces of the same type and colour are encoded together, and the leading group
+    // is either the leading pawns, three unique pieces (including the kings) or the two kings
+    // ex. KRvKN -> KRK + N, KNNvK -> KK + NN, KPPvKP -> P + PP + K + K
+    static void SetGroups(const Tablebases::TableEntry& e, PairsData& d, const int32_t order[2], int32_t file) {
+        const Encoding& encoding = GetEncoding();
+
+        int32_t n = 0;
+        int32_t firstLength = e.HasPawns ? 0 : e.HasUniquePieces ? 3 : 2;
+        d.GroupLength[n] = 1;
+
+        for (int32_t i = 1; i < e.PieceCount; i++) {
+            if (--firstLength > 0 || d.Pieces[i] == d.Pieces[i - 1])
+                d.GroupLength[n]++;
+            else
+                d.GroupLength[++n] = 1;
+        }
+
+        d.GroupLength[++n] = 0;
+
+        // The groups are combined in the order given by the file, the leading group at order[0]
+        // and the other pawns (if both players have pawns) at order[1]
+        const bool pawnsOnBothSides = e.HasPawns && e.PawnCount[1];
+        int32_t next = pawnsOnBothSides ? 2 : 1;
+        int32_t freeSquares = 64 - d.GroupLength[0] - (pawnsOnBothSides ? d.GroupLength[1] : 0);
+        uint64_t index = 1;
+
+        for (int32_t k = 0; next < n || k == order[0] || k == order[1]; k++) {
+            if (k == order[0]) {
+                d.GroupIndex[0] = index;
+                index *= e.HasPawns ? encoding.LeadPawnsSize[d.GroupLength[0]][file] : e.HasUniquePieces ? 31332 : 462;
+            } else if (k == order[1]) {
+                d.GroupIndex[1] = index;
+                index *= encoding.Binomial[d.GroupLength[1]][48 - d.GroupLength[0]];
+            } else {
+                d.GroupIndex[next] = index;
+                index *= encoding.Binomial[d.GroupLength[next]][freeSquares];
+                freeSquares -= d.GroupLength[next++];
+            }
+        }
+
+        d.GroupIndex[n] = index;
+    }
+
+    static uint8_t SetSymbolLength(PairsData& d, Symbol s, std::vector<bool>& visited) {
+        visited[s] = true;
+
+        Symbol right = d.Right(s);
+        if (right == 0xFFF)
+            return 0;
+
+        Symbol left = d.Left(s);
+
+        if (!visited[left])
+            d.SymbolLength[left] = SetSymbolLength(d, left, visited);
+
+        if (!visited[right])
+            d.SymbolLength[right] = SetSymbolLength(d, right, visited);
+
+        return d.SymbolLength[left] + d.SymbolLength[right] + 1;
+    }
+
+    static const uint8_t* SetSizes(PairsData& d, const uint8_t* data) {
+        d.Flags = *data++;
+
+        if (d.Flags & SingleValue) {
+            d.MinSymbolLength = *data++;
+            return data;
+        }
+
+        // The last group index is the size of the table
+        uint64_t tableSize = d.GroupIndex[std::find(d.GroupLength.begin(), d.GroupLength.end(), 0) - d.GroupLength.begin()];
+
+        d.BlockSize = (size_t)1 << *data++;
+        d.Span = (size_t)1 << *data++;
+        d.SparseIndexSize = (size_t)((tableSize + d.Span - 1) / d.Span);
+        uint8_t padding = *data++;
+        d.BlockCount = ReadLittleEndian32(data);
+        data += 4;
+        d.BlockLengthsSize = d.BlockCount + padding;  // So the sparse index can't point past the end
+        d.MaxSymbolLength = *data++;
+        d.MinSymbolLength = *data++;
+        d.LowestSymbol = data;
+        d.Base64.resize(d.MaxSymbolLength - d.MinSymbolLength + 1);
+
+        // Canonical Huffman code: longer codes have lower values
+        for (int32_t i = (int32_t)d.Base64.size() - 2; i >= 0; i--) {
+            d.Base64[i] = (d.Base64[i + 1] + ReadLittleEndian16(d.LowestSymbol + 2 * i) - ReadLittleEndian16(d.LowestSymbol + 2 * (i + 1))) / 2;
+        }
+
+        for (size_t i = 0; i < d.Base64.size(); i++)
+            d.Base64[i] <<= 64 - i - d.MinSymbolLength;
+
+        data += d.Base64.size() * sizeof(Symbol);
+        d.SymbolLength.resize(ReadLittleEndian16(data));
+        data += sizeof(uint16_t);
+        d.SymbolTree = data;
+
+        std::vector<bool> visited(d.SymbolLength.size());
+        for (Symbol s = 0; s < d.SymbolLength.size(); s++) {
+            if (!visited[s])
+                d.SymbolLength[s] = SetSymbolLength(d, s, visited);
+        }
+
+        return data + d.SymbolLength.size() * 3 + (d.SymbolLength.size() & 1);
+    }
+
+    static const uint8_t* SetDTZMap(Tablebases::TableEntry& e, const uint8_t* data, int32_t maxFile) {
+        e.DTZ.Map = data;
+
+        for (int32_t f = 0; f <= maxFile; f++) {
+            PairsData& d = e.Get(true, 0, f);
+            if (!(d.Flags & Mapped))
+                continue;
+
+            if (d.Flags & Wide) {
+                data = AlignTo(data, 2);
+                for (int32_t i = 0; i < 4; i++) {
+                    d.MapIndex[i] = (uint16_t)((data - e.DTZ.Map) / 2 + 1);
+                    data += 2 * ReadLittleEndian16(data) + 2;
+                }
+            } else {
+                for (int32_t i = 0; i < 4; i++) {
+                    d.MapIndex[i] = (uint16_t)(data - e.DTZ.Map + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+
+        return AlignTo(data, 2);
+    }
+
+    // Reads the headers of a newly mapped file
+    static void SetupTable(Tablebases::TableEntry& e, bool dtz, const uint8_t* data) {
+        data++;  // Flags (split, has pawns), which are known from the name
+
+        const int32_t sides = !dtz && e.Key != e.Key2 ? 2 : 1;
+        const int32_t maxFile = e.HasPawns ? 3 : 0;
+        const bool pawnsOnBothSides = e.HasPawns && e.PawnCount[1];
+
+        for (int32_t f = 0; f <= maxFile; f++) {
+            for (int32_t i = 0; i < sides; i++)
+                e.Get(dtz, i, f) = PairsData();
+
+            int32_t order[2][2] = {
+                { *data & 0xF, pawnsOnBothSides ? *(data + 1) & 0xF : 0xF },
+                { *data >> 4,  pawnsOnBothSides ? *(data + 1) >> 4  : 0xF }
+            };
+            data += 1 + pawnsOnBothSides;
+
+            for (int32_t k = 0; k < e.PieceCount; k++, data++)
+                for (int32_t i = 0; i < sides; i++)
+                    e.Get(dtz, i, f).Pieces[k] = i ? *data >> 4 : *data & 0xF;
+
+            for (int32_t i = 0; i < sides; i++)
+                SetGroups(e, e.Get(dtz, i, f), order[i], f);
+        }
+
+        data = AlignTo(data, 2);
+
+        for (int32_t f = 0; f <= maxFile; f++)
+            for (int32_t i = 0; i < sides; i++)
+                data = SetSizes(e.Get(dtz, i, f), data);
+
+        if (dtz)
+            data = SetDTZMap(e, data, maxFile);
+
+        for (int32_t f = 0; f <= maxFile; f++) {
+            for (int32_t i = 0; i < sides; i++) {
+                PairsData& d = e.Get(dtz, i, f);
+                d.SparseIndex = data;
+                data += d.SparseIndexSize * 6;
+            }
+        }
+
+        for (int32_t f = 0; f <= maxFile; f++) {
+            for (int32_t i = 0; i < sides; i++) {
+                PairsData& d = e.Get(dtz, i, f);
+                d.BlockLengths = data;
+                data += d.BlockLengthsSize * 2;
+            }
+        }
+
+        for (int32_t f = 0; f <= maxFile; f++) {
+            for (int32_t i = 0; i < sides; i++) {
+                PairsData& d = e.Get(dtz, i, f);
+                data = AlignTo(data, 64);
+                d.Data = data;
+                data += (size_t)d.BlockCount * d.BlockSize;
+            }
+        }
+    }
+
+    // Maps the file the first time it is needed (thread safe)
+    // Returns false if the file is missing or invalid
+    static bool MapTable(Tablebases::TableEntry& e, bool dtz, const std::vector<std::filesystem::path>& paths) {
+        static std::mutex s_Mutex;
+
+        Table& table = dtz ? e.DTZ : e.WDL;
+
+        if (table.Ready.load(std::memory_order_acquire))
+            return table.File.IsOpen();
+
+        std::lock_guard<std::mutex> lock(s_Mutex);
+
+        if (table.Ready.load(std::memory_order_relaxed))
+            return table.File.IsOpen();
+
+        static constexpr uint8_t s_Magics[2][4] = {
+            { 0x71, 0xE8, 0x23, 0x5D },  // WDL
+            { 0xD7, 0x66, 0x0C, 0xA5 }   // DTZ
+        };
+
+        const std::string fileName = e.Name + (dtz ? ".rtbz" : ".rtbw");
+        for (const std::filesystem::path& path : paths) {
+            if (!table.File.Open(path / fileName))
+                continue;
+
+            if (table.File.GetSize() > 4 && std::memcmp(table.File.GetData(), s_Magics[dtz], 4) == 0)
+                break;
+
+            table.File.Close();
+        }
+
+        if (table.File.IsOpen())
+            SetupTable(e, dtz, table.File.GetData() + 4);
+
+        table.Ready.store(true, std::memory_order_release);
+        return table.File.IsOpen();
+    }
+
+    // WDL values are stored as 0..4, DTZ values are remapped by frequency and may be stored in moves instead of plies
+    static int32_t MapScore(Tablebases::TableEntry& e, bool dtz, int32_t file, int32_t value, WDL wdl) {
+        if (!dtz)
+            return value - 2;
+
+        static constexpr int32_t s_WDLMap[] = { 1, 3, 0, 2, 0 };
+
+        const PairsData& d = e.Get(true, 0, file);
+        const uint8_t* map = e.DTZ.Map;
+        const uint16_t index = d.MapIndex[s_WDLMap[(int32_t)wdl + 2]];
+
+        if (d.Flags & Mapped) {
+            if (d.Flags & Wide)
+                value = ReadLittleEndian16(map + 2 * (index + value));
+            else
+                value = map[index + value];
+        }
+
+        if ((wdl == WDL::Win && !(d.Flags & WinPlies)) ||
+            (wdl == WDL::Loss && !(d.Flags & LossPlies)) ||
+            wdl == WDL::CursedWin || wdl == WDL::BlessedLoss)
+            value *= 2;
+
+        return value + 1;
+    }
+
+    // ---------------- Tablebases ----------------
+
+    Tablebases::Tablebases() = default;
+
+    Tablebases::Tablebases(const std::string& paths) {
+        Init(paths);
+    }
+
+    Tablebases::~Tablebases() = default;
+
+    void Tablebases::Init(const std::string& paths) {
+        m_Paths.clear();
+        m_Tables.clear();
+        m_Index.clear();
+        m_MaxPieces = 0;
+
+#if defined(_WIN32)
+        constexpr std::string_view separators = ";";
+#else
+        constexpr std::string_view separators = ":;";
+#endif
+
+        size_t begin = 0;
+        while (begin <= paths.size()) {
+            size_t end = std::min(paths.find_first_of(separators, begin), paths.size());
+            if (end > begin)
+                m_Paths.emplace_back(paths.substr(begin, end - begin));
+            begin = end + 1;
+        }
+
+        if (m_Paths.empty())
+            return;
+
+        // Every combination of pieces (in the order of the file names) with at most MAX_PIECES pieces
+        std::vector<std::string> sides = { "" };
+        for (size_t i = 0; i < sides.size(); i++) {
+            if (sides[i].size() + 1 >= MAX_PIECES - 1)
+                continue;
+
+            static constexpr std::string_view s_Pieces = "QRBNP";
+            size_t first = sides[i].empty() ? 0 : s_Pieces.find(sides[i].back());
+            for (size_t p = first; p < s_Pieces.size(); p++)
+                sides.push_back(sides[i] + s_Pieces[p]);
+        }
+
+        auto exists = [&](const std::string& name) {
+            for (const std::filesystem::path& path : m_Paths) {
+                std::error_code error;
+                if (std::filesystem::exists(path / (name + ".rtbw"), error))
+                    return true;
+            }
+            return false;
+        };
+
+        for (size_t i = 0; i < sides.size(); i++) {
+            for (size_t j = i; j < sides.size(); j++) {
+                const int32_t pieceCount = (int32_t)(2 + sides[i].size() + sides[j].size());
+                if (pieceCount < 3 || pieceCount > MAX_PIECES)
+                    continue;
+
+                std::string name = "K" + sides[j] + "vK" + sides[i];
+                if (!exists(name)) {
+                    name = "K" + sides[i] + "vK" + sides[j];
+                    if (!exists(name))
+                        continue;
+                }
+
+                auto entry = std::make_unique<TableEntry>();
+                entry->Name = name;
+                entry->PieceCount = pieceCount;
+
+                std::array<std::array<int32_t, PieceTypeCount>, ColourCount> counts{};
+                Colour colour = White;
+                for (char c : name) {
+                    if (c == 'v')
+                        colour = Black;
+                    else
+                        counts[colour][CharToPieceType(c)]++;
+                }
+
+                entry->Key = MaterialKey(counts);
+                std::swap(counts[White], counts[Black]);
+                entry->Key2 = MaterialKey(counts);
+                std::swap(counts[White], counts[Black]);
+
+                entry->HasPawns = counts[White][Pawn] + counts[Black][Pawn] > 0;
+                entry->HasUniquePieces = false;
+                for (uint8_t c = White; c < ColourCount; c++)
+                    for (uint8_t t = Pawn; t < King; t++)
+                        if (counts[c][t] == 1)
+                            entry->HasUniquePieces = true;
+
+                // The leading colour is the one with fewer pawns (but at least one)
+                const bool whiteLeads = counts[Black][Pawn] == 0 || (counts[White][Pawn] != 0 && counts[Black][Pawn] >= counts[White][Pawn]);
+                entry->PawnCount[0] = (uint8_t)counts[whiteLeads ? White : Black][Pawn];
+                entry->PawnCount[1] = (uint8_t)counts[whiteLeads ? Black : White][Pawn];
+
+                m_Index[entry->Key] = entry.get();
+                m_Index[entry->Key2] = entry.get();
+                m_MaxPieces = std::max(m_MaxPieces, pieceCount);
+                m_Tables.push_back(std::move(entry));
+            }
+        }
+    }
+
+    template<bool DTZ>
+    int32_t Tablebases::ProbeTable(const Board& board, ProbeResult& result, WDL wdl) const {
+        const BitBoard occupied = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+        if (SquareCount(occupied) == 2)
+            return (int32_t)WDL::Draw;  // KvK
+
+        const uint64_t key = MaterialKey(board);
+        auto it = m_Index.find(key);
+        if (it == m_Index.end() || !MapTable(*it->second, DTZ, m_Paths)) {
+            result = ProbeResult::Fail;
+            return 0;
+        }
+
+        TableEntry& entry = *it->second;
+        const Encoding& encoding = GetEncoding();
+
+        std::array<Square, MAX_PIECES> squares;
+        std::array<uint8_t, MAX_PIECES> pieces;
+        int32_t size = 0, leadPawnCount = 0;
+        BitBoard leadPawns = 0;
+        int32_t file = 0;
+        uint64_t index;
+
+        // The tables are stored with the first side of the name as White,
+        // and only White to move if both sides have the same pieces,
+        // otherwise the colours are swapped and the board is flipped
+        const bool symmetricBlackToMove = entry.Key == entry.Key2 && board.GetPlayerTurn() == Black;
+        const bool blackStronger = key != entry.Key;
+        const bool flip = symmetricBlackToMove || blackStronger;
+
+        const uint8_t flipColour = flip * 8;
+        const Square flipSquares = flip * 56;
+        const int32_t stm = flip ^ board.GetPlayerTurn();
+
+        auto pawnsCompare = [&](Square a, Square b) { return encoding.MapPawns[a] < encoding.MapPawns[b]; };
+
+        // Files with pawns have a table for each file (a-d) of the leading pawn,
+        // which is the one closest to the edge, then on the lowest rank
+        if (entry.HasPawns) {
+            const uint8_t pawn = entry.Get(DTZ, 0, 0).Pieces[0] ^ flipColour;
+            const Colour pawnColour = (Colour)((pawn - 1) >> 3);
+
+            leadPawns = board.GetPieceBitBoard(Pawn) & board.GetColourBitBoard(pawnColour);
+            for (BitBoard b = leadPawns; b != 0; b &= b - 1)
+                squares[size++] = GetSquare(b) ^ flipSquares;
+
+            leadPawnCount = size;
+
+            std::swap(squares[0], *std::max_element(squares.begin(), squares.begin() + leadPawnCount, pawnsCompare));
+
+            file = std::min<int32_t>(FileOf(squares[0]), 7 - FileOf(squares[0]));
+        }
+
+        // DTZ tables only store one player to move
+        if constexpr (DTZ) {
+            const uint8_t flags = entry.Get(true, stm, file).Flags;
+            if ((flags & SideToMove) != stm && !(entry.Key == entry.Key2 && !entry.HasPawns)) {
+                result = ProbeResult::ChangeSideToMove;
+                return 0;
+            }
+        }
+
+        for (BitBoard b = occupied & ~leadPawns; b != 0; b &= b - 1) {
+            Square s = GetSquare(b);
+            squares[size] = s ^ flipSquares;
+            pieces[size++] = ToFilePiece(board[s]) ^ flipColour;
+        }
+
+        const PairsData& d = entry.Get(DTZ, stm, file);
+
+        // Put the pieces in the order of the table
+        for (int32_t i = leadPawnCount; i < size - 1; i++) {
+            for (int32_t j = i + 1; j < size; j++) {
+                if (d.Pieces[i] == pieces[j]) {
+                    std::swap(pieces[i], pieces[j]);
+                    std::swap(squares[i], squares[j]);
+                    break;
+                }
+            }
+        }
+
+        // The leading piece goes on the queenside
+        if (FileOf(squares[0]) > 3)
+            for (int32_t i = 0; i < size; i++)
+                squares[i] = FlipFile(squares[i]);
+
+        if (entry.HasPawns) {
+            index = encoding.LeadPawnIndex[leadPawnCount][squares[0]];
+
+            std::stable_sort(squares.begin() + 1, squares.begin() + leadPawnCount, pawnsCompare);
+
+            for (int32_t i = 1; i < leadPawnCount; i++)
+                index += encoding.Binomial[i][encoding.MapPawns[squares[i]]];
+        } else {
+            // Without pawns, the leading piece also goes below the 5th rank and below the a1-h8 diagonal
+            if (RankOf(squares[0]) > 3)
+                for (int32_t i = 0; i < size; i++)
+                    squares[i] = FlipRank(squares[i]);
+
+            for (int32_t i = 0; i < d.GroupLength[0]; i++) {
+                if (!OffDiagonal(squares[i]))
+                    continue;
+
+                if (OffDiagonal(squares[i]) > 0)
+                    for (int32_t j = i; j < size; j++)
+                        squares[j] = (Square)(((squares[j] >> 3) | (squares[j] << 3)) & 63);
+                break;
+            }
+
+            if (entry.HasUniquePieces) {
+                // The first three pieces are encoded together
+                const int32_t adjust1 = squares[1] > squares[0];
+                const int32_t adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+                if (OffDiagonal(squares[0])) {
+                    index = ((uint64_t)encoding.MapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+                } else if (OffDiagonal(squares[1])) {
+                    index = ((uint64_t)6 * 63 + RankOf(squares[0]) * 28 + encoding.MapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+                } else if (OffDiagonal(squares[2])) {
+                    index = 6 * 63 * 62 + 4 * 28 * 62
+                        + RankOf(squares[0]) * 7 * 28
+                        + (RankOf(squares[1]) - adjust1) * 28
+                        + encoding.MapB1H1H7[squares[2]];
+                } else {
+                    index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                        + RankOf(squares[0]) * 7 * 6
+                        + (RankOf(squares[1]) - adjust1) * 6
+                        + (RankOf(squares[2]) - adjust2);
+                }
+            } else {
+                // Only the kings are encoded together
+                index = encoding.MapKK[encoding.MapA1D1D4[squares[0]]][squares[1]];
+            }
+        }
+
+        // The other groups, each sorted by square and skipping the squares taken by earlier groups
+        index *= d.GroupIndex[0];
+        Square* groupSquares = squares.data() + d.GroupLength[0];
+        bool remainingPawns = entry.HasPawns && entry.PawnCount[1];
+
+        for (int32_t next = 1; d.GroupLength[next]; next++) {
+            std::stable_sort(groupSquares, groupSquares + d.GroupLength[next]);
+
+            uint64_t n = 0;
+            for (int32_t i = 0; i < d.GroupLength[next]; i++) {
+                const int32_t adjust = (int32_t)std::count_if(squares.data(), groupSquares, [&](Square s) { return groupSquares[i] > s; });
+                n += encoding.Binomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+            }
+
+            remainingPawns = false;
+            index += n * d.GroupIndex[next];
+            groupSquares += d.GroupLength[next];
+        }
+
+        return MapScore(entry, DTZ, file, DecompressPairs(d, index), wdl);
+    }
+
+    // The tables store "don't care" values where the player to move has a winning capture
+    // (and where the best move is en passant), so captures have to be searched as well
+    // If 'checkZeroingMoves' then pawn moves are searched too (for DTZ)
+    WDL Tablebases::Search(Board& board, ProbeResult& result, bool checkZeroingMoves) const {
+        WDL value, bestValue = WDL::Loss;
+
+        MoveList moves;
+        board.GenerateLegalMoves(moves);
+
+        size_t moveCount = 0;
+        UndoInfo undo;
+        for (LongAlgebraicMove m : moves) {
+            if (!IsCapture(board, m) && (!checkZeroingMoves || GetPieceType(board[m.SourceSquare]) != Pawn))
+                continue;
+
+            moveCount++;
+
+            board.MakeMove(m, undo);
+            value = Negate(Search(board, result, false));
+            board.UnmakeMove(undo);
+
+            if (result == ProbeResult::Fail)
+                return WDL::Draw;
+
+            if (value > bestValue) {
+                bestValue = value;
+
+                if (value >= WDL::Win) {
+                    result = ProbeResult::ZeroingBestMove;
+                    return value;
+                }
+            }
+        }
+
+        // If every move was searched, the table doesn't need to be probed
+        // (and can't be trusted, ex. if en passant is possible)
+        const bool noMoreMoves = moveCount != 0 && moveCount == moves.Size;
+
+        if (noMoreMoves) {
+            value = bestValue;
+        } else {
+            value = (WDL)ProbeTable<false>(board, result, WDL::Draw);
+            if (result == ProbeResult::Fail)
+                return WDL::Draw;
+        }
+
+        if (bestValue >= value) {
+            result = bestValue > WDL::Draw || noMoreMoves ? ProbeResult::ZeroingBestMove : ProbeResult::Ok;
+            return bestValue;
+        }
+
+        result = ProbeResult::Ok;
+        return value;
+    }
+
+    int32_t Tablebases::ProbeDTZ(Board& board, ProbeResult& result) const {
+        result = ProbeResult::Ok;
+        const WDL wdl = Search(board, result, true);
+
+        if (result == ProbeResult::Fail || wdl == WDL::Draw)
+            return 0;
+
+        if (result == ProbeResult::ZeroingBestMove)
+            return DTZBeforeZeroing(wdl);
+
+        int32_t dtz = ProbeTable<true>(board, result, wdl);
+
+        if (result == ProbeResult::Fail)
+            return 0;
+
+        if (result != ProbeResult::ChangeSideToMove)
+            return (dtz + 100 * (wdl == WDL::BlessedLoss || wdl == WDL::CursedWin)) * SignOf((int32_t)wdl);
+
+        // The table stores the other player to move, so search one ply for the best DTZ
+        int32_t minDTZ = 0xFFFF;
+
+        MoveList moves;
+        board.GenerateLegalMoves(moves);
+
+        UndoInfo undo;
+        for (LongAlgebraicMove m : moves) {
+            const bool zeroing = IsCapture(board, m) || GetPieceType(board[m.SourceSquare]) == Pawn;
+
+            board.MakeMove(m, undo);
+
+            // For a zeroing move, the DTZ before the move is wanted
+            if (zeroing) {
+                result = ProbeResult::Ok;
+                dtz = -DTZBeforeZeroing(Search(board, result, false));
+            } else {
+                dtz = -ProbeDTZ(board, result);
+            }
+
+            // Checkmate
+            if (dtz == 1 && board.IsInCheck() && !board.HasLegalMoves(board.GetPlayerTurn()))
+                minDTZ = 1;
+
+            if (!zeroing)
+                dtz += SignOf(dtz);
+
+            if (dtz < minDTZ && SignOf(dtz) == SignOf((int32_t)wdl))
+                minDTZ = dtz;
+
+            board.UnmakeMove(undo);
+
+            if (result == ProbeResult::Fail)
+                return 0;
+        }
+
+        return minDTZ == 0xFFFF ? -1 : minDTZ;
+    }
+
+    std::optional<WDL> Tablebases::ProbeWDL(const Board& board) const {
+        const BitBoard occupied = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+        if ((int32_t)SquareCount(occupied) > m_MaxPieces || board.HasCastlingRights())
+            return std::nullopt;
+
+        Board position = board;
+        ProbeResult result = ProbeResult::Ok;
+        WDL wdl = Search(position, result, false);
+
+        if (result == ProbeResult::Fail)
+            return std::nullopt;
+
+        return wdl;
+    }
+
+    std::optional<int32_t> Tablebases::ProbeDTZ(const Board& board) const {
+        const BitBoard occupied = board.GetColourBitBoard(White) | board.GetColourBitBoard(Black);
+        if ((int32_t)SquareCount(occupied) > m_MaxPieces || board.HasCastlingRights())
+            return std::nullopt;
+
+        Board position = board;
+        ProbeResult result = ProbeResult::Ok;
+        int32_t dtz = ProbeDTZ(position, result);
+
+        if (result == ProbeResult::Fail)
+            return std::nullopt;
+
+        return dtz;
+    }
+
+}
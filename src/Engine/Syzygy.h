@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chess/Board.h"
+
+// Probes Syzygy endgame tablebases (.rtbw and .rtbz files)
+//
+// The files are memory mapped the first time a position needs them,
+// after that they can be probed from any number of threads at the same time
+// Source:
+// https://www.chessprogramming.org/Syzygy_Bases
+// The file format is decoded the same way as Ronald de Man's reference prober (tbprobe.c)
+namespace Syzygy {
+
+    // From the point of view of the player to move
+    enum class WDL : int8_t {
+        Loss = -2,
+        BlessedLoss = -1,  // Loss, but a draw because of the 50-move rule
+        Draw = 0,
+        CursedWin = 1,     // Win, but a draw because of the 50-move rule
+        Win = 2
+    };
+
+    class Tablebases {
+    public:
+        static constexpr int32_t MAX_PIECES = 7;
+
+        Tablebases();
+        Tablebases(const std::string& paths);
+
+        ~Tablebases();
+
+        Tablebases(const Tablebases&) = delete;
+        Tablebases& operator=(const Tablebases&) = delete;
+
+        // 'paths' is a list of directories separated by ';' (or ':' on Unix)
+        // Only checks which tables exist, they are loaded when probed
+        // Not thread safe
+        void Init(const std::string& paths);
+
+        size_t GetTableCount() const { return m_Tables.size(); }
+        // The most pieces (including kings) of the tables found
+        int32_t GetMaxPieces() const { return m_MaxPieces; }
+
+        // Returns std::nullopt if the table is missing, there are too many pieces or castling is possible
+        std::optional<WDL> ProbeWDL(const Board& board) const;
+
+        // Distance (in plies) to the next capture or pawn move that keeps the result,
+        // from the point of view of the player to move
+        // Returns std::nullopt in the same cases as ProbeWDL()
+        //
+        //         n < -100 : loss, but draw under the 50-move rule
+        // -100 <= n < -1   : loss in n plies (assuming the 50-move counter is 0)
+        //        -1        : loss, the player to move is checkmated
+        //         0        : draw
+        //     1 < n <= 100 : win in n plies (assuming the 50-move counter is 0)
+        //   100 < n        : win, but draw under the 50-move rule
+        //
+        // The value can be off by one ply, except right after a capture or pawn move
+        std::optional<int32_t> ProbeDTZ(const Board& board) const;
+
+        struct TableEntry;
+    private:
+        enum class ProbeResult {
+            Fail,
+            Ok,
+            ChangeSideToMove,  // The DTZ table only stores the other player to move
+            ZeroingBestMove    // The best move is a capture or pawn move, so the DTZ table can't be used
+        };
+
+        WDL Search(Board& board, ProbeResult& result, bool checkZeroingMoves) const;
+        int32_t ProbeDTZ(Board& board, ProbeResult& result) const;
+
+        template<bool DTZ>
+        int32_t ProbeTable(const Board& board, ProbeResult& result, WDL wdl) const;
+    private:
+        std::vector<std::filesystem::path> m_Paths;
+
+        std::vector<std::unique_ptr<TableEntry>> m_Tables;
+        std::unordered_map<uint64_t, TableEntry*> m_Index;  // Both material keys of each table
+
+        int32_t m_MaxPieces = 0;
+    };
+
+}
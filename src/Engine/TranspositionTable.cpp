@@ -0,0 +1,71 @@
+#include "TranspositionTable.h"
+
+void TranspositionTable::Resize(size_t megabytes) {
+    // Round down to a power of 2 so the key can be masked instead of using modulo
+    size_t size = 1;
+    while (size * 2 * sizeof(Slot) <= megabytes * 1024 * 1024)
+        size *= 2;
+
+    m_Slots = std::make_unique<Slot[]>(size);
+    m_Size = size;
+
+    Clear();
+}
+
+void TranspositionTable::Clear() {
+    for (size_t i = 0; i < m_Size; i++) {
+        m_Slots[i].Key.store(0, std::memory_order_relaxed);
+        m_Slots[i].Data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::Probe(uint64_t key, Entry& entry) const {
+    const Slot& slot = m_Slots[key & (m_Size - 1)];
+
+    uint64_t data = slot.Data.load(std::memory_order_relaxed);
+    if ((slot.Key.load(std::memory_order_relaxed) ^ data) != key)
+        return false;
+
+    entry = Unpack(data);
+    return entry.Bound != BoundType::None;
+}
+
+void TranspositionTable::Store(uint64_t key, const Entry& entry) {
+    Slot& slot = m_Slots[key & (m_Size - 1)];
+
+    // Keep deeper results of the same position, unless the new result is exact
+    uint64_t oldData = slot.Data.load(std::memory_order_relaxed);
+    if ((slot.Key.load(std::memory_order_relaxed) ^ oldData) == key) {
+        Entry old = Unpack(oldData);
+        if (old.Depth > entry.Depth && entry.Bound != BoundType::Exact)
+            return;
+    }
+
+    uint64_t data = Pack(entry);
+    slot.Key.store(key ^ data, std::memory_order_relaxed);
+    slot.Data.store(data, std::memory_order_relaxed);
+}
+
+// Layout (least significant bit first):
+// source square (6 bits), destination square (6 bits), promotion (3 bits),
+// score (16 bits), depth (8 bits), bound (2 bits)
+uint64_t TranspositionTable::Pack(const Entry& entry) {
+    uint64_t data = entry.Move.SourceSquare;
+    data |= (uint64_t)entry.Move.DestinationSquare << 6;
+    data |= (uint64_t)entry.Move.Promotion << 12;
+    data |= (uint64_t)(uint16_t)entry.Score << 15;
+    data |= (uint64_t)(uint8_t)entry.Depth << 31;
+    data |= (uint64_t)entry.Bound << 39;
+    return data;
+}
+
+TranspositionTable::Entry TranspositionTable::Unpack(uint64_t data) {
+    Entry entry;
+    entry.Move.SourceSquare = data & 0x3F;
+    entry.Move.DestinationSquare = (data >> 6) & 0x3F;
+    entry.Move.Promotion = (PieceType)((data >> 12) & 0x7);
+    entry.Score = (int16_t)(uint16_t)(data >> 15);
+    entry.Depth = (int8_t)(uint8_t)(data >> 31);
+    entry.Bound = (BoundType)((data >> 39) & 0x3);
+    return entry;
+}
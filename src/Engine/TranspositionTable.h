@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "Chess/Move.h"
+
+// Hash table of search results shared by all search threads
+//
+// Each slot stores the key XORed with the data, so a slot that was
+// torn by two threads writing at the same time is seen as a miss
+// instead of being read as another position's data (no locks needed)
+// Source:
+// https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+class TranspositionTable {
+public:
+    enum class BoundType : uint8_t {
+        None,
+        Upper,  // Score is at most 'Score' (failed low)
+        Lower,  // Score is at least 'Score' (failed high)
+        Exact
+    };
+
+    struct Entry {
+        LongAlgebraicMove Move;
+        int16_t Score = 0;
+        int8_t Depth = 0;
+        BoundType Bound = BoundType::None;
+    };
+
+    TranspositionTable(size_t megabytes = 16) { Resize(megabytes); }
+
+    void Resize(size_t megabytes);
+    void Clear();
+
+    size_t GetSizeMB() const { return m_Size * sizeof(Slot) / (1024 * 1024); }
+
+    // Returns false if the position is not in the table
+    bool Probe(uint64_t key, Entry& entry) const;
+    void Store(uint64_t key, const Entry& entry);
+private:
+    struct Slot {
+        std::atomic<uint64_t> Key;
+        std::atomic<uint64_t> Data;
+    };
+
+    static uint64_t Pack(const Entry& entry);
+    static Entry Unpack(uint64_t data);
+
+    std::unique_ptr<Slot[]> m_Slots;
+    size_t m_Size = 0;  // Always a power of 2
+};
@@ -0,0 +1,48 @@
+#include "Utility/MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat status;
+    if (fstat(fd, &status) == -1) {
+        close(fd);
+        return false;
+    }
+
+    m_Size = (size_t)status.st_size;
+
+    if (m_Size != 0) {
+        void* data = mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            m_Size = 0;
+            return false;
+        }
+
+        m_Data = (const uint8_t*)data;
+    }
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+
+    m_Open = true;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_Data)
+        munmap((void*)m_Data, m_Size);
+
+    m_Open = false;
+    m_Data = nullptr;
+    m_Size = 0;
+}
@@ -0,0 +1,57 @@
+#include "Utility/MappedFile.h"
+
+#include <Windows.h>
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_Size = (size_t)size.QuadPart;
+
+    if (m_Size != 0) {
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            CloseHandle(file);
+            m_Size = 0;
+            return false;
+        }
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == NULL) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            m_Size = 0;
+            return false;
+        }
+
+        m_Handle = mapping;
+        m_Data = (const uint8_t*)data;
+    }
+
+    // The mapping stays valid after the file is closed
+    CloseHandle(file);
+
+    m_Open = true;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_Handle)
+        CloseHandle((HANDLE)m_Handle);
+
+    m_Open = false;
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Handle = nullptr;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// A queue between threads that holds at most 'capacity' items
+// Push() waits while the queue is full, so a fast producer is slowed down to the speed of the consumers
+// The time spent waiting is added to the 'waited' arguments (in seconds), for finding which thread is the bottleneck
+template<typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity) : m_Capacity(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Returns false (without adding the item) if the queue was closed
+    bool Push(T&& item, double* waited = nullptr) {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+
+        if (m_Items.size() >= m_Capacity && !m_Closed)
+            Wait(m_NotFull, lock, [this]() { return m_Items.size() < m_Capacity || m_Closed; }, waited);
+
+        if (m_Closed)
+            return false;
+
+        m_Items.push_back(std::move(item));
+        lock.unlock();
+        m_NotEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false when the queue is closed and empty
+    bool Pop(T& item, double* waited = nullptr) {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+
+        if (m_Items.empty() && !m_Closed)
+            Wait(m_NotEmpty, lock, [this]() { return !m_Items.empty() || m_Closed; }, waited);
+
+        if (m_Items.empty())
+            return false;
+
+        item = std::move(m_Items.front());
+        m_Items.pop_front();
+        lock.unlock();
+        m_NotFull.notify_one();
+        return true;
+    }
+
+    // No more items can be pushed, the items in the queue can still be popped
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Closed = true;
+        }
+
+        m_NotFull.notify_all();
+        m_NotEmpty.notify_all();
+    }
+private:
+    template<typename Predicate>
+    static void Wait(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, Predicate predicate, double* waited) {
+        const auto start = std::chrono::steady_clock::now();
+        condition.wait(lock, predicate);
+
+        if (waited)
+            *waited += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+private:
+    std::mutex m_Mutex;
+    std::condition_variable m_NotFull;
+    std::condition_variable m_NotEmpty;
+    std::deque<T> m_Items;
+    size_t m_Capacity;
+    bool m_Closed = false;
+};
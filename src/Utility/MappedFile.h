@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+// A read-only file mapped into memory
+// The pages are loaded by the OS when they are first read, and are shared between threads and processes
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const std::filesystem::path& path) { Open(path); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { Swap(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept { Close(); Swap(other); return *this; }
+
+    ~MappedFile() { Close(); }
+
+    // Returns false if the file doesn't exist or could not be mapped
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return m_Open; }
+
+    // nullptr for an empty file
+    const uint8_t* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+private:
+    void Swap(MappedFile& other) noexcept {
+        std::swap(m_Open, other.m_Open);
+        std::swap(m_Data, other.m_Data);
+        std::swap(m_Size, other.m_Size);
+        std::swap(m_Handle, other.m_Handle);
+    }
+private:
+    bool m_Open = false;
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+
+    void* m_Handle = nullptr;  // The file mapping object on Windows (unused elsewhere)
+};
@@ -1,13 +1,21 @@
 #pragma once
 
 #include <charconv>
+#include <string>
 #include <string_view>
 #include <optional>
 
 class StringParser {
 public:
-    StringParser(const std::string& data) : m_Data(data) {}
-    StringParser(std::string&& data) : m_Data(std::move(data)) {}
+    StringParser(const std::string& data) : m_Storage(data), m_Data(m_Storage) {}
+    StringParser(std::string&& data) : m_Storage(std::move(data)), m_Data(m_Storage) {}
+
+    // Doesn't copy 'data', so it has to outlive the parser
+    explicit StringParser(std::string_view data) : m_Data(data) {}
+
+    // 'm_Data' can point into 'm_Storage'
+    StringParser(const StringParser&) = delete;
+    StringParser& operator=(const StringParser&) = delete;
 
     size_t Position() const { return m_TokenBegin; }
 
@@ -37,7 +45,7 @@ public:
         if (m_TokenEnd == m_Data.size())
             return std::nullopt;
 
-        m_TokenBegin = m_Data.find_first_not_of(" \t\n", m_TokenEnd);
+        m_TokenBegin = m_Data.find_first_not_of(" \t\r\n", m_TokenEnd);
         if (m_TokenBegin == std::string::npos) {
             m_TokenEnd = m_Data.size();
             return std::nullopt;
@@ -46,7 +54,7 @@ public:
         uint64_t delimBegin = std::min(m_Data.find(delim, m_TokenBegin), m_Data.size());
         m_TokenEnd = delimBegin + delim.size();
         // Remove whitespace from the end
-        delimBegin = m_Data.find_last_not_of(" \t", delimBegin - 1) + 1;
+        delimBegin = m_Data.find_last_not_of(" \t\r", delimBegin - 1) + 1;
 
         return std::string_view(m_Data.data() + m_TokenBegin, delimBegin - m_TokenBegin);
     }
@@ -57,7 +65,7 @@ public:
         uint64_t delimBegin = std::min(m_Data.find(delim, m_TokenBegin), m_Data.size());
         m_TokenEnd = delimBegin + delim.size();
         // Remove whitespace from the end
-        delimBegin = m_Data.find_last_not_of(" \t", delimBegin - 1) + 1;
+        delimBegin = m_Data.find_last_not_of(" \t\r", delimBegin - 1) + 1;
 
         return std::string_view(m_Data.data() + m_TokenBegin, delimBegin - m_TokenBegin);
     }
@@ -70,13 +78,13 @@ public:
         if (m_TokenEnd == m_Data.size())
             return std::nullopt;
 
-        m_TokenBegin = m_Data.find_first_not_of(" \t\n", m_TokenEnd);
+        m_TokenBegin = m_Data.find_first_not_of(" \t\r\n", m_TokenEnd);
         if (m_TokenBegin == std::string::npos) {
             m_TokenEnd = m_Data.size();
             return std::nullopt;
         }
 
-        m_TokenEnd = std::min(m_Data.find_first_of(" \t\n", m_TokenBegin), m_Data.size());
+        m_TokenEnd = std::min(m_Data.find_first_of(" \t\r\n", m_TokenBegin), m_Data.size());
 
         return std::string_view(m_Data.data() + m_TokenBegin, m_TokenEnd - m_TokenBegin);
     }
@@ -126,12 +134,13 @@ public:
     }
     
     std::string_view ToEnd() {
-        m_TokenBegin = std::min(m_Data.find_first_not_of(" \t\n", m_TokenBegin), m_Data.size());
+        m_TokenBegin = std::min(m_Data.find_first_not_of(" \t\r\n", m_TokenBegin), m_Data.size());
         m_TokenEnd = m_Data.size();
 
         return { m_Data.data() + m_TokenBegin, m_TokenEnd - m_TokenBegin };
     }
 private:
-    std::string m_Data;
+    std::string m_Storage;
+    std::string_view m_Data;
     size_t m_TokenBegin = 0, m_TokenEnd = 0;
 };
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+// Keeps one copy of each string, so text that repeats across many objects (like the names of players) is only stored once
+// The strings are never freed, the views returned by Intern() are valid for the life of the pool
+// Safe to use from multiple threads: the strings are split between shards with their own lock,
+// so threads interning different strings rarely wait for each other
+class StringPool {
+public:
+    StringPool() = default;
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    std::string_view Intern(std::string_view text) {
+        if (text.empty())
+            return {};
+
+        const size_t hash = std::hash<std::string_view>()(text);
+        Shard& shard = m_Shards[hash % SHARD_COUNT];
+
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+
+        auto it = shard.Strings.find(text);
+        if (it != shard.Strings.end())
+            return *it;
+
+        char* copy = (char*)shard.Memory.allocate(text.size(), 1);
+        std::copy(text.begin(), text.end(), copy);
+
+        return *shard.Strings.emplace(copy, text.size()).first;
+    }
+
+    // The pool shared by the whole program
+    static StringPool& Get() {
+        static StringPool s_Pool;
+        return s_Pool;
+    }
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Shard {
+        std::mutex Mutex;
+        std::pmr::monotonic_buffer_resource Memory;
+        std::unordered_set<std::string_view> Strings;
+    };
+
+    std::array<Shard, SHARD_COUNT> m_Shards;
+};
@@ -1,7 +1,9 @@
 #include "Chess/Board.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 bool TestLegalMove() {
     // Interesting positions:
@@ -115,9 +117,198 @@ bool TestAlgebraicMove() {
     return true;
 }
 
+bool TestMoveFormatting() {
+    Board board("k7/1p5P/5Q2/2P5/5Q1Q/8/8/K7 w - - 0 1");
+
+    char buffer[AlgebraicMove::MAX_FIGURINE_STRING_LENGTH];
+
+    for (LongAlgebraicMove m : { LongAlgebraicMove("f4f5"), LongAlgebraicMove("b7b5"), LongAlgebraicMove("c5b6"), LongAlgebraicMove("a8b8"), LongAlgebraicMove("h7h8q") }) {
+        char* end = m.WriteTo(buffer);
+        std::cout << "UCI: " << std::string_view(buffer, end - buffer);
+
+        AlgebraicMove am = board.Move(m);
+        end = am.WriteTo(buffer);
+        std::cout << " SAN: " << std::string_view(buffer, end - buffer);
+
+        end = am.WriteFigurineTo(buffer);
+        std::cout << " Figurine: " << std::string_view(buffer, end - buffer) << "\n";
+    }
+
+    return true;
+}
+
+bool TestEvaluation() {
+    // The starting position is symmetrical
+    Board board;
+    if (board.Evaluate() != 0)
+        return false;
+
+    // The incrementally updated score must match a board set up from scratch
+    std::string inputString = "e2e4 d7d5 e4d5 d8d5 b1c3 d5a5 d2d4 c7c6 g1f3 c8g4 f1e2 e7e6 e1g1 g8f6 h2h3 g4h5";
+
+    std::istringstream input(inputString);
+    std::string move;
+    while (input >> move) {
+        board.Move(LongAlgebraicMove(move));
+
+        Board fromFEN(board.ToFEN());
+        std::cout << move << ": " << board.Evaluate() << "\n";
+
+        if (board.Evaluate() != fromFEN.Evaluate())
+            return false;
+    }
+
+    // Mirrored positions have the same score for the player to move
+    Board white("4k3/8/8/8/8/8/3PP3/R3K2R w - - 0 1");
+    Board black("r3k2r/3pp3/8/8/8/8/8/4K3 b - - 0 1");
+
+    return white.Evaluate() == black.Evaluate();
+}
+
+// The checks generated directly are the legal moves that leave the opponent in check,
+// in positions from random games (with castling, en passant, promotions and discovered checks)
+bool TestLegalChecks() {
+    const char* fens[] = {
+        Board::START_FEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "4k3/1P4P1/8/3B4/8/2R5/8/R3K2R w KQ - 0 1",
+        "4k3/8/8/2pP4/8/8/8/R3K2B w Q c6 0 1",
+    };
+
+    uint64_t seed = 1;
+    uint64_t positions = 0, checks = 0;
+    MoveList moves, generated;
+    UndoInfo undo;
+
+    for (const char* fen : fens) {
+        for (int game = 0; game < 200; game++) {
+            Board board(fen);
+
+            for (int ply = 0; ply < 80; ply++) {
+                board.GenerateLegalMoves(moves);
+                if (moves.Size == 0)
+                    break;
+
+                std::vector<std::string> expected;
+                for (LongAlgebraicMove m : moves) {
+                    board.MakeMove(m, undo);
+                    if (board.IsInCheck())
+                        expected.push_back(m.ToString());
+                    board.UnmakeMove(undo);
+                }
+
+                board.GenerateLegalChecks(generated);
+                std::vector<std::string> actual;
+                for (LongAlgebraicMove m : generated)
+                    actual.push_back(m.ToString());
+
+                std::sort(expected.begin(), expected.end());
+                std::sort(actual.begin(), actual.end());
+                if (actual != expected) {
+                    std::cout << board.ToFEN() << ": " << actual.size() << " checks generated, " << expected.size() << " expected\n";
+                    return false;
+                }
+
+                positions++;
+                checks += actual.size();
+
+                board.MakeMove(moves[Zobrist::NextRandom(seed) % moves.Size], undo);
+            }
+        }
+    }
+
+    std::cout << checks << " checks in " << positions << " positions\n";
+    return true;
+}
+
+// Moves from random squares are made by TryMakeMove() exactly when they are legal moves,
+// in positions from random games
+bool TestTryMakeMove() {
+    uint64_t seed = 2, legal = 0;
+    MoveList moves;
+    UndoInfo undo;
+
+    for (int game = 0; game < 200; game++) {
+        Board board;
+
+        for (int ply = 0; ply < 100; ply++) {
+            board.GenerateLegalMoves(moves);
+            if (moves.Size == 0)
+                break;
+
+            // Half of the moves are legal ones, the others are random squares and promotions
+            for (int i = 0; i < 20; i++) {
+                LongAlgebraicMove m = moves[Zobrist::NextRandom(seed) % moves.Size];
+                if (i % 2) {
+                    const uint64_t random = Zobrist::NextRandom(seed);
+                    m = LongAlgebraicMove(random % 64, (random >> 8) % 64, (PieceType)((random >> 16) % (i % 4 == 1 ? 1 : PieceTypeCount)));
+                }
+
+                const bool expected = std::find(moves.begin(), moves.end(), m) != moves.end();
+                const std::string fen = board.ToFEN();
+                const uint64_t hash = board.GetHash();
+
+                if (board.TryMakeMove(m, undo) != expected) {
+                    std::cout << fen << ": " << m << (expected ? " is legal\n" : " isn't legal\n");
+                    return false;
+                }
+
+                if (expected) {
+                    legal++;
+                    board.UnmakeMove(undo);
+                }
+
+                if (board.GetHash() != hash || board.ToFEN() != fen)
+                    return false;
+            }
+
+            board.MakeMove(moves[Zobrist::NextRandom(seed) % moves.Size], undo);
+        }
+    }
+
+    std::cout << legal << " legal moves made\n";
+    return true;
+}
+
+// Positions from random games (with castling rights, en passant squares and move counters) read back from ToPacked()
+bool TestPacked() {
+    uint64_t seed = 5;
+    MoveList moves;
+    UndoInfo undo;
+    uint8_t packed[Board::PACKED_SIZE];
+
+    for (int game = 0; game < 100; game++) {
+        Board board;
+
+        for (int ply = 0; ply < 120; ply++) {
+            board.ToPacked(packed);
+
+            Board read("8/8/8/4k3/8/8/8/4K3 b - - 7 40");
+            read.FromPacked(packed);
+            if (read.ToFEN() != board.ToFEN() || read.GetHash() != board.GetHash() || read.Evaluate() != board.Evaluate())
+                return false;
+
+            board.GenerateLegalMoves(moves);
+            if (moves.Size == 0)
+                break;
+
+            board.MakeMove(moves[Zobrist::NextRandom(seed) % moves.Size], undo);
+        }
+    }
+
+    return true;
+}
+
 int main() {
     //TestLegalMove();
     //TestLegalMove1();
     TestAlgebraicMove();
     //TestAlgebraicMoveGeneration();
+    TestMoveFormatting();
+    std::cout << "Evaluation: " << (TestEvaluation() ? "passed" : "FAILED") << "\n";
+    std::cout << "Legal checks: " << (TestLegalChecks() ? "passed" : "FAILED") << "\n";
+    std::cout << "Try make move: " << (TestTryMakeMove() ? "passed" : "FAILED") << "\n";
+    std::cout << "Packed: " << (TestPacked() ? "passed" : "FAILED") << "\n";
 }
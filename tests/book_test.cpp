@@ -0,0 +1,168 @@
+#include "Chess/Game.h"
+#include "Chess/Polyglot.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+// Keys from the Polyglot specification
+bool TestKeys() {
+    struct Expected {
+        const char* Moves;
+        uint64_t Key;
+    };
+
+    static constexpr Expected s_Keys[] = {
+        { "",                              0x463B96181691FC9C },
+        { "e2e4",                          0x823C9B50FD114196 },
+        { "e2e4 d7d5",                     0x0756B94461C50FB0 },
+        { "e2e4 d7d5 e4e5",                0x662FAFB965DB29D4 },
+        { "e2e4 d7d5 e4e5 f7f5",           0x22A48B5A8E47FF78 },
+        { "e2e4 d7d5 e4e5 f7f5 e1e2",      0x652A607CA3F242C1 },
+        { "e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00FDD303C946BDD9 },
+        { "a2a4 b7b5 h2h4 b5b4 c2c4",      0x3C8123EA7B067637 },
+        { "a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5C3F9B829B279560 },
+    };
+
+    bool passed = true;
+    for (const Expected& expected : s_Keys) {
+        Board board;
+
+        std::istringstream input(expected.Moves);
+        std::string move;
+        while (input >> move)
+            board.Move(LongAlgebraicMove(move));
+
+        if (Polyglot::GetKey(board) != expected.Key) {
+            std::cout << "Wrong key after \"" << expected.Moves << "\": " << std::hex << Polyglot::GetKey(board) << std::dec << "\n";
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+bool TestMoveEncoding() {
+    // Castling is the king taking its own rook
+    Board board("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    if (Polyglot::EncodeMove(board, LongAlgebraicMove("e1g1")) != ((E1 << 6) | H1))
+        return false;
+
+    for (const char* move : { "e1g1", "e1c1", "a1a8", "e1f1" }) {
+        LongAlgebraicMove m(move);
+        if (Polyglot::DecodeMove(board, Polyglot::EncodeMove(board, m)) != m)
+            return false;
+    }
+
+    board.FromFEN("8/1P6/8/8/8/8/8/k1K5 w - - 0 1");
+    LongAlgebraicMove promotion("b7b8n");
+    return Polyglot::DecodeMove(board, Polyglot::EncodeMove(board, promotion)) == promotion;
+}
+
+bool TestBuildAndRead() {
+    static const char* s_Games[] = {
+        "[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. Ba4 Nf6 5. O-O Be7 1-0",
+        "[Result \"1/2-1/2\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bb5 Nf6 4. O-O Nxe4 1/2-1/2",
+        "[Result \"0-1\"]\n\n1. e4 c5 2. Nf3 d6 3. d4 cxd4 0-1",
+        "[Result \"1-0\"]\n\n1. d4 d5 2. c4 e6 1-0",
+    };
+
+    Polyglot::BookBuilder builder;
+    for (const char* pgn : s_Games) {
+        Game game(pgn);
+        builder.AddGame(game);
+    }
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "book_test.bin";
+    if (!builder.Write(path))
+        return false;
+
+    Polyglot::Book book(path);
+    std::cout << "Positions: " << builder.GetPositionCount() << ", entries: " << book.GetEntryCount() << "\n";
+
+    Board board;
+    std::vector<Polyglot::BookMove> moves;
+    book.GetMoves(board, moves);
+
+    for (const Polyglot::BookMove& move : moves)
+        std::cout << move.Move << " " << move.Weight << "\n";
+
+    // 1. e4 won once, drew once and lost once, 1. d4 won once
+    bool passed = moves.size() == 2
+        && moves[0].Move == LongAlgebraicMove("e2e4") && moves[0].Weight == 3
+        && moves[1].Move == LongAlgebraicMove("d2d4") && moves[1].Weight == 2;
+
+    passed &= book.GetBestMove(board) == LongAlgebraicMove("e2e4");
+
+    // Black only lost after 1. d4, so the book has no moves for it
+    uint64_t seed = 12345;
+    board.Move(LongAlgebraicMove("d2d4"));
+    passed &= book.GetMoves(board, moves) == 0 && !book.PickMove(board, seed);
+
+    // Castling from a book
+    board.FromFEN("r1bqkbnr/1ppp1ppp/p1n5/4p3/B3P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 1 4");
+    board.Move(LongAlgebraicMove("g8f6"));
+    passed &= book.GetBestMove(board) == LongAlgebraicMove("e1g1");
+
+    // The picked moves follow the weights (3:2)
+    board.Reset();
+    int32_t e4 = 0;
+    for (int32_t i = 0; i < 10000; i++)
+        e4 += book.PickMove(board, seed) == LongAlgebraicMove("e2e4");
+
+    std::cout << "1. e4 picked " << e4 << " times out of 10000\n";
+    passed &= e4 > 5700 && e4 < 6300;
+
+    book.Close();
+    std::filesystem::remove(path);
+    return passed;
+}
+
+void Benchmark(const std::filesystem::path& path) {
+    Polyglot::Book book(path);
+    if (!book.IsOpen()) {
+        std::cout << "Could not open " << path << "\n";
+        return;
+    }
+
+    std::cout << path << ": " << book.GetEntryCount() << " entries\n";
+
+    // Follow book moves from the starting position
+    std::vector<Board> positions;
+    uint64_t seed = 1;
+    for (int32_t game = 0; game < 1000; game++) {
+        Board board;
+        while (std::optional<LongAlgebraicMove> move = book.PickMove(board, seed)) {
+            positions.push_back(board);
+            if (!board.IsMoveLegal(*move))
+                break;
+            board.Move(*move);
+        }
+    }
+
+    if (positions.empty())
+        return;
+
+    std::vector<Polyglot::BookMove> moves;
+    size_t found = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int32_t repeat = 0; repeat < 10; repeat++)
+        for (const Board& board : positions)
+            found += book.GetMoves(board, moves);
+
+    auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << positions.size() * 10 << " lookups, " << time * 1e6 / (positions.size() * 10) << " us/lookup (" << found << " moves)\n";
+}
+
+int main(int argc, char** argv) {
+    std::cout << "Keys: " << (TestKeys() ? "passed" : "FAILED") << "\n";
+    std::cout << "Move encoding: " << (TestMoveEncoding() ? "passed" : "FAILED") << "\n";
+
+    bool passed = TestBuildAndRead();
+    std::cout << "Build and read: " << (passed ? "passed" : "FAILED") << "\n";
+
+    // Benchmark an existing book
+    if (argc > 1)
+        Benchmark(argv[1]);
+}
@@ -0,0 +1,310 @@
+#include "Chess/ChessException.h"
+#include "Chess/Game.h"
+#include "Chess/GameDatabase.h"
+#include "Chess/Zobrist.h"
+
+#include <chrono>
+#include <filesystem>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static const char* PGN =
+    "[Event \"Linares\"]\n[Site \"Linares ESP\"]\n[Date \"2016.02.20\"]\n[Round \"3\"]\n"
+    "[White \"Carlsen, Magnus\"]\n[Black \"Anand, Viswanathan\"]\n[Result \"1-0\"]\n"
+    "[WhiteElo \"2851\"]\n[BlackElo \"2784\"]\n[ECO \"B90\"]\n\n"
+    "1. e4 c5 2. Nf3 d6 3. d4 cxd4 4. Nxd4 Nf6 5. Nc3 a6 6. Be3 (6. Bg5 e6 7. f4) 6... e5 {Najdorf} 7. Nb3 Be6 1-0\n\n"
+    "[Event \"Wijk aan Zee\"]\n[Date \"2018.01.14\"]\n"
+    "[White \"Anand, Viswanathan\"]\n[Black \"Carlsen, Magnus\"]\n[Result \"1/2-1/2\"]\n"
+    "[WhiteElo \"2767\"]\n[BlackElo \"2834\"]\n[ECO \"C65\"]\n\n"
+    "1. e4 e5 2. Nf3 Nc6 3. Bb5 Nf6 4. d3 Bc5 1/2-1/2\n\n"
+    "[Event \"Club\"]\n[Date \"2019.??.??\"]\n"
+    "[White \"Smith, John\"]\n[Black \"Carlsen, Magnus\"]\n[Result \"0-1\"]\n\n"
+    "1. d4 Nf6 2. c4 e6 0-1\n\n";
+
+// Ids of the games that match the query, from the columns of every game
+static std::vector<GameId> Scan(const GameDatabase& database, const GameQuery& query) {
+    std::vector<GameId> ids;
+    for (GameId id = 0; id < database.GetGameCount(); id++) {
+        if (database.Matches(id, query))
+            ids.push_back(id);
+    }
+
+    return ids;
+}
+
+// Games with random tags and no moves (so the database is mostly columns)
+static void AddRandomGames(GameDatabase& database, uint32_t count, uint32_t players, uint64_t seed) {
+    Game game;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint64_t r = Zobrist::NextRandom(seed);
+
+        game.SetHeader("White", "Player " + std::to_string(r % players));
+        game.SetHeader("Black", "Player " + std::to_string((r >> 16) % players));
+        game.SetHeader("WhiteElo", std::to_string(1200 + (r >> 32) % 1700));
+        game.SetHeader("BlackElo", (r >> 44) % 20 ? std::to_string(1200 + (r >> 44) % 1700) : "");
+        game.SetHeader("Date", std::to_string(1990 + (r >> 56) % 35) + "." + std::to_string(10 + (r >> 8) % 3) + ".1" + std::to_string((r >> 12) % 9));
+        game.SetHeader("Result", std::string(ToString((GameResult)((r >> 24) % 4))));
+
+        const uint32_t eco = (r >> 40) % 520;
+        game.SetHeader("ECO", eco < 500 ? std::string(1, 'A' + eco / 100) + std::to_string(eco / 10 % 10) + std::to_string(eco % 10) : "?");
+
+        database.AddGame(game);
+    }
+}
+
+// Writes the file with one value of one of its arrays replaced
+// The arrays of the file are in this order, each as its size (8 bytes) and its values
+static void CorruptArray(const std::filesystem::path& path, const std::string& saved, size_t array, size_t index, uint64_t value) {
+    static const size_t sizes[] = {
+        4, 4, 2, 2, 4, 2, 1, 8, 8, 8,  // Columns and offsets
+        4, 4, 4, 4, 4, 4, 4,           // Indexes
+        8, 8, 8, 8,                    // Result bitmaps
+    };
+
+    std::string data = saved;
+    size_t offset = 16;  // MAGIC, VERSION and the number of indexed games
+    for (size_t i = 0; i < array; i++) {
+        uint64_t count;
+        std::memcpy(&count, &data[offset], sizeof(count));
+        offset += 8 + count * sizes[i];
+    }
+
+    std::memcpy(&data[offset + 8 + index * sizes[array]], &value, sizes[array]);
+    std::ofstream(path, std::ios::binary) << data;
+}
+
+// Games go in with their tags and come out the same, also from a saved database and from an import
+bool TestGames() {
+    std::vector<Game> games;
+    const std::string pgn = PGN;
+    for (size_t begin = 0; begin < pgn.size();) {
+        const size_t end = pgn.find("[Event ", begin + 1);
+        games.emplace_back(pgn.substr(begin, end - begin));
+        begin = end;
+    }
+
+    GameDatabase database;
+    for (const Game& game : games)
+        database.AddGame(game);
+
+    bool passed = !database.HasIndexes();
+    try {
+        database.Query(GameQuery());
+        passed = false;
+    } catch (const InvalidGameDataException&) {}
+
+    database.BuildIndexes();
+
+    auto check = [&](const GameDatabase& db) {
+        bool ok = db.GetGameCount() == games.size();
+        for (GameId id = 0; id < games.size() && ok; id++)
+            ok &= db.GetGame(id).ToPGN() == games[id].ToPGN();
+
+        ok &= db.GetWhite(0) == "Carlsen, Magnus" && db.GetBlackElo(0) == 2784 && db.GetDate(0) == 20160220;
+        ok &= db.GetECO(1) == "C65" && db.GetECO(2) == "" && db.GetResult(2) == GameResult::BlackWins && db.GetDate(2) == 20190000;
+
+        GameQuery query;
+        ok &= db.Query(query) == std::vector<GameId>({ 0, 1, 2 });
+
+        query.Player = "Carlsen, Magnus";
+        ok &= db.Query(query) == std::vector<GameId>({ 0, 1, 2 });
+        query.MinDate = 20170000;
+        ok &= db.Query(query) == std::vector<GameId>({ 1, 2 });
+
+        query = GameQuery();
+        query.White = "Anand, Viswanathan";
+        query.Black = "Carlsen, Magnus";
+        ok &= db.Query(query) == std::vector<GameId>({ 1 });
+
+        query = GameQuery();
+        query.MinWhiteElo = 2600;
+        query.ECO = "B";
+        ok &= db.Query(query) == std::vector<GameId>({ 0 });
+        query.ECO = "B91";
+        ok &= db.Query(query).empty();
+
+        query = GameQuery();
+        query.Result = GameResult::Draw;
+        ok &= db.Query(query) == std::vector<GameId>({ 1 });
+
+        query = GameQuery();
+        query.Player = "Kasparov, Garry";
+        ok &= db.Query(query).empty();
+
+        return ok;
+    };
+
+    passed &= check(database);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "game_database_test.db";
+    passed &= database.Save(path);
+
+    GameDatabase opened;
+    passed &= opened.Open(path) && opened.HasIndexes() && check(opened);
+
+    // Adding to an opened database moves its heap out of the file
+    opened.AddGame(games[0]);
+    opened.BuildIndexes();
+    passed &= opened.GetGameCount() == 4 && opened.GetGame(3).ToPGN() == games[0].ToPGN() && opened.GetGame(1).ToPGN() == games[1].ToPGN();
+
+    // Files with ids or ranges outside of the database, which leave the opened database as it was
+    passed &= database.Save(path);
+    std::ifstream file(path, std::ios::binary);
+    const std::string saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    const struct { size_t Array; size_t Index; uint64_t Value; } corruptions[] = {
+        { 0, 0, 100 },     // White player
+        { 1, 2, 3 },       // Black player (there are 3 players)
+        { 5, 1, 501 },     // ECO
+        { 6, 0, 4 },       // Result
+        { 9, 1, 1 << 30 }, // Offset of a game
+        { 9, 3, 10 },      // Offset of the end of the heap
+        { 12, 0, 3 },      // Id in the dates index
+        { 13, 300, 0 },    // ECO starts going back
+        { 13, 501, 5 },    // ECO starts past the index
+        { 14, 2, 7 },      // Id in the ECO index
+        { 15, 3, 7 },      // Player starts past the index
+        { 16, 0, 3 },      // Id in the players index
+        { 17, 0, 0x8 },    // Result bit of a game that doesn't exist
+    };
+
+    for (const auto& c : corruptions) {
+        CorruptArray(path, saved, c.Array, c.Index, c.Value);
+        try {
+            opened.Open(path);
+            passed = false;
+        } catch (const InvalidGameDataException&) {
+            passed &= opened.GetGameCount() == 4 && opened.HasIndexes() && opened.GetGame(3).ToPGN() == games[0].ToPGN();
+        }
+    }
+
+    std::ofstream(path, std::ios::binary) << saved;
+    passed &= opened.Open(path) && opened.GetGameCount() == 3 && check(opened);
+
+    // A file that is cut short
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    try {
+        GameDatabase cut;
+        cut.Open(path);
+        passed = false;
+    } catch (const InvalidGameDataException&) {}
+
+    const std::filesystem::path pgnPath = std::filesystem::temp_directory_path() / "game_database_test.pgn";
+    std::ofstream(pgnPath) << PGN;
+
+    GameDatabase imported;
+    PgnImporter::Options options;
+    options.Threads = 2;
+    PgnImporter::Statistics statistics;
+    passed &= imported.Import(pgnPath, options, statistics) && imported.HasIndexes() && check(imported);
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(pgnPath);
+
+    return passed;
+}
+
+// The indexes find the same games as checking every game
+bool TestQueries() {
+    GameDatabase database;
+    AddRandomGames(database, 50000, 300, 11);
+    database.BuildIndexes();
+
+    bool passed = true;
+    uint64_t seed = 3, matches = 0;
+
+    for (int i = 0; i < 400 && passed; i++) {
+        GameQuery query;
+        auto random = [&seed]() { return Zobrist::NextRandom(seed); };
+
+        if (random() % 2) query.MinWhiteElo = 1200 + random() % 1800;
+        if (random() % 3 == 0) query.MaxWhiteElo = query.MinWhiteElo + random() % 400;
+        if (random() % 3 == 0) query.MinBlackElo = random() % 2 ? 1 : 2000 + random() % 800;
+        if (random() % 2) {
+            query.MinDate = (1990 + random() % 35) * 10000;
+            query.MaxDate = query.MinDate + random() % 5 * 10000 + 1231;
+        }
+        if (random() % 2) {
+            const uint32_t eco = random() % 500;
+            query.ECO = std::string(1, 'A' + eco / 100) + std::to_string(eco / 10 % 10) + std::to_string(eco % 10);
+            query.ECO.resize(1 + random() % 3);
+        }
+        if (random() % 4 == 0) query.Player = "Player " + std::to_string(random() % 300);
+        if (random() % 6 == 0) query.White = "Player " + std::to_string(random() % 300);
+        if (random() % 6 == 0) query.Black = "Player " + std::to_string(random() % 300);
+        if (random() % 3 == 0) query.Result = (GameResult)(random() % 4);
+
+        const std::vector<GameId> ids = database.Query(query);
+        passed &= ids == Scan(database, query);
+        matches += ids.size();
+    }
+
+    std::cout << "400 queries matched " << matches << " games\n";
+    return passed;
+}
+
+// Queries over a million games, against checking every game
+bool TestBenchmark() {
+    auto time = [](auto function) {
+        const auto startTime = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    const uint32_t games = 1000000;
+    GameDatabase database;
+    const double addSeconds = time([&]() { AddRandomGames(database, games, 20000, 5); });
+    const double indexSeconds = time([&]() { database.BuildIndexes(); });
+
+    // White Elo > 2600, ECO B90, 2015 to 2020
+    GameQuery query;
+    query.MinWhiteElo = 2601;
+    query.ECO = "B90";
+    query.MinDate = 20150000;
+    query.MaxDate = 20201231;
+
+    GameQuery player;
+    player.Player = "Player 42";
+    player.Result = GameResult::WhiteWins;
+
+    GameQuery wide;
+    wide.MinWhiteElo = 2000;
+    wide.MinBlackElo = 2000;
+    wide.Result = GameResult::Draw;
+
+    bool passed = true;
+    std::cout << games << " games added in " << addSeconds << "s, indexed in " << indexSeconds << "s\n";
+
+    for (const GameQuery* q : { &query, &player, &wide }) {
+        std::vector<GameId> ids, scanned;
+        const int runs = 20;
+        const double querySeconds = time([&]() {
+            for (int i = 0; i < runs; i++)
+                ids = database.Query(*q);
+        });
+        const double scanSeconds = time([&]() { scanned = Scan(database, *q); });
+
+        std::cout << ids.size() << " games: " << querySeconds / runs * 1000 << "ms, checking every game " << scanSeconds * 1000 << "ms\n";
+        passed &= ids == scanned && !ids.empty();
+    }
+
+    GameId id = 0;
+    const double loadSeconds = time([&]() {
+        for (; id < 100000; id++)
+            passed &= database.GetGame(id).GetHeader().GetWhiteElo() == database.GetWhiteElo(id);
+    });
+
+    std::cout << "Games loaded: " << id / loadSeconds / 1e6 << "M/s\n";
+    return passed;
+}
+
+int main() {
+    std::cout << "Games: " << (TestGames() ? "passed" : "FAILED") << "\n";
+    std::cout << "Queries: " << (TestQueries() ? "passed" : "FAILED") << "\n";
+    std::cout << "Benchmark: " << (TestBenchmark() ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,112 @@
+#include "Chess/Game.h"
+#include "Chess/GameGenerator.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static void PrintStatistics(const GameGenerator::Statistics& statistics) {
+    std::cout << statistics.Games << " games, " << statistics.Positions << " positions in " << statistics.Seconds << "s: ";
+    std::cout << (uint64_t)(statistics.Games / statistics.Seconds) << " games/s, ";
+    std::cout << (uint64_t)(statistics.Positions / statistics.Seconds) << " positions/s\n";
+    std::cout << "+" << statistics.WhiteWins << " -" << statistics.BlackWins << " =" << statistics.Draws;
+    std::cout << " unfinished " << statistics.Unfinished << " failed checks " << statistics.Failures << "\n";
+
+    if (statistics.Failures != 0)
+        std::cout << statistics.FirstFailure << "\n";
+}
+
+bool TestChecks() {
+    GameGenerator::Options options;
+    options.Games = 200;
+    options.Threads = 4;
+    options.Seed = 1;
+    options.Check = true;
+
+    GameGenerator::Statistics uniform = GameGenerator(options).Run();
+    PrintStatistics(uniform);
+
+    // Captures make more promotions, en passant and endings
+    options.CaptureWeight = 8;
+    GameGenerator::Statistics weighted = GameGenerator(options).Run();
+    PrintStatistics(weighted);
+
+    return uniform.Failures == 0 && uniform.Games == options.Games && weighted.Failures == 0 && weighted.Games == options.Games;
+}
+
+// The same seed on one thread plays the same games, so the PGN and the binary output must have the same moves
+bool TestFormats() {
+    GameGenerator::Options options;
+    options.Games = 50;
+    options.Threads = 1;
+    options.Seed = 2;
+    options.MaxPlies = 200;
+
+    std::ostringstream pgn;
+    options.OutputFormat = GameGenerator::Format::PGN;
+    GameGenerator(options).Run(&pgn);
+
+    std::stringstream binary;
+    options.OutputFormat = GameGenerator::Format::Binary;
+    GameGenerator(options).Run(&binary);
+
+    const std::string pgnText = pgn.str();
+    size_t begin = pgnText.find("[Event ");
+
+    std::vector<LongAlgebraicMove> moves;
+    std::string result;
+    uint64_t games = 0;
+
+    while (GameGenerator::ReadBinary(binary, moves, result)) {
+        if (begin == std::string::npos)
+            return false;
+
+        size_t end = pgnText.find("[Event ", begin + 1);
+        Game game(pgnText.substr(begin, end - begin));
+        game.ToBeginning();
+        begin = end;
+
+        if (game.GetHeader("Result") != result)
+            return false;
+
+        for (LongAlgebraicMove m : moves) {
+            if (!game.Forward())
+                return false;
+
+            const GameMove& played = game.GetNode(game.CurrentNode()).Move;
+            if (played.Start != m.SourceSquare || played.Destination != m.DestinationSquare)
+                return false;
+        }
+
+        if (game.Forward())
+            return false;
+
+        games++;
+    }
+
+    return games == options.Games && begin == std::string::npos;
+}
+
+int main(int argc, char** argv) {
+    // generator_test <games> [threads] [none|pgn|binary] [output file]
+    if (argc > 1) {
+        GameGenerator::Options options;
+        options.Games = std::stoull(argv[1]);
+        options.Threads = argc > 2 ? std::stoul(argv[2]) : 0;
+
+        const std::string format = argc > 3 ? argv[3] : "none";
+        options.OutputFormat = format == "pgn" ? GameGenerator::Format::PGN : format == "binary" ? GameGenerator::Format::Binary : GameGenerator::Format::None;
+
+        std::ofstream file;
+        if (argc > 4)
+            file.open(argv[4], std::ios::binary);
+
+        PrintStatistics(GameGenerator(options).Run(file.is_open() ? &file : nullptr));
+        return 0;
+    }
+
+    bool checks = TestChecks();
+    std::cout << "Checks: " << (checks ? "passed" : "FAILED") << "\n";
+    std::cout << "Formats: " << (TestFormats() ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,126 @@
+#include "Chess/Board.h"
+#include "Engine/MateSolver.h"
+#include "Engine/Search.h"
+
+#include <chrono>
+#include <iostream>
+
+struct MatePosition {
+    const char* FEN;
+    int32_t Moves;
+    const char* FirstMove;  // nullptr if there is more than one
+};
+
+static const MatePosition s_Positions[] = {
+    { "6k1/5ppp/8/8/8/8/5PPP/R5K1 w - - 0 1", 1, "a1a8" },
+    { "r5k1/5ppp/8/8/8/8/5PPP/6K1 b - - 0 1", 1, "a8a1" },
+    { "6rk/6pp/8/6N1/8/8/8/7K w - - 0 1", 1, "g5f7" },
+    { "r1b2k1r/ppp1bppp/8/1B1Q4/5q2/2P5/PPP2PPP/R3R1K1 w - - 1 0", 2, "d5d8" },
+    { "r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 1 0", 2, "d5f6" },
+    { "5r1k/6pp/7N/8/8/1Q6/8/6K1 w - - 0 1", 2, nullptr },
+    { "1k5r/pP3ppp/3p2b1/1BN1n3/1Q2P3/P1B5/KP3P1P/7q w - - 1 0", 3, nullptr },
+    { "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1", 3, nullptr },
+    { "r3k2r/ppp2Npp/1b5n/4p2b/2B1P2q/BQP2P2/P5PP/RN5K w kq - 1 0", 3, nullptr },
+};
+
+bool TestKnownMates() {
+    MateSolver solver(16, 1);
+
+    bool passed = true;
+    for (const MatePosition& position : s_Positions) {
+        MateSolver::Limits limits;
+        limits.Moves = position.Moves;
+
+        MateSolver::Result result = solver.Solve(Board(position.FEN), limits);
+
+        std::cout << position.FEN << ": " << (result.Mate ? "mate in " + std::to_string(result.Moves) : "no mate");
+        std::cout << " (" << result.Nodes << " nodes) ";
+        for (LongAlgebraicMove m : result.Continuation)
+            std::cout << m << " ";
+        std::cout << "\n";
+
+        if (!result.Mate || result.Moves != position.Moves || result.Continuation.empty())
+            passed = false;
+        else if (position.FirstMove && result.Continuation[0].ToString() != position.FirstMove)
+            passed = false;
+
+        // The continuation has to end in mate
+        Board board(position.FEN);
+        for (LongAlgebraicMove m : result.Continuation)
+            board.Move(m);
+
+        if (!board.IsInCheck() || board.HasLegalMoves(board.GetPlayerTurn()))
+            passed = false;
+    }
+
+    return passed;
+}
+
+bool TestNoMate() {
+    MateSolver solver(16, 1);
+
+    MateSolver::Limits limits;
+    limits.Moves = 4;
+
+    // The starting position (no checks at all), and a position where the checks run out
+    MateSolver::Result start = solver.Solve(Board(), limits);
+    MateSolver::Result checks = solver.Solve(Board("6k1/5ppp/8/8/8/8/5PPP/1R4K1 b - - 0 1"), limits);
+
+    // Mate in 2 isn't found with a limit of 1 move
+    limits.Moves = 1;
+    MateSolver::Result shorter = solver.Solve(Board(s_Positions[3].FEN), limits);
+
+    return !start.Mate && start.Nodes == 1 && !checks.Mate && !shorter.Mate;
+}
+
+// Every position of the batch is solved by the mate solver on all threads,
+// and by the alpha-beta search with enough depth to see the mate
+bool TestAgainstSearch() {
+    std::vector<Board> positions;
+    for (const MatePosition& position : s_Positions)
+        positions.emplace_back(position.FEN);
+
+    MateSolver solver(64, 4);
+    MateSolver::Limits limits;
+    limits.Moves = 5;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<MateSolver::Result> results = solver.Solve(positions, limits);
+    auto solverTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    uint64_t solverNodes = 0;
+    for (const MateSolver::Result& result : results)
+        solverNodes += result.Nodes;
+
+    Search search(64, 1);
+    uint64_t searchNodes = 0;
+
+    bool passed = true;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); i++) {
+        search.ClearHash();
+
+        Search::Limits searchLimits;
+        searchLimits.Depth = 2 * s_Positions[i].Moves;
+
+        Engine::BestContinuation continuation = search.Run(positions[i], searchLimits);
+        searchNodes += search.GetNodes();
+
+        if (!continuation.Mate || continuation.Score != results[i].Moves)
+            passed = false;
+    }
+    auto searchTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "Mate solver (" << solver.GetThreads() << " threads): " << solverNodes << " nodes, " << solverTime.count() << "us\n";
+    std::cout << "Alpha-beta search (1 thread): " << searchNodes << " nodes, " << searchTime.count() << "us\n";
+
+    return passed;
+}
+
+int main() {
+    bool known = TestKnownMates();
+    std::cout << "Known mates: " << (known ? "passed" : "FAILED") << "\n";
+    std::cout << "No mate: " << (TestNoMate() ? "passed" : "FAILED") << "\n";
+    bool search = TestAgainstSearch();
+    std::cout << "Against search: " << (search ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,245 @@
+#include "Chess/Board.h"
+#include "Engine/NNUE.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Positions (with the moves that led to them) from random games
+struct GamePosition {
+    Board Position;
+    UndoInfo Undo;  // The move that was made to reach 'Position'
+};
+
+static std::vector<GamePosition> RandomGames(size_t games, uint64_t seed) {
+    std::vector<GamePosition> positions;
+
+    for (size_t g = 0; g < games; g++) {
+        Board board;
+        MoveList moves;
+
+        for (int32_t ply = 0; ply < 200; ply++) {
+            board.GenerateLegalMoves(moves);
+            if (moves.Size == 0 || board.GetHalfMoves() >= 100)
+                break;
+
+            GamePosition position;
+            board.MakeMove(moves[Zobrist::NextRandom(seed) % moves.Size], position.Undo);
+            position.Position = board;
+            positions.push_back(position);
+        }
+    }
+
+    return positions;
+}
+
+bool TestIncrementalUpdates(const NNUE::Network& network, const std::vector<GamePosition>& positions) {
+    NNUE::Accumulator accumulator, next, refreshed;
+
+    Board start;
+    network.Refresh(accumulator, start);
+
+    for (const GamePosition& position : positions) {
+        // A new game started
+        if (position.Position.GetFullMoves() == 1 && position.Position.GetPlayerTurn() == Black)
+            network.Refresh(accumulator, start);
+
+        network.Update(accumulator, next, position.Position, position.Undo);
+        network.Refresh(refreshed, position.Position);
+
+        if (std::memcmp(&next, &refreshed, sizeof(NNUE::Accumulator)) != 0) {
+            std::cout << "Accumulator mismatch after " << position.Undo.Move << " in " << position.Position.ToFEN() << "\n";
+            return false;
+        }
+
+        accumulator = next;
+    }
+
+    return true;
+}
+
+bool TestSaveAndLoad(const NNUE::Network& network, const std::vector<GamePosition>& positions) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "nnue_test.nnue";
+    network.Save(path);
+
+    std::unique_ptr<NNUE::Network> loaded = NNUE::Network::Load(path);
+    std::filesystem::remove(path);
+
+    for (const GamePosition& position : positions) {
+        if (loaded->Evaluate(position.Position) != network.Evaluate(position.Position))
+            return false;
+    }
+
+    return true;
+}
+
+// The network read back from its file and computed with plain loops,
+// to check the kernels of whatever instruction set the test was compiled for
+struct ReferenceNetwork {
+    NNUE::FeatureSet Set;
+    std::vector<int16_t> AccumulatorBiases, AccumulatorWeights;
+    std::vector<int32_t> Hidden1Biases, Hidden2Biases;
+    std::vector<int8_t> Hidden1Weights, Hidden2Weights, OutputWeights;
+    int32_t OutputBias = 0;
+
+    template<typename T>
+    static void Read(std::istream& file, std::vector<T>& values, size_t count) {
+        values.resize(count);
+        file.read((char*)values.data(), count * sizeof(T));
+    }
+
+    explicit ReferenceNetwork(const NNUE::Network& network) {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / "nnue_test_reference.nnue";
+        network.Save(path);
+
+        std::ifstream file(path, std::ios::binary);
+        uint32_t header[6];
+        file.read((char*)header, sizeof(header));
+        Set = (NNUE::FeatureSet)header[2];
+
+        Read(file, AccumulatorBiases, NNUE::ACCUMULATOR_SIZE);
+        Read(file, AccumulatorWeights, NNUE::FeatureCount(Set) * NNUE::ACCUMULATOR_SIZE);
+        Read(file, Hidden1Biases, NNUE::HIDDEN1_SIZE);
+        Read(file, Hidden1Weights, NNUE::HIDDEN1_SIZE * 2 * NNUE::ACCUMULATOR_SIZE);
+        Read(file, Hidden2Biases, NNUE::HIDDEN2_SIZE);
+        Read(file, Hidden2Weights, NNUE::HIDDEN2_SIZE * NNUE::HIDDEN1_SIZE);
+        file.read((char*)&OutputBias, sizeof(OutputBias));
+        Read(file, OutputWeights, NNUE::HIDDEN2_SIZE);
+
+        file.close();
+        std::filesystem::remove(path);
+    }
+
+    void Refresh(NNUE::Accumulator& accumulator, const Board& board) const {
+        const size_t pieceCount = Set == NNUE::FeatureSet::HalfKP ? 10 : 12;
+
+        for (Colour perspective : { White, Black }) {
+            auto& values = accumulator.Values[perspective];
+            std::copy(AccumulatorBiases.begin(), AccumulatorBiases.end(), values.begin());
+
+            const Square king = GetSquare(board.GetPieceBitBoard(King) & board.GetColourBitBoard(perspective));
+            for (Square s = 0; s < 64; s++) {
+                if (board[s] == Piece::None || (Set == NNUE::FeatureSet::HalfKP && GetPieceType(board[s]) == King))
+                    continue;
+
+                const size_t piece = GetPieceType(board[s]) * 2 + (GetColour(board[s]) != perspective);
+                const size_t feature = (FlipPerspective(king, perspective) * pieceCount + piece) * 64 + FlipPerspective(s, perspective);
+                for (size_t i = 0; i < NNUE::ACCUMULATOR_SIZE; i++)
+                    values[i] += AccumulatorWeights[feature * NNUE::ACCUMULATOR_SIZE + i];
+            }
+        }
+    }
+
+    int32_t Evaluate(const NNUE::Accumulator& accumulator, Colour playerTurn) const {
+        uint8_t input[2 * NNUE::ACCUMULATOR_SIZE];
+        for (size_t i = 0; i < NNUE::ACCUMULATOR_SIZE; i++) {
+            input[i] = (uint8_t)std::clamp<int16_t>(accumulator.Values[playerTurn][i], 0, 127);
+            input[NNUE::ACCUMULATOR_SIZE + i] = (uint8_t)std::clamp<int16_t>(accumulator.Values[OppositeColour(playerTurn)][i], 0, 127);
+        }
+
+        uint8_t hidden1[NNUE::HIDDEN1_SIZE];
+        for (size_t o = 0; o < NNUE::HIDDEN1_SIZE; o++) {
+            int32_t sum = Hidden1Biases[o];
+            for (size_t i = 0; i < 2 * NNUE::ACCUMULATOR_SIZE; i++)
+                sum += input[i] * Hidden1Weights[o * 2 * NNUE::ACCUMULATOR_SIZE + i];
+            hidden1[o] = (uint8_t)std::clamp(sum >> NNUE::WEIGHT_SCALE_BITS, 0, 127);
+        }
+
+        uint8_t hidden2[NNUE::HIDDEN2_SIZE];
+        for (size_t o = 0; o < NNUE::HIDDEN2_SIZE; o++) {
+            int32_t sum = Hidden2Biases[o];
+            for (size_t i = 0; i < NNUE::HIDDEN1_SIZE; i++)
+                sum += hidden1[i] * Hidden2Weights[o * NNUE::HIDDEN1_SIZE + i];
+            hidden2[o] = (uint8_t)std::clamp(sum >> NNUE::WEIGHT_SCALE_BITS, 0, 127);
+        }
+
+        int32_t output = OutputBias;
+        for (size_t i = 0; i < NNUE::HIDDEN2_SIZE; i++)
+            output += hidden2[i] * OutputWeights[i];
+
+        return output / NNUE::OUTPUT_SCALE;
+    }
+};
+
+// Refresh(), Update() and Evaluate() give the same accumulators and evaluations as the plain loops
+bool TestAgainstReference(const NNUE::Network& network, const std::vector<GamePosition>& positions) {
+    const ReferenceNetwork reference(network);
+    NNUE::Accumulator accumulator, next, expected;
+
+    Board start;
+    network.Refresh(accumulator, start);
+
+    for (const GamePosition& position : positions) {
+        if (position.Position.GetFullMoves() == 1 && position.Position.GetPlayerTurn() == Black)
+            network.Refresh(accumulator, start);
+
+        reference.Refresh(expected, position.Position);
+        network.Update(accumulator, next, position.Position, position.Undo);
+        network.Refresh(accumulator, position.Position);
+
+        const bool same = std::memcmp(&next, &expected, sizeof(NNUE::Accumulator)) == 0 && std::memcmp(&accumulator, &expected, sizeof(NNUE::Accumulator)) == 0;
+        const int32_t evaluation = reference.Evaluate(expected, position.Position.GetPlayerTurn());
+
+        if (!same || network.Evaluate(next, position.Position.GetPlayerTurn()) != evaluation || network.Evaluate(position.Position) != evaluation) {
+            std::cout << "Mismatch with the reference in " << position.Position.ToFEN() << "\n";
+            return false;
+        }
+
+        accumulator = next;
+    }
+
+    return true;
+}
+
+void Benchmark(const NNUE::Network& network, const std::vector<GamePosition>& positions) {
+    int64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const GamePosition& position : positions)
+        checksum += network.Evaluate(position.Position);
+    std::chrono::duration<double> refreshTime = std::chrono::steady_clock::now() - start;
+
+    NNUE::Accumulator accumulators[2];
+    Board startPosition;
+    network.Refresh(accumulators[0], startPosition);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); i++) {
+        const GamePosition& position = positions[i];
+        if (position.Position.GetFullMoves() == 1 && position.Position.GetPlayerTurn() == Black)
+            network.Refresh(accumulators[i & 1], startPosition);
+
+        network.Update(accumulators[i & 1], accumulators[(i + 1) & 1], position.Position, position.Undo);
+        checksum -= network.Evaluate(accumulators[(i + 1) & 1], position.Position.GetPlayerTurn());
+    }
+    std::chrono::duration<double> updateTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Refresh and evaluate: " << positions.size() / refreshTime.count() << " evals/s\n";
+    std::cout << "Update and evaluate:  " << positions.size() / updateTime.count() << " evals/s\n";
+    std::cout << "Checksum (should be 0): " << checksum << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<GamePosition> positions = RandomGames(200, 0xB00C);
+    std::cout << "Positions: " << positions.size() << ", kernels: " << NNUE::GetInstructionSet() << "\n";
+
+    for (NNUE::FeatureSet set : { NNUE::FeatureSet::HalfKP, NNUE::FeatureSet::HalfKA }) {
+        std::unique_ptr<NNUE::Network> network = NNUE::Network::CreateRandom(set, 42);
+
+        std::cout << (set == NNUE::FeatureSet::HalfKP ? "HalfKP\n" : "HalfKA\n");
+        std::cout << "Incremental updates: " << (TestIncrementalUpdates(*network, positions) ? "passed" : "FAILED") << "\n";
+        std::cout << "Save and load: " << (TestSaveAndLoad(*network, positions) ? "passed" : "FAILED") << "\n";
+        std::cout << "Against reference: " << (TestAgainstReference(*network, positions) ? "passed" : "FAILED") << "\n";
+        Benchmark(*network, positions);
+    }
+
+    // Benchmark a trained network
+    if (argc > 1) {
+        std::unique_ptr<NNUE::Network> network = NNUE::Network::Load(argv[1]);
+        std::cout << argv[1] << "\n";
+        Benchmark(*network, positions);
+    }
+}
@@ -0,0 +1,326 @@
+#include "Chess/Game.h"
+#include "Chess/GameGenerator.h"
+#include "Chess/OpeningExplorer.h"
+#include "Chess/Zobrist.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static double Time(const std::function<void()>& function) {
+    const auto startTime = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Generated games as PGN, with random ratings
+static std::string GeneratePgn(uint64_t count, uint64_t seed) {
+    GameGenerator::Options options;
+    options.Games = count;
+    options.Threads = 1;
+    options.Seed = seed;
+    options.MaxPlies = 60;
+    options.OutputFormat = GameGenerator::Format::PGN;
+
+    std::ostringstream output;
+    GameGenerator(options).Run(&output);
+    const std::string pgn = output.str();
+
+    // Games from the generator are all different, so a few are played again to have moves that are played more than once
+    std::string rated;
+    for (size_t begin = pgn.find("[Event "), i = 0; begin != std::string::npos; i++) {
+        const size_t end = pgn.find("[Event ", begin + 1);
+        const std::string game = pgn.substr(begin, end - begin);
+        const uint64_t random = Zobrist::NextRandom(seed);
+
+        for (uint64_t copies = random % 4 == 0 ? 3 : 1; copies > 0; copies--) {
+            rated += "[WhiteElo \"" + std::to_string(1500 + random % 1000) + "\"]\n";
+            if (random % 3)
+                rated += "[BlackElo \"" + std::to_string(1500 + (random >> 16) % 1000) + "\"]\n";
+            rated += game;
+        }
+
+        begin = end;
+    }
+
+    return rated;
+}
+
+static std::vector<Game> ParseGames(const std::string& pgn) {
+    std::vector<Game> games;
+    for (size_t begin = pgn.find("[WhiteElo "); begin != std::string::npos;) {
+        const size_t end = pgn.find("[WhiteElo ", pgn.find("[Event ", begin));
+        games.emplace_back(pgn.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return games;
+}
+
+static std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// The explorer has the moves of every position of the games, whether the moves were sorted in memory or in many runs
+bool TestExplorer() {
+    const std::vector<Game> games = ParseGames(GeneratePgn(1000, 1));
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const uint32_t maxPly = 30;
+
+    // Every move of the games, played with the games themselves
+    std::map<std::pair<uint64_t, std::string>, MoveStatistics> expected;
+    std::map<uint64_t, Board> positions;
+
+    for (Game game : games) {
+        MoveStatistics statistics;
+        statistics.Games = 1;
+        statistics.WhiteWins = game.GetHeader().GetResult() == GameResult::WhiteWins;
+        statistics.Draws = game.GetHeader().GetResult() == GameResult::Draw;
+        statistics.BlackWins = game.GetHeader().GetResult() == GameResult::BlackWins;
+        statistics.EloSum = game.GetHeader().GetWhiteElo() + game.GetHeader().GetBlackElo();
+        statistics.EloCount = (game.GetHeader().GetWhiteElo() != 0) + (game.GetHeader().GetBlackElo() != 0);
+
+        game.ToBeginning();
+        for (uint32_t ply = 0; ply < maxPly; ply++) {
+            const Board position = game.GetPosition();
+            if (!game.Forward())
+                break;
+
+            const GameMove& m = game.GetNode(game.CurrentNode()).Move;
+            const LongAlgebraicMove move(m.Start, m.Destination, (PieceType)(m.Flags & GameMoveFlag::PromotionFlags));
+
+            expected[{ position.GetHash(), move.ToString() }].Add(statistics);
+            positions.emplace(position.GetHash(), position);
+        }
+    }
+
+    bool passed = true;
+    std::string files[2];
+    size_t runs[2];
+
+    for (int i = 0; i < 2; i++) {
+        OpeningExplorerBuilder::Options options;
+        options.MaxPly = maxPly;
+        options.BufferedMoves = i == 0 ? 1000 : 1 << 22;
+        options.TemporaryDirectory = directory;
+
+        OpeningExplorerBuilder builder(options);
+        for (const Game& game : games)
+            passed &= builder.AddGame(game);
+
+        const std::filesystem::path path = directory / ("opening_explorer_test_" + std::to_string(i) + ".bin");
+        runs[i] = builder.GetRunCount() + 1;
+        passed &= builder.Write(path) && builder.GetRunCount() == 0;
+
+        files[i] = ReadFile(path);
+        std::filesystem::remove(path);
+    }
+
+    // The entries are the same, the buckets depend on the number of moves in the runs
+    const size_t entriesSize = expected.size() * OpeningExplorer::ENTRY_SIZE;
+    passed &= runs[0] > 10 && runs[1] == 1;
+    passed &= files[0].substr(OpeningExplorer::HEADER_SIZE, entriesSize) == files[1].substr(OpeningExplorer::HEADER_SIZE, entriesSize);
+
+    const std::filesystem::path path = directory / "opening_explorer_test.bin";
+    std::ofstream(path, std::ios::binary) << files[0];
+
+    OpeningExplorer explorer(path);
+    passed &= explorer.IsOpen() && explorer.GetEntryCount() == expected.size();
+
+    std::vector<ExplorerMove> moves;
+    size_t found = 0;
+    for (const auto& [hash, position] : positions) {
+        explorer.GetMoves(position, moves);
+
+        uint32_t games = 0;
+        for (size_t i = 0; i < moves.size(); i++) {
+            const auto it = expected.find({ hash, moves[i].Move.ToString() });
+            passed &= it != expected.end() && (i == 0 || moves[i].Statistics.Games <= moves[i - 1].Statistics.Games);
+
+            if (it != expected.end()) {
+                const MoveStatistics& s = it->second;
+                const MoveStatistics& m = moves[i].Statistics;
+                passed &= m.Games == s.Games && m.WhiteWins == s.WhiteWins && m.Draws == s.Draws && m.BlackWins == s.BlackWins;
+                passed &= m.EloSum == s.EloSum && m.EloCount == s.EloCount;
+                found++;
+            }
+
+            games += moves[i].Statistics.Games;
+        }
+
+        passed &= explorer.GetStatistics(position).Games == games;
+    }
+
+    // Every game starts from the start position, and some come back to it
+    passed &= found == expected.size();
+    passed &= explorer.GetStatistics(Board()).Games >= games.size();
+
+    // A position no game reached
+    passed &= explorer.GetMoves(Board("8/8/8/4k3/8/8/8/R3K3 w - - 0 1"), moves) == 0;
+
+    // Files that aren't explorers: buckets past the last entry, buckets that go backwards, and a file cut short
+    explorer.Close();
+    const size_t bucketOffset = files[0].size() - 16;
+    for (const uint64_t bucket : { (uint64_t)1 << 40, (uint64_t)expected.size() + 1, (uint64_t)0 }) {
+        std::string corrupt = files[0];
+        std::memcpy(&corrupt[bucketOffset], &bucket, sizeof(bucket));
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << corrupt;
+        passed &= !explorer.Open(path) && !explorer.IsOpen() && explorer.GetMoves(Board(), moves) == 0;
+    }
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << files[0];
+    passed &= explorer.Open(path);
+    explorer.Close();
+    std::filesystem::resize_file(path, files[0].size() - 8);
+    passed &= !explorer.Open(path) && !explorer.Open(directory / "opening_explorer_test_missing.bin");
+    std::filesystem::remove(path);
+
+    std::cout << expected.size() << " moves from " << positions.size() << " positions, " << runs[0] << " runs\n";
+    return passed;
+}
+
+// An explorer straight from a PGN file
+bool TestImport() {
+    const std::string pgn = GeneratePgn(500, 2);
+    const std::filesystem::path pgnPath = std::filesystem::temp_directory_path() / "opening_explorer_test.pgn";
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "opening_explorer_test_import.bin";
+    std::ofstream(pgnPath) << pgn;
+
+    OpeningExplorerBuilder::Options options;
+    options.BufferedMoves = 5000;
+    OpeningExplorerBuilder builder(options);
+
+    PgnImporter::Statistics statistics;
+    bool passed = builder.Import(pgnPath, PgnImporter::Options(), statistics) && builder.Write(path);
+
+    const std::vector<Game> games = ParseGames(pgn);
+    passed &= statistics.Games == games.size() && builder.GetGameCount() == games.size();
+
+    OpeningExplorer explorer(path);
+    std::vector<ExplorerMove> moves;
+    passed &= explorer.GetStatistics(Board()).Games >= games.size() && explorer.GetMoves(Board(), moves) > 0;
+
+    // The first move of the first game
+    Game game = games[0];
+    game.ToBeginning();
+    game.Forward();
+    const GameMove& first = game.GetNode(game.CurrentNode()).Move;
+    passed &= std::any_of(moves.begin(), moves.end(), [&first](const ExplorerMove& m) {
+        return m.Move.SourceSquare == first.Start && m.Move.DestinationSquare == first.Destination;
+    });
+
+    std::filesystem::remove(pgnPath);
+    explorer.Close();
+    std::filesystem::remove(path);
+
+    return passed;
+}
+
+// Builders that share a directory for their runs, an explorer that can't be written where it was asked to be,
+// and a builder that was already written
+bool TestWriteFailures() {
+    const std::vector<Game> games = ParseGames(GeneratePgn(200, 4));
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "opening_explorer_test_runs";
+    std::filesystem::create_directories(directory);
+
+    OpeningExplorerBuilder::Options options;
+    options.BufferedMoves = 500;
+    options.TemporaryDirectory = directory;
+
+    OpeningExplorerBuilder first(options), second(options);
+    bool passed = true;
+    for (const Game& game : games)
+        passed &= first.AddGame(game) && second.AddGame(game);
+
+    // Every run has a file of its own
+    const size_t runs = first.GetRunCount() + second.GetRunCount();
+    passed &= first.GetRunCount() > 5 && (size_t)std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()) == runs;
+
+    // A directory that doesn't exist: nothing is merged, and the runs are kept for another try
+    const std::filesystem::path missing = directory / "missing" / "explorer.bin";
+    passed &= !first.Write(missing) && !std::filesystem::exists(missing) && first.GetRunCount() != 0;
+
+    std::string files[2];
+    for (int i = 0; i < 2; i++) {
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / ("opening_explorer_test_write_" + std::to_string(i) + ".bin");
+        passed &= (i == 0 ? first : second).Write(path);
+        files[i] = ReadFile(path);
+        std::filesystem::remove(path);
+    }
+
+    passed &= !files[0].empty() && files[0] == files[1] && std::filesystem::is_empty(directory);
+
+    // The moves went to the first file, so there is nothing for a second one
+    const std::filesystem::path again = std::filesystem::temp_directory_path() / "opening_explorer_test_again.bin";
+    passed &= !first.Write(again) && !std::filesystem::exists(again) && !first.AddGame(games[0]);
+
+    std::filesystem::remove(directory);
+    return passed;
+}
+
+// Building from many games in runs, and looking up their positions
+bool TestBenchmark() {
+    const std::vector<Game> games = ParseGames(GeneratePgn(20000, 3));
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "opening_explorer_test_benchmark.bin";
+
+    OpeningExplorerBuilder::Options options;
+    options.BufferedMoves = 1 << 18;
+    OpeningExplorerBuilder builder(options);
+
+    bool passed = true;
+    size_t runs = 0;
+    const double buildSeconds = Time([&]() {
+        for (const Game& game : games)
+            passed &= builder.AddGame(game);
+
+        runs = builder.GetRunCount() + 1;
+        passed &= builder.Write(path);
+    });
+
+    // Positions of the games, in a random order
+    std::vector<Board> positions;
+    uint64_t seed = 8;
+    for (int i = 0; i < 10000; i++) {
+        Game game = games[Zobrist::NextRandom(seed) % games.size()];
+        game.ToBeginning();
+        for (uint64_t ply = Zobrist::NextRandom(seed) % 40; ply > 0 && game.Forward(); ply--);
+        positions.push_back(game.GetPosition());
+    }
+
+    OpeningExplorer explorer(path);
+    std::vector<ExplorerMove> moves;
+    size_t found = 0;
+    const int rounds = 20;
+    const double lookupSeconds = Time([&]() {
+        for (int round = 0; round < rounds; round++) {
+            for (const Board& position : positions)
+                found += explorer.GetMoves(position, moves) != 0;
+        }
+    });
+
+    std::cout << games.size() << " games, " << explorer.GetEntryCount() << " entries from " << runs << " runs in " << buildSeconds << "s\n";
+    std::cout << "Lookups: " << lookupSeconds / (rounds * positions.size()) * 1e6 << "us\n";
+
+    explorer.Close();
+    std::filesystem::remove(path);
+
+    // Only the positions at the end of a game have no moves
+    return passed && found > rounds * positions.size() * 9 / 10;
+}
+
+int main() {
+    std::cout << "Explorer: " << (TestExplorer() ? "passed" : "FAILED") << "\n";
+    std::cout << "Import: " << (TestImport() ? "passed" : "FAILED") << "\n";
+    std::cout << "Write failures: " << (TestWriteFailures() ? "passed" : "FAILED") << "\n";
+    std::cout << "Benchmark: " << (TestBenchmark() ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,221 @@
+#include "Chess/Game.h"
+#include "Chess/GameGenerator.h"
+#include "Chess/PgnImporter.h"
+#include "Chess/PgnReader.h"
+
+#include "Utility/MappedFile.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+static std::string GenerateGames(uint64_t games) {
+    GameGenerator::Options options;
+    options.Games = games;
+    options.Threads = 1;
+    options.Seed = 5;
+    options.MaxPlies = 200;
+    options.OutputFormat = GameGenerator::Format::PGN;
+
+    std::ostringstream output;
+    GameGenerator(options).Run(&output);
+    return output.str();
+}
+
+// The final position of every game, parsed one at a time
+static std::vector<std::string> ParseInOrder(std::string_view text) {
+    std::vector<size_t> offsets;
+    PgnScanner scanner(text);
+    size_t offset;
+    while (scanner.Next(offset))
+        offsets.push_back(offset);
+
+    offsets.push_back(text.size());
+
+    std::vector<std::string> positions;
+    for (size_t i = 0; i + 1 < offsets.size(); i++) {
+        try {
+            positions.push_back(Game(PgnScanner::GetGameText(text, offsets[i], offsets[i + 1])).GetPosition().ToFEN());
+        } catch (std::exception&) {
+            positions.push_back("");
+        }
+    }
+
+    return positions;
+}
+
+// Small batches and queues, so the stages wait for each other
+bool TestOrdered() {
+    const std::string text = GenerateGames(500) + "[Event \"Broken\"]\n\n1. e4 e5 2. Ke3 *\n";
+    const std::vector<std::string> expected = ParseInOrder(text);
+
+    PgnImporter::Options options;
+    options.Threads = 4;
+    options.BatchSize = 7;
+    options.QueueSize = 2;
+
+    size_t next = 0;
+    bool passed = true;
+    PgnImporter::Statistics statistics = PgnImporter(options).Import(text, [&](PgnImporter::ImportedGame& game) {
+        passed &= game.Index == next++;
+        passed &= game.Parsed ? game.Parsed->GetPosition().ToFEN() == expected[game.Index] : expected[game.Index].empty();
+    });
+
+    return passed && next == expected.size() && statistics.Games == expected.size() && statistics.Failures == 1;
+}
+
+bool TestUnordered() {
+    const std::string text = GenerateGames(300);
+
+    PgnImporter::Options options;
+    options.Threads = 3;
+    options.Ordered = false;
+    options.BatchSize = 5;
+    options.QueueSize = 1;
+
+    std::vector<int> seen(300);
+    PgnImporter::Statistics statistics = PgnImporter(options).Import(text, [&](PgnImporter::ImportedGame& game) {
+        seen.at(game.Index)++;
+    });
+
+    return statistics.Games == 300 && statistics.Failures == 0 && std::count(seen.begin(), seen.end(), 1) == 300;
+}
+
+// An exception from the callback stops the import (instead of leaving the other stages waiting)
+bool TestCallbackException() {
+    const std::string text = GenerateGames(300);
+
+    PgnImporter::Options options;
+    options.Threads = 2;
+    options.BatchSize = 4;
+    options.QueueSize = 1;
+
+    try {
+        PgnImporter(options).Import(text, [](PgnImporter::ImportedGame& game) {
+            if (game.Index == 50)
+                throw std::runtime_error("Stop");
+        });
+    } catch (std::runtime_error&) {
+        return true;
+    }
+
+    return false;
+}
+
+// Movetext that isn't SAN fails its game, and only its game
+bool TestCorruptMoves() {
+    const char* moves[] = { "hello", "zz9", "e9", "i4", "exd", "exd9", "e8=K", "e8Q", "Nz4", "Ni", "N", "Qa", "Kb9x", "N3x", "x" };
+
+    std::string text = GenerateGames(20);
+    for (const char* move : moves)
+        text += std::string("[Event \"Corrupt\"]\n\n1. e4 e5 2. ") + move + " Nc6 *\n\n" + GenerateGames(1);
+
+    PgnImporter::Options options;
+    options.Threads = 2;
+
+    bool passed = true;
+    uint64_t failures = 0;
+    PgnImporter::Statistics statistics = PgnImporter(options).Import(text, [&](PgnImporter::ImportedGame& game) {
+        if (!game.Parsed) {
+            passed &= !game.Error.empty();
+            failures++;
+        }
+    });
+
+    const size_t count = sizeof(moves) / sizeof(moves[0]);
+    return passed && failures == count && statistics.Failures == count && statistics.Games == 20 + 2 * count;
+}
+
+// Imports a file (or generated games) with more and more threads, which give the same games in the same order
+// More than one thread must be at least MIN_SPEEDUP times faster than one when there are several cores,
+// on a single core the speedups are only reported
+bool TestScaling(const char* path) {
+    constexpr double MIN_SPEEDUP = 1.2;
+
+    std::string generated;
+    std::string_view text;
+    MappedFile file;
+
+    if (path) {
+        if (!file.Open(path))
+            return false;
+
+        text = std::string_view((const char*)file.GetData(), file.GetSize());
+    } else {
+        generated = GenerateGames(5000);
+        text = generated;
+    }
+
+    const uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+    // 1, 2, 4, ... and the number of cores
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+
+    threadCounts.push_back(cores);
+
+    bool passed = true;
+    double oneThread = 0;
+    double bestSpeedup = 0;
+    PgnImporter::Statistics first;
+    std::vector<uint64_t> firstFailures;
+
+    for (uint32_t threads : threadCounts) {
+        PgnImporter::Options options;
+        options.Threads = threads;
+
+        // The indexes of the games that failed, and whether the games came in order
+        uint64_t next = 0;
+        bool ordered = true;
+        std::vector<uint64_t> failures;
+
+        PgnImporter::Statistics statistics = PgnImporter(options).Import(text, [&](PgnImporter::ImportedGame& game) {
+            ordered &= game.Index == next++;
+            if (!game.Parsed)
+                failures.push_back(game.Index);
+        });
+
+        if (threads == 1) {
+            oneThread = statistics.Seconds;
+            first = statistics;
+            firstFailures = failures;
+        } else {
+            bestSpeedup = std::max(bestSpeedup, oneThread / statistics.Seconds);
+        }
+
+        passed &= ordered && next == statistics.Games && failures.size() == statistics.Failures;
+        passed &= statistics.Games == first.Games && statistics.Failures == first.Failures && failures == firstFailures;
+
+        statistics.Report(std::cout);
+        std::cout << "Speedup: " << oneThread / statistics.Seconds << "\n\n";
+    }
+
+    if (cores > 1) {
+        std::cout << "Best speedup: " << bestSpeedup << " (at least " << MIN_SPEEDUP << " on " << cores << " cores)\n";
+        passed &= bestSpeedup >= MIN_SPEEDUP;
+    } else {
+        std::cout << "One core: the speedup is only a benchmark\n";
+    }
+
+    return passed && first.Games != 0;
+}
+
+int main(int argc, char** argv) {
+    bool ordered = TestOrdered();
+    std::cout << "Ordered: " << (ordered ? "passed" : "FAILED") << "\n";
+
+    bool unordered = TestUnordered();
+    std::cout << "Unordered: " << (unordered ? "passed" : "FAILED") << "\n";
+
+    bool exception = TestCallbackException();
+    std::cout << "Callback exception: " << (exception ? "passed" : "FAILED") << "\n";
+
+    bool corrupt = TestCorruptMoves();
+    std::cout << "Corrupt moves: " << (corrupt ? "passed" : "FAILED") << "\n";
+
+    bool scaling = TestScaling(argc > 1 ? argv[1] : nullptr);
+    std::cout << "Scaling: " << (scaling ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,185 @@
+#include "Chess/ChessException.h"
+#include "Chess/Game.h"
+#include "Chess/GameGenerator.h"
+#include "Chess/PgnLexer.h"
+#include "Utility/StringParser.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The tokens as "<type>:<text>", with the number of move numbers and NAGs, and the value of tags
+static std::string Describe(std::string_view pgn) {
+    static const char* types[] = { "tag", "number", "move", "nag", "comment", "(", ")", "result" };
+
+    std::string description;
+    PgnLexer lexer(pgn);
+    PgnToken token;
+    while (lexer.Next(token)) {
+        if (!description.empty())
+            description += ' ';
+
+        description += types[(int)token.Type];
+        description += ':';
+        description += token.Text;
+
+        if (token.Type == PgnTokenType::Tag)
+            description += "=" + (token.Escaped ? PgnLexer::Unescape(token.Value) : std::string(token.Value));
+        else if (token.Type == PgnTokenType::MoveNumber || token.Type == PgnTokenType::Nag)
+            description += "=" + std::to_string(token.Number);
+    }
+
+    return description;
+}
+
+static bool Throws(std::string_view pgn) {
+    try {
+        Describe(pgn);
+        return false;
+    } catch (const InvalidPgnException&) {
+        return true;
+    }
+}
+
+bool TestTokens() {
+    const std::string pgn =
+        "[Event \"A \\\"quoted\\\" \\\\ name\"]\n"
+        "[ Site  \"Here\" ]\n"
+        "% A line for another program [Tag \"no\"]\n"
+        "\n"
+        "1.e4 e5!? 2. Nf3 $14 {A comment\n"
+        "on two lines} Nc6 ; The rest of the line\r\n"
+        "3... Bb5?! (3. Bc4) 3... a6 4.Ba4 Nf6 5. O-O Be7 6. Re1 b5 7. Bb3 d6 8. c3 O-O 9. h3 Na5 10. Bc2 c5 11. d4 Qc7 12. Nbd2 cxd4 "
+        "13. cxd4 Nc6 14. Nb3 a5 15. Be3 a4 16. Nbd2 Bd7 17. Rc1 Qb7 18. Qe2 Rfe8 19. a3 Bf8 20. Bd3 g6 21. Qf1 Bg7 22. d5 Nd8 "
+        "23. Bb1 e8=Q+ exf8=N# 1/2-1/2";
+
+    const std::string expected =
+        "tag:Event=A \"quoted\" \\ name tag:Site=Here "
+        "number:1=1 move:e4 move:e5 nag:!?=5 number:2=2 move:Nf3 nag:$14=14 comment:A comment\non two lines move:Nc6 "
+        "comment: The rest of the line number:3=3 move:Bb5 nag:?!=6 (:( number:3=3 move:Bc4 ):) number:3=3 move:a6 "
+        "number:4=4 move:Ba4 move:Nf6 number:5=5 move:O-O";
+
+    std::string description = Describe(pgn);
+    bool passed = description.substr(0, expected.size()) == expected;
+    const std::string end = "move:Bb1 move:e8=Q+ move:exf8=N# result:1/2-1/2";
+    passed &= description.size() > end.size() && description.substr(description.size() - end.size()) == end;
+
+    // Annotations and results on their own
+    passed &= Describe("e4! e5? Nf3!! Nc6?? *") == "move:e4 nag:!=1 move:e5 nag:?=2 move:Nf3 nag:!!=3 move:Nc6 nag:\?\?=4 result:*";
+    passed &= Describe("1. e4 1-0 0-1") == "number:1=1 move:e4 result:1-0 result:0-1";
+    passed &= Describe("{Not closed") == "comment:Not closed";
+    passed &= Describe("1 ... e5") == "number:1=1 move:e5";
+
+    passed &= Throws("1. e4 <e5>") && Throws("[Event \"Not closed]") && Throws("[Event]") && Throws("1. e4 $");
+
+    // Symbols that aren't SAN moves
+    passed &= Describe("Nbd7 R1e2 Qh4xe1 exd6 d8=Q+ O-O-O#") == "move:Nbd7 move:R1e2 move:Qh4xe1 move:exd6 move:d8=Q+ move:O-O-O#";
+    for (const char* move : { "hello", "zz9", "e9", "i4", "exd", "e8=K", "Nz4", "Qa", "O-O-O-O", "e4x", "Kb9x", "0-0", "e4+#" })
+        passed &= Throws(std::string("1. ") + move);
+
+    // Where each token starts
+    PgnLexer lexer("1. e4  {c}");
+    PgnToken token;
+    lexer.Next(token);
+    passed &= token.Offset == 0;
+    lexer.Next(token);
+    passed &= token.Offset == 3;
+    lexer.Next(token);
+    passed &= token.Offset == 7 && !lexer.Next(token) && lexer.GetOffset() == 10;
+
+    return passed;
+}
+
+// The parts of PGN that the tokens are used for in a game
+bool TestGames() {
+    Game game("[Event \"The \\\"Immortal\\\" game\"]\n% Skipped\n[Result \"1-0\"]\n\n"
+        "1.e4 e5 2.f4!? exf4 $6 3.Bc4 Qh4+ {A} {B} 4.Kf1 b5 ; Bryan's countergambit\n"
+        "5. Bxb5 Nf6 (5... c6) (5... Qf6 6. Nc3) 6. Nf3 Qh6 7. d3 Nh5 1-0 8. Nh4");
+
+    bool passed = game.GetHeader("Event") == "The \"Immortal\" game";
+    passed &= game.ToPGN().substr(game.ToPGN().find("\n\n") + 2) ==
+        "1. e4 e5 2. f4 exf4 3. Bc4 Qh4+ {A B} 4. Kf1 b5 {Bryan's countergambit} 5. Bxb5 Nf6 (5... c6) (5... Qf6 6. Nc3) "
+        "6. Nf3 Qh6 7. d3 Nh5";
+
+    // The quotes in the tag are escaped again
+    passed &= game.ToPGN().find("[Event \"The \\\"Immortal\\\" game\"]") == 0;
+
+    try {
+        Game unmatched("1. e4 e5)");
+        passed = false;
+    } catch (const InvalidPgnException&) {}
+
+    // A variation has to replace a move
+    try {
+        Game variation("( 1. e4 ) 1. d4 d5");
+        passed = false;
+    } catch (const InvalidPgnException& e) {
+        passed &= std::string(e.what()).find("Variation before any move") != std::string::npos;
+    }
+
+    return passed;
+}
+
+// Lexes generated games, and compares that with splitting them into tokens at whitespace with StringParser
+bool TestBenchmark() {
+    GameGenerator::Options options;
+    options.Games = 5000;
+    options.Threads = 1;
+    options.Seed = 11;
+    options.MaxPlies = 200;
+    options.OutputFormat = GameGenerator::Format::PGN;
+
+    std::ostringstream output;
+    GameGenerator(options).Run(&output);
+    const std::string pgn = output.str();
+    const double megabytes = pgn.size() / 1e6;
+
+    auto time = [](auto function) {
+        const auto startTime = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    uint64_t moves = 0, tags = 0;
+    const double lexerSeconds = time([&]() {
+        PgnLexer lexer(pgn);
+        PgnToken token;
+        while (lexer.Next(token)) {
+            moves += token.Type == PgnTokenType::Move;
+            tags += token.Type == PgnTokenType::Tag;
+        }
+    });
+
+    uint64_t words = 0;
+    const double splitSeconds = time([&]() {
+        StringParser sp(std::string_view{ pgn });
+        while (sp.Next<std::string_view>())
+            words++;
+    });
+
+    // Every game has the same moves as its parsed game
+    uint64_t plies = 0;
+    for (size_t begin = pgn.find("[Event "); begin != std::string::npos;) {
+        const size_t end = pgn.find("[Event ", begin + 1);
+        const Game game(std::string_view(pgn).substr(begin, end - begin));
+
+        for (NodeIndex n = game.GetNode(Game::GetRoot()).FirstChild; n != NO_NODE; n = game.GetNode(n).FirstChild)
+            plies++;
+
+        begin = end;
+    }
+
+    std::cout << megabytes << "MB, " << moves << " moves, " << tags << " tags\n";
+    std::cout << "PgnLexer: " << megabytes / lexerSeconds << "MB/s\n";
+    std::cout << "StringParser (whitespace only): " << megabytes / splitSeconds << "MB/s, " << words << " words\n";
+
+    return moves == plies && tags >= options.Games * 7;
+}
+
+int main() {
+    std::cout << "Tokens: " << (TestTokens() ? "passed" : "FAILED") << "\n";
+    std::cout << "Games: " << (TestGames() ? "passed" : "FAILED") << "\n";
+    std::cout << "Benchmark: " << (TestBenchmark() ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,172 @@
+#include "Chess/Game.h"
+#include "Chess/GameGenerator.h"
+#include "Chess/PgnReader.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static void WriteFile(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+}
+
+// A byte order mark, a comment with a line that looks like a tag, a game without a Result tag,
+// and Windows line endings
+static const std::string s_Games =
+    "\xEF\xBB\xBF[Event \"One\"]\n[White \"Morphy\"]\n[Result \"1-0\"]\n\n"
+    "1. e4 e5 2. Nf3 d6 {A comment\n[that is not a tag]} 3. d4 1-0\n\n"
+    "[Event \"Two\"]\n\n"
+    "1. d4 d5 2. c4 ; The rest of the line { is a comment\n2... e6\n\n\n"
+    "[Event \"Three\"]\r\n[Result \"0-1\"]\r\n\r\n1. f3 e5 2. g4 Qh4# 0-1\r\n";
+
+bool TestReader() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "pgn_reader_test.pgn";
+    WriteFile(path, s_Games);
+    std::filesystem::remove(PgnReader::GetIndexPath(path));
+
+    PgnReader reader(path);
+    if (!reader.IsOpen() || reader.IsIndexLoaded() || reader.GetGameCount() != 3)
+        return false;
+
+    std::unique_ptr<Game> first = reader.ReadGame(0);
+    std::unique_ptr<Game> second = reader.ReadGame(1);
+    std::unique_ptr<Game> third = reader.ReadGame(2);
+
+    bool passed = first->GetHeader("White") == "Morphy" && first->CurrentPly() == 5;
+    passed &= second->GetHeader("Event") == "Two" && second->CurrentPly() == 4;
+    passed &= third->GetHeader("Result") == "0-1" && third->CurrentPly() == 4;
+    passed &= third->GetPosition().IsInCheck() && !third->GetPosition().HasLegalMoves(White);
+
+    // The saved offsets are used when the file is opened again, until the file changes
+    const uint64_t lastOffset = reader.GetGameOffset(2);
+    passed &= reader.SaveIndex();
+
+    reader.Open(path);
+    passed &= reader.IsIndexLoaded() && reader.GetGameCount() == 3 && reader.GetGameOffset(2) == lastOffset;
+
+    WriteFile(path, s_Games + "\n[Event \"Four\"]\n\n1. e4 *\n");
+    reader.Open(path);
+    passed &= !reader.IsIndexLoaded() && reader.GetGameCount() == 4;
+
+    reader.Close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(PgnReader::GetIndexPath(path));
+
+    return passed;
+}
+
+// An index with offsets out of order, or that don't end at the end of the file, is scanned again instead of used
+bool TestCorruptIndex() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "pgn_reader_corrupt_test.pgn";
+    WriteFile(path, s_Games);
+    std::filesystem::remove(PgnReader::GetIndexPath(path));
+
+    PgnReader reader(path);
+    const uint64_t secondOffset = reader.GetGameOffset(1);
+    bool passed = true;
+
+    // The offsets of the 3 games and the end of the file follow the 32-byte header
+    const std::pair<size_t, uint64_t> corruptions[] = {
+        { 0, secondOffset + 1 },           // After the second game
+        { 1, s_Games.size() + 1 },         // Past the end of the file
+        { 2, secondOffset - 1 },           // Before the game before it
+        { 3, s_Games.size() - 1 },         // Ends before the end of the file
+        { 3, ~0ull },
+    };
+
+    for (const auto& [index, offset] : corruptions) {
+        // The index of the last corruption was rejected, so this saves a new one
+        reader.Open(path);
+        passed &= reader.SaveIndex();
+        reader.Close();
+
+        std::fstream file(PgnReader::GetIndexPath(path), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(32 + index * sizeof(uint64_t));
+        file.write((const char*)&offset, sizeof(offset));
+        file.close();
+
+        reader.Open(path);
+        passed &= !reader.IsIndexLoaded() && reader.GetGameCount() == 3 && reader.GetGameOffset(1) == secondOffset;
+        passed &= reader.ReadGame(2)->GetHeader("Event") == "Three";
+    }
+
+    reader.Close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(PgnReader::GetIndexPath(path));
+
+    return passed;
+}
+
+// Scans a file (generated if none is given), then parses every game
+bool TestBenchmark(std::filesystem::path path) {
+    const bool generated = path.empty();
+    if (generated) {
+        path = std::filesystem::temp_directory_path() / "pgn_reader_benchmark.pgn";
+
+        GameGenerator::Options options;
+        options.Games = 5000;
+        options.Seed = 3;
+        options.MaxPlies = 200;
+        options.OutputFormat = GameGenerator::Format::PGN;
+
+        std::ofstream file(path, std::ios::binary);
+        GameGenerator(options).Run(&file);
+    }
+
+    std::filesystem::remove(PgnReader::GetIndexPath(path));
+
+    auto start = std::chrono::steady_clock::now();
+    PgnReader reader(path);
+    const double scanTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!reader.IsOpen())
+        return false;
+
+    const double megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    std::cout << reader.GetGameCount() << " games in " << megabytes << "MB, scanned in " << scanTime * 1000 << "ms (";
+    std::cout << megabytes / scanTime << "MB/s)\n";
+
+    reader.SaveIndex();
+    start = std::chrono::steady_clock::now();
+    PgnReader indexed(path);
+    const double indexTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Opened with the index in " << indexTime * 1000 << "ms\n";
+
+    bool passed = indexed.IsIndexLoaded() && indexed.GetGameCount() == reader.GetGameCount();
+
+    size_t failed = 0;
+    uint64_t plies = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < indexed.GetGameCount(); i++) {
+        try {
+            plies += indexed.ReadGame(i)->CurrentPly();
+        } catch (std::exception&) {
+            failed++;
+        }
+    }
+    const double parseTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Parsed in " << parseTime << "s: " << indexed.GetGameCount() / parseTime << " games/s, ";
+    std::cout << plies / parseTime << " plies/s, " << failed << " failed\n";
+
+    indexed.Close();
+    reader.Close();
+    std::filesystem::remove(PgnReader::GetIndexPath(path));
+    if (generated)
+        std::filesystem::remove(path);
+
+    return passed && (!generated || (failed == 0 && plies > 0));
+}
+
+int main(int argc, char** argv) {
+    bool reader = TestReader();
+    std::cout << "Reader: " << (reader ? "passed" : "FAILED") << "\n";
+
+    bool corruptIndex = TestCorruptIndex();
+    std::cout << "Corrupt index: " << (corruptIndex ? "passed" : "FAILED") << "\n";
+
+    bool benchmark = TestBenchmark(argc > 1 ? argv[1] : "");
+    std::cout << "Benchmark: " << (benchmark ? "passed" : "FAILED") << "\n";
+}
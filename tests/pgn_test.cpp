@@ -1,6 +1,64 @@
 #include "Chess/Game.h"
-
+#include "Chess/GameTraversal.h"
+#include "Chess/PgnWriter.h"
+#include "Chess/Zobrist.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// Counts the allocations, for TestAllocations()
+static std::atomic<uint64_t> s_Allocations = 0;
+
+void* operator new(size_t size) {
+	s_Allocations++;
+	if (void* p = std::malloc(size))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+// The arenas of the games are allocated with an alignment
+void* operator new(size_t size, std::align_val_t alignment) {
+	s_Allocations++;
+#if defined(_WIN32)
+	void* p = _aligned_malloc(size, (size_t)alignment);
+#else
+	void* p = std::aligned_alloc((size_t)alignment, (size + (size_t)alignment - 1) / (size_t)alignment * (size_t)alignment);
+#endif
+	if (p)
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+#if defined(_WIN32)
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void operator delete(void* p, size_t, std::align_val_t alignment) noexcept {
+	operator delete(p, alignment);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
 
 bool TestLongAlgebraicMove() {
 	Game game;
@@ -368,14 +426,14 @@ bool TestGameTraversal() {
 		game.Seek(7);
 		std::cout << "Current position:\n" << game.GetPosition() << "\n";
 
-		Branch* mainLine = game.CurrentVariation();
+		NodeIndex mainLine = game.CurrentNode();
 
 		std::cout << "Going the end of the Grunfeld variation...\n";
 		game.Move(AlgebraicMove("d5"));
 		game.Seek(14);
 		std::cout << "Current position:\n" << game.GetPosition() << "\n";
 
-		Branch* grunfeldVariation = game.CurrentVariation();
+		NodeIndex grunfeldVariation = game.CurrentNode();
 
 		try {
 			game.Seek(15);
@@ -389,19 +447,19 @@ bool TestGameTraversal() {
 		std::cout << "Current position:\n" << game.GetPosition() << "\n";
 
 		std::cout << "----------------------------------\n";
-		std::cout << "Testing Seek(uint32_t, Branch*)...\n";
+		std::cout << "Testing GoTo(NodeIndex)...\n";
 
 		std::cout << "Going to move 6 in Grunfeld variation...\n";
-		game.Seek(11, grunfeldVariation);
+		game.GoTo(game.GetNodeAtPly(11, grunfeldVariation));
 		std::cout << "Current position:\n" << game.GetPosition() << "\n";
 
 		std::cout << "Going to move 41 in main line...\n";
-		game.Seek(81, mainLine);
+		game.GoTo(game.GetNodeAtPly(81, mainLine));
 		std::cout << "Current position:\n" << game.GetPosition() << "\n";
 
 		std::cout << "Seeking over multiple branches...\n";
-		game.Seek(1, mainLine);
-		game.Seek(82, mainLine);
+		game.GoTo(game.GetNodeAtPly(1, mainLine));
+		game.GoTo(game.GetNodeAtPly(82, mainLine));
 		std::cout << "Current position:\n" << game.GetPosition() << "\n";
 	}
 	catch (std::exception& e) {
@@ -441,7 +499,7 @@ Nxd7 {And now for the memorable checkmating combination:} 16. Qb8+ Nxb8 17. Rd8#
 		std::cout << "Game PGN:\n" << game << "\n";
 
 		std::cout << "Deleting from move 16...\n";
-		game.Delete(31, game.CurrentVariation());
+		game.Delete(game.GetNodeAtPly(31));
 		std::cout << "Game PGN:\n" << game << "\n";
 
 		std::cout << "Clearing comment...\n";
@@ -450,21 +508,21 @@ Nxd7 {And now for the memorable checkmating combination:} 16. Qb8+ Nxb8 17. Rd8#
 
 		game.Seek(3);
 		std::cout << "Deleting main line from ply 4...\n";
-		game.Delete(4, game.CurrentVariation());
+		game.Delete(game.GetNodeAtPly(4));
 		std::cout << "Game PGN:\n" << game << "\n";
 
 		// Get pointer for petrov branch
 		game.Move(AlgebraicMove("Nf6"));
-		Branch* petrov = game.CurrentVariation();
+		NodeIndex petrov = game.CurrentNode();
 		game.Back();
 
 		std::cout << "Deleting move 4 from petrov variation...\n";
-		game.Delete(7, petrov);
+		game.Delete(game.GetNodeAtPly(7, petrov));
 		std::cout << "Game PGN: " << game << "\n";
 
 		std::cout << "Going to end and deleting from move 2...\n";
 		game.ToEnd();
-		game.Delete(3, game.CurrentVariation());
+		game.Delete(game.GetNodeAtPly(3));
 		std::cout << "Game PGN: " << game << "\n";
 		std::cout << game.GetPosition() << "\n";
 	}
@@ -476,6 +534,511 @@ Nxd7 {And now for the memorable checkmating combination:} 16. Qb8+ Nxb8 17. Rd8#
 	return true;
 }
 
+// Writing a game and parsing it again gives the same tree, copies are independent,
+// and deleted nodes are reused
+bool TestGameTree() {
+	std::string pgn = "[Event \"Tree\"]\n\n{Before the first move} 1. e4 (1. d4 d5 (1... Nf6 2. c4) 2. c4 {Queen's gambit}) "
+		"1... e5 2. Nf3 Nc6 (2... d6 {Philidor}) (2... Nf6) 3. Bb5 a6";
+
+	Game game(pgn);
+	const std::string written = game.ToPGN();
+
+	Game parsed(written);
+	bool passed = parsed.ToPGN() == written && parsed.GetComment(Game::GetRoot()) == "Before the first move";
+
+	Game copy = parsed;
+	copy.ToBeginning();
+	copy.Move(AlgebraicMove("c4"));
+	copy.SetComment("English");
+	passed &= parsed.ToPGN() == written && copy.ToPGN() != written;
+
+	// Delete 1... Nf6 2. c4, then play the same moves again in the nodes that were freed
+	const NodeIndex d4 = parsed.GetNode(parsed.GetNodeAtPly(1, Game::GetRoot())).NextSibling;
+	const NodeIndex d5 = parsed.GetNode(d4).FirstChild;
+	const NodeIndex nf6 = parsed.GetNode(d5).NextSibling;
+	const NodeIndex c4 = parsed.GetNode(nf6).FirstChild;
+	parsed.Delete(nf6);
+	passed &= parsed.ToPGN() != written;
+
+	parsed.GoTo(d4);
+	parsed.Move(AlgebraicMove("Nf6"));
+	passed &= parsed.CurrentNode() == nf6 || parsed.CurrentNode() == c4;
+	parsed.Move(AlgebraicMove("c4"));
+	passed &= parsed.CurrentNode() == nf6 || parsed.CurrentNode() == c4;
+	passed &= parsed.ToPGN() == written;
+
+	std::cout << written << "\n";
+	return passed;
+}
+
+// Jumping to a node from a checkpoint gives the same position as playing every move from the start
+bool TestCheckpoints() {
+	std::string pgn = "1. e4 e5 2. Nf3 Nc6 3. Bb5 (3. Bc4 Bc5 (3... Nf6 4. Ng5 d5 5. exd5 Na5) 4. c3 Nf6 5. d4 exd4 6. O-O) "
+		"3... a6 4. Ba4 Nf6 5. O-O Be7 (5... b5 6. Bb3 Bc5) 6. Re1 b5 7. Bb3 d6 8. c3 O-O 9. h3 Nb8 10. d4 Nbd7 "
+		"11. Nbd2 Bb7 12. Bc2 Re8 (12... c5 13. d5) 13. Nf1 Bf8 14. Ng3 g6 15. a4 c5 16. d5 c4 17. Bg5 h6 18. Be3 Nc5 "
+		"19. Qd2 h5 (19... Kh7 20. Nh2) 20. Bg5 Be7 21. Ra3 Nh7 22. Bxe7 Qxe7 23. Rea1 Nf6 24. axb5 axb5 25. Rxa8 Rxa8";
+
+	Game game(pgn);
+
+	// Every node of the tree, with the position after it from playing the moves from the start
+	std::vector<NodeIndex> nodes;
+	std::vector<std::string> positions;
+
+	std::vector<std::pair<NodeIndex, Board>> stack = { { Game::GetRoot(), Board() } };
+	while (!stack.empty()) {
+		auto [node, board] = stack.back();
+		stack.pop_back();
+
+		nodes.push_back(node);
+		positions.push_back(board.ToFEN());
+
+		for (NodeIndex child = game.GetNode(node).FirstChild; child != NO_NODE; child = game.GetNode(child).NextSibling) {
+			const GameMove& move = game.GetNode(child).Move;
+			Board next = board;
+			next.Move(LongAlgebraicMove(move.Start, move.Destination, (PieceType)(move.Flags & GameMoveFlag::PromotionFlags)));
+			stack.emplace_back(child, next);
+		}
+	}
+
+	bool passed = nodes.size() > 60;
+
+	for (uint32_t interval : { 0, 1, 4, 16 }) {
+		game.SetCheckpointInterval(interval);
+
+		// Forwards, backwards, then jumping around
+		for (int pass = 0; pass < 3; pass++) {
+			for (size_t i = 0; i < nodes.size(); i++) {
+				size_t j = pass == 0 ? i : pass == 1 ? nodes.size() - 1 - i : (i * 37) % nodes.size();
+
+				game.GoTo(nodes[j]);
+				passed &= game.CurrentNode() == nodes[j] && game.GetPosition().ToFEN() == positions[j];
+			}
+		}
+
+		game.Seek(0);
+		passed &= game.GetPosition().ToFEN() == Board().ToFEN();
+
+		std::cout << "Interval " << interval << ": " << game.GetCheckpointCount() << " checkpoints\n";
+		passed &= interval != 0 || game.GetCheckpointCount() == 0;
+	}
+
+	return passed;
+}
+
+// The walk visits every node once in the order of the PGN, with the position after each move,
+// and trees too deep for recursion are written and read back
+bool TestTreeWalk() {
+	Game game("1. e4 e5 2. Nf3 Nc6 3. Bb5 (3. Bc4 Bc5 (3... Nf6 4. Ng5 d5 5. exd5 Na5) 4. c3 Nf6 5. d4 exd4 6. O-O) "
+		"3... a6 4. Ba4 Nf6 5. O-O Be7 (5... b5 6. Bb3 Bc5) (5... Nxe4) 6. Re1 b5 7. Bb3 d6 8. c3 O-O 9. h3 Nb8");
+
+	// The moves in the order of the walk, as SAN, with the variations in parentheses
+	std::string walked;
+	std::vector<NodeIndex> starts;
+	std::vector<bool> visited(1000);
+	uint32_t maxDepth = 0;
+	bool passed = true;
+
+	auto withoutCounters = [](const Board& board) {
+		const std::string fen = board.ToFEN();
+		return fen.substr(0, fen.rfind(' ', fen.rfind(' ') - 1));
+	};
+
+	GameTraversal traversal(game, true);
+	GameTraversal::Event event;
+	while (traversal.Next(event)) {
+		switch (event.Type) {
+			case GameTraversal::EventType::Move: {
+				walked += (walked.empty() || walked.back() == '(' ? "" : " ") + game.GetNode(event.Node).San.ToString();
+				passed &= !visited[event.Node] && traversal.GetLength() == game.GetNode(event.Node).Ply;
+				visited[event.Node] = true;
+
+				// The same position as going to the node (Game doesn't keep the move counters when it goes back)
+				game.GoTo(event.Node);
+				passed &= withoutCounters(traversal.GetPosition()) == withoutCounters(game.GetPosition());
+				break;
+			}
+			case GameTraversal::EventType::StartVariation:
+				walked += " (";
+				starts.push_back(event.Node);
+				passed &= event.Depth == starts.size();
+				maxDepth = std::max(maxDepth, event.Depth);
+				break;
+			case GameTraversal::EventType::EndVariation:
+				walked += ")";
+				passed &= !starts.empty() && starts.back() == event.Node && event.Depth == starts.size();
+				starts.pop_back();
+				break;
+		}
+	}
+
+	// The walk ends at the end of the main line
+	game.ToEnd();
+	passed &= starts.empty() && maxDepth == 2 && traversal.GetLength() == game.CurrentPly();
+	passed &= withoutCounters(traversal.GetPosition()) == withoutCounters(game.GetPosition());
+	passed &= walked == "e4 e5 Nf3 Nc6 Bb5 (Bc4 Bc5 (Nf6 Ng5 d5 exd5 Na5) c3 Nf6 d4 exd4 O-O) a6 Ba4 Nf6 O-O Be7 (b5 Bb3 Bc5) (Nxe4) "
+		"Re1 b5 Bb3 d6 c3 O-O h3 Nb8";
+
+	// Each variation nested in the one before it: the knights go out and back, and each move has another one as the main line
+	const char* mainMoves[] = { "Nf3", "Nf6", "Nf4", "Nf5" };
+	const char* variationMoves[] = { "Nh3", "Nh6", "Ng1", "Ng8" };
+
+	Game deep;
+	const uint32_t depth = 20000;
+	for (uint32_t i = 0; i < depth; i++) {
+		deep.Move(AlgebraicMove(mainMoves[i % 4]));
+		deep.Back();
+		deep.Move(AlgebraicMove(variationMoves[i % 4]));
+	}
+
+	const std::string written = deep.ToPGN();
+	Game parsed(written);
+	passed &= parsed.ToPGN() == written;
+
+	uint64_t nodes = 0;
+	maxDepth = 0;
+	const auto startTime = std::chrono::steady_clock::now();
+	for (GameTraversal walk(parsed, true); walk.Next(event);) {
+		nodes += event.Type == GameTraversal::EventType::Move;
+		maxDepth = std::max(maxDepth, event.Depth);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	passed &= nodes == depth * 2 && maxDepth == depth;
+
+	std::cout << walked << "\n";
+	std::cout << depth << " nested variations, walked with positions at " << nodes / seconds / 1e6 << " M nodes/s\n";
+	return passed;
+}
+
+// The SAN saved in the nodes is written as it would be after playing the moves again,
+// and the wrapped lines are read back as the same game
+bool TestPgnWriter() {
+	// The check, the mate and the capture of the knight aren't in the moves
+	Game game("[Event \"Writer\"]\n[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 d6 3. Nxe5 dxe5 (3... Qe7 4. Bb5 c6 5. Nxc6) "
+		"4. Qh5 Nc6 5. Bc4 {Threatening mate} Nf6 6. Qxf7 1-0");
+
+	bool passed = game.ToPGN().find("3. Nxe5") != std::string::npos && game.ToPGN().find("6. Qxf7#") != std::string::npos;
+
+	std::string text;
+	{
+		PgnWriter writer(text, { 30 });
+		writer.Write(game);
+		writer.Write(game);
+	}
+
+	size_t lineStart = 0;
+	for (size_t lineEnd = text.find('\n'); lineEnd != std::string::npos; lineStart = lineEnd + 1, lineEnd = text.find('\n', lineStart))
+		passed &= lineEnd - lineStart <= 30;
+
+	// After the blank line at the end of the movetext
+	const size_t second = text.find(" 1-0\n\n") + 6;
+	passed &= text.substr(0, second) == text.substr(second);
+	// The order of the tags can change
+	auto movetext = [](const Game& g) { std::string pgn = g.ToPGN(); return pgn.substr(pgn.find("\n\n")); };
+	passed &= movetext(Game(text.substr(0, second))) == movetext(game);
+
+	std::cout << text.substr(0, second);
+	return passed;
+}
+
+// The common tags are typed, values that don't fit their type are kept as text,
+// and the Seven Tag Roster is written first
+bool TestHeader() {
+	std::string pgn = "[Annotator \"Fritz\"]\n[WhiteElo \"2780\"]\n[Black \"Kasparov, Garry\"]\n[Date \"1999.??.??\"]\n"
+		"[Result \"1/2-1/2\"]\n[BlackElo \"?\"]\n[ECO \"B90\"]\n[Event \"Wijk aan Zee\"]\n[Round \"4.1\"]\n[White \"Anand, Viswanathan\"]\n"
+		"[Site \"Wijk aan Zee NED\"]\n[TimeControl \"40/7200\"]\n\n1. e4 c5 1/2-1/2";
+
+	Game game(pgn);
+	const GameHeader& header = game.GetHeader();
+
+	bool passed = header.GetWhite() == "Anand, Viswanathan" && header.GetResult() == GameResult::Draw;
+	passed &= header.GetDate().Year == 1999 && header.GetDate().Month == 0 && game.GetHeader("Date") == "1999.??.??";
+	passed &= header.GetWhiteElo() == 2780 && header.GetBlackElo() == 0 && game.GetHeader("BlackElo") == "?";
+	passed &= header.GetECO() == "B90" && game.GetHeader("Annotator") == "Fritz" && game.GetHeader("PlyCount").empty();
+
+	// Interned, so the same name in another game is the same memory
+	passed &= Game(pgn).GetHeader().GetBlack().data() == header.GetBlack().data();
+
+	const std::string written = game.ToPGN();
+	passed &= written.rfind("[Event \"Wijk aan Zee\"]\n[Site \"Wijk aan Zee NED\"]\n[Date \"1999.??.??\"]\n[Round \"4.1\"]\n", 0) == 0;
+	passed &= Game(written).ToPGN() == written;
+
+	// Only the text of the header, to measure parsing the tags
+	pgn.resize(pgn.find("\n\n") + 2);
+
+	const int games = 20000;
+	const uint64_t start = s_Allocations;
+	const auto startTime = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < games; i++)
+		Game header(pgn);
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	std::cout << double(s_Allocations - start) / games << " allocations per header, " << games / seconds << " headers/s, ";
+	std::cout << sizeof(GameHeader) << " bytes per header (with " << pgn.size() << " bytes of text)\n";
+
+	return passed;
+}
+
+// Games read from the binary format are the same as the games that were written,
+// and reading them is much faster than parsing the PGN
+bool TestSerialize() {
+	const std::string pgns[] = {
+		"[Event \"Serialize\"]\n[WhiteElo \"?\"]\n\n{Before the first move} 1. e4 (1. d4 d5 (1... Nf6 2. c4) 2. c4 {Queen's gambit}) "
+			"1... e5 2. Nf3 Nc6 (2... d6 {Philidor}) (2... Nf6) 3. Bb5 a6 4. Ba4 Nf6 5. O-O Be7 6. Re1 b5 7. Bb3 d6 8. c3 O-O",
+		"[FEN \"r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3\"]\n\n3. Bc4 Bc5 4. b4 Bxb4 5. c3",
+		"1. e4 d5 2. exd5 Qd6 3. Qf3 Qb6 4. d6 f6 5. d7+ Kf7 6. d8=N+ (6. dxc8=Q) 6... Ke8",
+		"1. e4 e5 2. Nf3 Nc6 3. Bb5 (3. Bc4 Bc5 (3... Nf6 4. Ng5 d5 5. exd5 Na5) 4. c3 Nf6 5. d4 exd4 6. O-O) "
+			"3... a6 4. Ba4 Nf6 5. O-O Be7 (5... b5 6. Bb3 Bc5) 6. Re1 b5 7. Bb3 d6 8. c3 O-O 9. h3 Nb8 10. d4 Nbd7 "
+			"11. Nbd2 Bb7 12. Bc2 Re8 (12... c5 13. d5) 13. Nf1 Bf8 14. Ng3 g6 15. a4 c5 16. d5 c4 17. Bg5 h6 18. Be3 Nc5 "
+			"19. Qd2 h5 (19... Kh7 20. Nh2) 20. Bg5 Be7 21. Ra3 Nh7 22. Bxe7 Qxe7 23. Rea1 Nf6 24. axb5 axb5 25. Rxa8 Rxa8",
+	};
+
+	std::string data;
+	std::vector<Game> games;
+	std::vector<std::pair<std::string, std::string>> expected;  // The PGN and the FEN of the current position
+	for (const std::string& pgn : pgns) {
+		Game& game = games.emplace_back(pgn);
+		game.Serialize(data);
+		expected.emplace_back(game.ToPGN(), game.GetPosition().ToFEN());
+	}
+
+	// Freed nodes aren't written, and the current node can be in a variation
+	Game& deleted = games[0];
+	deleted.Delete(deleted.GetNodeAtPly(5, Game::GetRoot()));
+	deleted.GoTo(deleted.GetNodeAtPly(2, deleted.GetNode(deleted.GetNode(Game::GetRoot()).FirstChild).NextSibling));
+	deleted.Serialize(data);
+	expected.emplace_back(deleted.ToPGN(), deleted.GetPosition().ToFEN());
+
+	// The same with or without playing every move
+	bool passed = true;
+	for (bool trusted : { false, true }) {
+		std::string_view remaining = data;
+		for (const auto& [pgn, fen] : expected) {
+			Game game;
+			remaining.remove_prefix(game.Deserialize(remaining, trusted));
+
+			passed &= game.ToPGN() == pgn;
+			passed &= game.GetPosition().ToFEN() == fen;
+		}
+
+		passed &= remaining.empty();
+	}
+
+	// The main line alone, the same as going forward in the game (also through a transposition)
+	Game& transposed = games.emplace_back("1. e4 (1. Nf3 Nc6 2. e4 e5 3. d4) 1... e5 2. Nf3 Nc6 3. Bc4 Bc5");
+	transposed.SetMergeTranspositions(true);
+
+	for (Game& game : games) {
+		std::string single, fen;
+		std::vector<LongAlgebraicMove> moves;
+		game.Serialize(single);
+		passed &= Game::DeserializeMainLine(single, fen, moves) == single.size();
+		passed &= fen == game.GetHeader("FEN");
+
+		game.ToBeginning();
+		for (LongAlgebraicMove move : moves) {
+			passed &= game.Forward();
+			const GameMove& gm = game.GetNode(game.CurrentNode()).Move;
+			passed &= gm.Start == move.SourceSquare && gm.Destination == move.DestinationSquare;
+		}
+
+		passed &= !game.Forward();
+	}
+
+	passed &= games.back().CurrentPly() > 4;
+	games.pop_back();
+
+	// Cut short
+	Game cut(pgns[2]);
+	passed &= cut.Deserialize(std::string_view(data).substr(0, 40)) == 0 && cut.ToPGN() == Game().ToPGN();
+
+	// Flipped bytes: the game is either empty or has only legal moves, which can be played again
+	// The checksum doesn't let any of them through as trusted data
+	std::string flipped;
+	games[3].Serialize(flipped);
+	uint64_t seed = 3, rejected = 0;
+	for (int i = 0; i < 3000; i++) {
+		std::string corrupt = flipped;
+		corrupt[Zobrist::NextRandom(seed) % corrupt.size()] ^= (char)(1 << (Zobrist::NextRandom(seed) % 8));
+
+		Game game;
+		passed &= game.Deserialize(corrupt, true) == 0;
+		if (game.Deserialize(corrupt) == 0) {
+			rejected++;
+			passed &= game.GetNode(Game::GetRoot()).FirstChild == NO_NODE;
+			continue;
+		}
+
+		// Every node can be gone to and written
+		passed &= !game.ToPGN().empty();
+		std::vector<NodeIndex> nodes = { Game::GetRoot() };
+		while (!nodes.empty()) {
+			const NodeIndex node = nodes.back();
+			nodes.pop_back();
+			game.GoTo(node);
+
+			for (NodeIndex child = game.GetNode(node).FirstChild; child != NO_NODE; child = game.GetNode(child).NextSibling)
+				nodes.push_back(child);
+		}
+	}
+
+	// Bytes of the moves are most of the data
+	passed &= rejected > 1000;
+
+	const Game& game = games.back();
+	std::string single;
+	game.Serialize(single);
+
+	const int count = 2000;
+	auto time = [count](auto function) {
+		const auto startTime = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+			function();
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	};
+
+	// Rounds of each one right after the other, so the machine runs them at the same speed, and the median round
+	const std::string pgn = game.ToPGN();
+	std::vector<std::array<double, 3>> rounds(9);
+	for (auto& [pgnSeconds, binarySeconds, trustedSeconds] : rounds) {
+		pgnSeconds = time([&pgn]() { Game game(pgn); });
+		binarySeconds = time([&single]() { Game game; game.Deserialize(single); });
+		trustedSeconds = time([&single]() { Game game; game.Deserialize(single, true); });
+	}
+
+	std::sort(rounds.begin(), rounds.end(), [](const std::array<double, 3>& a, const std::array<double, 3>& b) { return a[0] / a[2] < b[0] / b[2]; });
+	const auto [pgnSeconds, binarySeconds, trustedSeconds] = rounds[rounds.size() / 2];
+
+	std::cout << pgn.size() << " bytes of PGN: " << count / pgnSeconds << " games/s, ";
+	std::cout << single.size() << " bytes of binary: " << count / binarySeconds << " games/s (" << pgnSeconds / binarySeconds << "x), ";
+	std::cout << count / trustedSeconds << " games/s trusted (" << pgnSeconds / trustedSeconds << "x)\n";
+
+	return passed && pgnSeconds / trustedSeconds >= 10;
+}
+
+// Merging transpositions keeps the moves after a position in one node,
+// and the other lines that reach it continue from there
+bool TestTranspositions() {
+	Game game("1. e4 (1. Nf3 Nf6 2. Ng1 Ng8 3. g3) 1... e5 (1... Nc6 2. Nf3 e5 3. Bc4 {Same position} Bc5 4. d3 (4. O-O) Nf6 5. Nc3) "
+		"2. Nf3 Nc6 3. Bc4 {Italian} Bc5 4. c3");
+
+	const size_t pgnLength = game.ToPGN().size();
+	game.SetMergeTranspositions(true);
+
+	bool passed = game.GetMergeTranspositions();
+	passed &= game.ToPGN() == "1. e4 (1. Nf3 Nf6 2. Ng1 Ng8 3. g3) 1... e5 (1... Nc6 2. Nf3 e5 3. Bc4) "
+		"2. Nf3 Nc6 3. Bc4 {Italian Same position} 3... Bc5 4. c3 (4. d3 Nf6 5. Nc3) (4. O-O)";
+	passed &= game.ToPGN().size() < pgnLength;
+
+	// The 3. Bc4 of the variation transposes into the 3. Bc4 of the main line (repeating the start position isn't a transposition)
+	const NodeIndex e4 = game.GetNode(Game::GetRoot()).FirstChild;
+	const NodeIndex italian = game.GetNodeAtPly(5, e4);
+	const NodeIndex transposition = game.GetNodeAtPly(5, game.GetNode(game.GetNode(e4).FirstChild).NextSibling);
+
+	passed &= game.GetTransposition(transposition) == italian;
+	passed &= game.GetTransposition(italian) == NO_NODE;
+	passed &= game.GetTransposition(game.GetNodeAtPly(4, game.GetNode(e4).NextSibling)) == NO_NODE;
+	passed &= game.GetComment(transposition) == game.GetComment(italian);
+
+	// Forward() continues from the main line, and Back() returns through the transposition
+	game.GoTo(transposition);
+	passed &= game.Forward() && game.Forward() && game.CurrentNode() == game.GetNodeAtPly(7, italian);
+	passed &= game.Back() && game.Back() && game.CurrentNode() == transposition;
+	passed &= game.Back() && game.CurrentNode() == game.GetNode(transposition).Parent;
+
+	// New moves after a transposition are added to the node it transposes into
+	game.GoTo(transposition);
+	game.Move(AlgebraicMove("Nf6"));
+	passed &= game.GetNode(game.CurrentNode()).Parent == italian;
+
+	// Transposing while adding moves
+	game.ToBeginning();
+	for (const char* move : { "d4", "Nf6", "c4", "e6", "Nc3" })
+		game.Move(AlgebraicMove(move));
+
+	game.ToBeginning();
+	for (const char* move : { "c4", "e6", "d4", "Nf6" })
+		game.Move(AlgebraicMove(move));
+
+	const NodeIndex nf6 = game.CurrentNode();
+	passed &= game.GetTransposition(nf6) != NO_NODE && game.Forward() && game.GetNode(game.CurrentNode()).San.ToString() == "Nc3";
+
+	// The links are saved in the binary format
+	std::string data;
+	game.Serialize(data);
+
+	Game copy;
+	copy.Deserialize(data);
+	passed &= copy.ToPGN() == game.ToPGN();
+	const NodeIndex copyE4 = copy.GetNode(Game::GetRoot()).FirstChild;
+	passed &= copy.GetTransposition(copy.GetNodeAtPly(5, copy.GetNode(copy.GetNode(copyE4).FirstChild).NextSibling)) == copy.GetNodeAtPly(5, copyE4);
+
+	// Deleting the moves a transposition continues with leaves it at the end of its line
+	game.Delete(italian);
+	passed &= game.GetTransposition(transposition) == NO_NODE;
+	game.GoTo(transposition);
+	passed &= !game.Forward();
+
+	return passed;
+}
+
+// The nodes of a game are allocated in its arena, so a game with comments
+// and variations only needs a few allocations (mostly for the header)
+bool TestAllocations() {
+	std::string pgn = "[Event \"Allocations\"]\n\n1. e4 {The best by test} e5 (1... c5 {Sicilian} 2. Nf3 (2. c3) d6) "
+		"2. Nf3 {Attacking the pawn} Nc6 (2... d6 {Philidor} 3. d4) 3. Bb5 {The Ruy Lopez, named after a Spanish priest} a6 "
+		"4. Ba4 (4. Bxc6 {The exchange variation} dxc6) Nf6 5. O-O Be7 6. Re1 b5 7. Bb3 d6 8. c3 O-O 9. h3 Nb8";
+
+	const int games = 2000;
+	const uint64_t start = s_Allocations;
+	const auto startTime = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < games; i++)
+		Game game(pgn);
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	const double allocations = double(s_Allocations - start) / games;
+	std::cout << allocations << " allocations per game, " << games / seconds << " games/s\n";
+
+	return allocations <= 8;
+}
+
+// Comments, variations and checkpoints that are replaced or deleted give their memory back to the game,
+// which reuses it for the next ones, so editing a game over and over doesn't make it grow
+bool TestEditMemory() {
+	Game game("1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. Ba4 Nf6 5. O-O Be7");
+	game.SetCheckpointInterval(1);
+	std::string comment;
+	comment.reserve(600);
+	uint64_t seed = 7;
+
+	auto edit = [&game, &comment, &seed](int count) {
+		for (int i = 0; i < count; i++) {
+			const NodeIndex node = game.GetNodeAtPly(1 + Zobrist::NextRandom(seed) % 10, Game::GetRoot());
+			comment.assign(Zobrist::NextRandom(seed) % 600, (char)('a' + i % 26));
+			game.SetComment(node, comment);
+
+			// A variation with a comment, gone to (saving its checkpoints), then deleted
+			game.GoTo(game.GetNodeAtPly(4, Game::GetRoot()));
+			game.Move(AlgebraicMove("Bc4"));
+			game.Move(AlgebraicMove("Bc5"));
+			game.SetComment(comment);
+			game.Delete(game.GetNode(game.CurrentNode()).Parent);
+		}
+	};
+
+	// Once blocks of every size have been freed, the game only allocates when it needs more of one size at once than before
+	edit(2000);
+	const uint64_t start = s_Allocations;
+	edit(100000);
+
+	const uint64_t allocations = s_Allocations - start;
+	std::cout << allocations << " allocations for 100000 edits\n";
+	return allocations < 10 && game.GetComment(game.GetNodeAtPly(4, Game::GetRoot())).size() < 600;
+}
+
 int main() {
 	//TestLongAlgebraicMove();
 	//TestAlgebraicMove();
@@ -486,4 +1049,31 @@ int main() {
 	//TestCastling();
 	//TestGameTraversal();
 	TestGameDelete();
+
+	bool tree = TestGameTree();
+	std::cout << "Game tree: " << (tree ? "passed" : "FAILED") << "\n";
+
+	bool writer = TestPgnWriter();
+	std::cout << "PGN writer: " << (writer ? "passed" : "FAILED") << "\n";
+
+	bool header = TestHeader();
+	std::cout << "Header: " << (header ? "passed" : "FAILED") << "\n";
+
+	bool serialize = TestSerialize();
+	std::cout << "Serialize: " << (serialize ? "passed" : "FAILED") << "\n";
+
+	bool transpositions = TestTranspositions();
+	std::cout << "Transpositions: " << (transpositions ? "passed" : "FAILED") << "\n";
+
+	bool walk = TestTreeWalk();
+	std::cout << "Tree walk: " << (walk ? "passed" : "FAILED") << "\n";
+
+	bool checkpoints = TestCheckpoints();
+	std::cout << "Checkpoints: " << (checkpoints ? "passed" : "FAILED") << "\n";
+
+	bool allocations = TestAllocations();
+	std::cout << "Allocations: " << (allocations ? "passed" : "FAILED") << "\n";
+
+	bool edits = TestEditMemory();
+	std::cout << "Edit memory: " << (edits ? "passed" : "FAILED") << "\n";
 }
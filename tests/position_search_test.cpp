@@ -0,0 +1,353 @@
+#include "Chess/Game.h"
+#include "Chess/GameDatabase.h"
+#include "Chess/GameGenerator.h"
+#include "Chess/PositionSearch.h"
+#include "Chess/Zobrist.h"
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// A condition of a pattern, tested square by square in Matches() below
+struct Condition {
+    Piece Which;
+    BitBoard Squares;
+    bool Required;
+};
+
+static bool Matches(const Board& board, const std::vector<Condition>& conditions) {
+    for (const Condition& c : conditions) {
+        for (Square s = 0; s < 64; s++) {
+            if ((c.Squares >> s & 1) && (board[s] == c.Which) != c.Required)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static PositionPattern ToPattern(const std::vector<Condition>& conditions) {
+    PositionPattern pattern;
+    for (const Condition& c : conditions) {
+        if (c.Required)
+            pattern.Require(c.Which, c.Squares);
+        else
+            pattern.Forbid(c.Which, c.Squares);
+    }
+
+    return pattern;
+}
+
+static std::vector<Condition> RandomConditions(uint64_t& seed) {
+    static const Piece pieces[] = { WhitePawn, WhiteKnight, WhiteBishop, WhiteRook, WhiteQueen, WhiteKing,
+        BlackPawn, BlackKnight, BlackBishop, BlackRook, BlackQueen, BlackKing };
+
+    std::vector<Condition> conditions;
+    for (uint64_t i = Zobrist::NextRandom(seed) % 3 + 1; i > 0; i--) {
+        const Piece piece = pieces[Zobrist::NextRandom(seed) % 12];
+        if (Zobrist::NextRandom(seed) % 2)
+            conditions.push_back({ piece, 1ull << (Zobrist::NextRandom(seed) % 64), true });
+        else
+            conditions.push_back({ piece, Zobrist::NextRandom(seed) & Zobrist::NextRandom(seed), false });
+    }
+
+    return conditions;
+}
+
+// Generated games in a database
+static void AddGames(GameDatabase& database, uint64_t count, uint64_t seed) {
+    GameGenerator::Options options;
+    options.Games = count;
+    options.Threads = 1;
+    options.Seed = seed;
+    options.MaxPlies = 200;
+    options.OutputFormat = GameGenerator::Format::PGN;
+
+    std::ostringstream output;
+    GameGenerator(options).Run(&output);
+    const std::string pgn = output.str();
+
+    for (size_t begin = pgn.find("[Event "); begin != std::string::npos;) {
+        const size_t end = pgn.find("[Event ", begin + 1);
+        database.AddGame(Game(pgn.substr(begin, end - begin)));
+        begin = end;
+    }
+
+    database.BuildIndexes();
+}
+
+// The positions of the main line of a game, played with the game itself
+static std::vector<Board> GetPositions(const GameDatabase& database, GameId id) {
+    Game game = database.GetGame(id);
+    game.ToBeginning();
+
+    std::vector<Board> positions = { game.GetPosition() };
+    while (game.Forward())
+        positions.push_back(game.GetPosition());
+
+    return positions;
+}
+
+// The bitboard tests give the same answers as the squares, and the material of the pattern is right
+bool TestPatterns() {
+    GameDatabase database;
+    AddGames(database, 100, 1);
+
+    bool passed = true;
+    uint64_t seed = 9, matches = 0, tests = 0;
+
+    for (GameId id = 0; id < database.GetGameCount(); id++) {
+        const std::vector<Board> positions = GetPositions(database, id);
+
+        for (size_t ply = 0; ply < positions.size(); ply++) {
+            const std::vector<Condition> conditions = RandomConditions(seed);
+            const bool expected = Matches(positions[ply], conditions);
+            passed &= ToPattern(conditions).Matches(positions[ply]) == expected;
+            matches += expected;
+            tests++;
+
+            // A position matches itself, and can be reached from the start of its game with the material of its game
+            const PositionPattern exact = PositionPattern::FromPosition(positions[ply]);
+            passed &= exact.Matches(positions[ply]) && exact.CanMatch(database.GetFirstMaterial(id), database.GetLastMaterial(id));
+            passed &= ply == 0 || !exact.Matches(positions[ply - 1]);
+        }
+
+        passed &= GetMaterialSignature(positions.back()) == database.GetLastMaterial(id);
+    }
+
+    // A white knight on d5 and no black pawns on the c and e files, with White to move
+    Board board("r1bqkb1r/pp3ppp/3p1n2/3Np3/4P3/8/PPP2PPP/R2QKB1R w KQkq - 0 1");
+    PositionPattern pattern = PositionPattern().Require(WhiteKnight, 1ull << D5).Forbid(BlackPawn, BitBoardFile(C1) | BitBoardFile(E1));
+    passed &= !pattern.Matches(board);
+
+    board.FromFEN("r1bqkb1r/pp3ppp/3p1n2/3N4/4P3/8/PPP2PPP/R2QKB1R w KQkq - 0 1");
+    passed &= pattern.Matches(board);
+    passed &= !pattern.SetPlayerTurn(Black).Matches(board);
+
+    std::cout << matches << " of " << tests << " random patterns matched\n";
+    return passed;
+}
+
+// Random boards against exact patterns of boards that differ from them by at most one piece,
+// so every piece of both colours (each lane of the SIMD tests) is the one that doesn't match at some point
+bool TestRandomBoards() {
+    static const Piece pieces[] = { WhitePawn, WhiteKnight, WhiteBishop, WhiteRook, WhiteQueen, WhiteKing,
+        BlackPawn, BlackKnight, BlackBishop, BlackRook, BlackQueen, BlackKing };
+
+    bool passed = true;
+    uint64_t seed = 21, matches = 0;
+    const int tests = 20000;
+
+    for (int i = 0; i < tests; i++) {
+        const Colour playerTurn = Zobrist::NextRandom(seed) % 2 ? White : Black;
+        std::array<Piece, 64> squares;
+        squares.fill(Piece::None);
+        for (uint64_t count = Zobrist::NextRandom(seed) % 32; count > 0; count--)
+            squares[Zobrist::NextRandom(seed) % 64] = pieces[Zobrist::NextRandom(seed) % 12];
+
+        // Every square of every piece is required or forbidden
+        std::vector<Condition> conditions;
+        for (Piece piece : pieces) {
+            BitBoard bits = 0;
+            for (Square s = 0; s < 64; s++)
+                bits |= (BitBoard)(squares[s] == piece) << s;
+
+            conditions.push_back({ piece, bits, true });
+            conditions.push_back({ piece, ~bits, false });
+        }
+
+        // The same, another piece on a square, or an empty square
+        const uint64_t change = Zobrist::NextRandom(seed) % 3;
+        const Square square = Zobrist::NextRandom(seed) % 64;
+        if (change != 0)
+            squares[square] = change == 1 ? pieces[Zobrist::NextRandom(seed) % 12] : Piece::None;
+
+        Board board;
+        board.Clear(playerTurn);
+        for (Square s = 0; s < 64; s++) {
+            if (squares[s] != Piece::None)
+                board.SetPiece(squares[s], s);
+        }
+
+        const bool expected = Matches(board, conditions);
+        passed &= ToPattern(conditions).Matches(board) == expected;
+        matches += expected;
+    }
+
+    std::cout << matches << " of " << tests << " random boards matched\n";
+    return passed && matches > tests / 4 && matches < tests * 3 / 4;
+}
+
+// The search finds the first matching position of each game, like playing every game
+bool TestSearch() {
+    GameDatabase database;
+    AddGames(database, 2000, 2);
+
+    std::vector<std::vector<Board>> games;
+    for (GameId id = 0; id < database.GetGameCount(); id++)
+        games.push_back(GetPositions(database, id));
+
+    PositionSearch::Options options;
+    options.BatchSize = 16;
+    options.Threads = 4;
+    const PositionSearch search(database, options);
+    options.Threads = 1;
+    const PositionSearch single(database, options);
+
+    bool passed = true;
+    uint64_t seed = 4, skipped = 0, found = 0;
+
+    auto check = [&](const PositionPattern& pattern, auto matches) {
+        std::vector<PositionMatch> expected;
+        for (GameId id = 0; id < games.size(); id++) {
+            for (uint32_t ply = 0; ply < games[id].size(); ply++) {
+                if (matches(games[id][ply])) {
+                    expected.push_back({ id, ply });
+                    break;
+                }
+            }
+        }
+
+        PositionSearch::Statistics statistics;
+        passed &= search.Search(pattern, &statistics) == expected && single.Search(pattern) == expected;
+        passed &= statistics.Games == games.size() && statistics.Matches == expected.size();
+        skipped += statistics.Skipped;
+        found += expected.size();
+    };
+
+    for (int i = 0; i < 50; i++) {
+        const std::vector<Condition> conditions = RandomConditions(seed);
+        check(ToPattern(conditions), [&](const Board& b) { return Matches(b, conditions); });
+    }
+
+    // Positions from the games, found again
+    for (int i = 0; i < 50; i++) {
+        const std::vector<Board>& positions = games[Zobrist::NextRandom(seed) % games.size()];
+        const Board& position = positions[Zobrist::NextRandom(seed) % positions.size()];
+        const PositionPattern pattern = PositionPattern::FromPosition(position);
+        check(pattern, [&](const Board& b) { return pattern.Matches(b); });
+    }
+
+    // Only some of the games
+    std::vector<GameId> ids;
+    for (GameId id = 0; id < games.size(); id += 3)
+        ids.push_back(id);
+
+    const PositionPattern knight = PositionPattern().Require(WhiteKnight, 1ull << D5);
+    std::vector<PositionMatch> expected;
+    for (const PositionMatch& match : search.Search(knight)) {
+        if (match.Game % 3 == 0)
+            expected.push_back(match);
+    }
+
+    passed &= search.Search(knight, ids) == expected && !expected.empty();
+
+    std::cout << found << " games found, " << skipped << " skipped by their material\n";
+    return passed && skipped > 0;
+}
+
+// Patterns over the games of the database, on one thread and on every core
+// A saved database with a move of one game changed to one from an empty square:
+// the game is searched up to that move, and the others are searched as usual
+bool TestCorruptMoves() {
+    GameDatabase database;
+    AddGames(database, 50, 6);
+
+    // The game is written to the move heap as it is serialized, with the 8 byte record of each node at the end
+    // (the generated games have no variations, so the node after the root is the first move)
+    const Game game = database.GetGame(0);
+    std::string serialized;
+    game.Serialize(serialized);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "position_search_test.db";
+    database.Save(path);
+
+    std::string data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    const size_t start = data.find(serialized);
+    size_t nodes = 1;
+    for (NodeIndex n = game.GetNode(Game::GetRoot()).FirstChild; n != NO_NODE; n = game.GetNode(n).FirstChild)
+        nodes++;
+
+    // a3a4, with no pawn on a3
+    const uint16_t move = A3 | A4 << 6;
+    const size_t record = start + serialized.size() - nodes * 8 + 8;
+    bool passed = start != std::string::npos && data.find(serialized, start + 1) == std::string::npos;
+    if (!passed)
+        return false;
+
+    std::memcpy(&data[record], &move, sizeof(move));
+    std::ofstream(path, std::ios::binary) << data;
+
+    // The database keeps the file mapped until it is destroyed
+    {
+        GameDatabase opened;
+        passed &= opened.Open(path);
+
+        std::string fen;
+        std::vector<LongAlgebraicMove> moves;
+        opened.GetMainLine(0, fen, moves);
+        passed &= !moves.empty() && moves[0] == LongAlgebraicMove(A3, A4);
+
+        // No white pawn is ever on a1, so the games are played until they have no white pawns left
+        PositionSearch::Options options;
+        options.Threads = 1;
+        PositionSearch::Statistics statistics;
+        passed &= PositionSearch(opened, options).Search(PositionPattern().Require(WhitePawn, 1ull << A1), &statistics).empty();
+        passed &= statistics.Corrupt == 1 && statistics.Games == 50;
+
+        // A pattern of the starting position finds every game, the one with the bad move too
+        passed &= PositionSearch(opened, options).Search(PositionPattern::FromPosition(Board()), &statistics).size() == 50;
+    }
+
+    std::filesystem::remove(path);
+    return passed;
+}
+
+bool TestBenchmark() {
+    GameDatabase database;
+    AddGames(database, 20000, 3);
+
+    const PositionPattern patterns[] = {
+        PositionPattern().Require(WhiteKnight, 1ull << D5).Forbid(BlackPawn, BitBoardFile(C1) | BitBoardFile(E1)),
+        PositionPattern::FromPosition(Board("4k3/8/8/8/8/8/8/R3K3 w - - 0 1")),
+        PositionPattern::FromPosition(GetPositions(database, 17)[30]),
+    };
+    const char* names[] = { "Knight on d5", "Rook endgame", "Position" };
+
+    bool passed = true;
+    for (int i = 0; i < 3; i++) {
+        for (uint32_t threads : { 1u, 0u }) {
+            PositionSearch::Options options;
+            options.Threads = threads;
+
+            PositionSearch::Statistics statistics;
+            PositionSearch(database, options).Search(patterns[i], &statistics);
+
+            std::cout << names[i] << (threads == 1 ? ", 1 thread: " : ", every core: ") << statistics.Matches << " games, "
+                << statistics.Skipped << " skipped, " << statistics.Positions / statistics.Seconds / 1e6 << "M positions/s, "
+                << statistics.Games / statistics.Seconds / 1e3 << "k games/s\n";
+            passed &= statistics.Games == database.GetGameCount();
+        }
+    }
+
+    return passed;
+}
+
+int main() {
+    std::cout << "Patterns: " << (TestPatterns() ? "passed" : "FAILED") << "\n";
+    std::cout << "Random boards: " << (TestRandomBoards() ? "passed" : "FAILED") << "\n";
+    std::cout << "Search: " << (TestSearch() ? "passed" : "FAILED") << "\n";
+    std::cout << "Corrupt moves: " << (TestCorruptMoves() ? "passed" : "FAILED") << "\n";
+    std::cout << "Benchmark: " << (TestBenchmark() ? "passed" : "FAILED") << "\n";
+}
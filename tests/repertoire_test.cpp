@@ -0,0 +1,173 @@
+#include "Chess/Game.h"
+#include "Chess/GameGenerator.h"
+#include "Chess/Repertoire.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Generated games, parsed
+static std::vector<Game> GenerateGames(uint64_t count, uint32_t maxPlies) {
+    GameGenerator::Options options;
+    options.Games = count;
+    options.Threads = 1;
+    options.Seed = 5;
+    options.MaxPlies = maxPlies;
+    options.OutputFormat = GameGenerator::Format::PGN;
+
+    std::ostringstream output;
+    GameGenerator(options).Run(&output);
+    const std::string pgn = output.str();
+
+    std::vector<Game> games;
+    games.reserve(count);
+
+    for (size_t begin = pgn.find("[Event "); begin != std::string::npos;) {
+        const size_t end = pgn.find("[Event ", begin + 1);
+        games.emplace_back(pgn.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return games;
+}
+
+bool TestStatistics() {
+    std::vector<Game> games;
+    games.emplace_back("[Result \"1-0\"]\n[WhiteElo \"2000\"]\n[BlackElo \"2100\"]\n\n1. e4 e5 2. Nf3 (2. Nc3) 2... Nc6 1-0");
+    games.emplace_back("[Result \"0-1\"]\n[WhiteElo \"2300\"]\n\n1. e4 c5 0-1");
+    games.emplace_back("[Result \"1/2-1/2\"]\n\n1. d4 d5 1/2-1/2");
+    games.emplace_back("[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nf6 1-0");
+    games.emplace_back("[FEN \"8/8/8/4k3/8/8/8/4K2R w K - 0 1\"]\n\n1. O-O");
+
+    Repertoire repertoire;
+    bool passed = repertoire.AddGames(games, 1) == 4;
+
+    const MoveStatistics& root = repertoire.GetNode(Repertoire::GetRoot()).Statistics;
+    passed &= root.Games == 4 && root.WhiteWins == 2 && root.Draws == 1 && root.BlackWins == 1;
+
+    const NodeIndex e4 = repertoire.FindMove(Repertoire::GetRoot(), LongAlgebraicMove("e2e4"));
+    const NodeIndex e5 = repertoire.FindMove(e4, LongAlgebraicMove("e7e5"));
+    passed &= e4 != NO_NODE && e5 != NO_NODE && repertoire.GetNode(e5).San.ToString() == "e5";
+
+    const MoveStatistics& e4Statistics = repertoire.GetNode(e4).Statistics;
+    passed &= e4Statistics.Games == 3 && e4Statistics.WhiteWins == 2 && e4Statistics.BlackWins == 1;
+    passed &= e4Statistics.GetAverageElo() == (2000 + 2100 + 2300) / 3.0;
+
+    // Only the main line of a game is added
+    const NodeIndex nf3 = repertoire.FindMove(e5, LongAlgebraicMove("g1f3"));
+    passed &= repertoire.GetNode(nf3).Statistics.Games == 2;
+    passed &= repertoire.FindMove(e5, LongAlgebraicMove("b1c3")) == NO_NODE;
+    passed &= repertoire.GetNodeCount() == 9;
+
+    // The most played move is the main line
+    passed &= repertoire.ToGame().ToPGN() == "1. e4 (1. d4 d5) 1... e5 (1... c5) 2. Nf3 Nc6 (2... Nf6)";
+    passed &= repertoire.ToGame(2).ToPGN() == "1. e4 e5 2. Nf3";
+
+    // The same games split between threads give the same tree (too few games for more than one thread),
+    // and so do shards of the games that are merged, like the threads do
+    Repertoire parallel, merged, shard;
+    parallel.AddGames(games, 3);
+    merged.AddGames({ games[0], games[1] }, 1);
+    shard.AddGames({ games[2], games[3], games[4] }, 1);
+    merged.Merge(shard);
+
+    for (const Repertoire* other : { &parallel, &merged })
+        passed &= other->GetNodeCount() == repertoire.GetNodeCount() && other->ToGame().ToPGN() == repertoire.ToGame().ToPGN();
+
+    return passed;
+}
+
+// Every node of one tree is in the other, with the same statistics
+static bool SameTree(const Repertoire& a, const Repertoire& b) {
+    bool passed = a.GetNodeCount() == b.GetNodeCount();
+
+    std::vector<std::pair<NodeIndex, NodeIndex>> stack = { { Repertoire::GetRoot(), Repertoire::GetRoot() } };
+    while (!stack.empty() && passed) {
+        const auto [nodeA, nodeB] = stack.back();
+        stack.pop_back();
+
+        const MoveStatistics& sa = a.GetNode(nodeA).Statistics;
+        const MoveStatistics& sb = b.GetNode(nodeB).Statistics;
+        passed &= sa.Games == sb.Games && sa.WhiteWins == sb.WhiteWins && sa.Draws == sb.Draws && sa.BlackWins == sb.BlackWins;
+        passed &= sa.EloSum == sb.EloSum && sa.EloCount == sb.EloCount;
+
+        for (NodeIndex child = a.GetNode(nodeA).FirstChild; child != NO_NODE; child = a.GetNode(child).NextSibling) {
+            const GameMove& m = a.GetNode(child).Move;
+            const NodeIndex other = b.FindMove(nodeB, LongAlgebraicMove(m.Start, m.Destination, (PieceType)(m.Flags & GameMoveFlag::PromotionFlags)));
+
+            passed &= other != NO_NODE;
+            if (other != NO_NODE)
+                stack.emplace_back(child, other);
+        }
+    }
+
+    return passed;
+}
+
+// Merges many games into one tree on 1 and 4 threads, and compares that with adding them to a Game one move at a time
+// The threads only pay off with several cores. Merging 4 shards of the games (timed on its own) is about as slow as adding the games,
+// which the threads avoid by splitting the games by their first move
+bool TestBenchmark() {
+    const std::vector<Game> games = GenerateGames(4 * Repertoire::MIN_GAMES_PER_THREAD, 80);
+
+    uint64_t plies = 0;
+    for (const Game& game : games) {
+        for (NodeIndex n = game.GetNode(Game::GetRoot()).FirstChild; n != NO_NODE; n = game.GetNode(n).FirstChild)
+            plies++;
+    }
+
+    auto time = [](auto function) {
+        const auto startTime = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    // A Game only adds a move by playing it, and searches the moves of the position for it
+    Game tree;
+    const double gameSeconds = time([&]() {
+        for (const Game& game : games) {
+            tree.ToBeginning();
+            for (NodeIndex n = game.GetNode(Game::GetRoot()).FirstChild; n != NO_NODE; n = game.GetNode(n).FirstChild) {
+                const GameMove& m = game.GetNode(n).Move;
+                tree.Move(LongAlgebraicMove(m.Start, m.Destination, (PieceType)(m.Flags & GameMoveFlag::PromotionFlags)));
+            }
+        }
+    });
+
+    Repertoire single;
+    const double singleSeconds = time([&]() { single.AddGames(games, 1); });
+
+    Repertoire parallel;
+    const double parallelSeconds = time([&]() { parallel.AddGames(games, 4); });
+
+    // The shards of 4 threads, merged on this one
+    std::vector<Repertoire> shards(4);
+    for (size_t i = 0; i < shards.size(); i++)
+        shards[i].AddGames(std::vector<Game>(games.begin() + games.size() * i / 4, games.begin() + games.size() * (i + 1) / 4), 1);
+
+    Repertoire merged;
+    const double mergeSeconds = time([&]() {
+        for (const Repertoire& shard : shards)
+            merged.Merge(shard);
+    });
+
+    std::cout << games.size() << " games, " << single.GetNodeCount() << " nodes, " << std::thread::hardware_concurrency() << " cores\n";
+    std::cout << "Game::Move(): " << games.size() / gameSeconds << " games/s\n";
+    std::cout << "Repertoire, 1 thread: " << games.size() / singleSeconds << " games/s, " << plies / singleSeconds << " plies/s\n";
+    std::cout << "Repertoire, 4 threads: " << games.size() / parallelSeconds << " games/s\n";
+    std::cout << "Merging 4 shards: " << games.size() / mergeSeconds << " games/s\n";
+
+    bool passed = single.GetGameCount() == games.size() && parallel.GetGameCount() == games.size();
+    passed &= SameTree(single, parallel) && SameTree(parallel, single);
+    passed &= SameTree(single, merged) && SameTree(merged, single);
+
+    return passed;
+}
+
+int main() {
+    std::cout << "Statistics: " << (TestStatistics() ? "passed" : "FAILED") << "\n";
+    std::cout << "Benchmark: " << (TestBenchmark() ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,210 @@
+#include "Chess/Board.h"
+#include "Engine/Retrograde.h"
+
+#include <iostream>
+
+using Retrograde::Result;
+
+// The index of a position, as described in Retrograde.h
+static size_t GetIndex(const Board& board, const std::vector<Piece>& pieces) {
+    size_t index = 0;
+
+    for (size_t i = pieces.size(); i > 0; i--) {
+        const Piece p = pieces[i - 1];
+        BitBoard b = board.GetPieceBitBoard(GetPieceType(p)) & board.GetColourBitBoard(GetColour(p));
+
+        // Identical pieces are in order of their squares
+        size_t identical = 0;
+        for (size_t j = 0; j < i - 1; j++)
+            identical += pieces[j] == p;
+
+        for (; identical > 0; identical--)
+            b &= b - 1;
+
+        index = (index << 6) | GetSquare(b);
+    }
+
+    return (index << 1) | board.GetPlayerTurn();
+}
+
+// Solves the ending by repeatedly looking one move ahead from every position until nothing changes,
+// and compares the results with the generated table
+bool TestBruteForce(Retrograde::Generator& generator, const std::string& name, const std::vector<Piece>& pieces) {
+    const Retrograde::Bitbase& table = generator.Generate(name);
+
+    const size_t positionCount = (size_t)2 << (6 * pieces.size());
+
+    struct Position {
+        bool Valid = false;
+        std::vector<size_t> Children;  // Moves that stay in the ending
+        bool WinningExit = false;      // A capture or promotion that wins
+        bool DrawingExit = false;
+        bool Checkmate = false;
+    };
+
+    std::vector<Position> positions(positionCount);
+
+    Board board;
+    MoveList moves;
+    UndoInfo undo;
+
+    for (size_t index = 0; index < positionCount; index++) {
+        board.Clear((Colour)(index & 1));
+
+        bool valid = true;
+        for (size_t i = 0; i < pieces.size() && valid; i++) {
+            const Square s = (index >> (1 + 6 * i)) & 63;
+            valid = board[s] == Piece::None && !(GetPieceType(pieces[i]) == Pawn && (s < 8 || s >= 56));
+            if (valid)
+                board.SetPiece(pieces[i], s);
+        }
+
+        if (!valid || GetIndex(board, pieces) != index)
+            continue;
+
+        const Colour opponent = OppositeColour(board.GetPlayerTurn());
+        if (board.AttackersTo(GetSquare(board.GetPieceBitBoard(King) & board.GetColourBitBoard(opponent)), board.GetPlayerTurn()))
+            continue;
+
+        Position& position = positions[index];
+        position.Valid = true;
+
+        board.GenerateLegalMoves(moves);
+        position.Checkmate = moves.Size == 0 && board.IsInCheck();
+
+        for (LongAlgebraicMove m : moves) {
+            const bool exit = board[m.DestinationSquare] != Piece::None || (GetPieceType(board[m.SourceSquare]) == Pawn && (RankOf(m.DestinationSquare) == 0 || RankOf(m.DestinationSquare) == 7));
+
+            board.MakeMove(m, undo);
+
+            if (!exit) {
+                position.Children.push_back(GetIndex(board, pieces));
+            } else if (SquareCount(board.GetColourBitBoard(White) | board.GetColourBitBoard(Black)) == 2) {
+                position.DrawingExit = true;
+            } else {
+                // The smaller endings are checked separately
+                std::string childName;
+                for (Colour c : { White, Black })
+                    for (PieceType t : { King, Queen, Rook, Bishop, Knight, Pawn })
+                        childName.append(SquareCount(board.GetPieceBitBoard(t) & board.GetColourBitBoard(c)), PieceTypeToChar(t));
+
+                Result result = *generator.Generate(childName).Probe(board);
+                position.WinningExit |= result == Result::Loss;
+                position.DrawingExit |= result == Result::Draw;
+            }
+
+            board.UnmakeMove(undo);
+        }
+    }
+
+    // 1 = win, -1 = loss, 0 = not known yet (a draw at the end)
+    std::vector<int8_t> values(positionCount, 0);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (size_t index = 0; index < positionCount; index++) {
+            const Position& position = positions[index];
+            if (!position.Valid || values[index] != 0)
+                continue;
+
+            bool win = position.WinningExit;
+            bool allLose = !position.DrawingExit && (!position.Children.empty() || position.Checkmate);
+
+            for (size_t child : position.Children) {
+                win |= values[child] == -1;
+                allLose &= values[child] == 1;
+            }
+
+            if (win || allLose) {
+                values[index] = win ? 1 : -1;
+                changed = true;
+            }
+        }
+    }
+
+    size_t mismatches = 0;
+    for (size_t index = 0; index < positionCount; index++) {
+        Result expected = !positions[index].Valid ? Result::Invalid : values[index] == 1 ? Result::Win : values[index] == -1 ? Result::Loss : Result::Draw;
+        mismatches += table.Probe(index) != expected;
+    }
+
+    std::cout << name << ": " << mismatches << " mismatches\n";
+    return mismatches == 0;
+}
+
+bool TestKnownPositions(Retrograde::Generator& generator) {
+    const Retrograde::Bitbase& kpk = generator.Generate("KPK");
+
+    struct Expected {
+        const char* FEN;
+        Result Value;
+    };
+
+    static constexpr Expected s_Positions[] = {
+        { "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", Result::Win },
+        { "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", Result::Loss },
+        { "4k3/4P3/4K3/8/8/8/8/8 b - - 0 1", Result::Draw },   // Stalemate
+        { "k7/8/1K6/P7/8/8/8/8 w - - 0 1", Result::Draw },     // Rook pawn with the king in the corner
+        { "8/8/8/8/4p3/4k3/8/4K3 b - - 0 1", Result::Win },    // The colours are swapped
+        { "8/8/8/8/4p3/4k3/8/4K3 w - - 0 1", Result::Loss },
+    };
+
+    bool passed = true;
+    for (const Expected& position : s_Positions) {
+        std::optional<Result> result = kpk.Probe(Board(position.FEN));
+        if (result != position.Value) {
+            std::cout << position.FEN << ": wrong result\n";
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+bool TestSaveAndOpen(Retrograde::Generator& generator) {
+    const Retrograde::Bitbase& generated = generator.Generate("KPK");
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "KPK.crbb";
+    if (!generated.Save(path))
+        return false;
+
+    bool passed;
+    {
+        Retrograde::Bitbase loaded;
+        passed = loaded.Open(path) && loaded.GetName() == "KPK" && loaded.GetPositionCount() == generated.GetPositionCount();
+
+        for (size_t index = 0; passed && index < loaded.GetPositionCount(); index++)
+            passed = loaded.Probe(index) == generated.Probe(index);
+    }
+
+    std::filesystem::remove(path);
+    return passed;
+}
+
+void PrintStatistics(const Retrograde::Generator& generator) {
+    for (const Retrograde::Statistics& s : generator.GetStatistics()) {
+        std::cout << s.Name << ": " << s.Seconds << " s, " << s.Passes << " passes, "
+            << s.WorkingMemory / (1024 * 1024) << " MB while generating, "
+            << s.Wins << " wins, " << s.Draws << " draws, " << s.Losses << " losses\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Retrograde::Generator generator;
+
+    bool passed = TestBruteForce(generator, "KQK", { WhiteKing, WhiteQueen, BlackKing })
+        && TestBruteForce(generator, "KRK", { WhiteKing, WhiteRook, BlackKing })
+        && TestBruteForce(generator, "KPK", { WhiteKing, WhitePawn, BlackKing });
+
+    std::cout << "Brute force: " << (passed ? "passed" : "FAILED") << "\n";
+    std::cout << "Known positions: " << (TestKnownPositions(generator) ? "passed" : "FAILED") << "\n";
+    std::cout << "Save and open: " << (TestSaveAndOpen(generator) ? "passed" : "FAILED") << "\n";
+
+    // Benchmark bigger endings, ex. "retrograde_test KQKR KRKP"
+    for (int i = 1; i < argc; i++)
+        generator.Generate(argv[i]);
+
+    PrintStatistics(generator);
+}
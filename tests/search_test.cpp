@@ -0,0 +1,159 @@
+#include "Chess/Board.h"
+#include "Engine/Engine.h"
+#include "Engine/InternalEngine.h"
+#include "Engine/Search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static uint64_t Perft(Board& board, int32_t depth) {
+    MoveList moves;
+    board.GenerateLegalMoves(moves);
+
+    if (depth == 1)
+        return moves.Size;
+
+    uint64_t nodes = 0;
+    UndoInfo undo;
+    for (LongAlgebraicMove m : moves) {
+        board.MakeMove(m, undo);
+        nodes += Perft(board, depth - 1);
+        board.UnmakeMove(undo);
+    }
+
+    return nodes;
+}
+
+// Known results from https://www.chessprogramming.org/Perft_Results
+bool TestPerft() {
+    struct PerftPosition {
+        const char* FEN;
+        int32_t Depth;
+        uint64_t Nodes;
+    };
+
+    const PerftPosition positions[] = {
+        { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281 },
+        { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862 },
+        { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+        { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333 },
+        { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379 },
+    };
+
+    bool passed = true;
+    for (const PerftPosition& position : positions) {
+        Board board(position.FEN);
+        uint64_t hash = board.GetHash();
+
+        uint64_t nodes = Perft(board, position.Depth);
+        std::cout << position.FEN << " depth " << position.Depth << ": " << nodes << " (expected " << position.Nodes << ")\n";
+
+        if (nodes != position.Nodes || board.GetHash() != hash || board.ToFEN() != Board(position.FEN).ToFEN())
+            passed = false;
+    }
+
+    return passed;
+}
+
+bool TestMate() {
+    Search search(16, 2);
+
+    // Mate in 2: 1. Qd8+ Bxd8 2. Re8#
+    Board board("r1b2k1r/ppp1bppp/8/1B1Q4/5q2/2P5/PPP2PPP/R3R1K1 w - - 1 0");
+
+    Search::Limits limits;
+    limits.Depth = 6;
+
+    auto start = std::chrono::steady_clock::now();
+    Engine::BestContinuation result = search.Run(board, limits);
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "Best continuation: ";
+    for (LongAlgebraicMove m : result.Continuation)
+        std::cout << m << " ";
+    std::cout << "\nScore: " << (result.Mate ? "mate " : "cp ") << result.Score;
+    std::cout << " Nodes: " << search.GetNodes() << " Time: " << time.count() << "ms\n";
+
+    return result.Mate && result.Score == 2 && !result.Continuation.empty() && result.Continuation[0].ToString() == "d5d8";
+}
+
+bool TestInternalEngine() {
+    auto engine = Engine::CreateInternal();
+
+    bool updated = false;
+    engine->SetUpdateCallback([&](const Engine::BestContinuation& continuation) {
+        updated = true;
+        std::cout << "depth " << continuation.Depth << " score " << continuation.Score << "\n";
+    });
+
+    engine->Init();
+    engine->PrintInfo();
+    engine->SetSpin("Threads", 2);
+    engine->SetPosition(Board::START_FEN);
+
+    engine->Run();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    engine->Stop();
+
+    return updated && !engine->GetBestContinuation().Continuation.empty();
+}
+
+// The moves of a position command are played up to the first one that isn't a legal move,
+// which must not throw: the engine then searches the position before it
+bool TestPositionCommand() {
+    const std::string promotion = "8/4P3/8/8/8/8/k7/7K w - - 0 1";
+
+    Board afterE4;
+    afterE4.Move(LongAlgebraicMove("e2e4"));
+
+    const std::pair<std::string, std::string> commands[] = {
+        { "startpos moves e2e4 i9i9 e7e5", afterE4.ToFEN() },
+        { "startpos moves e2e4 e2e4", afterE4.ToFEN() },
+        { "startpos moves e2e4 e7e5q", afterE4.ToFEN() },
+        { "fen " + promotion + " moves e7e8", promotion },
+        { "fen " + promotion + " moves e7e8k", promotion },
+        { "fen " + promotion + " moves e7e8x", promotion },
+        { "fen " + promotion + " moves e7e8Q", promotion },
+        { "fen " + promotion + " moves e7e8q", "4Q3/8/8/8/8/8/k7/7K b - - 0 1" },
+    };
+
+    bool passed = true;
+    for (const auto& [command, fen] : commands) {
+        InternalEngine engine;
+        engine.Send("position " + command + "\ngo depth 1\n");
+
+        // The best move is only legal in the position that the engine searched
+        std::string output, message;
+        for (int i = 0; i < 1000 && output.find("bestmove") == std::string::npos; i++) {
+            if (engine.Receive(message))
+                output += message;
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        const size_t bestMove = output.find("bestmove ");
+        if (bestMove == std::string::npos) {
+            passed = false;
+            continue;
+        }
+
+        const Board position(fen);
+        MoveList moves;
+        position.GenerateLegalMoves(moves);
+
+        const std::string move = output.substr(bestMove + 9, output.find_first_of(" \n", bestMove + 9) - bestMove - 9);
+        passed &= std::find_if(moves.begin(), moves.end(), [&](LongAlgebraicMove m) { return m.ToString() == move; }) != moves.end();
+    }
+
+    return passed;
+}
+
+int main() {
+    std::cout << "Perft: " << (TestPerft() ? "passed" : "FAILED") << "\n";
+    std::cout << "Mate: " << (TestMate() ? "passed" : "FAILED") << "\n";
+    std::cout << "Internal engine: " << (TestInternalEngine() ? "passed" : "FAILED") << "\n";
+    std::cout << "Position command: " << (TestPositionCommand() ? "passed" : "FAILED") << "\n";
+}
@@ -0,0 +1,243 @@
+#include "Chess/Game.h"
+#include "Chess/GameCursor.h"
+#include "Chess/GameTraversal.h"
+#include "Chess/SharedGame.h"
+#include "Chess/Zobrist.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The FEN without the move counters (the game doesn't keep them when it goes back)
+static std::string WithoutCounters(const Board& board) {
+    const std::string fen = board.ToFEN();
+    return fen.substr(0, fen.rfind(' ', fen.rfind(' ') - 1));
+}
+
+// Cursors move on their own, give the positions of the game, and don't move the game
+bool TestCursor() {
+    Game game("1. e4 e5 2. Nf3 Nc6 3. Bb5 (3. Bc4 Bc5 (3... Nf6 4. Ng5 d5 5. exd5 Na5) 4. c3 Nf6 5. d4 exd4 6. O-O) "
+        "3... a6 4. Ba4 Nf6 5. O-O Be7 (5... b5 6. Bb3 Bc5) 6. Re1 b5 7. Bb3 d6 8. c3 O-O 9. h3 Nb8 10. d4 Nbd7 "
+        "11. Nbd2 Bb7 12. Bc2 Re8 (12... c5 13. d5) 13. Nf1 Bf8 14. Ng3 g6 15. a4 c5 16. d5 c4 17. Bg5 h6 18. Be3 Nc5");
+    game.SetCheckpointInterval(4);
+    game.ToEnd();
+    const NodeIndex end = game.CurrentNode();
+
+    std::vector<NodeIndex> nodes;
+    std::vector<std::string> positions;
+    GameTraversal traversal(game, true);
+    GameTraversal::Event event;
+    while (traversal.Next(event)) {
+        if (event.Type == GameTraversal::EventType::Move) {
+            nodes.push_back(event.Node);
+            positions.push_back(WithoutCounters(traversal.GetPosition()));
+        }
+    }
+
+    GameCursor cursor(game), other(game);
+    bool passed = true;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const size_t j = (i * 37) % nodes.size();
+        cursor.GoTo(nodes[j]);
+        other.GoTo(nodes[i]);
+        passed &= cursor.CurrentNode() == nodes[j] && WithoutCounters(cursor.GetPosition()) == positions[j];
+        passed &= other.CurrentNode() == nodes[i] && WithoutCounters(other.GetPosition()) == positions[i];
+    }
+
+    // Forward and back to the start takes back every move exactly
+    cursor.ToBeginning();
+    std::vector<std::string> line = { cursor.GetPosition().ToFEN() };
+    while (cursor.Forward())
+        line.push_back(cursor.GetPosition().ToFEN());
+
+    passed &= cursor.CurrentNode() == end && line.size() == game.GetNode(end).Ply + 1;
+    for (size_t i = line.size() - 1; i > 0; i--) {
+        passed &= cursor.GetPosition().ToFEN() == line[i];
+        passed &= cursor.Back();
+    }
+
+    passed &= cursor.GetPosition().ToFEN() == line[0] && !cursor.Back();
+
+    // Back from a jump goes through the checkpoints
+    cursor.GoTo(end);
+    for (size_t i = line.size() - 1; i > 0; i--)
+        cursor.Back();
+    passed &= cursor.CurrentNode() == Game::GetRoot() && WithoutCounters(cursor.GetPosition()) == WithoutCounters(Board());
+
+    passed &= game.CurrentNode() == end;
+
+    // Through a transposition and back the same way, like the game
+    Game transpositions("1. e4 (1. Nf3 Nc6 2. e4 e5 3. d4) 1... e5 (1... c5) 2. Nf3 Nc6 3. Bc4 (3. Bb5 a6) 3... Bc5");
+    transpositions.SetMergeTranspositions(true);
+
+    GameCursor linked(transpositions);
+    const NodeIndex nf3 = transpositions.GetNode(transpositions.GetNode(Game::GetRoot()).FirstChild).NextSibling;
+    transpositions.GoTo(nf3);
+    linked.GoTo(nf3);
+
+    for (int i = 0; i < 4; i++) {
+        transpositions.Forward();
+        linked.Forward();
+        passed &= linked.CurrentNode() == transpositions.CurrentNode();
+    }
+
+    for (int i = 0; i < 4; i++) {
+        transpositions.Back();
+        linked.Back();
+        passed &= linked.CurrentNode() == transpositions.CurrentNode();
+    }
+
+    return passed;
+}
+
+// Readers walk snapshots while one thread adds moves and another annotates what the readers found
+bool TestConcurrentEdits() {
+    SharedGame shared;
+    std::atomic<bool> done = false;
+    std::atomic<bool> passed = true;
+    std::atomic<uint64_t> walks = 0;
+
+    const uint32_t moves = 3000;
+
+    // Adds moves from random nodes of the tree
+    std::thread writer([&]() {
+        uint64_t seed = 1;
+        for (uint32_t i = 0; i < moves; i++) {
+            shared.Edit([&](Game& game) {
+                NodeIndex node = Game::GetRoot();
+                for (uint32_t steps = Zobrist::NextRandom(seed) % 40; steps > 0 && game.GetNode(node).FirstChild != NO_NODE; steps--)
+                    node = game.GetNode(node).FirstChild;
+
+                game.GoTo(node);
+
+                MoveList legal;
+                game.GetPosition().GenerateLegalMoves(legal);
+                if (legal.Size != 0)
+                    game.Move(legal[Zobrist::NextRandom(seed) % legal.Size]);
+            });
+
+            // Lets the other threads run in between, even on one core
+            std::this_thread::yield();
+        }
+
+        done = true;
+    });
+
+    // Every snapshot stays the same while it is read, and has at least the moves of the one before it
+    auto reader = [&]() {
+        size_t lastNodes = 0;
+        while (!done) {
+            const std::shared_ptr<const Game> snapshot = shared.GetSnapshot();
+            const std::string pgn = snapshot->ToPGN();
+
+            size_t nodes = 0;
+            GameTraversal traversal(*snapshot, true);
+            GameTraversal::Event event;
+            while (traversal.Next(event)) {
+                if (event.Type == GameTraversal::EventType::Move) {
+                    nodes++;
+                    passed = passed && traversal.GetLength() == snapshot->GetNode(event.Node).Ply;
+                }
+            }
+
+            GameCursor cursor(snapshot);
+            cursor.ToEnd();
+
+            passed = passed && nodes >= lastNodes && snapshot->ToPGN() == pgn;
+            lastNodes = nodes;
+            walks++;
+        }
+    };
+
+    // Comments on the end of the main line of the latest snapshot
+    std::set<NodeIndex> annotated;
+    std::thread annotator([&]() {
+        while (!done) {
+            GameCursor cursor(shared.GetSnapshot());
+            cursor.ToEnd();
+
+            const NodeIndex node = cursor.CurrentNode();
+            if (node != Game::GetRoot() && annotated.insert(node).second)
+                shared.Edit([node](Game& game) { game.SetComment(node, "End of the main line"); });
+
+            std::this_thread::yield();
+        }
+    });
+
+    std::thread readers[] = { std::thread(reader), std::thread(reader) };
+
+    writer.join();
+    annotator.join();
+    for (std::thread& r : readers)
+        r.join();
+
+    const std::shared_ptr<const Game> last = shared.GetSnapshot();
+    size_t comments = 0;
+    for (NodeIndex node : annotated)
+        comments += last->GetComment(node) == "End of the main line";
+
+    std::cout << walks << " snapshots walked while " << moves << " moves were added, " << annotated.size() << " comments\n";
+    return passed && comments == annotated.size() && shared.GetVersion() == moves + annotated.size();
+}
+
+// The cost of publishing an edit (a copy of the game) and of taking a snapshot
+bool TestBenchmark() {
+    SharedGame shared;
+    uint64_t seed = 7;
+
+    auto time = [](auto function) {
+        const auto startTime = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    // A main line of 200 plies with variations
+    for (int i = 0; i < 10; i++) {
+        shared.Edit([&](Game& game) {
+            game.ToBeginning();
+            MoveList legal;
+            for (int ply = 0; ply < 200; ply++) {
+                game.GetPosition().GenerateLegalMoves(legal);
+                if (legal.Size == 0)
+                    break;
+
+                game.Move(legal[Zobrist::NextRandom(seed) % legal.Size]);
+            }
+        });
+    }
+
+    size_t nodes = 0;
+    GameTraversal traversal(*shared.GetSnapshot());
+    GameTraversal::Event event;
+    while (traversal.Next(event))
+        nodes += event.Type == GameTraversal::EventType::Move;
+
+    const int edits = 2000;
+    const double editSeconds = time([&]() {
+        for (int i = 0; i < edits; i++)
+            shared.Edit([i](Game& game) { game.SetComment(i % 2 ? "Odd" : "Even"); });
+    });
+
+    const int snapshots = 1000000;
+    size_t sum = 0;
+    const double snapshotSeconds = time([&]() {
+        for (int i = 0; i < snapshots; i++)
+            sum += shared.GetSnapshot()->CurrentNode();
+    });
+
+    std::cout << "Edits of a game with " << nodes << " nodes: " << edits / editSeconds << "/s\n";
+    std::cout << "Snapshots: " << snapshots / snapshotSeconds / 1e6 << "M/s\n";
+
+    return nodes > 1000 && sum > 0;
+}
+
+int main() {
+    std::cout << "Cursor: " << (TestCursor() ? "passed" : "FAILED") << "\n";
+    std::cout << "Concurrent edits: " << (TestConcurrentEdits() ? "passed" : "FAILED") << "\n";
+    std::cout << "Benchmark: " << (TestBenchmark() ? "passed" : "FAILED") << "\n";
+}
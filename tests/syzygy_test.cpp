@@ -0,0 +1,272 @@
+#include "Chess/Board.h"
+#include "Chess/Zobrist.h"
+#include "Engine/Syzygy.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Syzygy::WDL;
+
+static const char* ToString(std::optional<WDL> wdl) {
+    if (!wdl)
+        return "none";
+
+    switch (*wdl) {
+        case WDL::Loss:        return "loss";
+        case WDL::BlessedLoss: return "blessed loss";
+        case WDL::Draw:        return "draw";
+        case WDL::CursedWin:   return "cursed win";
+        case WDL::Win:         return "win";
+    }
+
+    return "?";
+}
+
+// Writes a WDL table for three unique pieces where every position has the same value for each player to move
+// 'pieces' are stored as the Piece enum plus 1
+static void WriteSingleValueTable(const std::filesystem::path& path, const uint8_t pieces[3], WDL whiteToMove, WDL blackToMove) {
+    std::vector<uint8_t> data = { 0x71, 0xE8, 0x23, 0x5D };  // Magic
+
+    data.push_back(0x00);  // No pawns
+    data.push_back(0x00);  // Order of the groups for both players to move
+
+    for (int32_t i = 0; i < 3; i++)
+        data.push_back((uint8_t)(pieces[i] | (pieces[i] << 4)));
+
+    if (data.size() & 1)
+        data.push_back(0);
+
+    data.push_back(0x80);  // Single value
+    data.push_back((uint8_t)((int32_t)whiteToMove + 2));
+    data.push_back(0x80);
+    data.push_back((uint8_t)((int32_t)blackToMove + 2));
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)data.data(), data.size());
+}
+
+bool TestSyntheticTable() {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "syzygy_test";
+    std::filesystem::create_directories(directory);
+
+    // A made up table where the side with the knight always wins
+    const uint8_t pieces[3] = { WhiteKing + 1, WhiteKnight + 1, BlackKing + 1 };
+    WriteSingleValueTable(directory / "KNvK.rtbw", pieces, WDL::Win, WDL::Loss);
+
+    bool passed = true;
+    {
+        Syzygy::Tablebases tablebases(directory.string());
+
+        auto expect = [&](const char* fen, std::optional<WDL> expected) {
+            std::optional<WDL> wdl = tablebases.ProbeWDL(Board(fen));
+            std::cout << fen << ": " << ToString(wdl) << "\n";
+            passed &= wdl == expected;
+        };
+
+        passed &= tablebases.GetTableCount() == 1 && tablebases.GetMaxPieces() == 3;
+
+        expect("8/8/8/4k3/8/8/8/1N2K3 w - - 0 1", WDL::Win);
+        expect("8/8/8/4k3/8/8/8/1N2K3 b - - 0 1", WDL::Loss);
+
+        // The colours are swapped to find the table
+        expect("1n2k3/8/8/8/4K3/8/8/8 b - - 0 1", WDL::Win);
+        expect("1n2k3/8/8/8/4K3/8/8/8 w - - 0 1", WDL::Loss);
+
+        // Capturing the knight draws, which is better than the value in the table
+        expect("8/8/8/8/8/8/1k6/1N2K3 b - - 0 1", WDL::Draw);
+
+        // Missing table and castling rights
+        expect("8/8/8/4k3/8/8/8/1B2K3 w - - 0 1", std::nullopt);
+        expect("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1", std::nullopt);
+    }
+
+    std::filesystem::remove_all(directory);
+    return passed;
+}
+
+// Checks positions with known results against real tables (at least up to 3 pieces)
+bool TestKnownResults(const Syzygy::Tablebases& tablebases) {
+    struct Expected {
+        const char* FEN;
+        WDL Result;
+        int32_t DTZ;  // 0 if only the sign is known
+    };
+
+    static constexpr Expected s_Positions[] = {
+        { "8/8/8/4k3/8/8/8/4K3 w - - 0 1",   WDL::Draw,  0 },
+        { "8/8/8/4k3/8/8/8/2N1K3 w - - 0 1", WDL::Draw,  0 },
+        { "8/8/8/4k3/8/8/8/2B1K3 b - - 0 1", WDL::Draw,  0 },
+        { "k7/8/1K6/8/8/8/8/7Q w - - 0 1",   WDL::Win,   1 },   // Qh8#
+        { "k7/1Q6/1K6/8/8/8/8/8 b - - 0 1",  WDL::Loss, -1 },   // Checkmated
+        { "8/8/8/8/8/3k4/1q6/K7 w - - 0 1",  WDL::Draw,  0 },   // Kxb2
+        { "8/8/8/4k3/8/8/8/R3K3 b - - 0 1",  WDL::Loss,  0 },
+        { "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1", WDL::Win,   1 },   // The pawn can move
+    };
+
+    bool passed = true;
+    for (const Expected& position : s_Positions) {
+        Board board(position.FEN);
+        std::optional<WDL> wdl = tablebases.ProbeWDL(board);
+        std::optional<int32_t> dtz = tablebases.ProbeDTZ(board);
+
+        std::cout << position.FEN << ": " << ToString(wdl) << ", DTZ " << (dtz ? std::to_string(*dtz) : "none") << "\n";
+
+        if (wdl != position.Result || !dtz) {
+            passed = false;
+            continue;
+        }
+
+        if (position.DTZ != 0 && *dtz != position.DTZ)
+            passed = false;
+
+        if ((*dtz > 0) != (position.Result > WDL::Draw) || (*dtz < 0) != (position.Result < WDL::Draw))
+            passed = false;
+    }
+
+    return passed;
+}
+
+// Legal positions with the given pieces placed at random
+static std::vector<Board> RandomPositions(const std::vector<Piece>& pieces, size_t count, uint64_t seed) {
+    std::vector<Board> positions;
+
+    while (positions.size() < count) {
+        std::array<Piece, 64> squares;
+        squares.fill(Piece::None);
+
+        bool valid = true;
+        for (Piece p : pieces) {
+            Square s = Zobrist::NextRandom(seed) % 64;
+            if (squares[s] != Piece::None || (GetPieceType(p) == Pawn && (s < 8 || s >= 56))) {
+                valid = false;
+                break;
+            }
+            squares[s] = p;
+        }
+
+        if (!valid)
+            continue;
+
+        std::string fen;
+        for (Square rank = 7; rank < 8; rank--) {
+            int32_t empty = 0;
+            for (Square file = 0; file < 8; file++) {
+                Piece p = squares[rank * 8 + file];
+                if (p == Piece::None) {
+                    empty++;
+                    continue;
+                }
+
+                if (empty)
+                    fen += (char)('0' + empty);
+                empty = 0;
+                fen += PieceToChar(p);
+            }
+
+            if (empty)
+                fen += (char)('0' + empty);
+            if (rank)
+                fen += '/';
+        }
+
+        const bool whiteToMove = Zobrist::NextRandom(seed) & 1;
+
+        // The player who just moved can't be in check
+        Board other(fen + (whiteToMove ? " b - - 0 1" : " w - - 0 1"));
+        if (other.IsInCheck())
+            continue;
+
+        positions.emplace_back(fen + (whiteToMove ? " w - - 0 1" : " b - - 0 1"));
+    }
+
+    return positions;
+}
+
+void Benchmark(const Syzygy::Tablebases& tablebases) {
+    static const std::vector<std::vector<Piece>> s_Materials = {
+        { WhiteKing, BlackKing, WhiteKnight },
+        { WhiteKing, BlackKing, WhiteQueen },
+        { WhiteKing, BlackKing, WhiteRook },
+        { WhiteKing, BlackKing, WhitePawn },
+        { WhiteKing, BlackKing, WhiteRook, BlackBishop },
+        { WhiteKing, BlackKing, WhiteBishop, WhiteKnight },
+        { WhiteKing, BlackKing, WhitePawn, BlackPawn },
+        { WhiteKing, BlackKing, WhiteQueen, BlackRook, WhitePawn },
+        { WhiteKing, BlackKing, WhiteRook, WhitePawn, BlackRook },
+    };
+
+    std::vector<Board> positions;
+    for (const std::vector<Piece>& material : s_Materials) {
+        std::vector<Board> random = RandomPositions(material, 2000, 0x5EED + material.size());
+        if (tablebases.ProbeWDL(random.front()))
+            positions.insert(positions.end(), random.begin(), random.end());
+    }
+
+    if (positions.empty()) {
+        std::cout << "No tables to benchmark\n";
+        return;
+    }
+
+    // The first probe of each table maps the file
+    std::vector<std::optional<WDL>> results(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+        results[i] = tablebases.ProbeWDL(positions[i]);
+
+    auto start = std::chrono::steady_clock::now();
+
+    int64_t checksum = 0;
+    for (const Board& position : positions)
+        checksum += (int32_t)tablebases.ProbeWDL(position).value_or(WDL::Draw);
+
+    auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "WDL: " << positions.size() << " probes, " << time * 1e9 / positions.size() << " ns/probe (checksum " << checksum << ")\n";
+
+    start = std::chrono::steady_clock::now();
+
+    checksum = 0;
+    for (const Board& position : positions)
+        checksum += tablebases.ProbeDTZ(position).value_or(0);
+
+    time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "DTZ: " << positions.size() << " probes, " << time * 1e9 / positions.size() << " ns/probe (checksum " << checksum << ")\n";
+
+    // All the threads share the mapped files and must agree with the single threaded results
+    const uint32_t threadCount = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    std::atomic<bool> consistent = true;
+
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < positions.size(); i += threadCount) {
+                if (tablebases.ProbeWDL(positions[i]) != results[i])
+                    consistent = false;
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << threadCount << " threads: " << positions.size() / time << " probes/s, " << (consistent ? "consistent" : "INCONSISTENT") << "\n";
+}
+
+int main(int argc, char** argv) {
+    bool passed = TestSyntheticTable();
+    std::cout << "Synthetic table: " << (passed ? "passed" : "FAILED") << "\n";
+
+    // Check against real tables
+    if (argc > 1) {
+        Syzygy::Tablebases tablebases(argv[1]);
+        std::cout << tablebases.GetTableCount() << " tables, up to " << tablebases.GetMaxPieces() << " pieces\n";
+
+        std::cout << "Known results: " << (TestKnownResults(tablebases) ? "passed" : "FAILED") << "\n";
+        Benchmark(tablebases);
+    }
+}